@@ -0,0 +1,90 @@
+#include "stdafx.h"
+#include "AllocationCounter.h"
+#include <cstdlib>
+#include <new>
+
+
+thread_local AllocationCounter::Subsystem AllocationCounter::current = AllocationCounter::OTHER;
+std::atomic<size_t> AllocationCounter::counts[AllocationCounter::SUBSYSTEM_COUNT] = {};
+std::atomic<size_t> AllocationCounter::bytes[AllocationCounter::SUBSYSTEM_COUNT] = {};
+
+size_t AllocationCounter::getTotalCount() {
+	size_t total = 0;
+	for (int subsystem = 0; subsystem < SUBSYSTEM_COUNT; subsystem++) total += getCount(static_cast<Subsystem>(subsystem));
+	return total;
+}
+
+const char* AllocationCounter::getName(Subsystem subsystem) {
+	static const char* const NAMES[SUBSYSTEM_COUNT] = { "other", "render", "input", "picking", "I/O" };
+	return (subsystem >= 0 && subsystem < SUBSYSTEM_COUNT)? NAMES[subsystem] : "";
+}
+
+
+/************************************************************************/
+/* GLOBAL ALLOCATION FUNCTIONS                                          */
+/************************************************************************/
+// Replace the default operator new and delete for the whole program, so every allocation is counted.
+// Over-aligned allocations use the library's aligned versions, which aren't counted
+
+/**
+* Allocates and counts, throwing std::bad_alloc on failure like the default operator new
+*/
+static void* countedAlloc(size_t size) {
+	AllocationCounter::record(size);
+	if (size == 0) size = 1;
+	while (true) {
+		void* memory = std::malloc(size);
+		if (memory) return memory;
+		std::new_handler handler = std::get_new_handler();
+		if (!handler) throw std::bad_alloc();
+		handler();
+	}
+}
+
+void* operator new(size_t size) {
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size) {
+	return countedAlloc(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return countedAlloc(size);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return countedAlloc(size);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+void operator delete(void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+	std::free(memory);
+}
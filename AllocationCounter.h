@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+
+/**
+* Counts heap allocations made through operator new, which AllocationCounter.cpp replaces, by the subsystem
+* that made them. The subsystem is set per thread with a Scope, so allocations can be blamed on rendering, input,
+* picking or I/O, and the frame and pick paths can be checked to not allocate at all.
+*
+* Usage:
+*	- Put an AllocationCounter::Scope scope(AllocationCounter::RENDER); at the start of a block to count its allocations as rendering.
+*	  Scopes nest, the innermost one is used
+*	- Compare getCount(subsystem) before and after an operation to get the allocations it made
+*/
+class AllocationCounter {
+
+public:
+	enum Subsystem {
+		OTHER, RENDER, INPUT, PICKING, IO, SUBSYSTEM_COUNT
+	};
+
+	/**
+	* Counts the allocations made on this thread during the block it's declared in against a subsystem
+	*/
+	class Scope {
+		Subsystem previous;
+
+	public:
+		inline Scope(Subsystem subsystem) : previous(current) { current = subsystem; }
+		inline ~Scope() { current = previous; }
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+
+protected:
+	// Subsystem allocations on this thread are counted against
+	static thread_local Subsystem current;
+	static std::atomic<size_t> counts[SUBSYSTEM_COUNT];
+	static std::atomic<size_t> bytes[SUBSYSTEM_COUNT];
+
+public:
+	/**
+	* Counts an allocation against the calling thread's current subsystem, called by operator new
+	* Parameter: size_t size  Bytes allocated
+	*/
+	static inline void record(size_t size) {
+		counts[current].fetch_add(1, std::memory_order_relaxed);
+		bytes[current].fetch_add(size, std::memory_order_relaxed);
+	}
+
+	/**
+	* Returns: size_t  Number of allocations made by a subsystem since the program started
+	*/
+	static inline size_t getCount(Subsystem subsystem) { return counts[subsystem].load(std::memory_order_relaxed); }
+	/**
+	* Returns: size_t  Bytes allocated by a subsystem since the program started
+	*/
+	static inline size_t getBytes(Subsystem subsystem) { return bytes[subsystem].load(std::memory_order_relaxed); }
+	/**
+	* Returns: size_t  Number of allocations made by every subsystem since the program started
+	*/
+	static size_t getTotalCount();
+	/**
+	* Returns: const char*  Short name of a subsystem, for display
+	*/
+	static const char* getName(Subsystem subsystem);
+};
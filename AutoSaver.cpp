@@ -0,0 +1,172 @@
+#include "stdafx.h"
+#include "AutoSaver.h"
+#include "ShapeManager.h"
+#include "SaveManager.h"
+#include "Trace.h"
+#include "AllocationCounter.h"
+#include <iostream>
+#include <cstdio>
+#ifdef _WIN32
+#include <Windows.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using std::string;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+using std::milli;
+
+
+/**
+* Flushes a file's contents from the OS cache to disk
+* Parameter: const string& file  File to flush
+* Returns: bool  True if the file was flushed
+*/
+static bool syncFile(const string& file) {
+#ifdef _WIN32
+	int fd = _open(file.c_str(), _O_RDWR | _O_BINARY);
+	if (fd < 0) return false;
+	bool success = _commit(fd) == 0;
+	_close(fd);
+#else
+	int fd = open(file.c_str(), O_RDWR);
+	if (fd < 0) return false;
+	bool success = fsync(fd) == 0;
+	close(fd);
+#endif
+	return success;
+}
+
+/**
+* Flushes a directory's entries to disk, so a file renamed into it survives a crash
+* Parameter: const string& file  File in the directory to flush
+* Returns: bool  True if the directory was flushed
+*/
+static bool syncParentDirectory(const string& file) {
+#ifdef _WIN32
+	// MoveFileEx with MOVEFILE_WRITE_THROUGH already waits for the rename to reach the disk
+	return true;
+#else
+	size_t slash = file.find_last_of('/');
+	string directory = slash == string::npos? "." : slash == 0? "/" : file.substr(0, slash);
+	int fd = open(directory.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	bool success = fsync(fd) == 0;
+	close(fd);
+	return success;
+#endif
+}
+
+/**
+* Atomically replaces target with source, so readers see either the old or the new file, never a partial one
+* Returns: bool  True if the file was replaced
+*/
+static bool replaceFile(const string& source, const string& target) {
+#ifdef _WIN32
+	// rename fails on Windows if the target exists
+	return MoveFileExA(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return std::rename(source.c_str(), target.c_str()) == 0;
+#endif
+}
+
+
+AutoSaver::AutoSaver() : lastWriteTime(0), saveCount(0) {}
+
+AutoSaver::~AutoSaver() {
+	stop();
+}
+
+void AutoSaver::start(string file, float interval) {
+	stop();
+	this->file = file;
+	this->interval = interval;
+	lastSaveTime = steady_clock::now();
+	running = true;
+	worker = std::thread(&AutoSaver::run, this);
+}
+
+void AutoSaver::stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		running = false;
+	}
+	condition.notify_one();
+	if (worker.joinable()) worker.join();
+}
+
+void AutoSaver::update(ShapeManager& shapeManager, const SceneSettings& sceneSettings) {
+	if (interval > 0 && duration<float>(steady_clock::now() - lastSaveTime).count() >= interval) {
+		requestSave(shapeManager, sceneSettings);
+	}
+}
+
+void AutoSaver::requestSave(ShapeManager& shapeManager, const SceneSettings& sceneSettings) {
+	// Only the snapshot is taken on the calling thread
+	Trace::Scope span("AutoSaver snapshot");
+	steady_clock::time_point startTime = steady_clock::now();
+	captureSnapshot.capture(shapeManager, sceneSettings);
+	lastSaveTime = steady_clock::now();
+	lastSnapshotTime = duration<double, milli>(lastSaveTime - startTime).count();
+	totalSnapshotTime += lastSnapshotTime;
+	snapshotCount++;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		// Replaces any snapshot that's still waiting to be written, since this one is newer
+		std::swap(captureSnapshot, queuedSnapshot);
+		queuedSnapshotTime = lastSnapshotTime;
+		savePending = true;
+	}
+	condition.notify_one();
+}
+
+void AutoSaver::run() {
+	Trace::setThreadName("AutoSaver");
+	// Everything this thread allocates is for saving
+	AllocationCounter::Scope allocations(AllocationCounter::IO);
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		condition.wait(lock, [this] { return savePending || !running; });
+		// Finish writing the last queued save before stopping
+		if (!savePending) break;
+		std::swap(queuedSnapshot, writeSnapshot);
+		double snapshotTime = queuedSnapshotTime;
+		savePending = false;
+
+		lock.unlock();
+		steady_clock::time_point startTime = steady_clock::now();
+		bool success = write(writeSnapshot);
+		double writeTime = duration<double, milli>(steady_clock::now() - startTime).count();
+		if (success) {
+			std::cout << "Autosaved " << writeSnapshot.size() << " shapes to " << file << " (snapshot " 
+				<< snapshotTime << "ms, write " << writeTime << "ms)" << std::endl;
+		} else {
+			std::cout << "Autosave to " << file << " failed" << std::endl;
+		}
+		lastWriteTime = writeTime;
+		lock.lock();
+	}
+}
+
+bool AutoSaver::write(const SceneSnapshot& snapshot) {
+	string tempFile = file + ".tmp";
+	if (BinarySaveManager::isBinaryFile(file)) {
+		if (!binarySaveManager.save(tempFile, snapshot)) return false;
+	} else {
+		SaveManager saveManager;
+		saveManager.startSave(tempFile);
+		snapshot.save(saveManager);
+		// Replacing the last good save with a partly written one would lose the scene
+		if (!saveManager.stopSave()) return false;
+	}
+	if (!syncFile(tempFile)) return false;
+	// Counted along with the rename, so readers holding the mutex know which file they're reading
+	std::lock_guard<std::mutex> lock(replaceMutex);
+	if (!replaceFile(tempFile, file)) return false;
+	saveCount++;
+	return syncParentDirectory(file);
+}
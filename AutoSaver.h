@@ -0,0 +1,129 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
+#include "SceneSnapshot.h"
+#include "SceneSettings.h"
+#include "BinarySaveManager.h"
+
+class ShapeManager;
+
+/**
+* Saves the scene periodically and on demand without blocking the caller for the duration of the save.
+* Files with the binary extension (see BinarySaveManager::isBinaryFile) are saved in the binary format, otherwise the text format is used.
+* The calling (UI) thread only captures a SceneSnapshot, the snapshot is then serialised, flushed to disk 
+* and atomically renamed over the target file on a background thread, so a crash mid-save never leaves a partial file.
+*
+* Usage:
+*	- Call start(file_name, interval) once
+*	- Call update(shapeManager, sceneSettings) every frame to trigger periodic saves
+*	- Call requestSave(shapeManager, sceneSettings) to save immediately
+*	- Call stop() to finish any queued save and stop the background thread
+*/
+class AutoSaver {
+
+protected:
+	// File to save to
+	std::string file;
+	// Seconds between periodic saves, 0 to only save on request
+	float interval = 0;
+	std::chrono::steady_clock::time_point lastSaveTime;
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool running = false;
+	// True when queuedSnapshot holds a snapshot the worker hasn't written yet
+	bool savePending = false;
+
+	// Snapshots are cycled between these so their allocations are reused:
+	// captureSnapshot is only used by the UI thread, writeSnapshot only by the worker and queuedSnapshot is guarded by mutex
+	SceneSnapshot captureSnapshot;
+	SceneSnapshot queuedSnapshot;
+	SceneSnapshot writeSnapshot;
+	// Only used by the worker
+	BinarySaveManager binarySaveManager;
+
+	// Timing statistics in milliseconds. The write statistics are updated by the worker
+	double lastSnapshotTime = 0;
+	double totalSnapshotTime = 0;
+	unsigned snapshotCount = 0;
+	// Snapshot time of queuedSnapshot, guarded by mutex
+	double queuedSnapshotTime = 0;
+	std::atomic<double> lastWriteTime;
+	std::atomic<unsigned> saveCount;
+	// Held while a finished save is renamed over the file and counted
+	std::mutex replaceMutex;
+
+public:
+	AutoSaver();
+	~AutoSaver();
+
+	/**
+	* Starts the background save thread
+	* Parameter: std::string file  File to save to
+	* Parameter: float interval  Seconds between periodic saves, 0 to only save on request
+	*/
+	void start(std::string file, float interval);
+	/**
+	* Sets the encoding used when saving to a binary file. Must be called before start
+	* Parameter: const BinaryEncoding& encoding  Encoding to use
+	*/
+	inline void setBinaryEncoding(const BinaryEncoding& encoding) { binarySaveManager.setEncoding(encoding); }
+	/**
+	* Writes any queued save then stops the background thread. Blocks until finished
+	*/
+	void stop();
+
+	/**
+	* Triggers a save if the periodic save interval has elapsed. Should be called every frame on the thread that edits the scene
+	* Parameter: ShapeManager& shapeManager  Shapes to save
+	* Parameter: const SceneSettings& sceneSettings  Scene settings to save
+	*/
+	void update(ShapeManager& shapeManager, const SceneSettings& sceneSettings);
+	/**
+	* Captures a snapshot of the scene and queues it to be written on the background thread. 
+	* If a previously queued snapshot hasn't been written yet, it's replaced
+	* Parameter: ShapeManager& shapeManager  Shapes to save
+	* Parameter: const SceneSettings& sceneSettings  Scene settings to save
+	*/
+	void requestSave(ShapeManager& shapeManager, const SceneSettings& sceneSettings);
+
+	/**
+	* Returns: double  Time, in milliseconds, the calling thread spent capturing the last snapshot
+	*/
+	inline double getLastSnapshotTime() { return lastSnapshotTime; }
+	/**
+	* Returns: double  Average time, in milliseconds, the calling thread has spent capturing snapshots
+	*/
+	inline double getAverageSnapshotTime() { return snapshotCount ? totalSnapshotTime / snapshotCount : 0; }
+	/**
+	* Returns: double  Time, in milliseconds, the background thread spent writing the last save
+	*/
+	inline double getLastWriteTime() { return lastWriteTime; }
+	/**
+	* Returns: unsigned  Number of saves completed
+	*/
+	inline unsigned getSaveCount() { return saveCount; }
+	/**
+	* Returns: std::mutex&  Mutex held while a save replaces the file. Code reading the file, such as tiles being paged in from it,
+	*						holds it to see one version of the file throughout, and compares getSaveCount to know if it's been replaced
+	*/
+	inline std::mutex& getReplaceMutex() { return replaceMutex; }
+
+protected:
+	/**
+	* Background thread loop, writes queued snapshots until stopped
+	*/
+	void run();
+	/**
+	* Writes a snapshot to a temporary file, flushes it to disk and renames it over the target file
+	* Parameter: const SceneSnapshot& snapshot  Snapshot to write
+	* Returns: bool  True if the file was saved successfully
+	*/
+	bool write(const SceneSnapshot& snapshot);
+};
@@ -0,0 +1,159 @@
+#include "stdafx.h"
+#include "BackgroundLoader.h"
+#include "ShapeManager.h"
+#include "SaveManager.h"
+#include "Trace.h"
+#include "AllocationCounter.h"
+
+using std::string;
+using std::vector;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+using std::milli;
+
+
+BackgroundLoader::BackgroundLoader() : cancelled(false), totalCount(0) {}
+
+BackgroundLoader::~BackgroundLoader() {
+	stop();
+}
+
+void BackgroundLoader::start(string file, const ShapeManager& shapeManager) {
+	stop();
+	this->file = file;
+	startTime = steady_clock::now();
+	cancelled = false;
+	finished = false;
+	succeeded = false;
+	totalCount = 0;
+	publishedCount = 0;
+	ordersReserved = false;
+	firstBatchTime = -1;
+	loadTime = 0;
+	loading = true;
+	worker = std::thread(&BackgroundLoader::run, this, &shapeManager);
+}
+
+bool BackgroundLoader::update(ShapeManager& shapeManager, SceneSettings& sceneSettings) {
+	if (!loading) return false;
+	vector<Shape*> batch;
+	bool done;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		// Limit how many shapes are added per update, so a backlog doesn't stall a frame
+		if (pendingShapes.size() <= PUBLISH_LIMIT) {
+			batch.swap(pendingShapes);
+		} else {
+			batch.assign(pendingShapes.begin(), pendingShapes.begin() + PUBLISH_LIMIT);
+			pendingShapes.erase(pendingShapes.begin(), pendingShapes.begin() + PUBLISH_LIMIT);
+		}
+		if (settingsPending) {
+			sceneSettings = pendingSettings;
+			settingsPending = false;
+		}
+		done = finished && pendingShapes.empty();
+	}
+
+	double elapsed = duration<double, milli>(steady_clock::now() - startTime).count();
+	if (!batch.empty()) {
+		// Stack every loaded shape below the shapes added while loading
+		if (!ordersReserved) {
+			shapeManager.reserveZOrders(totalCount);
+			ordersReserved = true;
+		}
+		shapeManager.insertOrdered(batch);
+		publishedCount += batch.size();
+		if (firstBatchTime < 0) firstBatchTime = elapsed;
+	}
+	if (done) {
+		if (worker.joinable()) worker.join();
+		loading = false;
+		loadTime = elapsed;
+		return true;
+	}
+	return false;
+}
+
+bool BackgroundLoader::finish(ShapeManager& shapeManager, SceneSettings& sceneSettings) {
+	if (!loading) return false;
+	if (worker.joinable()) worker.join();
+	while (!update(shapeManager, sceneSettings));
+	return true;
+}
+
+void BackgroundLoader::stop() {
+	cancelled = true;
+	if (worker.joinable()) worker.join();
+	for (Shape* shape : pendingShapes) delete shape;
+	pendingShapes.clear();
+	settingsPending = false;
+	loading = false;
+}
+
+void BackgroundLoader::run(const ShapeManager* shapeManager) {
+	Trace::setThreadName("BackgroundLoader");
+	Trace::Scope span("BackgroundLoader::run");
+	AllocationCounter::Scope allocations(AllocationCounter::IO);
+	const string section = "shape_manager";
+	SaveManager reader;
+	vector<Geometry> geometries;
+	vector<Shape*> batch;
+	bool success = false;
+
+	if (reader.loadIndex(file)) {
+		// Load the scene settings first, so the view is in place before the shapes arrive
+		if (reader.loadSection(file, "scene")) {
+			std::lock_guard<std::mutex> lock(mutex);
+			pendingSettings.load(reader);
+			settingsPending = true;
+		}
+		if (reader.loadSection(file, "geometry")) {
+			geometries = ShapeManager::loadGeometry(reader);
+			reader.unloadSection("geometry");
+		}
+		// Stream the shapes a batch of keys at a time, only the requested range is read from disk
+		size_t total = reader.getIndexedKeyCount(section, "shape");
+		totalCount = total;
+		success = true;
+		for (size_t first = 0; first < total && !cancelled; first += BATCH_SIZE) {
+			if (!reader.loadKeyRange(file, section, "shape", first, BATCH_SIZE)) {
+				success = false;
+				break;
+			}
+			shapeManager->createShapes(reader, section, geometries, 0, BATCH_SIZE, batch);
+			// Untiled saves are in stacking order
+			for (size_t i = 0; i < batch.size(); i++) batch[i]->setZOrder(first + i + 1);
+			queue(batch);
+		}
+	} else if (reader.load(file, 0)) {
+		// Saves without an index have to be parsed whole, the shapes are still created and published in batches
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pendingSettings.load(reader);
+			settingsPending = true;
+		}
+		geometries = ShapeManager::loadGeometry(reader);
+		size_t total = reader.getSectionKeyValues(section, "shape").size();
+		totalCount = total;
+		success = true;
+		for (size_t first = 0; first < total && !cancelled; first += BATCH_SIZE) {
+			shapeManager->createShapes(reader, section, geometries, first, BATCH_SIZE, batch);
+			for (size_t i = 0; i < batch.size(); i++) batch[i]->setZOrder(first + i + 1);
+			queue(batch);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	finished = true;
+	succeeded = success && !cancelled;
+}
+
+void BackgroundLoader::queue(vector<Shape*>& shapes) {
+	std::lock_guard<std::mutex> lock(mutex);
+	if (cancelled) {
+		for (Shape* shape : shapes) delete shape;
+	} else {
+		pendingShapes.insert(pendingShapes.end(), shapes.begin(), shapes.end());
+	}
+	shapes.clear();
+}
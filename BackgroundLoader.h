@@ -0,0 +1,123 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <atomic>
+#include "Shape.h"
+#include "SceneSettings.h"
+
+class ShapeManager;
+
+/**
+* Loads a text save on a background thread, publishing shapes to a ShapeManager in batches as they're created,
+* so the scene can be drawn and edited while a large file is still loading.
+* Saves with an index (see SaveManager) are streamed a range of shape keys at a time, older saves are parsed whole
+* then published in batches.
+*
+* Z order: loaded shapes are stacked in the order they were saved, below every shape added or brought to the front
+* while the load is running. The loaded shapes take z orders 1 to the number of saved shapes, which are freed
+* with ShapeManager::reserveZOrders before the first batch is published.
+*
+* Usage:
+*	- Call start(file_name, shapeManager) once the shape types have been added
+*	- Call update(shapeManager, sceneSettings) every frame to add the shapes loaded so far
+*	- Call finish(shapeManager, sceneSettings) to wait for the rest, or stop() to abandon the load
+*/
+class BackgroundLoader {
+
+protected:
+	std::string file;
+	std::thread worker;
+	std::mutex mutex;
+	// True from start until the last batch has been published or the load is stopped
+	bool loading = false;
+	std::atomic<bool> cancelled;
+	std::chrono::steady_clock::time_point startTime;
+
+	// Guarded by mutex: shapes created but not yet published, and loaded scene settings not yet applied
+	std::vector<Shape*> pendingShapes;
+	SceneSettings pendingSettings;
+	bool settingsPending = false;
+	// Guarded by mutex: true when the worker has finished, successfully if succeeded is set
+	bool finished = false;
+	bool succeeded = false;
+
+	// Number of shapes in the file, set by the worker before the first batch is queued
+	std::atomic<size_t> totalCount;
+	// Only used by the calling thread
+	size_t publishedCount = 0;
+	bool ordersReserved = false;
+	double firstBatchTime = -1;
+	double loadTime = 0;
+
+public:
+	// Number of shape keys parsed and created at a time
+	static const unsigned BATCH_SIZE = 4096;
+	// Most shapes added to the manager per update
+	static const unsigned PUBLISH_LIMIT = 2 * BATCH_SIZE;
+
+	BackgroundLoader();
+	~BackgroundLoader();
+
+	/**
+	* Starts loading a file on the background thread
+	* Parameter: std::string file  Text save to load
+	* Parameter: const ShapeManager& shapeManager  Manager whose shape types are used to create shapes, types mustn't be added while loading
+	*/
+	void start(std::string file, const ShapeManager& shapeManager);
+	/**
+	* Adds the shapes loaded since the last update to a manager, and applies the loaded scene settings once they're available.
+	* Should be called every frame on the thread that edits the scene
+	* Parameter: ShapeManager& shapeManager  Manager to add shapes to
+	* Parameter: SceneSettings& sceneSettings  Scene settings to replace with the loaded settings
+	* Returns: bool  True if the load finished during this update
+	*/
+	bool update(ShapeManager& shapeManager, SceneSettings& sceneSettings);
+	/**
+	* Waits for the load to finish and adds the remaining shapes. Blocks until finished
+	* Returns: bool  True if the load was running and finished during this call
+	*/
+	bool finish(ShapeManager& shapeManager, SceneSettings& sceneSettings);
+	/**
+	* Stops loading, deleting any shapes that haven't been published. Published shapes are kept
+	*/
+	void stop();
+
+	/**
+	* Returns: bool  True while the load is running or there are shapes left to publish
+	*/
+	inline bool isLoading() { return loading; }
+	/**
+	* Returns: bool  True if the file was loaded, only valid once the load has finished
+	*/
+	inline bool hasSucceeded() { return succeeded; }
+	/**
+	* Returns: size_t  Number of shapes added to the manager so far
+	*/
+	inline size_t getPublishedCount() { return publishedCount; }
+	/**
+	* Returns: size_t  Number of shapes in the file, 0 until it's known
+	*/
+	inline size_t getTotalCount() { return totalCount; }
+	/**
+	* Returns: double  Milliseconds from start until the first shapes were added to the manager, -1 if none have been
+	*/
+	inline double getFirstBatchTime() { return firstBatchTime; }
+	/**
+	* Returns: double  Milliseconds from start until the last shapes were added to the manager
+	*/
+	inline double getLoadTime() { return loadTime; }
+
+protected:
+	/**
+	* Background thread, creates shapes and queues them in batches
+	*/
+	void run(const ShapeManager* shapeManager);
+	/**
+	* Queues created shapes to be published, deleting them instead if the load has been stopped
+	*/
+	void queue(std::vector<Shape*>& shapes);
+};
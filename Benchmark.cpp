@@ -0,0 +1,91 @@
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "AllocationCounter.h"
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+
+using std::string;
+using std::vector;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+
+/**
+* Writes a string as a JSON string literal
+*/
+static void writeJsonString(std::ostream& os, const string& str) {
+	os << '"';
+	for (char c : str) {
+		if (c == '"' || c == '\\') os << '\\';
+		os << c;
+	}
+	os << '"';
+}
+
+
+Benchmark::Benchmark(double minTime, size_t minSamples) : minTime(minTime), minSamples(minSamples) {}
+
+const Benchmark::Result& Benchmark::measure(const string& name, size_t shapeCount, size_t batchSize, const std::function<void(size_t)>& operation) {
+	vector<double> samples;
+	double total = 0;
+	size_t allocations = 0;
+	while (total < minTime || samples.size() < minSamples) {
+		size_t allocationsBefore = AllocationCounter::getTotalCount();
+		steady_clock::time_point start = steady_clock::now();
+		operation(samples.size());
+		double seconds = duration<double>(steady_clock::now() - start).count();
+		allocations += AllocationCounter::getTotalCount() - allocationsBefore;
+		total += seconds;
+		samples.push_back(seconds * 1e6 / batchSize);
+	}
+
+	Result result;
+	result.name = name;
+	result.shapeCount = shapeCount;
+	result.operations = samples.size() * batchSize;
+	result.seconds = total;
+	result.opsPerSecond = result.operations / total;
+	std::sort(samples.begin(), samples.end());
+	result.mean = total * 1e6 / result.operations;
+	auto percentile = [&](double p) { return samples[std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()))]; };
+	result.p50 = percentile(0.5);
+	result.p95 = percentile(0.95);
+	result.p99 = percentile(0.99);
+	result.max = samples.back();
+	result.allocations = static_cast<double>(allocations) / result.operations;
+	results.push_back(result);
+	return results.back();
+}
+
+void Benchmark::writeJson(std::ostream& os) const {
+	os << "{\n\t\"results\": [";
+	os << std::setprecision(6);
+	for (size_t i = 0; i < results.size(); i++) {
+		const Result& result = results[i];
+		os << (i? ",\n\t\t{ " : "\n\t\t{ ") << "\"name\": ";
+		writeJsonString(os, result.name);
+		os << ", \"shapes\": " << result.shapeCount << ", \"operations\": " << result.operations
+			<< ", \"seconds\": " << result.seconds << ", \"ops_per_second\": " << result.opsPerSecond
+			<< ", \"latency_us\": { \"mean\": " << result.mean << ", \"p50\": " << result.p50 << ", \"p95\": " << result.p95
+			<< ", \"p99\": " << result.p99 << ", \"max\": " << result.max << " }, \"allocations_per_op\": " << result.allocations << " }";
+	}
+	os << "\n\t]\n}\n";
+}
+
+void Benchmark::printHeader(std::ostream& os) {
+	os << std::left << std::setw(24) << "Operation" << std::right << std::setw(10) << "Shapes" << std::setw(14) << "Ops/s"
+		<< std::setw(12) << "Mean us" << std::setw(12) << "p50" << std::setw(12) << "p95" << std::setw(12) << "p99" << std::setw(12) << "Max" << std::setw(12) << "Allocs/op" << std::endl;
+}
+
+void Benchmark::printRow(std::ostream& os, const Result& result) {
+	os << std::left << std::setw(24) << result.name << std::right << std::setw(10) << result.shapeCount
+		<< std::fixed << std::setprecision(0) << std::setw(14) << result.opsPerSecond << std::setprecision(3)
+		<< std::setw(12) << result.mean << std::setw(12) << result.p50 << std::setw(12) << result.p95
+		<< std::setw(12) << result.p99 << std::setw(12) << result.max << std::setw(12) << result.allocations << std::defaultfloat << std::endl;
+}
+
+void Benchmark::printTable(std::ostream& os) const {
+	printHeader(os);
+	for (const Result& result : results) printRow(os, result);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <ostream>
+
+/**
+* Times operations and collects their throughput and latency percentiles, for writing as JSON so results can be
+* compared between builds.
+*
+* Usage:
+*	- Call measure(name, shapeCount, batchSize, operation) for each operation, where operation runs batchSize operations
+*	- Call writeJson(stream) to write every result, or printTable(stream) for a readable summary
+*/
+class Benchmark {
+
+public:
+	/**
+	* Timings of an operation on a scene of a given size. Latencies are of a single operation, in microseconds.
+	* Allocations are the heap allocations made per operation, counted by AllocationCounter
+	*/
+	struct Result {
+		std::string name;
+		size_t shapeCount = 0;
+		size_t operations = 0;
+		double seconds = 0;
+		double opsPerSecond = 0;
+		double mean = 0, p50 = 0, p95 = 0, p99 = 0, max = 0;
+		double allocations = 0;
+	};
+
+protected:
+	std::vector<Result> results;
+	// Seconds each operation is repeated for, at least minSamples batches are always timed
+	double minTime;
+	size_t minSamples;
+
+public:
+	/**
+	* Parameter: double minTime  Seconds to repeat each operation for
+	* Parameter: size_t minSamples  Fewest batches to time, however long they take
+	*/
+	Benchmark(double minTime = 0.25, size_t minSamples = 3);
+
+	/**
+	* Times batches of an operation until minTime has passed, then stores the result
+	* Parameter: const std::string& name  Operation name
+	* Parameter: size_t shapeCount  Number of shapes in the scene the operation ran on
+	* Parameter: size_t batchSize  Number of operations each call of operation runs. Operations too fast to time
+	*	individually are run in batches, and their latency is the batch time divided by batchSize
+	* Parameter: const std::function<void(size_t)>& operation  Runs a batch, passed the index of the batch
+	* Returns: const Result&  The stored result
+	*/
+	const Result& measure(const std::string& name, size_t shapeCount, size_t batchSize, const std::function<void(size_t)>& operation);
+
+	/**
+	* Writes every result as a JSON object with a results array
+	* Parameter: std::ostream& os  Stream to write to
+	*/
+	void writeJson(std::ostream& os) const;
+	/**
+	* Writes a row per result
+	* Parameter: std::ostream& os  Stream to write to
+	*/
+	void printTable(std::ostream& os) const;
+	/**
+	* Writes the header of the table printTable writes, for printing results as they're measured
+	*/
+	static void printHeader(std::ostream& os);
+	static void printRow(std::ostream& os, const Result& result);
+
+	inline const std::vector<Result>& getResults() const { return results; }
+};
@@ -0,0 +1,413 @@
+#include "stdafx.h"
+#include "BinarySaveManager.h"
+#include "ByteStream.h"
+#include "Trace.h"
+#include "AllocationCounter.h"
+#include "RegularPolygon.h"
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include <climits>
+#include <algorithm>
+
+using std::string;
+using std::vector;
+
+static const char MAGIC[4] = { 'S', 'H', 'P', 'B' };
+static const unsigned VERSION = 1;
+static const unsigned FLAG_COMPACT = 1;
+static const unsigned FLAG_SPATIAL_INDEX = 2;
+// Quantisation steps used by the compact encoding
+static const float ROTATION_STEP = 0.01f;
+static const float SCALE_STEP = 0.001f;
+
+static_assert(sizeof(Point) == 2 * sizeof(float), "Points are read and written as pairs of floats");
+
+
+/**
+* Returns: int  Value rounded to the nearest multiple of step, clamped to the int range
+*/
+static inline int quantize(float value, float step) {
+	double steps = std::floor(value / step + 0.5);
+	if (steps > INT_MAX) return INT_MAX;
+	if (steps < INT_MIN) return INT_MIN;
+	return static_cast<int>(steps);
+}
+
+/**
+* Undoes zigzag encoding in place, so values holds the signed values
+*/
+static void unzigzag(int* values, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		unsigned value = static_cast<unsigned>(values[i]);
+		values[i] = static_cast<int>((value >> 1) ^ (0u - (value & 1)));
+	}
+}
+
+/**
+* Replaces each delta with the running total, giving the original quantized values
+*/
+static void undelta(int* values, size_t count) {
+	// Wraps around like putDeltaStream's deltas, rather than overflowing
+	unsigned total = 0;
+	for (size_t i = 0; i < count; i++) {
+		total += static_cast<unsigned>(values[i]);
+		values[i] = static_cast<int>(total);
+	}
+}
+
+/**
+* Converts quantized values back to floats, writing every stride floats from out
+*/
+static void dequantize(const int* values, size_t count, float step, float* out, size_t stride) {
+	for (size_t i = 0; i < count; i++) out[i * stride] = values[i] * step;
+}
+
+/**
+* Writes a stream of values quantized to step and delta encoded from the previous value
+* Parameter: const float* in  First value, subsequent values are read every stride floats
+*/
+static void putDeltaStream(ByteWriter& writer, const float* in, size_t count, size_t stride, float step) {
+	int previous = 0;
+	for (size_t i = 0; i < count; i++) {
+		int value = quantize(in[i * stride], step);
+		// Deltas between values far apart don't fit an int, so they're taken modulo 2^32, which undelta reverses exactly
+		writer.putSigned(static_cast<int>(static_cast<unsigned>(value) - static_cast<unsigned>(previous)));
+		previous = value;
+	}
+}
+
+/**
+* Reads a stream written by putDeltaStream, using values as a work buffer
+*/
+static void getDeltaStream(ByteReader& reader, vector<int>& values, size_t count, float step, float* out, size_t stride) {
+	values.resize(count);
+	reader.getVarints(values.data(), count);
+	unzigzag(values.data(), count);
+	undelta(values.data(), count);
+	dequantize(values.data(), count, step, out, stride);
+}
+
+static inline unsigned char packChannel(float value) {
+	if (value < 0) value = 0;
+	if (value > 1) value = 1;
+	return static_cast<unsigned char>(value * 255 + 0.5f);
+}
+
+static void putColours(ByteWriter& writer, const vector<Colour>& colours, bool compact) {
+	for (const Colour& colour : colours) {
+		if (compact) {
+			writer.put(packChannel(colour.r));
+			writer.put(packChannel(colour.g));
+			writer.put(packChannel(colour.b));
+		} else {
+			writer.put(colour.r);
+			writer.put(colour.g);
+			writer.put(colour.b);
+		}
+	}
+}
+
+static void getColours(ByteReader& reader, vector<Colour>& colours, bool compact) {
+	if (compact) {
+		if (reader.remaining() / 3 < colours.size()) {
+			reader.ok = false;
+			return;
+		}
+		for (Colour& colour : colours) {
+			colour.r = reader.pos[0] / 255.f;
+			colour.g = reader.pos[1] / 255.f;
+			colour.b = reader.pos[2] / 255.f;
+			reader.pos += 3;
+		}
+	} else {
+		for (Colour& colour : colours) {
+			colour.r = reader.get<float>();
+			colour.g = reader.get<float>();
+			colour.b = reader.get<float>();
+		}
+	}
+}
+
+/**
+* Reads a saved spatial index
+* Returns: bool  False if the index is truncated or inconsistent
+*/
+static bool getSpatialIndex(ByteReader& reader, SpatialIndexNodes& nodes) {
+	nodes.clear();
+	float cellSize = reader.get<float>();
+	size_t cells = reader.getVarint();
+	// Each cell takes at least three bytes
+	if (!reader.ok || !(cellSize > 0) || cells > reader.remaining() / 3) return false;
+	nodes.cellSize = cellSize;
+	nodes.cellX.resize(cells);
+	nodes.cellY.resize(cells);
+	nodes.cellStarts.resize(cells + 1);
+	int x = 0, y = 0;
+	size_t total = 0;
+	for (size_t cell = 0; cell < cells; cell++) {
+		x += reader.getSigned();
+		y += reader.getSigned();
+		nodes.cellX[cell] = x;
+		nodes.cellY[cell] = y;
+		nodes.cellStarts[cell] = total;
+		total += reader.getVarint();
+		// Every index takes at least one byte
+		if (!reader.ok || total > reader.remaining()) return false;
+	}
+	nodes.cellStarts[cells] = total;
+	nodes.shapes.resize(total);
+	for (size_t cell = 0; cell < cells; cell++) {
+		unsigned index = 0;
+		for (unsigned i = nodes.cellStarts[cell]; i < nodes.cellStarts[cell + 1]; i++) {
+			index += reader.getVarint();
+			nodes.shapes[i] = index;
+		}
+	}
+	return reader.ok;
+}
+
+
+BinarySaveManager::BinarySaveManager() {}
+
+bool BinarySaveManager::isBinaryFile(const string& file) {
+	const string extension = ".bin";
+	return file.size() >= extension.size() && file.compare(file.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+/************************************************************************/
+/* SAVING                                                               */
+/************************************************************************/
+
+bool BinarySaveManager::save(string file, const SceneSnapshot& snapshot) {
+	Trace::Scope span("BinarySaveManager::save");
+	AllocationCounter::Scope allocations(AllocationCounter::IO);
+	// Tiles that aren't loaded can only be copied between text saves
+	if (!snapshot.sourceTiles.empty()) return false;
+	buffer.clear();
+	ByteWriter writer(buffer);
+	bool compact = encoding.compact;
+	float precision = encoding.precision;
+	size_t count = snapshot.size();
+
+	// Header
+	writer.put(MAGIC);
+	writer.put(VERSION);
+	writer.put((compact? FLAG_COMPACT : 0u) | FLAG_SPATIAL_INDEX);
+	writer.put(precision);
+
+	// Scene
+	writer.put(snapshot.settings.zoom);
+	writer.put(snapshot.settings.panX);
+	writer.put(snapshot.settings.panY);
+
+	// Name table
+	size_t shapesStart = buffer.size();
+	vector<string> names;
+	vector<unsigned> nameIndices(count);
+	for (size_t i = 0; i < count; i++) {
+		// Scenes only use a handful of names, so a linear search is quicker than a map
+		auto name = std::find(names.begin(), names.end(), snapshot.names[i]);
+		nameIndices[i] = name - names.begin();
+		if (name == names.end()) names.push_back(snapshot.names[i]);
+	}
+	writer.putVarint(names.size());
+	for (const auto& name : names) writer.putString(name);
+
+	// Geometry dictionary
+	SceneSnapshot::GeometryDictionary dictionary;
+	snapshot.buildGeometryDictionary(dictionary);
+	vector<Point> vertices;
+	writer.putVarint(dictionary.entries.size());
+	for (const auto& entry : dictionary.entries) {
+		writer.putVarint(entry->size());
+		vertices.insert(vertices.end(), entry->begin(), entry->end());
+	}
+	if (compact) {
+		putDeltaStream(writer, reinterpret_cast<float*>(vertices.data()), vertices.size(), 2, precision);
+		putDeltaStream(writer, reinterpret_cast<float*>(vertices.data()) + 1, vertices.size(), 2, precision);
+	} else {
+		for (const Point& vertex : vertices) writer.put<Point, float>(vertex);
+	}
+
+	// Shape streams
+	writer.putVarint(count);
+	if (compact) {
+		for (unsigned index : nameIndices) writer.putVarint(index);
+		for (int edges : snapshot.numEdges) writer.putVarint(edges);
+		putDeltaStream(writer, snapshot.radii.data(), count, 1, precision);
+		// Entry index + 1, so shapes without geometry are 0
+		for (int entry : dictionary.shapeEntries) writer.putVarint(entry + 1);
+		putDeltaStream(writer, reinterpret_cast<const float*>(snapshot.positions.data()), count, 2, precision);
+		putDeltaStream(writer, reinterpret_cast<const float*>(snapshot.positions.data()) + 1, count, 2, precision);
+		for (float rotation : snapshot.rotations) writer.putSigned(quantize(rotation, ROTATION_STEP));
+		putDeltaStream(writer, snapshot.scales.data(), count, 1, SCALE_STEP);
+	} else {
+		for (unsigned index : nameIndices) writer.put(index);
+		for (int edges : snapshot.numEdges) writer.put(edges);
+		for (float radius : snapshot.radii) writer.put(radius);
+		for (int entry : dictionary.shapeEntries) writer.put(entry);
+		for (const Point& position : snapshot.positions) writer.put<Point, float>(position);
+		for (float rotation : snapshot.rotations) writer.put(rotation);
+		for (float scale : snapshot.scales) writer.put(scale);
+	}
+	putColours(writer, snapshot.colours, compact);
+	putColours(writer, snapshot.outlineColours, compact);
+
+	// Spatial index, followed by a checksum of everything from the name table so it's only used with the shapes it was built from
+	SpatialIndex::buildNodes(snapshot, SpatialIndex::DEFAULT_CELL_SIZE, nodes);
+	writer.put(nodes.cellSize);
+	writer.putVarint(nodes.size());
+	int previousX = 0, previousY = 0;
+	for (size_t cell = 0; cell < nodes.size(); cell++) {
+		// Cells are sorted by x, then y
+		writer.putSigned(nodes.cellX[cell] - previousX);
+		writer.putSigned(nodes.cellY[cell] - previousY);
+		previousX = nodes.cellX[cell];
+		previousY = nodes.cellY[cell];
+		writer.putVarint(nodes.cellStarts[cell + 1] - nodes.cellStarts[cell]);
+	}
+	for (size_t cell = 0; cell < nodes.size(); cell++) {
+		// Shape indices are ascending within each cell
+		unsigned previous = 0;
+		for (unsigned i = nodes.cellStarts[cell]; i < nodes.cellStarts[cell + 1]; i++) {
+			writer.putVarint(nodes.shapes[i] - previous);
+			previous = nodes.shapes[i];
+		}
+	}
+	writer.put(Utils::checksum(buffer.data() + shapesStart, buffer.size() - shapesStart));
+
+	std::ofstream os(file, std::ios::binary);
+	os.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	os.close();
+	return !os.fail();
+}
+
+/************************************************************************/
+/* LOADING                                                              */
+/************************************************************************/
+
+bool BinarySaveManager::load(string file, SceneSnapshot& snapshot) {
+	Trace::Scope span("BinarySaveManager::load");
+	AllocationCounter::Scope allocations(AllocationCounter::IO);
+	snapshot.clear();
+	std::ifstream is(file, std::ios::binary);
+	if (!is) return false;
+	is.seekg(0, std::ios::end);
+	buffer.resize(static_cast<size_t>(is.tellg()));
+	is.seekg(0, std::ios::beg);
+	is.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+	is.close();
+	ByteReader reader(buffer.data(), buffer.data() + buffer.size());
+
+	// Header
+	char magic[4];
+	reader.getArray(magic, 4);
+	if (!reader.ok || memcmp(magic, MAGIC, 4) != 0 || reader.get<unsigned>() != VERSION) return false;
+	unsigned flags = reader.get<unsigned>();
+	bool compact = (flags & FLAG_COMPACT) != 0;
+	float precision = reader.get<float>();
+
+	// Scene
+	snapshot.settings.zoom = reader.get<float>();
+	snapshot.settings.panX = reader.get<int>();
+	snapshot.settings.panY = reader.get<int>();
+
+	// Name table
+	const unsigned char* shapesStart = reader.pos;
+	vector<string> names(reader.getVarint());
+	if (names.size() > reader.remaining()) return false;
+	for (auto& name : names) name = reader.getString();
+
+	// Geometry dictionary
+	vector<unsigned> entrySizes(reader.getVarint());
+	if (entrySizes.size() > reader.remaining()) return false;
+	size_t vertexCount = 0;
+	for (auto& size : entrySizes) {
+		size = reader.getVarint();
+		vertexCount += size;
+	}
+	if (!reader.ok || vertexCount > reader.remaining()) return false;
+	vector<Point> vertices(vertexCount);
+	if (compact) {
+		getDeltaStream(reader, values, vertexCount, precision, reinterpret_cast<float*>(vertices.data()), 2);
+		getDeltaStream(reader, values, vertexCount, precision, reinterpret_cast<float*>(vertices.data()) + 1, 2);
+	} else {
+		reader.getArray<Point, float>(vertices.data(), vertexCount);
+	}
+	vector<Geometry> entries;
+	entries.reserve(entrySizes.size());
+	vector<Point>::iterator entryStart = vertices.begin();
+	for (unsigned size : entrySizes) {
+		entries.push_back(std::make_shared<const vector<Point>>(entryStart, entryStart + size));
+		entryStart += size;
+	}
+
+	// Shape streams, every stream has at least one byte per shape
+	size_t count = reader.getVarint();
+	if (!reader.ok || count > reader.remaining()) return false;
+	snapshot.names.resize(count);
+	snapshot.numEdges.resize(count);
+	snapshot.radii.resize(count);
+	snapshot.geometries.resize(count);
+	snapshot.positions.resize(count);
+	snapshot.rotations.resize(count);
+	snapshot.scales.resize(count);
+	snapshot.colours.resize(count);
+	snapshot.outlineColours.resize(count);
+	vector<int> nameIndices(count);
+	vector<int> entryIndices(count);
+	if (compact) {
+		reader.getVarints(nameIndices.data(), count);
+		reader.getVarints(snapshot.numEdges.data(), count);
+		getDeltaStream(reader, values, count, precision, snapshot.radii.data(), 1);
+		reader.getVarints(entryIndices.data(), count);
+		for (auto& entry : entryIndices) entry--;
+		getDeltaStream(reader, values, count, precision, reinterpret_cast<float*>(snapshot.positions.data()), 2);
+		getDeltaStream(reader, values, count, precision, reinterpret_cast<float*>(snapshot.positions.data()) + 1, 2);
+		values.resize(count);
+		reader.getVarints(values.data(), count);
+		unzigzag(values.data(), count);
+		dequantize(values.data(), count, ROTATION_STEP, snapshot.rotations.data(), 1);
+		getDeltaStream(reader, values, count, SCALE_STEP, snapshot.scales.data(), 1);
+	} else {
+		reader.getArray(nameIndices.data(), count);
+		reader.getArray(snapshot.numEdges.data(), count);
+		reader.getArray(snapshot.radii.data(), count);
+		reader.getArray(entryIndices.data(), count);
+		reader.getArray<Point, float>(snapshot.positions.data(), count);
+		reader.getArray(snapshot.rotations.data(), count);
+		reader.getArray(snapshot.scales.data(), count);
+	}
+	getColours(reader, snapshot.colours, compact);
+	getColours(reader, snapshot.outlineColours, compact);
+	if (!reader.ok) {
+		snapshot.clear();
+		return false;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		if (nameIndices[i] < 0 || nameIndices[i] >= static_cast<int>(names.size()) || entryIndices[i] >= static_cast<int>(entries.size())) {
+			snapshot.clear();
+			return false;
+		}
+		// Corrupt edge counts would create enormous polygons, and non-finite transforms can't be drawn or indexed
+		bool validEdges = snapshot.numEdges[i] == 0 || RegularPolygon::isValid(snapshot.numEdges[i], snapshot.radii[i]);
+		const Point& position = snapshot.positions[i];
+		if (!validEdges || !std::isfinite(snapshot.scales[i]) || !std::isfinite(snapshot.rotations[i]) 
+			|| !std::isfinite(position.x) || !std::isfinite(position.y)) {
+			snapshot.clear();
+			return false;
+		}
+		snapshot.names[i] = names[nameIndices[i]];
+		if (entryIndices[i] >= 0) snapshot.geometries[i] = entries[entryIndices[i]];
+	}
+
+	// The shapes are usable without the spatial index, so a missing or invalid index only means it has to be rebuilt
+	if (flags & FLAG_SPATIAL_INDEX) {
+		bool valid = getSpatialIndex(reader, snapshot.spatialIndex);
+		unsigned long long checksum = Utils::checksum(shapesStart, reader.pos - shapesStart);
+		if (!valid || reader.get<unsigned long long>() != checksum || !reader.ok) snapshot.spatialIndex.clear();
+	}
+	return true;
+}
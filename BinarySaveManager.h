@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "SceneSnapshot.h"
+
+/**
+* Settings for how BinarySaveManager encodes shape data
+*/
+struct BinaryEncoding {
+	// True to quantize and delta encode values, false to store them as 32 bit floats
+	bool compact = false;
+	// Step, in pixels, that positions, radii and vertices are rounded to when compact
+	float precision = 0.01f;
+};
+
+/**
+* Loads and saves scenes in a binary format, which is much smaller and quicker to load than SaveManager's text format.
+* Shape properties are stored as one stream per property (struct of arrays), matching SceneSnapshot.
+*
+* Layout (all values little endian, see ByteStream):
+*	header		"SHPB", format version, encoding flags and precision
+*	scene		zoom, pan x, pan y
+*	names		table of distinct shape names, shapes reference them by index
+*	geometry	distinct non parametric vertex lists (see SceneSnapshot::buildGeometryDictionary), shapes reference them by index
+*	shapes		shape count followed by one stream per property
+*	index		spatial index cells (see SpatialIndex) and the shapes in each
+*	checksum	checksum of everything from the names to the index, so the index is only restored 
+*				if it and the shapes are as saved. Otherwise it's rebuilt after loading
+*
+* Compact encoding:
+*	- Positions, radii and vertices are quantized to a multiple of the precision and delta encoded from the previous value
+*	- Rotation is quantized to 1/100 of a degree and scale to 1/1000
+*	- Quantized values are stored as zigzag varints, so small (delta) values only take one or two bytes
+*	- Colours are packed to 8 bits per channel
+*	Each stream is decoded in passes: the varints are unpacked into an integer array first, then deltas are summed 
+*	and converted back to floats in separate flat loops, which the compiler can vectorise.
+*	Quantized positions must be within +-2^31 precision steps of the origin
+*/
+class BinarySaveManager {
+
+protected:
+	BinaryEncoding encoding;
+	// Buffers reused between saves and loads
+	std::vector<unsigned char> buffer;
+	std::vector<int> values;
+	SpatialIndexNodes nodes;
+
+public:
+	BinarySaveManager();
+
+	/**
+	* Parameter: const BinaryEncoding& newEncoding  Encoding to use for future saves. Files are loaded using the encoding they were saved with
+	*/
+	inline void setEncoding(const BinaryEncoding& newEncoding) { encoding = newEncoding; }
+	/**
+	* Returns: const BinaryEncoding&  Encoding used for saving
+	*/
+	inline const BinaryEncoding& getEncoding() { return encoding; }
+
+	/**
+	* Saves a snapshot to a binary file. Shapes are saved untiled in the order they're in the snapshot
+	* Parameter: std::string file  File to write to
+	* Parameter: const SceneSnapshot& snapshot  Scene to save
+	* Returns: bool  True if the file was written successfully, false if it failed or the snapshot references tiles in another file
+	*/
+	bool save(std::string file, const SceneSnapshot& snapshot);
+	/**
+	* Loads a binary file into a snapshot. Parametric shapes have null geometry, as they're recreated from their parameters
+	* Parameter: std::string file  File to load
+	* Parameter: SceneSnapshot& snapshot  Snapshot to load into, replacing any previous contents
+	* Returns: bool  True if the file was a valid binary save and loaded successfully
+	*/
+	bool load(std::string file, SceneSnapshot& snapshot);
+
+	/**
+	* Parameter: const std::string& file  File name to check
+	* Returns: bool  True if the file name has the binary save extension (.bin)
+	*/
+	static bool isBinaryFile(const std::string& file);
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+/**
+* Byte buffer readers and writers shared by the binary file formats (see BinarySaveManager and InputRecorder).
+* Multi-byte values are written little endian whatever the machine's byte order, so files can be read on any machine. 
+* Variable length integers (varints) are written 7 bits per byte
+*/
+
+// True if the machine stores values little endian, so they're copied without swapping. MSVC only targets little endian machines
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr bool LITTLE_ENDIAN_MACHINE = false;
+#else
+constexpr bool LITTLE_ENDIAN_MACHINE = true;
+#endif
+
+/**
+* Type of the fields a value is swapped between byte orders by: numbers as a whole and arrays by element. 
+* Structs must give theirs, e.g. float for a Point
+*/
+template <typename T>
+using ByteWord = typename std::conditional<std::is_class<T>::value, void, typename std::remove_all_extents<T>::type>::type;
+
+/**
+* Reverses the bytes of each Word in a buffer, converting between little endian and the machine's byte order.
+* Does nothing on little endian machines
+* Parameter: unsigned char* data  Values to convert
+* Parameter: size_t size  Size of the values in bytes, a multiple of the Word size
+*/
+template <typename Word>
+inline void swapWords(unsigned char* data, size_t size) {
+	static_assert(!std::is_void<Word>::value, "Give the type of the fields the struct is made of");
+	if (LITTLE_ENDIAN_MACHINE || sizeof(Word) == 1) return;
+	for (size_t i = 0; i < size; i += sizeof(Word)) std::reverse(data + i, data + i + sizeof(Word));
+}
+
+/**
+* Appends values to a byte buffer
+*/
+struct ByteWriter {
+	std::vector<unsigned char>& bytes;
+
+	ByteWriter(std::vector<unsigned char>& bytes) : bytes(bytes) {}
+
+	// Writes a value little endian. Word is the type of the fields it's made of, see ByteWord
+	template <typename T, typename Word = ByteWord<T>>
+	void put(const T& value) {
+		size_t start = bytes.size();
+		const unsigned char* data = reinterpret_cast<const unsigned char*>(&value);
+		bytes.insert(bytes.end(), data, data + sizeof(T));
+		swapWords<Word>(&bytes[start], sizeof(T));
+	}
+	// Writes 7 bits per byte, with the top bit set if more bytes follow
+	void putVarint(unsigned value) {
+		while (value >= 0x80) {
+			bytes.push_back(static_cast<unsigned char>(value | 0x80));
+			value >>= 7;
+		}
+		bytes.push_back(static_cast<unsigned char>(value));
+	}
+	// Zigzag encodes a signed value so small negative values are also small varints
+	void putSigned(int value) {
+		putVarint((static_cast<unsigned>(value) << 1) ^ static_cast<unsigned>(value >> 31));
+	}
+	void putString(const std::string& str) {
+		putVarint(str.size());
+		bytes.insert(bytes.end(), str.begin(), str.end());
+	}
+};
+
+/**
+* Reads values from a byte buffer. Reading past the end of the buffer clears ok rather than reading out of bounds
+*/
+struct ByteReader {
+	const unsigned char* pos;
+	const unsigned char* end;
+	bool ok = true;
+
+	ByteReader(const unsigned char* begin, const unsigned char* end) : pos(begin), end(end) {}
+
+	inline size_t remaining() { return end - pos; }
+
+	// Reads a little endian value. Word is the type of the fields it's made of, see ByteWord
+	template <typename T, typename Word = ByteWord<T>>
+	T get() {
+		T value = T();
+		if (remaining() < sizeof(T)) {
+			ok = false;
+			pos = end;
+			return value;
+		}
+		memcpy(&value, pos, sizeof(T));
+		swapWords<Word>(reinterpret_cast<unsigned char*>(&value), sizeof(T));
+		pos += sizeof(T);
+		return value;
+	}
+	// Reads count little endian values straight into out
+	template <typename T, typename Word = ByteWord<T>>
+	void getArray(T* out, size_t count) {
+		if (remaining() / sizeof(T) < count) {
+			ok = false;
+			pos = end;
+			return;
+		}
+		memcpy(out, pos, count * sizeof(T));
+		swapWords<Word>(reinterpret_cast<unsigned char*>(out), count * sizeof(T));
+		pos += count * sizeof(T);
+	}
+	unsigned getVarint() {
+		unsigned value = 0;
+		for (int shift = 0; shift < 35 && pos < end; shift += 7) {
+			unsigned char byte = *pos++;
+			value |= static_cast<unsigned>(byte & 0x7F) << shift;
+			if (!(byte & 0x80)) return value;
+		}
+		ok = false;
+		return value;
+	}
+	int getSigned() {
+		unsigned value = getVarint();
+		return static_cast<int>((value >> 1) ^ (0u - (value & 1)));
+	}
+	// Unpacks count varints into out, as the first pass of decoding a stream
+	void getVarints(int* out, size_t count) {
+		for (size_t i = 0; i < count && ok; i++) out[i] = static_cast<int>(getVarint());
+	}
+	std::string getString() {
+		unsigned size = getVarint();
+		if (remaining() < size) {
+			ok = false;
+			return "";
+		}
+		std::string str(reinterpret_cast<const char*>(pos), size);
+		pos += size;
+		return str;
+	}
+};
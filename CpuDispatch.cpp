@@ -0,0 +1,602 @@
+#include "stdafx.h"
+#include "CpuDispatch.h"
+#include "TransformBatch.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DISPATCH_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit instructions past SSE2 in functions marked for them, MSVC emits them anywhere.
+// Multiplies and adds mustn't be fused, so they round the same as the scalar kernels: AVX2 is enabled without FMA,
+// and CMakeLists.txt turns contraction off for this file as AVX-512F includes FMA
+#if defined(DISPATCH_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define TARGET_AVX2
+#define TARGET_AVX512
+#endif
+
+static_assert(sizeof(Point) == 2 * sizeof(float), "Vertices are loaded as pairs of floats");
+
+
+/************************************************************************/
+/* SCALAR KERNELS                                                       */
+/************************************************************************/
+// The reference implementations, and the tails of the vector kernels. The vector kernels evaluate the same expressions
+// in the same order, so their results are identical
+
+/**
+* world = position + (x * a - y * b, x * b + y * a)
+*/
+static inline void transformScalar(const Point* in, size_t count, const ShapeTransform& t, Point* out) {
+	for (size_t i = 0; i < count; i++) {
+		out[i].x = t.x + (in[i].x * t.a - in[i].y * t.b);
+		out[i].y = t.y + (in[i].x * t.b + in[i].y * t.a);
+	}
+}
+
+/**
+* Returns: bool  True if the horizontal ray right of (x, y) crosses the edge from b to a
+*/
+static inline bool crossesEdge(const Point& a, const Point& b, float x, float y) {
+	return ((a.y > y) != (b.y > y)) && (x < (b.x - a.x) * (y - a.y) / (b.y - a.y) + a.x);
+}
+
+/**
+* PNPOLY by Wm. Randolph Franklin (https://www.ecse.rpi.edu/Homepages/wrf/Research/Short_Notes/pnpoly.html),
+* counting the edges crossed by a horizontal ray to the right of the point. An odd count is inside
+*/
+static bool pointInPolygonScalar(const Point* vertices, size_t count, float x, float y) {
+	bool inside = false;
+	for (size_t i = 0, j = count - 1; i < count; j = i++) {
+		if (crossesEdge(vertices[i], vertices[j], x, y)) inside = !inside;
+	}
+	return inside;
+}
+
+static void pointsInPolygonScalar(const Point* vertices, size_t count, const float* xs, const float* ys, size_t pointCount, unsigned char* inside) {
+	for (size_t i = 0; i < pointCount; i++) inside[i] = pointInPolygonScalar(vertices, count, xs[i], ys[i]);
+}
+
+/**
+* Widens bounds to include vertices
+*/
+static inline void extendBounds(const Point* vertices, size_t count, Point& min, Point& max) {
+	for (size_t i = 0; i < count; i++) {
+		if (vertices[i].x < min.x) min.x = vertices[i].x;
+		if (vertices[i].x > max.x) max.x = vertices[i].x;
+		if (vertices[i].y < min.y) min.y = vertices[i].y;
+		if (vertices[i].y > max.y) max.y = vertices[i].y;
+	}
+}
+
+static void boundsScalar(const Point* vertices, size_t count, Point& min, Point& max) {
+	min = max = vertices[0];
+	extendBounds(vertices + 1, count - 1, min, max);
+}
+
+static inline void fillPixelsScalar(unsigned char* pixels, size_t count, const unsigned char* rgb) {
+	for (size_t i = 0; i < count; i++, pixels += 3) {
+		pixels[0] = rgb[0];
+		pixels[1] = rgb[1];
+		pixels[2] = rgb[2];
+	}
+}
+
+/**
+* Returns: bool  True if c can start a number std::strtof reads, other than infinity, NaN and hex numbers which saves don't use
+*/
+static inline bool startsNumber(char c) {
+	return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.';
+}
+
+/**
+* Reads numbers with a function that reads one, returning the end of the number it read or its start if there wasn't one
+*/
+template <typename ParseOne>
+static inline size_t parseFloatsWith(const char* begin, const char* end, float* values, size_t count, ParseOne parseOne) {
+	size_t read = 0;
+	const char* pos = begin;
+	while (read < count && pos < end) {
+		if (!startsNumber(*pos)) {
+			pos++;
+			continue;
+		}
+		const char* next = parseOne(pos, end, values[read]);
+		if (next == pos) pos++;
+		else {
+			read++;
+			pos = next;
+		}
+	}
+	return read;
+}
+
+static inline const char* parseFloatScalar(const char* pos, const char*, float& value) {
+	char* next;
+	value = std::strtof(pos, &next);
+	return next;
+}
+
+static size_t parseFloatsScalar(const char* begin, const char* end, float* values, size_t count) {
+	return parseFloatsWith(begin, end, values, count, parseFloatScalar);
+}
+
+
+#ifdef DISPATCH_X86
+/************************************************************************/
+/* SSE2 KERNELS                                                         */
+/************************************************************************/
+// Points are pairs of floats, so vertices load as [x0 y0 x1 y1 ...]. Transforms multiply by [a a ...] and the swapped
+// pairs [y0 x0 ...] by [-b b ...], edge tests split the pairs into vectors of xs and ys
+
+static void transformSse2(const Point* in, size_t count, const ShapeTransform& t, Point* out) {
+	const float* src = reinterpret_cast<const float*>(in);
+	float* dst = reinterpret_cast<float*>(out);
+	const __m128 a = _mm_set1_ps(t.a);
+	const __m128 b = _mm_setr_ps(-t.b, t.b, -t.b, t.b);
+	const __m128 position = _mm_setr_ps(t.x, t.y, t.x, t.y);
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128 xy = _mm_loadu_ps(src + i * 2);
+		__m128 yx = _mm_shuffle_ps(xy, xy, _MM_SHUFFLE(2, 3, 0, 1));
+		_mm_storeu_ps(dst + i * 2, _mm_add_ps(position, _mm_add_ps(_mm_mul_ps(xy, a), _mm_mul_ps(yx, b))));
+	}
+	transformScalar(in + i, count - i, t, out + i);
+}
+
+/**
+* Returns: int  Bit mask of the 4 edges from b to a the ray crosses, given their xs and ys
+*/
+static inline int crossesEdgesSse2(__m128 ax, __m128 ay, __m128 bx, __m128 by, __m128 x, __m128 y) {
+	__m128 spans = _mm_xor_ps(_mm_cmpgt_ps(ay, y), _mm_cmpgt_ps(by, y));
+	__m128 crossX = _mm_add_ps(_mm_div_ps(_mm_mul_ps(_mm_sub_ps(bx, ax), _mm_sub_ps(y, ay)), _mm_sub_ps(by, ay)), ax);
+	return _mm_movemask_ps(_mm_and_ps(spans, _mm_cmplt_ps(x, crossX)));
+}
+
+/**
+* Returns: int  Number of set bits
+*/
+static inline int countBits(unsigned mask) {
+	int bits = 0;
+	for (; mask; mask &= mask - 1) bits++;
+	return bits;
+}
+
+static bool pointInPolygonSse2(const Point* vertices, size_t count, float x, float y) {
+	// The closing edge first, then edge i from vertex i - 1 to i, so both ends load contiguously
+	bool inside = crossesEdge(vertices[0], vertices[count - 1], x, y);
+	const float* src = reinterpret_cast<const float*>(vertices);
+	const __m128 px = _mm_set1_ps(x);
+	const __m128 py = _mm_set1_ps(y);
+	int crossings = 0;
+	size_t i = 1;
+	for (; i + 4 <= count; i += 4) {
+		__m128 a0 = _mm_loadu_ps(src + i * 2), a1 = _mm_loadu_ps(src + i * 2 + 4);
+		__m128 b0 = _mm_loadu_ps(src + i * 2 - 2), b1 = _mm_loadu_ps(src + i * 2 + 2);
+		crossings += countBits(crossesEdgesSse2(_mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1)),
+			_mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1)), px, py));
+	}
+	for (; i < count; i++) crossings += crossesEdge(vertices[i], vertices[i - 1], x, y);
+	return inside != ((crossings & 1) != 0);
+}
+
+/**
+* Tests 4 points at a time, against one edge at a time
+*/
+static void pointsInPolygonSse2(const Point* vertices, size_t count, const float* xs, const float* ys, size_t pointCount, unsigned char* inside) {
+	size_t p = 0;
+	for (; p + 4 <= pointCount; p += 4) {
+		__m128 x = _mm_loadu_ps(xs + p), y = _mm_loadu_ps(ys + p);
+		__m128 crossed = _mm_setzero_ps();
+		for (size_t i = 0, j = count - 1; i < count; j = i++) {
+			const Point& a = vertices[i];
+			const Point& b = vertices[j];
+			__m128 ax = _mm_set1_ps(a.x), ay = _mm_set1_ps(a.y);
+			__m128 spans = _mm_xor_ps(_mm_cmpgt_ps(ay, y), _mm_cmpgt_ps(_mm_set1_ps(b.y), y));
+			__m128 crossX = _mm_add_ps(_mm_div_ps(_mm_mul_ps(_mm_set1_ps(b.x - a.x), _mm_sub_ps(y, ay)), _mm_set1_ps(b.y - a.y)), ax);
+			crossed = _mm_xor_ps(crossed, _mm_and_ps(spans, _mm_cmplt_ps(x, crossX)));
+		}
+		int mask = _mm_movemask_ps(crossed);
+		for (int k = 0; k < 4; k++) inside[p + k] = (mask >> k) & 1;
+	}
+	pointsInPolygonScalar(vertices, count, xs + p, ys + p, pointCount - p, inside + p);
+}
+
+static void boundsSse2(const Point* vertices, size_t count, Point& min, Point& max) {
+	const float* src = reinterpret_cast<const float*>(vertices);
+	__m128 first = _mm_setr_ps(vertices[0].x, vertices[0].y, vertices[0].x, vertices[0].y);
+	__m128 lower = first, upper = first;
+	size_t i = 0;
+	for (; i + 2 <= count; i += 2) {
+		__m128 xy = _mm_loadu_ps(src + i * 2);
+		lower = _mm_min_ps(lower, xy);
+		upper = _mm_max_ps(upper, xy);
+	}
+	lower = _mm_min_ps(lower, _mm_movehl_ps(lower, lower));
+	upper = _mm_max_ps(upper, _mm_movehl_ps(upper, upper));
+	min = Point(_mm_cvtss_f32(lower), _mm_cvtss_f32(_mm_shuffle_ps(lower, lower, 1)));
+	max = Point(_mm_cvtss_f32(upper), _mm_cvtss_f32(_mm_shuffle_ps(upper, upper, 1)));
+	extendBounds(vertices + i, count - i, min, max);
+}
+
+/**
+* Fills a pattern of bytes with repeats of a colour, so whole vectors of pixels can be stored at once
+* Parameter: unsigned char* pattern  Bytes to fill, a multiple of 3
+*/
+static inline void fillPattern(unsigned char* pattern, size_t bytes, const unsigned char* rgb) {
+	for (size_t i = 0; i < bytes; i++) pattern[i] = rgb[i % 3];
+}
+
+static void fillPixelsSse2(unsigned char* pixels, size_t count, const unsigned char* rgb) {
+	// 16 pixels are 3 vectors
+	alignas(16) unsigned char pattern[48];
+	fillPattern(pattern, sizeof(pattern), rgb);
+	const __m128i* vectors = reinterpret_cast<const __m128i*>(pattern);
+	__m128i p0 = _mm_load_si128(vectors), p1 = _mm_load_si128(vectors + 1), p2 = _mm_load_si128(vectors + 2);
+	size_t i = 0;
+	for (; i + 16 <= count; i += 16) {
+		__m128i* dst = reinterpret_cast<__m128i*>(pixels + i * 3);
+		_mm_storeu_si128(dst, p0);
+		_mm_storeu_si128(dst + 1, p1);
+		_mm_storeu_si128(dst + 2, p2);
+	}
+	fillPixelsScalar(pixels + i * 3, count - i, rgb);
+}
+
+/**
+* Reads a number, finding its digits 16 characters at a time. Numbers with up to 7 significant digits, a fraction of up to
+* 10 digits and no exponent are converted exactly: the digits and the power of ten are both exact floats, so dividing
+* them rounds once, to the same nearest float std::strtof gives. Anything else is left to std::strtof
+*/
+static const char* parseFloatSse2(const char* pos, const char* end, float& value) {
+	static const float POWERS[] = { 1, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+	// Load from a copy near the end of the text, so the load doesn't read past it
+	char padded[16];
+	const char* text = pos;
+	if (end - pos < 16) {
+		std::memset(padded, 0, sizeof(padded));
+		std::memcpy(padded, pos, end - pos);
+		text = padded;
+	}
+	__m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+	// Digits are '0' to '9', which are the characters that are unchanged by clamping their offset from '0' to 9
+	__m128i offsets = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+	unsigned digits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(offsets, _mm_set1_epi8(9)), offsets));
+	unsigned points = _mm_movemask_epi8(_mm_cmpeq_epi8(chars, _mm_set1_epi8('.')));
+
+	bool negative = text[0] == '-';
+	unsigned start = (text[0] == '-' || text[0] == '+')? 1 : 0;
+	// Runs of digits before and after the decimal point, bits past the 16 characters are 0 so runs never pass them
+	unsigned intEnd = start;
+	while (digits & (1u << intEnd)) intEnd++;
+	unsigned fractionEnd = intEnd;
+	if (points & (1u << intEnd)) {
+		fractionEnd = intEnd + 1;
+		while (digits & (1u << fractionEnd)) fractionEnd++;
+	}
+	unsigned digitCount = fractionEnd - start - ((fractionEnd > intEnd)? 1 : 0);
+	unsigned fractionDigits = (fractionEnd > intEnd)? fractionEnd - intEnd - 1 : 0;
+	char next = (fractionEnd < 16)? text[fractionEnd] : '0';
+	if (digitCount == 0 || digitCount > 7 || fractionDigits > 10 || fractionEnd >= 16 || next == 'e' || next == 'E' || next == 'x' || next == 'X') {
+		return parseFloatScalar(pos, end, value);
+	}
+	unsigned mantissa = 0;
+	for (unsigned i = start; i < fractionEnd; i++) {
+		if (i != intEnd) mantissa = mantissa * 10 + (text[i] - '0');
+	}
+	value = static_cast<float>(mantissa) / POWERS[fractionDigits];
+	if (negative) value = -value;
+	return pos + fractionEnd;
+}
+
+static size_t parseFloatsSse2(const char* begin, const char* end, float* values, size_t count) {
+	return parseFloatsWith(begin, end, values, count, parseFloatSse2);
+}
+
+
+/************************************************************************/
+/* AVX2 KERNELS                                                         */
+/************************************************************************/
+
+TARGET_AVX2 static void transformAvx2(const Point* in, size_t count, const ShapeTransform& t, Point* out) {
+	const float* src = reinterpret_cast<const float*>(in);
+	float* dst = reinterpret_cast<float*>(out);
+	const __m256 a = _mm256_set1_ps(t.a);
+	const __m256 b = _mm256_setr_ps(-t.b, t.b, -t.b, t.b, -t.b, t.b, -t.b, t.b);
+	const __m256 position = _mm256_setr_ps(t.x, t.y, t.x, t.y, t.x, t.y, t.x, t.y);
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256 xy = _mm256_loadu_ps(src + i * 2);
+		__m256 yx = _mm256_permute_ps(xy, _MM_SHUFFLE(2, 3, 0, 1));
+		_mm256_storeu_ps(dst + i * 2, _mm256_add_ps(position, _mm256_add_ps(_mm256_mul_ps(xy, a), _mm256_mul_ps(yx, b))));
+	}
+	// Most shapes have under 8 vertices, so finish with two at a time before the last one
+	if (i + 2 <= count) {
+		__m128 xy = _mm_loadu_ps(src + i * 2);
+		__m128 yx = _mm_permute_ps(xy, _MM_SHUFFLE(2, 3, 0, 1));
+		_mm_storeu_ps(dst + i * 2, _mm_add_ps(_mm256_castps256_ps128(position),
+			_mm_add_ps(_mm_mul_ps(xy, _mm256_castps256_ps128(a)), _mm_mul_ps(yx, _mm256_castps256_ps128(b)))));
+		i += 2;
+	}
+	transformScalar(in + i, count - i, t, out + i);
+}
+
+TARGET_AVX2 static bool pointInPolygonAvx2(const Point* vertices, size_t count, float x, float y) {
+	bool inside = crossesEdge(vertices[0], vertices[count - 1], x, y);
+	const float* src = reinterpret_cast<const float*>(vertices);
+	const __m256 px = _mm256_set1_ps(x);
+	const __m256 py = _mm256_set1_ps(y);
+	int crossings = 0;
+	size_t i = 1;
+	for (; i + 8 <= count; i += 8) {
+		// Shuffles within each 128 bit half put the edges in a different order for a and b alike, which the count doesn't mind
+		__m256 a0 = _mm256_loadu_ps(src + i * 2), a1 = _mm256_loadu_ps(src + i * 2 + 8);
+		__m256 b0 = _mm256_loadu_ps(src + i * 2 - 2), b1 = _mm256_loadu_ps(src + i * 2 + 6);
+		__m256 ax = _mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)), ay = _mm256_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1));
+		__m256 bx = _mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)), by = _mm256_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1));
+		__m256 spans = _mm256_xor_ps(_mm256_cmp_ps(ay, py, _CMP_GT_OQ), _mm256_cmp_ps(by, py, _CMP_GT_OQ));
+		__m256 crossX = _mm256_add_ps(_mm256_div_ps(_mm256_mul_ps(_mm256_sub_ps(bx, ax), _mm256_sub_ps(py, ay)), _mm256_sub_ps(by, ay)), ax);
+		crossings += countBits(_mm256_movemask_ps(_mm256_and_ps(spans, _mm256_cmp_ps(px, crossX, _CMP_LT_OQ))));
+	}
+	for (; i < count; i++) crossings += crossesEdge(vertices[i], vertices[i - 1], x, y);
+	return inside != ((crossings & 1) != 0);
+}
+
+TARGET_AVX2 static void pointsInPolygonAvx2(const Point* vertices, size_t count, const float* xs, const float* ys, size_t pointCount, unsigned char* inside) {
+	size_t p = 0;
+	for (; p + 8 <= pointCount; p += 8) {
+		__m256 x = _mm256_loadu_ps(xs + p), y = _mm256_loadu_ps(ys + p);
+		__m256 crossed = _mm256_setzero_ps();
+		for (size_t i = 0, j = count - 1; i < count; j = i++) {
+			const Point& a = vertices[i];
+			const Point& b = vertices[j];
+			__m256 ax = _mm256_set1_ps(a.x), ay = _mm256_set1_ps(a.y);
+			__m256 spans = _mm256_xor_ps(_mm256_cmp_ps(ay, y, _CMP_GT_OQ), _mm256_cmp_ps(_mm256_set1_ps(b.y), y, _CMP_GT_OQ));
+			__m256 crossX = _mm256_add_ps(_mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(b.x - a.x), _mm256_sub_ps(y, ay)), _mm256_set1_ps(b.y - a.y)), ax);
+			crossed = _mm256_xor_ps(crossed, _mm256_and_ps(spans, _mm256_cmp_ps(x, crossX, _CMP_LT_OQ)));
+		}
+		int mask = _mm256_movemask_ps(crossed);
+		for (int k = 0; k < 8; k++) inside[p + k] = (mask >> k) & 1;
+	}
+	pointsInPolygonScalar(vertices, count, xs + p, ys + p, pointCount - p, inside + p);
+}
+
+TARGET_AVX2 static void boundsAvx2(const Point* vertices, size_t count, Point& min, Point& max) {
+	const float* src = reinterpret_cast<const float*>(vertices);
+	__m256 first = _mm256_castps128_ps256(_mm_setr_ps(vertices[0].x, vertices[0].y, vertices[0].x, vertices[0].y));
+	first = _mm256_insertf128_ps(first, _mm256_castps256_ps128(first), 1);
+	__m256 lower = first, upper = first;
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m256 xy = _mm256_loadu_ps(src + i * 2);
+		lower = _mm256_min_ps(lower, xy);
+		upper = _mm256_max_ps(upper, xy);
+	}
+	__m128 lower4 = _mm_min_ps(_mm256_castps256_ps128(lower), _mm256_extractf128_ps(lower, 1));
+	__m128 upper4 = _mm_max_ps(_mm256_castps256_ps128(upper), _mm256_extractf128_ps(upper, 1));
+	lower4 = _mm_min_ps(lower4, _mm_movehl_ps(lower4, lower4));
+	upper4 = _mm_max_ps(upper4, _mm_movehl_ps(upper4, upper4));
+	min = Point(_mm_cvtss_f32(lower4), _mm_cvtss_f32(_mm_shuffle_ps(lower4, lower4, 1)));
+	max = Point(_mm_cvtss_f32(upper4), _mm_cvtss_f32(_mm_shuffle_ps(upper4, upper4, 1)));
+	extendBounds(vertices + i, count - i, min, max);
+}
+
+TARGET_AVX2 static void fillPixelsAvx2(unsigned char* pixels, size_t count, const unsigned char* rgb) {
+	// 32 pixels are 3 vectors
+	alignas(32) unsigned char pattern[96];
+	fillPattern(pattern, sizeof(pattern), rgb);
+	const __m256i* vectors = reinterpret_cast<const __m256i*>(pattern);
+	__m256i p0 = _mm256_load_si256(vectors), p1 = _mm256_load_si256(vectors + 1), p2 = _mm256_load_si256(vectors + 2);
+	size_t i = 0;
+	for (; i + 32 <= count; i += 32) {
+		__m256i* dst = reinterpret_cast<__m256i*>(pixels + i * 3);
+		_mm256_storeu_si256(dst, p0);
+		_mm256_storeu_si256(dst + 1, p1);
+		_mm256_storeu_si256(dst + 2, p2);
+	}
+	fillPixelsScalar(pixels + i * 3, count - i, rgb);
+}
+
+
+/************************************************************************/
+/* AVX-512 KERNELS                                                      */
+/************************************************************************/
+
+TARGET_AVX512 static void transformAvx512(const Point* in, size_t count, const ShapeTransform& t, Point* out) {
+	const float* src = reinterpret_cast<const float*>(in);
+	float* dst = reinterpret_cast<float*>(out);
+	const __m512 a = _mm512_set1_ps(t.a);
+	const __m512 b = _mm512_setr_ps(-t.b, t.b, -t.b, t.b, -t.b, t.b, -t.b, t.b, -t.b, t.b, -t.b, t.b, -t.b, t.b, -t.b, t.b);
+	const __m512 position = _mm512_setr_ps(t.x, t.y, t.x, t.y, t.x, t.y, t.x, t.y, t.x, t.y, t.x, t.y, t.x, t.y, t.x, t.y);
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m512 xy = _mm512_loadu_ps(src + i * 2);
+		__m512 yx = _mm512_permute_ps(xy, _MM_SHUFFLE(2, 3, 0, 1));
+		_mm512_storeu_ps(dst + i * 2, _mm512_add_ps(position, _mm512_add_ps(_mm512_mul_ps(xy, a), _mm512_mul_ps(yx, b))));
+	}
+	// The remaining vertices with a masked load and store, two floats per vertex
+	if (i < count) {
+		__mmask16 mask = static_cast<__mmask16>((1u << ((count - i) * 2)) - 1);
+		__m512 xy = _mm512_maskz_loadu_ps(mask, src + i * 2);
+		__m512 yx = _mm512_permute_ps(xy, _MM_SHUFFLE(2, 3, 0, 1));
+		_mm512_mask_storeu_ps(dst + i * 2, mask, _mm512_add_ps(position, _mm512_add_ps(_mm512_mul_ps(xy, a), _mm512_mul_ps(yx, b))));
+	}
+}
+
+TARGET_AVX512 static bool pointInPolygonAvx512(const Point* vertices, size_t count, float x, float y) {
+	bool inside = crossesEdge(vertices[0], vertices[count - 1], x, y);
+	const float* src = reinterpret_cast<const float*>(vertices);
+	const __m512 px = _mm512_set1_ps(x);
+	const __m512 py = _mm512_set1_ps(y);
+	int crossings = 0;
+	size_t i = 1;
+	for (; i + 16 <= count; i += 16) {
+		__m512 a0 = _mm512_loadu_ps(src + i * 2), a1 = _mm512_loadu_ps(src + i * 2 + 16);
+		__m512 b0 = _mm512_loadu_ps(src + i * 2 - 2), b1 = _mm512_loadu_ps(src + i * 2 + 14);
+		__m512 ax = _mm512_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0)), ay = _mm512_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1));
+		__m512 bx = _mm512_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0)), by = _mm512_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1));
+		__mmask16 spans = _mm512_cmp_ps_mask(ay, py, _CMP_GT_OQ) ^ _mm512_cmp_ps_mask(by, py, _CMP_GT_OQ);
+		__m512 crossX = _mm512_add_ps(_mm512_div_ps(_mm512_mul_ps(_mm512_sub_ps(bx, ax), _mm512_sub_ps(py, ay)), _mm512_sub_ps(by, ay)), ax);
+		crossings += countBits(spans & _mm512_cmp_ps_mask(px, crossX, _CMP_LT_OQ));
+	}
+	for (; i < count; i++) crossings += crossesEdge(vertices[i], vertices[i - 1], x, y);
+	return inside != ((crossings & 1) != 0);
+}
+
+TARGET_AVX512 static void pointsInPolygonAvx512(const Point* vertices, size_t count, const float* xs, const float* ys, size_t pointCount, unsigned char* inside) {
+	size_t p = 0;
+	for (; p + 16 <= pointCount; p += 16) {
+		__m512 x = _mm512_loadu_ps(xs + p), y = _mm512_loadu_ps(ys + p);
+		__mmask16 crossed = 0;
+		for (size_t i = 0, j = count - 1; i < count; j = i++) {
+			const Point& a = vertices[i];
+			const Point& b = vertices[j];
+			__m512 ax = _mm512_set1_ps(a.x), ay = _mm512_set1_ps(a.y);
+			__mmask16 spans = _mm512_cmp_ps_mask(ay, y, _CMP_GT_OQ) ^ _mm512_cmp_ps_mask(_mm512_set1_ps(b.y), y, _CMP_GT_OQ);
+			__m512 crossX = _mm512_add_ps(_mm512_div_ps(_mm512_mul_ps(_mm512_set1_ps(b.x - a.x), _mm512_sub_ps(y, ay)), _mm512_set1_ps(b.y - a.y)), ax);
+			crossed ^= spans & _mm512_cmp_ps_mask(x, crossX, _CMP_LT_OQ);
+		}
+		for (int k = 0; k < 16; k++) inside[p + k] = (crossed >> k) & 1;
+	}
+	pointsInPolygonScalar(vertices, count, xs + p, ys + p, pointCount - p, inside + p);
+}
+
+TARGET_AVX512 static void boundsAvx512(const Point* vertices, size_t count, Point& min, Point& max) {
+	const float* src = reinterpret_cast<const float*>(vertices);
+	__m512 first = _mm512_setr_ps(vertices[0].x, vertices[0].y, vertices[0].x, vertices[0].y, vertices[0].x, vertices[0].y, vertices[0].x, vertices[0].y,
+		vertices[0].x, vertices[0].y, vertices[0].x, vertices[0].y, vertices[0].x, vertices[0].y, vertices[0].x, vertices[0].y);
+	__m512 lower = first, upper = first;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m512 xy = _mm512_loadu_ps(src + i * 2);
+		lower = _mm512_min_ps(lower, xy);
+		upper = _mm512_max_ps(upper, xy);
+	}
+	if (i < count) {
+		// Masked off lanes keep their current bounds
+		__mmask16 mask = static_cast<__mmask16>((1u << ((count - i) * 2)) - 1);
+		__m512 xy = _mm512_maskz_loadu_ps(mask, src + i * 2);
+		lower = _mm512_mask_min_ps(lower, mask, lower, xy);
+		upper = _mm512_mask_max_ps(upper, mask, upper, xy);
+	}
+	// Reduce the 8 pairs to 1, halving each step
+	__m256 lower8 = _mm256_min_ps(_mm512_castps512_ps256(lower), _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(lower), 1)));
+	__m256 upper8 = _mm256_max_ps(_mm512_castps512_ps256(upper), _mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(upper), 1)));
+	__m128 lower4 = _mm_min_ps(_mm256_castps256_ps128(lower8), _mm256_extractf128_ps(lower8, 1));
+	__m128 upper4 = _mm_max_ps(_mm256_castps256_ps128(upper8), _mm256_extractf128_ps(upper8, 1));
+	lower4 = _mm_min_ps(lower4, _mm_movehl_ps(lower4, lower4));
+	upper4 = _mm_max_ps(upper4, _mm_movehl_ps(upper4, upper4));
+	min = Point(_mm_cvtss_f32(lower4), _mm_cvtss_f32(_mm_shuffle_ps(lower4, lower4, 1)));
+	max = Point(_mm_cvtss_f32(upper4), _mm_cvtss_f32(_mm_shuffle_ps(upper4, upper4, 1)));
+}
+
+TARGET_AVX512 static void fillPixelsAvx512(unsigned char* pixels, size_t count, const unsigned char* rgb) {
+	// 64 pixels are 3 vectors
+	alignas(64) unsigned char pattern[192];
+	fillPattern(pattern, sizeof(pattern), rgb);
+	__m512i p0 = _mm512_load_si512(pattern), p1 = _mm512_load_si512(pattern + 64), p2 = _mm512_load_si512(pattern + 128);
+	size_t i = 0;
+	for (; i + 64 <= count; i += 64) {
+		unsigned char* dst = pixels + i * 3;
+		_mm512_storeu_si512(dst, p0);
+		_mm512_storeu_si512(dst + 64, p1);
+		_mm512_storeu_si512(dst + 128, p2);
+	}
+	fillPixelsScalar(pixels + i * 3, count - i, rgb);
+}
+
+
+/************************************************************************/
+/* DETECTION                                                            */
+/************************************************************************/
+
+/**
+* Returns: Isa  Widest instruction set the CPU supports and the OS saves the registers of
+*/
+static CpuDispatch::Isa detectIsa() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	int maxLeaf = info[0];
+	__cpuid(info, 1);
+	// The OS must save the AVX registers, and for AVX-512 the mask and upper ZMM registers, on context switches
+	if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) || maxLeaf < 7) return CpuDispatch::SSE2;
+	unsigned long long enabled = _xgetbv(0);
+	if ((enabled & 0x6) != 0x6) return CpuDispatch::SSE2;
+	__cpuidex(info, 7, 0);
+	if ((info[1] & (1 << 16)) && (enabled & 0xe6) == 0xe6) return CpuDispatch::AVX512;
+	if (info[1] & (1 << 5)) return CpuDispatch::AVX2;
+	return CpuDispatch::SSE2;
+#else
+	// Includes the OS support checks
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) return CpuDispatch::AVX512;
+	if (__builtin_cpu_supports("avx2")) return CpuDispatch::AVX2;
+	return CpuDispatch::SSE2;
+#endif
+}
+#endif
+
+
+/************************************************************************/
+/* DISPATCH                                                             */
+/************************************************************************/
+
+#ifdef DISPATCH_X86
+// Parsing uses 16 characters at a time at every width, numbers are rarely longer
+static const CpuDispatch::Kernels KERNELS[CpuDispatch::ISA_COUNT] = {
+	{ transformScalar, pointInPolygonScalar, pointsInPolygonScalar, boundsScalar, fillPixelsScalar, parseFloatsScalar },
+	{ transformSse2, pointInPolygonSse2, pointsInPolygonSse2, boundsSse2, fillPixelsSse2, parseFloatsSse2 },
+	{ transformAvx2, pointInPolygonAvx2, pointsInPolygonAvx2, boundsAvx2, fillPixelsAvx2, parseFloatsSse2 },
+	{ transformAvx512, pointInPolygonAvx512, pointsInPolygonAvx512, boundsAvx512, fillPixelsAvx512, parseFloatsSse2 }
+};
+#else
+static const CpuDispatch::Kernels KERNELS[1] = {
+	{ transformScalar, pointInPolygonScalar, pointsInPolygonScalar, boundsScalar, fillPixelsScalar, parseFloatsScalar }
+};
+#endif
+
+// Scalar until the detected selection below is made, in case a kernel runs during another file's static initialisation
+const CpuDispatch::Kernels* CpuDispatch::current = &KERNELS[SCALAR];
+CpuDispatch::Isa CpuDispatch::currentIsa = SCALAR;
+static const bool detected = CpuDispatch::select(CpuDispatch::getDetected());
+
+CpuDispatch::Isa CpuDispatch::getDetected() {
+#ifdef DISPATCH_X86
+	static const Isa isa = detectIsa();
+	return isa;
+#else
+	return SCALAR;
+#endif
+}
+
+const CpuDispatch::Kernels& CpuDispatch::get(Isa isa) {
+	return KERNELS[isSupported(isa)? isa : SCALAR];
+}
+
+bool CpuDispatch::select(Isa isa) {
+	if (isa < SCALAR || isa >= ISA_COUNT || !isSupported(isa)) return false;
+	current = &KERNELS[isa];
+	currentIsa = isa;
+	return true;
+}
+
+bool CpuDispatch::select(const std::string& name) {
+	for (int isa = SCALAR; isa < ISA_COUNT; isa++) {
+		if (name == getName(static_cast<Isa>(isa))) return select(static_cast<Isa>(isa));
+	}
+	return false;
+}
+
+const char* CpuDispatch::getName(Isa isa) {
+	static const char* const NAMES[ISA_COUNT] = { "scalar", "sse2", "avx2", "avx512" };
+	return (isa >= 0 && isa < ISA_COUNT)? NAMES[isa] : "";
+}
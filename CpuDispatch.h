@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include "Utils.h"
+
+struct ShapeTransform;
+
+/**
+* Chooses the implementation of each hot kernel for the instruction sets the CPU supports, so one build runs on any x86-64 CPU
+* and uses the widest vectors available. The CPU is checked once at startup and the kernels are called through the function
+* pointers of the selected instruction set. Every instruction set's kernels give identical results, fused multiply-adds
+* aren't used since they round differently, so the selection can be overridden for testing and comparison.
+*
+* Builds for other architectures only have the scalar kernels.
+*
+* Usage:
+*	- Call CpuDispatch::get().kernel(...) to run a kernel with the selected instruction set
+*	- Call select(isa) at startup, before any other threads run kernels, to override the selection
+*/
+class CpuDispatch {
+
+public:
+	/**
+	* Instruction sets with their own kernels, from narrowest to widest
+	*/
+	enum Isa {
+		SCALAR,		// Plain C++, for every CPU
+		SSE2,		// 128 bit vectors, available on every x86-64 CPU
+		AVX2,		// 256 bit vectors
+		AVX512,		// 512 bit vectors, using AVX-512F
+		ISA_COUNT
+	};
+
+	/**
+	* Function pointers to an instruction set's kernels
+	*/
+	struct Kernels {
+		/**
+		* Transforms vertices to world coordinates, see TransformBatch
+		* Parameter: const Point* in  Local vertices
+		* Parameter: size_t count  Number of vertices
+		* Parameter: const ShapeTransform& transform  Transform to apply
+		* Parameter: Point* out  World vertices, count of them
+		*/
+		void (*transform)(const Point* in, size_t count, const ShapeTransform& transform, Point* out);
+		/**
+		* Tests a point against a polygon with the even-odd rule, see Shape::pointInShape
+		* Returns: bool  True if the point is inside
+		*/
+		bool (*pointInPolygon)(const Point* vertices, size_t count, float x, float y);
+		/**
+		* Tests many points against one polygon, several points at a time, giving the same results as pointInPolygon
+		* Parameter: const float* xs  X coordinates of the points
+		* Parameter: const float* ys  Y coordinates of the points
+		* Parameter: size_t pointCount  Number of points
+		* Parameter: unsigned char* inside  Set to 1 for each point inside and 0 for each point outside
+		*/
+		void (*pointsInPolygon)(const Point* vertices, size_t count, const float* xs, const float* ys, size_t pointCount, unsigned char* inside);
+		/**
+		* Finds the smallest and largest x and y of at least one vertex
+		* Parameter: Point& min  Set to the smallest x and y
+		* Parameter: Point& max  Set to the largest x and y
+		*/
+		void (*bounds)(const Point* vertices, size_t count, Point& min, Point& max);
+		/**
+		* Sets a run of 8 bit RGB pixels to one colour, see SoftwareRenderer
+		* Parameter: unsigned char* pixels  First pixel's red byte
+		* Parameter: size_t count  Number of pixels
+		* Parameter: const unsigned char* rgb  Colour to fill with
+		*/
+		void (*fillPixels)(unsigned char* pixels, size_t count, const unsigned char* rgb);
+		/**
+		* Reads decimal numbers as std::strtof does, skipping any other characters between them, see SaveManager::parseFloats.
+		* The text must be followed by a character that can't continue a number, such as a std::string's terminator
+		* Parameter: const char* begin  Start of the text
+		* Parameter: const char* end  End of the text
+		* Parameter: float* values  Numbers read
+		* Parameter: size_t count  Most numbers to read
+		* Returns: size_t  Numbers read
+		*/
+		size_t (*parseFloats)(const char* begin, const char* end, float* values, size_t count);
+	};
+
+protected:
+	// Kernels in use, the widest the CPU supports unless overridden
+	static const Kernels* current;
+	static Isa currentIsa;
+
+public:
+	/**
+	* Returns: const Kernels&  Kernels of the selected instruction set
+	*/
+	static inline const Kernels& get() { return *current; }
+	/**
+	* Returns: const Kernels&  Kernels of an instruction set, which must be supported
+	*/
+	static const Kernels& get(Isa isa);
+	static inline Isa getIsa() { return currentIsa; }
+
+	/**
+	* Overrides the instruction set to run kernels with. Not thread safe, call at startup
+	* Parameter: Isa isa  Instruction set to use
+	* Returns: bool  False if the CPU doesn't support it, the selection is unchanged
+	*/
+	static bool select(Isa isa);
+	/**
+	* Overrides the instruction set by name, see select(Isa) and getName
+	* Returns: bool  False if the name is unknown or the CPU doesn't support it
+	*/
+	static bool select(const std::string& name);
+
+	/**
+	* Returns: Isa  Widest instruction set the CPU and OS support, checked once
+	*/
+	static Isa getDetected();
+	/**
+	* Returns: bool  True if the CPU and OS support an instruction set
+	*/
+	static inline bool isSupported(Isa isa) { return isa <= getDetected(); }
+	/**
+	* Returns: const char*  Lower case name of an instruction set, as select(name) takes
+	*/
+	static const char* getName(Isa isa);
+};
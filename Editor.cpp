@@ -0,0 +1,752 @@
+#include "stdafx.h"
+#include "Editor.h"
+#include "InputCodes.h"
+#include "InputReplayer.h"
+#include "Pentagon.h"
+#include "Triangle.h"
+#include "Square.h"
+#include "Trace.h"
+#include "CpuDispatch.h"
+#include <iostream>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <algorithm>
+
+// Verbose to avoid potentially conflicting namespaces
+using std::cout;			using std::endl;
+using std::vector;			using std::unique_ptr;
+using std::string;
+
+
+/**
+* Reads all of an option's value as a number
+* Returns: bool  False if the value isn't entirely a number, or doesn't fit the type. Integers can't be negative
+*/
+template<typename T>
+static bool parseNumber(const string& value, T& number) {
+	if (value.empty()) return false;
+	char* end = nullptr;
+	errno = 0;
+	if constexpr (std::is_integral<T>::value) {
+		// strtoull would wrap negative numbers around
+		if (!std::isdigit(static_cast<unsigned char>(value[0]))) return false;
+		unsigned long long parsed = std::strtoull(value.c_str(), &end, 10);
+		if (errno != 0 || parsed > static_cast<unsigned long long>(std::numeric_limits<T>::max())) return false;
+		number = static_cast<T>(parsed);
+	} else {
+		double parsed = std::strtod(value.c_str(), &end);
+		if (errno != 0 || !std::isfinite(static_cast<T>(parsed))) return false;
+		number = static_cast<T>(parsed);
+	}
+	return end == value.c_str() + value.size();
+}
+
+bool EditorOptions::parse(int argc, char* argv[]) {
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		// Text after the = of options with values
+		string value = arg.substr(arg.find('=') + 1);
+		bool valid = true;
+		if (arg == "--compact") binaryEncoding.compact = true;
+		else if (arg == "--tiles") tiledSave = true;
+		else if (arg.compare(0, 9, "--memory=") == 0) {
+			size_t megabytes = 0;
+			valid = parseNumber(value, megabytes) && megabytes <= (std::numeric_limits<size_t>::max() >> 20);
+			pagingSettings.memoryBudget = megabytes * 1024 * 1024;
+		}
+		else if (arg.compare(0, 9, "--record=") == 0) recordFile = value;
+		else if (arg.compare(0, 9, "--replay=") == 0) replayFile = value;
+		else if (arg == "--realtime") realtimeReplay = true;
+		else if (arg == "--draw") drawReplay = true;
+		else if (arg.compare(0, 8, "--trace=") == 0) traceFile = value;
+		else if (arg == "--single-thread") splitThreads = false;
+		else if (arg.compare(0, 6, "--fps=") == 0) valid = parseNumber(value, frameRate) && frameRate >= 0;
+		else if (arg.compare(0, 14, "--update-rate=") == 0) valid = parseNumber(value, updateRate) && updateRate > 0;
+		else if (arg.compare(0, 6, "--isa=") == 0) isa = value;
+		else if (arg.compare(0, 11, "--generate=") == 0) valid = parseNumber(value, generation.count);
+		else if (arg.compare(0, 7, "--seed=") == 0) valid = parseNumber(value, generation.seed);
+		else if (arg.compare(0, 8, "--edges=") == 0) {
+			float minEdges = 0, maxEdges = 0;
+			valid = parseRange(value, minEdges, maxEdges);
+			generation.minEdges = static_cast<int>(minEdges);
+			generation.maxEdges = static_cast<int>(maxEdges);
+		}
+		else if (arg.compare(0, 10, "--overlap=") == 0) valid = parseNumber(value, generation.overlap);
+		else if (arg.compare(0, 13, "--clustering=") == 0) valid = parseNumber(value, generation.clustering);
+		else if (arg.compare(0, 11, "--clusters=") == 0) valid = parseNumber(value, generation.clusters);
+		else if (arg.compare(0, 9, "--spread=") == 0) valid = parseNumber(value, generation.clusterSpread);
+		else if (arg.compare(0, 8, "--scale=") == 0) valid = parseRange(value, generation.minScale, generation.maxScale);
+		else if (arg.compare(0, 11, "--rotation=") == 0) valid = parseRange(value, generation.minRotation, generation.maxRotation);
+		else if (arg.compare(0, 9, "--colour=") == 0) valid = parseRange(value, generation.minColour, generation.maxColour);
+		// Anything else starting with -- is a misspelled or unknown option, which would otherwise be taken as the save file
+		else if (arg.compare(0, 2, "--") == 0) valid = false;
+		else saveFile = arg;
+		if (!valid) {
+			cout << "Invalid argument " << arg << endl;
+			printUsage();
+			return false;
+		}
+	}
+	return true;
+}
+
+void EditorOptions::printUsage() {
+	cout << "Usage: [save_file] [--compact] [--tiles] [--memory=MB] [--record=FILE] [--replay=FILE] [--realtime] [--draw] [--trace=FILE]" << endl
+		<< "       [--single-thread] [--fps=N] [--update-rate=N] [--isa=NAME] [--generate=N] [--seed=N] [--edges=MIN,MAX] [--overlap=F]" << endl
+		<< "       [--clustering=F] [--clusters=N] [--spread=F] [--scale=MIN,MAX] [--rotation=MIN,MAX] [--colour=MIN,MAX]" << endl;
+}
+
+bool EditorOptions::parseRange(const string& value, float& min, float& max) {
+	size_t separator = value.find(',');
+	if (!parseNumber(value.substr(0, separator), min)) return false;
+	if (separator == string::npos) {
+		max = min;
+		return true;
+	}
+	return parseNumber(value.substr(separator + 1), max);
+}
+
+
+Editor::Editor(const EditorOptions& options) : options(options), motion(mouse) {
+	if (!options.isa.empty() && !CpuDispatch::select(options.isa)) {
+		cout << "Instruction set " << options.isa << " isn't supported, using " << CpuDispatch::getName(CpuDispatch::getIsa()) << endl;
+	}
+}
+
+void Editor::start() {
+	if (!options.traceFile.empty()) Trace::start();
+	initScene();
+	// Start saving in the background
+	autoSaver.setBinaryEncoding(options.binaryEncoding);
+	autoSaver.start(options.saveFile, options.autosaveInterval);
+	if (!options.recordFile.empty()) startRecording();
+}
+
+void Editor::initScene() {
+	// Key mappings
+	keyMappings[Action::A_MODIFIER] = ' '; // Held to switch from shape to view manipulation
+	keyMappings[Action::A_ADD] = 'a';
+	keyMappings[Action::A_DUPLICATE] = 'd';
+	keyMappings[Action::A_DELETE] = 'x';
+	keyMappings[Action::A_MORPH_UP] = 'w';
+	keyMappings[Action::A_MORPH_DOWN] = 's';
+	keyMappings[Action::A_COLOUR_RED] = 'r';
+	keyMappings[Action::A_COLOUR_GREEN] = 'g';
+	keyMappings[Action::A_COLOUR_BLUE] = 'b';
+	keyMappings[Action::A_CLEAR] = '\b';
+	keyMappings[Action::A_GROUP] = 'q';
+	keyMappings[Action::A_UNGROUP] = 'u';
+
+	specialMappings[Action::A_SAVE] = InputCodes::KEY_F5;
+	specialMappings[Action::A_TRACE] = InputCodes::KEY_F6;
+
+	mouseMappings[Action::A_PAN] = InputCodes::RIGHT_BUTTON;
+	mouseMappings[Action::A_TRANSLATE] = InputCodes::RIGHT_BUTTON;
+	mouseMappings[Action::A_ROTATE] = InputCodes::LEFT_BUTTON;
+	mouseMappings[Action::A_SCALE] = InputCodes::MIDDLE_BUTTON;
+	mouseMappings[Action::A_ZOOM] = InputCodes::MIDDLE_BUTTON;
+	mouseMappings[Action::A_MARQUEE] = InputCodes::RIGHT_BUTTON; // Dragged from empty canvas
+
+	initTypes();
+
+	// Load save
+	load(options.saveFile);
+	// Binary saves can't be paged
+	if ((options.tiledSave || shapeManager.isPaging()) && !BinarySaveManager::isBinaryFile(options.saveFile)) shapeManager.setPaging(options.pagingSettings);
+	// The view until the first reshape
+	updateMouseProjection(WINDOW_WIDTH, WINDOW_HEIGHT);
+}
+
+void Editor::initTypes() {
+	// Create shape types, from triangle to decagon, for cycling through when the up and down arrow keys are pressed.
+	// Saved shapes are recreated from these types, so they must be added before loading
+	// Examples of RegularPolygon child classes
+	shapeManager.addType(new Triangle(DEFAULT_RADIUS, Point(0, 0)));
+	shapeManager.addType(new Square(DEFAULT_RADIUS, Point(0, 0)));
+	shapeManager.addType(new Pentagon(DEFAULT_RADIUS, Point(0, 0)));
+	// Examples of instantiating a RegularPolygon directly
+	shapeManager.addType(new RegularPolygon("Hexagon", 6, DEFAULT_RADIUS, Point(0, 0)));
+	shapeManager.addType(new RegularPolygon("Heptagon", 7, DEFAULT_RADIUS, Point(0, 0)));
+	shapeManager.addType(new RegularPolygon("Octagon", 8, DEFAULT_RADIUS, Point(0, 0)));
+	shapeManager.addType(new RegularPolygon("Nonagon", 9, DEFAULT_RADIUS, Point(0, 0)));
+	shapeManager.addType(new RegularPolygon("Decagon", 10, DEFAULT_RADIUS, Point(0, 0)));
+}
+
+void Editor::startRecording() {
+	// Replays load the whole scene before the first event, so the load mustn't overlap the recording
+	backgroundLoader.finish(shapeManager, sceneSettings);
+	InputSession session;
+	session.seed = static_cast<unsigned>(std::chrono::system_clock::now().time_since_epoch().count());
+	session.paging = shapeManager.isPaging();
+	session.memoryBudget = shapeManager.getPagingSettings().memoryBudget;
+	session.binaryScene = BinarySaveManager::isBinaryFile(options.saveFile);
+
+	string sceneFile = InputRecorder::getSceneFile(options.recordFile, session.binaryScene);
+	SceneSnapshot snapshot;
+	snapshot.capture(shapeManager, sceneSettings);
+	if (session.binaryScene) {
+		BinarySaveManager binarySaveManager;
+		binarySaveManager.setEncoding(options.binaryEncoding);
+		if (!binarySaveManager.save(sceneFile, snapshot)) {
+			cout << "Couldn't save the scene to " << sceneFile << ", not recording" << endl;
+			return;
+		}
+	} else {
+		SaveManager sceneSaveManager;
+		sceneSaveManager.startSave(sceneFile);
+		snapshot.save(sceneSaveManager);
+		if (!sceneSaveManager.stopSave()) {
+			cout << "Couldn't save the scene to " << sceneFile << ", not recording" << endl;
+			return;
+		}
+	}
+	shapeManager.clear();
+	selectedShape = lastSelectedShape = nullptr;
+	load(sceneFile);
+	backgroundLoader.finish(shapeManager, sceneSettings);
+
+	srand(session.seed);
+	if (recorder.start(options.recordFile, session)) cout << "Recording input to " << options.recordFile << endl;
+	else cout << "Couldn't record input to " << options.recordFile << endl;
+}
+
+int Editor::generate() {
+	if (!options.traceFile.empty()) Trace::start();
+	initTypes();
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	float width = shapeManager.generate(options.generation);
+	cout << "Generated " << shapeManager.getShapes().size() << " shapes in a " << width << " wide square in "
+		<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() << "ms" << endl;
+
+	// Saved the same way as edited scenes, so every format the editor can write is available
+	if (options.tiledSave && !BinarySaveManager::isBinaryFile(options.saveFile)) shapeManager.setPaging(options.pagingSettings);
+	autoSaver.setBinaryEncoding(options.binaryEncoding);
+	autoSaver.start(options.saveFile, 0);
+	autoSaver.requestSave(shapeManager, sceneSettings);
+	autoSaver.stop();
+	writeTrace();
+	if (autoSaver.getSaveCount() == 0) {
+		cout << "Couldn't save the scene to " << options.saveFile << endl;
+		return 1;
+	}
+	cout << "Saved to " << options.saveFile << " in " << autoSaver.getLastWriteTime() << "ms" << endl;
+	return 0;
+}
+
+int Editor::replay(Renderer* frameRenderer) {
+	InputReplayer replayer;
+	if (!replayer.load(options.replayFile)) {
+		cout << "Couldn't load input log " << options.replayFile << endl;
+		return 1;
+	}
+	const InputSession& session = replayer.getSession();
+	options.saveFile = InputRecorder::getSceneFile(options.replayFile, session.binaryScene);
+	options.tiledSave = session.paging;
+	options.pagingSettings.memoryBudget = static_cast<size_t>(session.memoryBudget);
+	if (!options.traceFile.empty()) Trace::start();
+	initScene();
+	backgroundLoader.finish(shapeManager, sceneSettings);
+	srand(session.seed);
+
+	cout << "Replaying " << replayer.getEvents().size() << " events" << (options.realtimeReplay? " in real time" : "")
+		<< (frameRenderer? ", drawing frames" : "") << endl;
+	replayer.run([this, frameRenderer](const InputEvent& event) { replayEvent(event, frameRenderer); }, options.realtimeReplay);
+	replayer.printReport(cout);
+	writeTrace();
+
+	unsigned long long checksum = sceneChecksum();
+	cout << "Scene checksum: " << std::hex << checksum << std::dec;
+	if (!replayer.hasChecksum()) {
+		cout << " (the recording has no checksum to compare with)" << endl;
+		return 0;
+	}
+	bool matched = checksum == replayer.getChecksum();
+	cout << (matched? " matches" : " doesn't match") << " the recording" << endl;
+	return matched? 0 : 2;
+}
+
+void Editor::replayEvent(const InputEvent& event, Renderer* frameRenderer) {
+	// Frames update the scene, then update the view as drawing would
+	if (event.type == InputEvent::FRAME) {
+		updateScene();
+		if (frameRenderer) render(*frameRenderer);
+		else updateMouseModelMatrix();
+	} else {
+		dispatch(event);
+	}
+}
+
+void Editor::dispatch(const InputEvent& event) {
+	dirty = true;
+	const int* args = event.args;
+	switch (event.type) {
+	case InputEvent::MOUSE: onMouse(args[0], args[1], args[2], args[3]); break;
+	case InputEvent::MOTION: onMotion(args[0], args[1]); break;
+	case InputEvent::KEY_DOWN: onKeyDown(static_cast<unsigned char>(args[0]), args[1], args[2]); break;
+	case InputEvent::KEY_UP: onKeyUp(static_cast<unsigned char>(args[0]), args[1], args[2]); break;
+	case InputEvent::SPECIAL_DOWN: onSpecialDown(args[0], args[1], args[2]); break;
+	case InputEvent::SPECIAL_UP: onSpecialUp(args[0], args[1], args[2]); break;
+	case InputEvent::RESHAPE: reshape(args[0], args[1]); break;
+	default: break;
+	}
+}
+
+void Editor::updateMouseProjection(int w, int h) {
+	if (h == 0) h = 1;
+	// Orthographic camera for 2D with 0,0 at center of screen, the same projection as the GLUT frontend's glOrtho
+	double left = -CAMERA_WIDTH / 2, right = CAMERA_WIDTH / 2, bottom = CAMERA_HEIGHT / 2, top = -CAMERA_HEIGHT / 2, zNear = 0, zFar = 2;
+	double projection[16] = { 0 };
+	projection[0] = 2 / (right - left);
+	projection[5] = 2 / (top - bottom);
+	projection[10] = -2 / (zFar - zNear);
+	projection[12] = -(right + left) / (right - left);
+	projection[13] = -(top + bottom) / (top - bottom);
+	projection[14] = -(zFar + zNear) / (zFar - zNear);
+	projection[15] = 1;
+	int viewport[4] = { 0, 0, w, h };
+	mouse.setProjectionMatrix(projection, viewport);
+}
+
+void Editor::updateMouseModelMatrix() {
+	double model[16] = { 0 };
+	model[0] = model[5] = sceneSettings.zoom;
+	model[10] = model[15] = 1;
+	model[12] = sceneSettings.zoom * sceneSettings.panX;
+	model[13] = sceneSettings.zoom * sceneSettings.panY;
+	mouse.setModelMatrix(model);
+}
+
+unsigned long long Editor::sceneChecksum() {
+	SceneSnapshot snapshot;
+	snapshot.capture(shapeManager, sceneSettings);
+	return snapshot.checksum();
+}
+
+
+void Editor::render(Renderer& renderer, RenderSnapshot::Detail detail) {
+	Trace::Scope span("Editor::render");
+	AllocationCounter::Scope allocations(AllocationCounter::RENDER);
+	capture(frameSnapshot);
+	frameSnapshot.render(renderer, detail);
+}
+
+void Editor::capture(RenderSnapshot& snapshot) {
+	Trace::Scope span("Editor::capture");
+	AllocationCounter::Scope allocations(AllocationCounter::RENDER);
+	Trace::counter("Shapes", static_cast<double>(shapeManager.getShapes().size()));
+	dirty = false;
+	snapshot.capture(shapeManager.getShapes(), sceneSettings);
+	// Update the view used for mouse mapping to the one being drawn
+	updateMouseModelMatrix();
+
+	// HUD text in the top left of the screen, formatted into the snapshot so it doesn't allocate
+	int lineHeight = 15;
+	float x = -CAMERA_WIDTH / 2;
+	float y = -CAMERA_HEIGHT / 2 + lineHeight;
+	// Calculate zoom percentage
+	int zoom = ((CAMERA_WIDTH * sceneSettings.zoom) / CAMERA_WIDTH) * 100;
+	// Zoom and pan text
+	snapshot.addText(x, y, "Zoom: %d%%", zoom);
+	snapshot.addText(x, y += lineHeight, "Pan: %d, %d", sceneSettings.panX, sceneSettings.panY);
+	// Selected shape settings
+	if (selectedShape) {
+		snapshot.addText(x, y += lineHeight * 2, "Name: %s", selectedShape->getName().c_str());
+		snapshot.addText(x, y += lineHeight, "Scale: %f", selectedShape->getWorldScale());
+		snapshot.addText(x, y += lineHeight, "Rotation: %f", selectedShape->getWorldRotation());
+		Point position = selectedShape->getWorldPosition();
+		snapshot.addText(x, y += lineHeight, "Position: %f, %f", position.x, position.y);
+		if (ShapeGroup* group = getDragGroup(selectedShape)) snapshot.addText(x, y += lineHeight, "Group: %zu shapes", group->getShapeCount());
+	}
+	size_t selected = shapeManager.getSelection().size();
+	if (selected > 0) snapshot.addText(x, y += lineHeight * 2, "Selected: %zu shapes", selected);
+	if (marqueeActive) snapshot.setMarquee(marqueeStart, marqueeEnd);
+	// Frame time statistics, from the frontend drawing the snapshots
+	if (frameStats.frames > 0) {
+		snapshot.addDetailText(x, CAMERA_HEIGHT / 2 - lineHeight * 6, "Frame: %.2fms (p95 %.2fms, max %.2fms), %zu overruns", frameStats.last, 
+			frameStats.p95, frameStats.max, frameStats.overruns);
+	}
+	// The allocations each subsystem made last frame, which should all be 0 unless shapes are being added or loaded
+	snapshot.addDetailText(x, CAMERA_HEIGHT / 2 - lineHeight * 5, "Allocations: render %zu, input %zu, picking %zu, I/O %zu, other %zu",
+		frameAllocations[AllocationCounter::RENDER], frameAllocations[AllocationCounter::INPUT], frameAllocations[AllocationCounter::PICKING],
+		frameAllocations[AllocationCounter::IO], frameAllocations[AllocationCounter::OTHER]);
+	// How many motion events have been coalesced into how many shape updates
+	if (motion.getEventCount() > 0) {
+		snapshot.addDetailText(x, CAMERA_HEIGHT / 2 - lineHeight * 4, "Motion: %zu events, %zu shape updates", motion.getEventCount(), motion.getUpdateCount());
+	}
+	// Loading progress
+	if (backgroundLoader.isLoading()) {
+		size_t total = backgroundLoader.getTotalCount();
+		if (total) snapshot.addText(x, CAMERA_HEIGHT / 2 - lineHeight * 3, "Loading: %zu/%zu shapes (%zu%%)", 
+			backgroundLoader.getPublishedCount(), total, backgroundLoader.getPublishedCount() * 100 / total);
+		else snapshot.addText(x, CAMERA_HEIGHT / 2 - lineHeight * 3, "Loading: %zu/?", backgroundLoader.getPublishedCount());
+	}
+	// Paging state
+	if (shapeManager.isPaging()) {
+		snapshot.addDetailText(x, CAMERA_HEIGHT / 2 - lineHeight * 2, "Tiles: %zu/%zu resident, %zuKB of %zuKB", shapeManager.getResidentTileCount(), 
+			shapeManager.getTileCount(), shapeManager.getResidentMemory() / 1024, shapeManager.getPagingSettings().memoryBudget / 1024);
+	}
+	// Autosave timings, the snapshot time is the only part of a save that blocks input
+	if (autoSaver.getSaveCount() > 0) {
+		snapshot.addDetailText(x, CAMERA_HEIGHT / 2 - lineHeight, "Autosave: snapshot %fms (avg %fms), write %fms", autoSaver.getLastSnapshotTime(),
+			autoSaver.getAverageSnapshotTime(), autoSaver.getLastWriteTime());
+	}
+}
+
+void Editor::reshape(int w, int h) {
+	recorder.record(InputEvent::RESHAPE, w, h);
+	// Update the projection used for mouse mapping
+	updateMouseProjection(w, h);
+}
+
+void Editor::update() {
+	for (int subsystem = 0; subsystem < AllocationCounter::SUBSYSTEM_COUNT; subsystem++) {
+		size_t total = AllocationCounter::getCount(static_cast<AllocationCounter::Subsystem>(subsystem));
+		frameAllocations[subsystem] = total - allocationTotals[subsystem];
+		allocationTotals[subsystem] = total;
+	}
+	recorder.record(InputEvent::FRAME);
+	updateScene();
+}
+
+void Editor::updateScene() {
+	Trace::Scope span("Editor::updateScene");
+	// Apply the shape changes from this frame's motion events in one go
+	motion.apply();
+	updateMarquee();
+	// Add the shapes loaded in the background since the last frame
+	if (backgroundLoader.update(shapeManager, sceneSettings) && backgroundLoader.hasSucceeded()) {
+		cout << "Loaded " << backgroundLoader.getPublishedCount() << " shapes in " << backgroundLoader.getLoadTime()
+			<< "ms, first shapes shown after " << backgroundLoader.getFirstBatchTime() << "ms" << endl;
+	}
+	// Page tiles in and out as the view moves, keeping the shapes being manipulated. Autosaves replace the file tiles are read from,
+	// so it can't be replaced while they're read, and its new index is read once it has been
+	{
+		std::lock_guard<std::mutex> lock(autoSaver.getReplaceMutex());
+		if (autoSaver.getSaveCount() != pagingSaveCount) {
+			pagingSaveCount = autoSaver.getSaveCount();
+			shapeManager.reloadPagingIndex();
+		}
+		shapeManager.updatePaging(sceneSettings, CAMERA_WIDTH, CAMERA_HEIGHT, { selectedShape, lastSelectedShape });
+	}
+	// Trigger a periodic autosave if it's due. Saving a partly loaded scene would overwrite the file with fewer shapes
+	if (!backgroundLoader.isLoading()) autoSaver.update(shapeManager, sceneSettings);
+	// Loading progress and autosave timings are shown in the HUD
+	if (backgroundLoader.isLoading() || autoSaver.getSaveCount() != shownSaveCount) {
+		shownSaveCount = autoSaver.getSaveCount();
+		dirty = true;
+	}
+}
+
+void Editor::save() {
+	// Add the rest of the shapes if the scene is still loading, so none are lost
+	backgroundLoader.finish(shapeManager, sceneSettings);
+	motion.apply();
+	// End the input log with the final scene, for replays to compare with
+	if (recorder.isRecording()) recorder.stop(sceneChecksum());
+	// Queue a final save and wait for the background thread to finish writing it
+	autoSaver.requestSave(shapeManager, sceneSettings);
+	autoSaver.stop();
+	writeTrace();
+}
+
+void Editor::writeTrace() {
+	if (options.traceFile.empty()) return;
+	if (Trace::write(options.traceFile)) cout << "Wrote trace to " << options.traceFile << endl;
+	else cout << "Couldn't write trace to " << options.traceFile << endl;
+}
+
+void Editor::load(const string& file) {
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	bool loaded = false;
+	if (BinarySaveManager::isBinaryFile(file)) {
+		BinarySaveManager binarySaveManager;
+		SceneSnapshot snapshot;
+		if (binarySaveManager.load(file, snapshot)) {
+			sceneSettings = snapshot.settings;
+			shapeManager.restore(snapshot);
+			loaded = true;
+		}
+	}
+	// Tiled saves only load the scene settings and tile directory, tiles are loaded as they come into view
+	else if (shapeManager.loadPaged(file)) {
+		if (saveManager.loadSection(file, "scene")) sceneSettings.load(saveManager);
+		loaded = true;
+	}
+	// Other text saves are loaded in the background, shapes are drawn and can be edited as they arrive
+	else {
+		backgroundLoader.start(file, shapeManager);
+	}
+	if (loaded) {
+		cout << "Loaded " << shapeManager.getShapes().size() << " shapes in "
+			<< std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() << "ms using "
+			<< std::thread::hardware_concurrency() << " threads" << endl;
+		// Build the spatial index now, unless it was restored from the save, so the first click doesn't stall
+		bool restored = shapeManager.isIndexValid();
+		shapeManager.updateIndex();
+		cout << "Pickable after " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count() << "ms ("
+			<< (restored? "restored" : "rebuilt") << " spatial index)" << endl;
+	}
+}
+
+void Editor::onMouse(int button, int state, int x, int y) {
+	Trace::Scope span("Editor::onMouse");
+	AllocationCounter::Scope allocations(AllocationCounter::INPUT);
+	recorder.record(InputEvent::MOUSE, button, state, x, y);
+	// Finish the changes to the selected shape before the selection changes
+	motion.apply();
+	// Delegate to Mouse instance
+	mouse.onClick(button, state, x, y);
+	// When releasing a button, selected shape should be set to null, otherwise get the shape under the mouse
+	lastSelectedShape = selectedShape;
+	selectedShape = (state == InputCodes::BUTTON_UP)? nullptr : shapeManager.getShapeAt(mouse.getPosition().x, mouse.getPosition().y);
+	// Clicking anything but a selected shape clears the selection, unless the view is being manipulated
+	bool viewManipulation = keyboard.isKeyDown(keyMappings[Action::A_MODIFIER]);
+	if (state == InputCodes::BUTTON_DOWN && !viewManipulation && !(selectedShape && selectedShape->isSelected())) shapeManager.clearSelection();
+	if (selectedShape) {
+		// Bring the selected shape to the front and show it's outline
+		shapeManager.bringToFront(selectedShape);
+		selectedShape->setOutlineVisible(true);
+		// Dragging a grouped shape drags its outermost group, dragging a shape in a group selection drags the whole selection
+		if (getDragGroup(selectedShape)) motion.beginGroupDrag();
+		else if (isGroupSelected(selectedShape)) motion.beginSelectionDrag(shapeManager);
+	} else if (lastSelectedShape && !lastSelectedShape->isSelected()) {
+		// Hide the outline of the last shape
+		lastSelectedShape->setOutlineVisible(false);
+	}
+	// Pressing the marquee button on empty canvas starts a marquee, releasing it makes the final selection
+	if (button == mouseMappings[Action::A_MARQUEE]) {
+		if (state == InputCodes::BUTTON_DOWN && !selectedShape && !viewManipulation) {
+			marqueeStart = marqueeEnd = mouse.getPosition();
+			marqueeActive = marqueeChanged = true;
+		}
+		else if (state == InputCodes::BUTTON_UP && marqueeActive) {
+			marqueeEnd = mouse.getPosition();
+			marqueeChanged = true;
+			updateMarquee();
+			marqueeActive = false;
+		}
+	}
+}
+
+void Editor::updateMarquee() {
+	if (!marqueeChanged) return;
+	marqueeChanged = false;
+	ShapeManager::RegionMode mode = (marqueeEnd.x >= marqueeStart.x)? ShapeManager::CONTAINED : ShapeManager::INTERSECTING;
+	shapeManager.getShapesInRect(marqueeStart, marqueeEnd, mode, marqueeShapes);
+	shapeManager.setSelection(marqueeShapes);
+}
+
+bool Editor::isGroupSelected(Shape* shape) {
+	return shape && shape->isSelected() && shapeManager.getSelection().size() > 1;
+}
+
+ShapeGroup* Editor::getDragGroup(Shape* shape) {
+	return (shape && shape->getGroup())? shape->getGroup()->getRoot() : nullptr;
+}
+
+void Editor::onMotion(int x, int y) {
+	Trace::Scope span("Editor::onMotion");
+	AllocationCounter::Scope allocations(AllocationCounter::INPUT);
+	recorder.record(InputEvent::MOTION, x, y);
+	// Delegate to Mouse instance
+	mouse.onMove(x, y);
+	motion.countEvent();
+	if (marqueeActive) {
+		marqueeEnd = mouse.getPosition();
+		marqueeChanged = true;
+	}
+
+	// Using mouse screen position for input, rather than object position provides, a much smoother input experience
+	// and avoids potentially large floating point number arithmetic
+	if (ShapeGroup* group = getDragGroup(selectedShape)) {
+		// The same actions applied to the group's transform, so the cost doesn't depend on how many shapes are in it
+		if (mouse.isButtonPressed(mouseMappings[Action::A_TRANSLATE]) && !keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
+			motion.moveGroup(group);
+		}
+		else if (mouse.isButtonPressed(mouseMappings[Action::A_ROTATE]) && !keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
+			motion.rotateGroup(group, mouse.getScreenPosition().x - mouse.getPrevScreenPosition().x);
+		}
+		else if (mouse.isButtonPressed(mouseMappings[Action::A_SCALE]) && !keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
+			motion.scaleGroup(group, (mouse.getScreenPosition().x - mouse.getPrevScreenPosition().x) * 0.01);
+		}
+	}
+	else if (isGroupSelected(selectedShape)) {
+		// The same actions applied to the whole selection, moving it with the mouse and pivoting about its centroid
+		if (mouse.isButtonPressed(mouseMappings[Action::A_TRANSLATE]) && !keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
+			motion.moveSelection(shapeManager);
+		}
+		else if (mouse.isButtonPressed(mouseMappings[Action::A_ROTATE]) && !keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
+			motion.rotateSelection(shapeManager, mouse.getScreenPosition().x - mouse.getPrevScreenPosition().x);
+		}
+		else if (mouse.isButtonPressed(mouseMappings[Action::A_SCALE]) && !keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
+			motion.scaleSelection(shapeManager, (mouse.getScreenPosition().x - mouse.getPrevScreenPosition().x) * 0.01);
+		}
+	}
+	else if (selectedShape) {
+		if (mouse.isButtonPressed(mouseMappings[Action::A_TRANSLATE])
+			&& !keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
+			// Use mouse object position for placing shapes.
+			// Shapes are transformed once per frame rather than for every motion event, see MotionCoalescer
+			motion.moveToMouse(selectedShape);
+		}
+		else if (mouse.isButtonPressed(mouseMappings[Action::A_ROTATE])
+				 && !keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
+			motion.rotateBy(selectedShape, mouse.getScreenPosition().x - mouse.getPrevScreenPosition().x);
+		}
+		else if (mouse.isButtonPressed(mouseMappings[Action::A_SCALE])
+				 && !keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
+			motion.scaleBy(selectedShape, (mouse.getScreenPosition().x - mouse.getPrevScreenPosition().x) * 0.01);
+		}
+	}
+	if (mouse.isButtonPressed(mouseMappings[Action::A_PAN])
+			 && keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
+		// Pan when the pan button and modifier key are pressed
+		sceneSettings.panX += mouse.getScreenPosition().x - mouse.getPrevScreenPosition().x;
+		sceneSettings.panY += mouse.getScreenPosition().y - mouse.getPrevScreenPosition().y;
+	}
+	else if (mouse.isButtonPressed(mouseMappings[Action::A_ZOOM])
+		&& keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
+		// Zoom when the zoom button and modifier key are pressed
+		sceneSettings.zoom += (mouse.getPrevScreenPosition().y - mouse.getScreenPosition().y) * 0.002;
+		// Clamp max zoom at 1000% and min zoom at 1%
+		if (sceneSettings.zoom < 0.01) sceneSettings.zoom = 0.01;
+		else if (sceneSettings.zoom > 10) sceneSettings.zoom = 10;
+	}
+}
+
+void Editor::onKeyDown(unsigned char key, int x, int y) {
+	Trace::Scope span("Editor::onKeyDown");
+	AllocationCounter::Scope allocations(AllocationCounter::INPUT);
+	recorder.record(InputEvent::KEY_DOWN, key, x, y);
+	// Key actions use the selected shape as it is after the motion so far
+	motion.apply();
+	keyboard.keyboardFunc(key, x, y);
+	// Since key presses get repeated when held, the mouse position shouldn't be updated when the modifier key is pressed
+	// as it causes the position delta fluctuate too much making view manipulation less smooth
+	if (key != keyMappings[Action::A_MODIFIER]) mouse.onMove(x, y);
+
+	// Shape keys change every selected shape, unless a shape outside the selection is held
+	bool group = !shapeManager.getSelection().empty() && (!selectedShape || selectedShape->isSelected());
+
+	if (keyboard.isKeyDown(keyMappings[Action::A_ADD])) {
+		// Add a pentagon at the mouse location
+		std::cout << "Adding Shape" << std::endl;
+		shapeManager.add(new Pentagon(DEFAULT_RADIUS, Point(mouse.getPosition().x, mouse.getPosition().y)));
+	}
+	else if (keyboard.isKeyDown(keyMappings[Action::A_CLEAR])) {
+		// Clear shapes, abandoning any that are still loading
+		backgroundLoader.stop();
+		shapeManager.clear();
+		// Both are pinned while paging, so neither can be left pointing at a deleted shape
+		selectedShape = lastSelectedShape = nullptr;
+	}
+	else if (keyboard.isKeyDown(keyMappings[Action::A_DUPLICATE]) && selectedShape) {
+		// Duplicate shape
+		Shape* s = new RegularPolygon(selectedShape);
+		// Randomly offset (between -30 and 30) slightly to visualise the duplication
+		int randRange = 30 - -30 + 1;
+		s->translate(rand() % randRange + -30, rand() % randRange + -30);
+		shapeManager.add(s);
+	}
+	else if (keyboard.isKeyDown(keyMappings[Action::A_DELETE]) && selectedShape) {
+		if (lastSelectedShape == selectedShape) lastSelectedShape = nullptr;
+		shapeManager.remove(selectedShape);
+		selectedShape = nullptr;
+	}
+	else if (keyboard.isKeyDown(keyMappings[Action::A_GROUP]) && !shapeManager.getSelection().empty()) {
+		shapeManager.groupSelection();
+	}
+	else if (keyboard.isKeyDown(keyMappings[Action::A_UNGROUP]) && (group || getDragGroup(selectedShape))) {
+		// Ungroups one level, of the selection's groups or the held shape's
+		if (group) shapeManager.ungroupSelection();
+		else shapeManager.ungroup(getDragGroup(selectedShape));
+	}
+	// Colour change keys
+	else if (keyboard.isKeyDown(keyMappings[Action::A_COLOUR_RED]) && (group || selectedShape)) {
+		// Red
+		if (group) shapeManager.setSelectionColour(Colour(0.9f, 0.12f, 0.25f));
+		else selectedShape->setColour(0.9, 0.12, 0.25);
+	}
+	else if (keyboard.isKeyDown(keyMappings[Action::A_COLOUR_GREEN]) && (group || selectedShape)) {
+		// Green
+		if (group) shapeManager.setSelectionColour(Colour(0.64f, 0.91f, 0.12f));
+		else selectedShape->setColour(0.64, 0.91, 0.12);
+	}
+	else if (keyboard.isKeyDown(keyMappings[Action::A_COLOUR_BLUE]) && (group || selectedShape)) {
+		// Blue
+		if (group) shapeManager.setSelectionColour(Colour(0.12f, 0.64f, 0.9f));
+		else selectedShape->setColour(0.12, 0.64, 0.9);
+	}
+	// Cycle through shapes when w or s key is pressed
+	else if ((group || selectedShape) && (keyboard.isKeyDown(keyMappings[Action::A_MORPH_UP]) || keyboard.isKeyDown(keyMappings[Action::A_MORPH_DOWN]))
+		     && !keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
+		// Whether the shape type should be cycled in reverse
+		bool reverse = false;
+		if (keyboard.isKeyDown(keyMappings[Action::A_MORPH_DOWN])) reverse = true;
+		if (group) {
+			shapeManager.morphSelection(reverse);
+		} else {
+			// Iterate over map of shape types
+			vector<unique_ptr<Shape>>& shapeTypes = shapeManager.getTypes();
+			for (vector<unique_ptr<Shape>>::iterator it = shapeTypes.begin(); it != shapeTypes.end(); it++) {
+				// If the selected shape is the same as the current shape type
+				if (selectedShape->getName() == (*it)->getName()) {
+					if (reverse) {
+						// If cycling in reverse, and the iterator is at the beginning of the map, wrap around to the end
+						if (it == shapeTypes.begin()) it = shapeTypes.end();
+						// Minus one from the iterator to get the shapeType in front of the current shape in the map
+						it--;
+					}
+					// If the next iteration is the end of the map, wrap around to the beginning of the map
+					else if (++it == shapeTypes.end()) it = shapeTypes.begin();
+					// Morph the shape to the next shape type
+					selectedShape->morph((*it).get());
+					break;
+				}
+			}
+		}
+	}
+}
+
+void Editor::onKeyUp(unsigned char key, int x, int y) {
+	Trace::Scope span("Editor::onKeyUp");
+	AllocationCounter::Scope allocations(AllocationCounter::INPUT);
+	recorder.record(InputEvent::KEY_UP, key, x, y);
+	keyboard.keyboardUpFunc(key, x, y);
+	mouse.onMove(x, y);
+}
+
+void Editor::onSpecialDown(int key, int x, int y) {
+	Trace::Scope span("Editor::onSpecialDown");
+	AllocationCounter::Scope allocations(AllocationCounter::INPUT);
+	recorder.record(InputEvent::SPECIAL_DOWN, key, x, y);
+	motion.apply();
+	keyboard.specialFunc(key, x, y);
+	mouse.onMove(x, y);
+
+	if (keyboard.isSpecialDown(specialMappings[Action::A_SAVE])) {
+		// Save now, without waiting for the next periodic autosave
+		if (backgroundLoader.isLoading()) cout << "Can't save until loading has finished" << endl;
+		else autoSaver.requestSave(shapeManager, sceneSettings);
+	}
+	else if (keyboard.isSpecialDown(specialMappings[Action::A_TRACE])) {
+		// Write the trace so far, recording carries on
+		writeTrace();
+	}
+}
+
+void Editor::onSpecialUp(int key, int x, int y) {
+	Trace::Scope span("Editor::onSpecialUp");
+	AllocationCounter::Scope allocations(AllocationCounter::INPUT);
+	recorder.record(InputEvent::SPECIAL_UP, key, x, y);
+	keyboard.specialUpFunc(key, x, y);
+	mouse.onMove(x, y);
+}
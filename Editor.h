@@ -0,0 +1,281 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include "Utils.h"
+#include "Renderer.h"
+#include "ShapeManager.h"
+#include "Mouse.h"
+#include "Keyboard.h"
+#include "SaveManager.h"
+#include "SceneSettings.h"
+#include "AutoSaver.h"
+#include "BinarySaveManager.h"
+#include "BackgroundLoader.h"
+#include "InputRecorder.h"
+#include "MotionCoalescer.h"
+#include "AllocationCounter.h"
+#include "RenderSnapshot.h"
+#include "FrameScheduler.h"
+
+/**
+* Settings read from the program arguments
+*/
+struct EditorOptions {
+	// File to load and save, files ending in .bin use the binary format
+	std::string saveFile = "save.txt";
+	BinaryEncoding binaryEncoding;
+	// Tiled saves are always paged, untiled text saves are paged and saved tiled from then on when --tiles is passed
+	bool tiledSave = false;
+	PagingSettings pagingSettings;
+	// Input log to record to or replay, and whether replays wait for each event's recorded time
+	std::string recordFile;
+	std::string replayFile;
+	bool realtimeReplay = false;
+	// Whether replays draw each frame with the software renderer
+	bool drawReplay = false;
+	// Chrome trace file to record spans to, written on demand and on exit
+	std::string traceFile;
+	// Shapes to generate and write to the save file instead of editing, when the count isn't 0
+	GenerationSettings generation;
+	// Whether the GLUT frontend handles input and updates the scene on a separate thread from drawing, see UpdateThread
+	bool splitThreads = true;
+	// Frames per second the GLUT frontend draws at, 0 for as fast as possible, and fixed scene updates per second, see FrameScheduler
+	double frameRate = 60;
+	double updateRate = 120;
+	// Seconds between autosaves, 0 to only save on exit and on request
+	float autosaveInterval = 30;
+	// Instruction set to run the vectorised kernels with instead of the widest supported, see CpuDispatch::getName
+	std::string isa;
+
+	/**
+	* Reads the program arguments (the GLUT frontend passes them after glutInit removes any it uses):
+	* [save_file] [--compact] [--tiles] [--memory=MB] [--record=FILE] [--replay=FILE] [--realtime] [--draw] [--trace=FILE]
+	* [--single-thread] [--fps=N] [--update-rate=N] [--isa=NAME] [--generate=N] [--seed=N] [--edges=MIN,MAX] [--overlap=F] [--clustering=F] [--clusters=N] [--spread=F] 
+	* [--scale=MIN,MAX] [--rotation=MIN,MAX] [--colour=MIN,MAX]
+	* Returns: bool  False if an option is unknown or its value isn't valid, after printing it and the usage
+	*/
+	bool parse(int argc, char* argv[]);
+	/**
+	* Prints the arguments parse reads
+	*/
+	static void printUsage();
+
+protected:
+	/**
+	* Reads a MIN,MAX range, or a single value used as both
+	* Returns: bool  False if either value isn't a number
+	*/
+	static bool parseRange(const std::string& value, float& min, float& max);
+};
+
+/**
+* The shape editor, independent of any windowing system. A frontend creates one, passes it input events
+* using the InputCodes values and calls update and render each frame. Replays run it without a frontend at all.
+*
+* Usage:
+*	- Call start() once the frontend is ready for input, then update() and render(renderer) each frame
+*	- Call reshape(w, h) when the window size changes, and the on* functions for input events
+*	- Call save() before exiting
+*/
+class Editor {
+
+public:
+	static constexpr int CAMERA_WIDTH = 1000;
+	static constexpr int CAMERA_HEIGHT = static_cast<int>(CAMERA_WIDTH / (16.0 / 9)); // Optimise for 16:9 resolutions
+	static constexpr int DEFAULT_RADIUS = 25; // Used when adding and morphing shapes
+	static constexpr int WINDOW_WIDTH = 1280;
+	static constexpr int WINDOW_HEIGHT = 720;
+
+	// Actions used for key and mouse mappings
+	enum Action {
+		A_ADD, A_DUPLICATE, A_DELETE, A_ZOOM, A_PAN, A_TRANSLATE, A_SCALE, A_ROTATE,
+		A_COLOUR_RED, A_COLOUR_GREEN, A_COLOUR_BLUE, A_MORPH_UP, A_MORPH_DOWN, A_MODIFIER, A_CLEAR, A_SAVE, A_TRACE, A_MARQUEE,
+		A_GROUP, A_UNGROUP
+	};
+
+protected:
+	EditorOptions options;
+	std::map<Action, char> keyMappings;
+	std::map<Action, int> specialMappings;
+	std::map<Action, int> mouseMappings;
+
+	SceneSettings sceneSettings;
+	SaveManager saveManager;
+	ShapeManager shapeManager;
+	AutoSaver autoSaver;
+	BackgroundLoader backgroundLoader;
+	InputRecorder recorder;
+	Mouse mouse;
+	// Shape changes from mouse motion, applied once per frame
+	MotionCoalescer motion;
+	Keyboard keyboard;
+	Shape* selectedShape = nullptr;
+	Shape* lastSelectedShape = nullptr;
+	// Corners of the marquee while it's dragged from empty canvas, in world coordinates. 
+	// The shapes in it are selected once per frame when they change
+	bool marqueeActive = false;
+	bool marqueeChanged = false;
+	Point marqueeStart, marqueeEnd;
+	// Shapes in the marquee, reused so dragging it doesn't allocate
+	std::vector<Shape*> marqueeShapes;
+	// Allocations each subsystem made during the last frame, and the totals they're calculated from
+	size_t frameAllocations[AllocationCounter::SUBSYSTEM_COUNT] = {};
+	size_t allocationTotals[AllocationCounter::SUBSYSTEM_COUNT] = {};
+	// Snapshot render draws through when the scene is drawn on the thread that edits it
+	RenderSnapshot frameSnapshot;
+	// True if the scene or HUD may have changed since the last capture
+	bool dirty = true;
+	unsigned shownSaveCount = 0;
+	// Frame times of the frontend drawing the snapshots, shown in the HUD
+	FrameScheduler::Stats frameStats;
+	// Saves finished when tiles were last paged in, the paging file's index is reread after each
+	unsigned pagingSaveCount = 0;
+
+public:
+	/**
+	* Selects the options' instruction set, if one was given
+	* Parameter: const EditorOptions& options  Save file, paging and recording settings
+	*/
+	Editor(const EditorOptions& options);
+
+	/**
+	* Loads the save and starts autosaving, and recording if a record file was given
+	*/
+	void start();
+	/**
+	* Replays the options' replay file from the scene it was recorded with, then reports the latency of each event type
+	* and whether the final scene matches the recording
+	* Parameter: Renderer* frameRenderer  Renderer to draw each replayed frame with, or nullptr to only update the scene
+	* Returns: int  Exit code, 0 if the replay reproduced the recorded scene
+	*/
+	int replay(Renderer* frameRenderer);
+	/**
+	* Generates a scene with the options' generation settings and writes it to the save file, in the format the options select
+	* Returns: int  Exit code, 0 if the scene was saved
+	*/
+	int generate();
+	/**
+	* Per frame update: applies motion, adds background loaded shapes, pages tiles and autosaves.
+	* Also takes the allocations made since the previous update as the last frame's, for the HUD
+	*/
+	void update();
+	/**
+	* Draws the shapes and the HUD, and updates the view used for mouse mapping to the one drawn
+	* Parameter: Renderer& renderer  Renderer to draw with
+	* Parameter: RenderSnapshot::Detail detail  Optional work to do, see FrameScheduler
+	*/
+	void render(Renderer& renderer, RenderSnapshot::Detail detail = RenderSnapshot::DETAIL_FULL);
+	/**
+	* Captures the shapes and the HUD for drawing, possibly on another thread, and updates the view used for mouse mapping 
+	* to the one captured
+	* Parameter: RenderSnapshot& snapshot  Snapshot to overwrite
+	*/
+	void capture(RenderSnapshot& snapshot);
+	/**
+	* Parameter: int w  New window width
+	* Parameter: int h  New window height
+	*/
+	void reshape(int w, int h);
+	/**
+	* Applies pending changes, finishes the recording and writes a final save, waiting for it to finish.
+	* Writes the trace too, if one is being recorded
+	*/
+	void save();
+	/**
+	* Writes the events traced so far to the trace file
+	*/
+	void writeTrace();
+
+	/**
+	* Parameter: int button  InputCodes button
+	* Parameter: int state  InputCodes::BUTTON_DOWN or BUTTON_UP
+	* Parameter: int x  Mouse X position in window pixels
+	* Parameter: int y  Mouse Y position in window pixels
+	*/
+	void onMouse(int button, int state, int x, int y);
+	void onMotion(int x, int y);
+	void onKeyDown(unsigned char key, int x, int y);
+	void onKeyUp(unsigned char key, int x, int y);
+	/**
+	* Parameter: int key  InputCodes::KEY_X key
+	*/
+	void onSpecialDown(int key, int x, int y);
+	void onSpecialUp(int key, int x, int y);
+	/**
+	* Passes an input event to the on* function for its type. Frame events are ignored, call update for those
+	*/
+	void dispatch(const InputEvent& event);
+
+	/**
+	* Returns: unsigned long long  Checksum of the current scene, see SceneSnapshot::checksum
+	*/
+	unsigned long long sceneChecksum();
+
+	/**
+	* Returns: bool  True if input has been handled or the scene has changed since the last capture, so there's something new to draw
+	*/
+	inline bool isDirty() const { return dirty; }
+
+	inline const EditorOptions& getOptions() const { return options; }
+	inline ShapeManager& getShapeManager() { return shapeManager; }
+	inline SceneSettings& getSceneSettings() { return sceneSettings; }
+	/**
+	* Returns: size_t  Allocations a subsystem made between the last two updates
+	*/
+	inline size_t getFrameAllocations(AllocationCounter::Subsystem subsystem) const { return frameAllocations[subsystem]; }
+	/**
+	* Sets the frame times shown in the HUD from the next capture on. They don't make the editor dirty, 
+	* so drawing a frame doesn't cause another
+	* Parameter: const FrameScheduler::Stats& stats  Frame times of the frontend drawing the editor
+	*/
+	inline void setFrameStats(const FrameScheduler::Stats& stats) { frameStats = stats; }
+
+protected:
+	/**
+	* Sets up the input mappings and shape types, and loads the save. Shared by windowed runs and replays
+	*/
+	void initScene();
+	/**
+	* Adds the shape types, which saved shapes are recreated from and the up and down keys cycle through
+	*/
+	void initTypes();
+	/**
+	* Starts recording input to the record file. The scene is saved next to the log and reloaded from there,
+	* so the recording starts from exactly the scene replays load, rounding included
+	*/
+	void startRecording();
+	/**
+	* Per frame scene updates, run by update and by replayed frames
+	*/
+	void updateScene();
+	/**
+	* Selects the shapes in the marquee, if it's changed since the last update. Dragging right selects the shapes wholly inside it,
+	* dragging left also selects the shapes it touches
+	*/
+	void updateMarquee();
+	/**
+	* Returns: bool  True if the shape is selected along with others, so dragging it or pressing a shape key changes them all
+	*/
+	bool isGroupSelected(Shape* shape);
+	/**
+	* Returns: ShapeGroup*  Outermost group of the shape, which dragging the shape drags, or nullptr if it isn't grouped
+	*/
+	ShapeGroup* getDragGroup(Shape* shape);
+	/**
+	* Passes a replayed event to the handler it was recorded from
+	*/
+	void replayEvent(const InputEvent& event, Renderer* frameRenderer);
+	void load(const std::string& file);
+	/**
+	* Sets the projection matrix and viewport used for mouse mapping to the camera's orthographic projection
+	* Parameter: int w  Window width
+	* Parameter: int h  Window height
+	*/
+	void updateMouseProjection(int w, int h);
+	/**
+	* Sets the model matrix used for mouse mapping to the view render draws with: scaled by zoom then translated by pan.
+	* Mouse only recalculates its mapping when this changes
+	*/
+	void updateMouseModelMatrix();
+};
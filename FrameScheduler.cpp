@@ -0,0 +1,86 @@
+#include "stdafx.h"
+#include "FrameScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+using std::chrono::duration;
+using std::chrono::duration_cast;
+
+
+FrameScheduler::FrameScheduler(double updateRate, double frameRate, int maxDetail) 
+	: updateStep(1 / updateRate), frameInterval(frameRate > 0? 1 / frameRate : 0), detail(maxDetail), maxDetail(maxDetail) {
+	budget = (frameInterval > 0)? frameInterval : 1 / 60.0;
+	lastUpdateTime = nextFrameTime = frameStartTime = Clock::now();
+}
+
+unsigned FrameScheduler::takeFrameDelay() {
+	Clock::duration interval = duration_cast<Clock::duration>(duration<double>(frameInterval > 0? frameInterval : updateStep));
+	Clock::time_point now = Clock::now();
+	nextFrameTime += interval;
+	// Behind, so start pacing again from now rather than running frames back to back to catch up
+	if (nextFrameTime < now) {
+		nextFrameTime = now;
+		return 0;
+	}
+	// Rounded up so frames are never early
+	return static_cast<unsigned>(std::ceil(duration<double, std::milli>(nextFrameTime - now).count()));
+}
+
+int FrameScheduler::takeUpdateSteps() {
+	Clock::time_point now = Clock::now();
+	updateAccumulator += duration<double>(now - lastUpdateTime).count();
+	lastUpdateTime = now;
+	int steps = static_cast<int>(updateAccumulator / updateStep);
+	updateAccumulator -= steps * updateStep;
+	if (steps > MAX_UPDATE_STEPS) {
+		steps = MAX_UPDATE_STEPS;
+		updateAccumulator = 0;
+	}
+	return steps;
+}
+
+void FrameScheduler::beginFrame() {
+	frameStartTime = Clock::now();
+}
+
+void FrameScheduler::endFrame() {
+	double seconds = duration<double>(Clock::now() - frameStartTime).count();
+	frameTimes[frameCount++ % HISTORY] = seconds * 1000;
+
+	if (seconds > budget) {
+		overruns++;
+		headroomFrames = 0;
+		// Shed optional work after a few overruns in a row, a single slow frame could be anything
+		if (++overrunFrames >= OVERRUNS_TO_LOWER && detail > 0) {
+			detail--;
+			overrunFrames = 0;
+		}
+	} else {
+		overrunFrames = 0;
+		// Only restore detail once frames have had plenty of headroom for a while, so it doesn't flip back and forth
+		if (seconds < budget / 2 && ++headroomFrames >= HEADROOM_TO_RAISE && detail < maxDetail) {
+			detail++;
+			headroomFrames = 0;
+		}
+	}
+}
+
+FrameScheduler::Stats FrameScheduler::getStats() const {
+	Stats stats;
+	stats.frames = frameCount;
+	stats.overruns = overruns;
+	size_t count = std::min(frameCount, HISTORY);
+	if (count == 0) return stats;
+	double sorted[HISTORY];
+	std::copy(frameTimes, frameTimes + count, sorted);
+	std::sort(sorted, sorted + count);
+	for (size_t i = 0; i < count; i++) stats.mean += sorted[i];
+	stats.mean /= count;
+	stats.last = frameTimes[(frameCount - 1) % HISTORY];
+	auto percentile = [&](double p) { return sorted[std::min(count - 1, static_cast<size_t>(p * count))]; };
+	stats.p50 = percentile(0.5);
+	stats.p95 = percentile(0.95);
+	stats.p99 = percentile(0.99);
+	stats.max = sorted[count - 1];
+	return stats;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+/**
+* Paces the main loop on a monotonic clock: runs scene updates at a fixed step, draws frames at a target frame rate 
+* and leaves the loop idle in between rather than redrawing as fast as possible. Frame times are kept for statistics, and a detail level
+* is lowered when frames overrun the frame budget so optional work can be skipped, and raised again once there's headroom.
+*
+* Usage:
+*	- Each loop iteration run takeUpdateSteps() fixed updates, then wait takeFrameDelay() milliseconds without blocking input,
+*	  e.g. with a timer
+*	- If there's something new to draw, call beginFrame() and endFrame() around drawing it, drawing at getDetail()
+*/
+class FrameScheduler {
+
+public:
+	typedef std::chrono::steady_clock Clock;
+	/**
+	* Statistics of recent frame times in milliseconds, from beginFrame to endFrame, so time between frames isn't included
+	*/
+	struct Stats {
+		size_t frames = 0;
+		double last = 0, mean = 0, p50 = 0, p95 = 0, p99 = 0, max = 0;
+		// Frames that took longer than the budget, since the scheduler was created
+		size_t overruns = 0;
+	};
+
+	// Frames statistics are calculated from
+	static constexpr size_t HISTORY = 120;
+	// Most updates run per frame, after a long stall the missed updates beyond this are dropped rather than caught up
+	static constexpr int MAX_UPDATE_STEPS = 5;
+	// Consecutive overrunning frames before the detail is lowered, and frames under half the budget before it's raised
+	static constexpr int OVERRUNS_TO_LOWER = 3;
+	static constexpr int HEADROOM_TO_RAISE = 60;
+
+protected:
+	// Seconds between updates and between frames, a frame interval of 0 draws frames as fast as possible
+	double updateStep;
+	double frameInterval;
+	// Seconds a frame may take before the detail is lowered
+	double budget;
+
+	Clock::time_point lastUpdateTime;
+	double updateAccumulator = 0;
+	Clock::time_point nextFrameTime;
+	Clock::time_point frameStartTime;
+
+	// Ring buffer of the last HISTORY frame times, in milliseconds
+	double frameTimes[HISTORY] = {};
+	size_t frameCount = 0;
+	size_t overruns = 0;
+
+	int detail;
+	int maxDetail;
+	int overrunFrames = 0;
+	int headroomFrames = 0;
+
+public:
+	/**
+	* Parameter: double updateRate  Fixed updates per second
+	* Parameter: double frameRate  Target frames per second, 0 to draw as fast as possible. The budget is 1/60s when it's 0
+	* Parameter: int maxDetail  Highest detail level, which frames start at
+	*/
+	FrameScheduler(double updateRate = 120, double frameRate = 60, int maxDetail = 2);
+
+	/**
+	* Schedules the next frame. When the frame rate is unlimited the loop is only woken every update step to check for changes
+	* Returns: unsigned  Milliseconds until the next frame is due, 0 if the loop is behind
+	*/
+	unsigned takeFrameDelay();
+	/**
+	* Returns: int  Number of fixed updates due since the last call, at most MAX_UPDATE_STEPS
+	*/
+	int takeUpdateSteps();
+	/**
+	* Starts timing a frame
+	*/
+	void beginFrame();
+	/**
+	* Records the frame time and adjusts the detail level to the budget
+	*/
+	void endFrame();
+
+	/**
+	* Returns: Stats  Statistics of the last HISTORY frames
+	*/
+	Stats getStats() const;
+	/**
+	* Returns: int  Detail level to draw the next frame at, from 0 (least) to the max detail
+	*/
+	inline int getDetail() const { return detail; }
+	/**
+	* Returns: double  Seconds between fixed updates
+	*/
+	inline double getUpdateStep() const { return updateStep; }
+	/**
+	* Returns: double  Seconds between frames, 0 if unlimited
+	*/
+	inline double getFrameInterval() const { return frameInterval; }
+};
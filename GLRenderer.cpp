@@ -0,0 +1,47 @@
+#include "stdafx.h"
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+#include "GLRenderer.h"
+// The bundled GLUT header is for Windows, elsewhere the system's matches its GL headers
+#ifdef _WIN32
+#include "glut.h"
+#else
+#include <GL/glut.h>
+#endif
+
+
+GLRenderer::GLRenderer() {}
+
+void GLRenderer::clear(const Colour& colour) {
+	glClearColor(colour.r, colour.g, colour.b, 1);
+	// Clear the colour and depth buffers
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void GLRenderer::setTransform(float scale, float translateX, float translateY) {
+	glMatrixMode(GL_MODELVIEW);
+	glLoadIdentity();
+	glScalef(scale, scale, 1);
+	glTranslatef(translateX, translateY, 0);
+}
+
+void GLRenderer::fillPolygon(const Point* vertices, size_t count, const Colour& colour) {
+	glBegin(GL_POLYGON);
+	glColor3f(colour.r, colour.g, colour.b);
+	for (size_t i = 0; i < count; i++) glVertex2f(vertices[i].x, vertices[i].y);
+	glEnd();
+}
+
+void GLRenderer::drawLineLoop(const Point* vertices, size_t count, const Colour& colour) {
+	glBegin(GL_LINE_LOOP);
+	glColor3f(colour.r, colour.g, colour.b);
+	for (size_t i = 0; i < count; i++) glVertex2f(vertices[i].x, vertices[i].y);
+	glEnd();
+}
+
+void GLRenderer::drawText(float x, float y, const char* text, const Colour& colour) {
+	glColor3f(colour.r, colour.g, colour.b);
+	glRasterPos2f(x, y);
+	for (const char* c = text; *c; c++) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, *c);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Renderer.h"
+
+/**
+* Renderer for the GLUT frontend, drawing with OpenGL immediate mode and GLUT bitmap fonts.
+* Expects the projection matrix to be set to the camera's orthographic projection
+*/
+class GLRenderer : public Renderer {
+
+public:
+	GLRenderer();
+
+	virtual void clear(const Colour& colour) override;
+	virtual void setTransform(float scale, float translateX, float translateY) override;
+	virtual void fillPolygon(const Point* vertices, size_t count, const Colour& colour) override;
+	virtual void drawLineLoop(const Point* vertices, size_t count, const Colour& colour) override;
+	virtual void drawText(float x, float y, const char* text, const Colour& colour) override;
+};
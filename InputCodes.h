@@ -0,0 +1,18 @@
+#pragma once
+
+/**
+* Mouse button, button state and special key codes used by the input handlers (see Mouse, Keyboard and Editor).
+* The values are the same as GLUT's, so a GLUT frontend can pass its callback arguments straight through, 
+* and recorded input logs are the same on every platform
+*/
+struct InputCodes {
+	static constexpr int LEFT_BUTTON = 0;
+	static constexpr int MIDDLE_BUTTON = 1;
+	static constexpr int RIGHT_BUTTON = 2;
+
+	static constexpr int BUTTON_DOWN = 0;
+	static constexpr int BUTTON_UP = 1;
+
+	static constexpr int KEY_F5 = 5;
+	static constexpr int KEY_F6 = 6;
+};
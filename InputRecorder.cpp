@@ -0,0 +1,88 @@
+#include "stdafx.h"
+#include "InputRecorder.h"
+#include "ByteStream.h"
+
+using std::string;
+using std::chrono::steady_clock;
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+
+const char InputRecorder::MAGIC[4] = { 'S', 'H', 'P', 'I' };
+const unsigned InputRecorder::VERSION;
+const unsigned char InputRecorder::END;
+// Buffered bytes are written to the file once there's this many
+static const size_t FLUSH_SIZE = 64 * 1024;
+
+
+int InputEvent::getArgCount(Type type) {
+	switch (type) {
+	case MOUSE: return 4;
+	case MOTION: return 2;
+	case KEY_DOWN: case KEY_UP: case SPECIAL_DOWN: case SPECIAL_UP: return 3;
+	case RESHAPE: return 2;
+	default: return 0;
+	}
+}
+
+const char* InputEvent::getTypeName(Type type) {
+	static const char* names[TYPE_COUNT] = { "mouse", "motion", "key_down", "key_up", "special_down", "special_up", "reshape", "frame" };
+	return (type < TYPE_COUNT)? names[type] : "unknown";
+}
+
+
+InputRecorder::InputRecorder() {}
+
+InputRecorder::~InputRecorder() {
+	if (recording) {
+		flush();
+		os.close();
+	}
+}
+
+string InputRecorder::getSceneFile(const string& file, bool binary) {
+	return file + (binary? ".scene.bin" : ".scene.txt");
+}
+
+bool InputRecorder::start(string file, const InputSession& session) {
+	os.open(file, std::ios::binary | std::ios::trunc);
+	if (!os) return false;
+	buffer.clear();
+	ByteWriter writer(buffer);
+	writer.put(MAGIC);
+	writer.put(VERSION);
+	writer.put(session.seed);
+	writer.put(session.memoryBudget);
+	writer.put((session.paging? FLAG_PAGING : 0u) | (session.binaryScene? FLAG_BINARY_SCENE : 0u));
+	recording = true;
+	startTime = steady_clock::now();
+	lastTime = 0;
+	return true;
+}
+
+void InputRecorder::record(InputEvent::Type type, int a, int b, int c, int d) {
+	if (!recording) return;
+	unsigned long long time = duration_cast<microseconds>(steady_clock::now() - startTime).count();
+	ByteWriter writer(buffer);
+	writer.put(static_cast<unsigned char>(type));
+	writer.putVarint(static_cast<unsigned>(time - lastTime));
+	lastTime = time;
+	const int args[4] = { a, b, c, d };
+	for (int i = 0; i < InputEvent::getArgCount(type); i++) writer.putSigned(args[i]);
+	if (buffer.size() >= FLUSH_SIZE) flush();
+}
+
+bool InputRecorder::stop(unsigned long long checksum) {
+	if (!recording) return false;
+	ByteWriter writer(buffer);
+	writer.put(END);
+	writer.put(checksum);
+	flush();
+	os.close();
+	recording = false;
+	return !os.fail();
+}
+
+void InputRecorder::flush() {
+	os.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	buffer.clear();
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <chrono>
+
+/**
+* An input callback and its arguments, as recorded by InputRecorder
+*/
+struct InputEvent {
+	enum Type : unsigned char {
+		MOUSE,			// button, state, x, y
+		MOTION,			// x, y
+		KEY_DOWN,		// key, x, y
+		KEY_UP,			// key, x, y
+		SPECIAL_DOWN,	// key, x, y
+		SPECIAL_UP,		// key, x, y
+		RESHAPE,		// width, height
+		FRAME,			// No arguments, one per idle update
+		TYPE_COUNT
+	};
+	Type type = FRAME;
+	// Microseconds since recording started
+	unsigned long long time = 0;
+	int args[4] = { 0, 0, 0, 0 };
+
+	InputEvent() {}
+	InputEvent(Type type, int arg0 = 0, int arg1 = 0, int arg2 = 0, int arg3 = 0) : type(type), args{ arg0, arg1, arg2, arg3 } {}
+
+	/**
+	* Returns: int  Number of arguments events of the type have
+	*/
+	static int getArgCount(Type type);
+	/**
+	* Returns: const char*  Name of the event type
+	*/
+	static const char* getTypeName(Type type);
+};
+
+/**
+* State needed to replay a recorded session the same way
+*/
+struct InputSession {
+	// Seed passed to srand when recording started
+	unsigned seed = 0;
+	// Paging settings the session was recorded with
+	bool paging = false;
+	unsigned long long memoryBudget = 0;
+	// True if the scene the session started with was saved in the binary format, see InputRecorder::getSceneFile
+	bool binaryScene = false;
+};
+
+/**
+* Records input callbacks to a compact binary log, so sessions can be replayed deterministically with InputReplayer.
+* The scene at the start of the recording is saved next to the log, so replays start from the same scene
+* regardless of later saves.
+*
+* Layout:
+*	header		"SHPI", format version, random seed, paging settings, flags
+*	events		event type byte, microseconds since the previous event and the arguments, as (zigzag) varints
+*	end			END type byte and a checksum of the scene when recording stopped (see SceneSnapshot::checksum)
+*
+* Usage:
+*	- Save the starting scene to getSceneFile(log_file, binary), then call start(log_file, session)
+*	- Call record(type, args...) at the start of every input callback
+*	- Call stop(checksum) to write the end of the log
+*/
+class InputRecorder {
+
+public:
+	static const char MAGIC[4];
+	static const unsigned VERSION = 1;
+	static const unsigned FLAG_PAGING = 1;
+	static const unsigned FLAG_BINARY_SCENE = 2;
+	// Type byte marking the end of the events
+	static const unsigned char END = 0xFF;
+
+protected:
+	std::ofstream os;
+	std::vector<unsigned char> buffer;
+	bool recording = false;
+	std::chrono::steady_clock::time_point startTime;
+	unsigned long long lastTime = 0;
+
+public:
+	InputRecorder();
+	~InputRecorder();
+
+	/**
+	* Starts recording to a file, replacing it
+	* Parameter: std::string file  Log file to write
+	* Parameter: const InputSession& session  Session state to write in the header
+	* Returns: bool  True if the file was opened
+	*/
+	bool start(std::string file, const InputSession& session);
+	/**
+	* Records an event, timestamped now. Does nothing if not recording
+	* Parameter: InputEvent::Type type  Type of the event
+	* Parameter: int a, b, c, d  Arguments of the event, see InputEvent::Type. Unused arguments are ignored
+	*/
+	void record(InputEvent::Type type, int a = 0, int b = 0, int c = 0, int d = 0);
+	/**
+	* Writes the end of the log and closes it
+	* Parameter: unsigned long long checksum  Checksum of the scene when recording stopped
+	* Returns: bool  True if the whole log was written successfully
+	*/
+	bool stop(unsigned long long checksum);
+
+	/**
+	* Returns: bool  True if recording
+	*/
+	inline bool isRecording() { return recording; }
+
+	/**
+	* Parameter: const std::string& file  Log file
+	* Parameter: bool binary  True if the scene is saved in the binary format
+	* Returns: std::string  File the scene a log starts with is saved to
+	*/
+	static std::string getSceneFile(const std::string& file, bool binary);
+
+protected:
+	/**
+	* Appends the buffered events to the file
+	*/
+	void flush();
+};
@@ -0,0 +1,103 @@
+#include "stdafx.h"
+#include "InputReplayer.h"
+#include "ByteStream.h"
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <iomanip>
+
+using std::string;
+using std::vector;
+using std::chrono::steady_clock;
+using std::chrono::duration;
+using std::chrono::microseconds;
+using std::milli;
+
+
+InputReplayer::InputReplayer() {}
+
+bool InputReplayer::load(string file) {
+	events.clear();
+	checksumRecorded = false;
+	checksum = 0;
+	std::ifstream is(file, std::ios::binary);
+	if (!is) return false;
+	vector<unsigned char> bytes((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+	ByteReader reader(bytes.data(), bytes.data() + bytes.size());
+
+	char magic[4];
+	reader.getArray(magic, 4);
+	if (!reader.ok || memcmp(magic, InputRecorder::MAGIC, 4) != 0 || reader.get<unsigned>() != InputRecorder::VERSION) return false;
+	session.seed = reader.get<unsigned>();
+	session.memoryBudget = reader.get<unsigned long long>();
+	unsigned flags = reader.get<unsigned>();
+	if (!reader.ok) return false;
+	session.paging = (flags & InputRecorder::FLAG_PAGING) != 0;
+	session.binaryScene = (flags & InputRecorder::FLAG_BINARY_SCENE) != 0;
+
+	unsigned long long time = 0;
+	while (reader.remaining() > 0) {
+		unsigned char type = reader.get<unsigned char>();
+		if (type == InputRecorder::END) {
+			checksum = reader.get<unsigned long long>();
+			checksumRecorded = reader.ok;
+			break;
+		}
+		if (type >= InputEvent::TYPE_COUNT) return false;
+		InputEvent event;
+		event.type = static_cast<InputEvent::Type>(type);
+		time += reader.getVarint();
+		event.time = time;
+		for (int i = 0; i < InputEvent::getArgCount(event.type); i++) event.args[i] = reader.getSigned();
+		// Stop at an event that was only partly written
+		if (!reader.ok) break;
+		events.push_back(event);
+	}
+	return true;
+}
+
+void InputReplayer::run(const std::function<void(const InputEvent&)>& handler, bool realtime) {
+	for (auto& typeTimes : times) typeTimes.clear();
+	steady_clock::time_point start = steady_clock::now();
+	for (const InputEvent& event : events) {
+		if (realtime) std::this_thread::sleep_until(start + microseconds(event.time));
+		steady_clock::time_point eventStart = steady_clock::now();
+		handler(event);
+		times[event.type].push_back(duration<double, milli>(steady_clock::now() - eventStart).count());
+	}
+	runTime = duration<double, milli>(steady_clock::now() - start).count();
+}
+
+InputReplayer::Latency InputReplayer::getLatency(InputEvent::Type type) const {
+	Latency latency;
+	vector<double> sorted = times[type];
+	if (sorted.empty()) return latency;
+	std::sort(sorted.begin(), sorted.end());
+	latency.count = sorted.size();
+	double total = 0;
+	for (double time : sorted) total += time;
+	latency.mean = total / sorted.size();
+	auto percentile = [&](double p) { return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))]; };
+	latency.p50 = percentile(0.5);
+	latency.p95 = percentile(0.95);
+	latency.p99 = percentile(0.99);
+	latency.max = sorted.back();
+	return latency;
+}
+
+void InputReplayer::printReport(std::ostream& os) const {
+	os << std::left << std::setw(14) << "Event" << std::right << std::setw(8) << "Count"
+		<< std::setw(10) << "Mean ms" << std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99" << std::setw(10) << "Max" << std::endl;
+	os << std::fixed << std::setprecision(3);
+	for (int type = 0; type < InputEvent::TYPE_COUNT; type++) {
+		Latency latency = getLatency(static_cast<InputEvent::Type>(type));
+		if (latency.count == 0) continue;
+		os << std::left << std::setw(14) << InputEvent::getTypeName(static_cast<InputEvent::Type>(type)) << std::right << std::setw(8) << latency.count
+			<< std::setw(10) << latency.mean << std::setw(10) << latency.p50 << std::setw(10) << latency.p95
+			<< std::setw(10) << latency.p99 << std::setw(10) << latency.max << std::endl;
+	}
+	os << "Replayed " << events.size() << " events in " << runTime << "ms" << std::endl;
+	os << std::defaultfloat;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <ostream>
+#include "InputRecorder.h"
+
+/**
+* Replays a log written by InputRecorder, passing each event to a handler and timing how long it takes,
+* so recorded sessions can be run headlessly as performance regression tests.
+*
+* Usage:
+*	- Call load(log_file), then load the scene at InputRecorder::getSceneFile(log_file, getSession().binaryScene)
+*	- Call run(handler, realtime) to replay the events
+*	- Print the per event type latencies with printReport(stream), and compare getChecksum() with the final scene
+*/
+class InputReplayer {
+
+public:
+	/**
+	* Latencies of the events of a type, in milliseconds
+	*/
+	struct Latency {
+		size_t count = 0;
+		double mean = 0, p50 = 0, p95 = 0, p99 = 0, max = 0;
+	};
+
+protected:
+	InputSession session;
+	std::vector<InputEvent> events;
+	bool checksumRecorded = false;
+	unsigned long long checksum = 0;
+	// Milliseconds each event took to handle during the last run, by event type
+	std::vector<double> times[InputEvent::TYPE_COUNT];
+	double runTime = 0;
+
+public:
+	InputReplayer();
+
+	/**
+	* Loads a log
+	* Parameter: std::string file  Log written by InputRecorder
+	* Returns: bool  True if the log was valid. A log cut short, e.g. by a crash, is still loaded up to the last whole event
+	*/
+	bool load(std::string file);
+	/**
+	* Passes each loaded event to a handler in order, timing each call
+	* Parameter: const std::function<void(const InputEvent&)>& handler  Called for each event
+	* Parameter: bool realtime  True to wait until each event's recorded time before handling it, false to replay as fast as possible
+	*/
+	void run(const std::function<void(const InputEvent&)>& handler, bool realtime);
+	/**
+	* Returns: Latency  Latencies of the events of a type during the last run
+	*/
+	Latency getLatency(InputEvent::Type type) const;
+	/**
+	* Writes a table of latencies per event type during the last run
+	* Parameter: std::ostream& os  Stream to write to
+	*/
+	void printReport(std::ostream& os) const;
+
+	/**
+	* Returns: const InputSession&  Session state the log was recorded with
+	*/
+	inline const InputSession& getSession() const { return session; }
+	/**
+	* Returns: const std::vector<InputEvent>&  Loaded events
+	*/
+	inline const std::vector<InputEvent>& getEvents() const { return events; }
+	/**
+	* Returns: bool  True if the recording was stopped properly, and so has a final scene checksum
+	*/
+	inline bool hasChecksum() const { return checksumRecorded; }
+	/**
+	* Returns: unsigned long long  Checksum of the scene when recording stopped
+	*/
+	inline unsigned long long getChecksum() const { return checksum; }
+	/**
+	* Returns: double  Milliseconds the last run took
+	*/
+	inline double getRunTime() const { return runTime; }
+};
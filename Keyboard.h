@@ -28,14 +28,14 @@ public:
 	void keyboardUpFunc(unsigned char key, int x, int y);
 	/**
 	* Glut special key call back
-	* Parameter: int key  Key (GLUT_KEY_X) that was pressed
+	* Parameter: int key  Key (InputCodes::KEY_X) that was pressed
 	* Parameter: int x  Mouse X position when the key pressed
 	* Parameter: int y  Mouse Y position when the key pressed
 	*/
 	void specialFunc(int key, int x, int y);
 	/**
 	* Glut special key up call back
-	* Parameter: int key  Key (GLUT_KEY_X) that was released
+	* Parameter: int key  Key (InputCodes::KEY_X) that was released
 	* Parameter: int x  Mouse X position when the key released
 	* Parameter: int y  Mouse Y position when the key released
 	*/
@@ -47,7 +47,7 @@ public:
 	*/
 	inline bool isKeyDown(unsigned char key) { return keyStates[key]; }
 	/**
-	* Parameter: int key  GLUT_KEY_X key to query
+	* Parameter: int key  InputCodes::KEY_X key to query
 	* Returns: bool  True if the key is currently pressed down
 	*/
 	inline bool isSpecialDown(int key) { return specialStates[key]; }
@@ -0,0 +1,123 @@
+#include "stdafx.h"
+#include "MotionCoalescer.h"
+#include "ShapeManager.h"
+#include "ShapeGroup.h"
+#include <algorithm>
+
+
+MotionCoalescer::MotionCoalescer(Mouse& mouse) : mouse(mouse) {}
+
+void MotionCoalescer::moveToMouse(Shape* target) {
+	setTarget(target);
+	moved = true;
+}
+
+void MotionCoalescer::rotateBy(Shape* target, float angle) {
+	setTarget(target);
+	rotation += angle;
+}
+
+void MotionCoalescer::scaleBy(Shape* target, float amount) {
+	setTarget(target);
+	scale += amount;
+}
+
+void MotionCoalescer::beginSelectionDrag(ShapeManager& manager) {
+	apply();
+	pivot = manager.getSelectionCentroid();
+	dragPosition = mouse.getPosition();
+}
+
+void MotionCoalescer::moveSelection(ShapeManager& manager) {
+	setTarget(&manager);
+	moved = true;
+}
+
+void MotionCoalescer::rotateSelection(ShapeManager& manager, float angle) {
+	setTarget(&manager);
+	rotation += angle;
+}
+
+void MotionCoalescer::scaleSelection(ShapeManager& manager, float amount) {
+	setTarget(&manager);
+	scale += amount;
+}
+
+void MotionCoalescer::beginGroupDrag() {
+	apply();
+	dragPosition = mouse.getPosition();
+}
+
+void MotionCoalescer::moveGroup(ShapeGroup* target) {
+	setTarget(target);
+	moved = true;
+}
+
+void MotionCoalescer::rotateGroup(ShapeGroup* target, float angle) {
+	setTarget(target);
+	rotation += angle;
+}
+
+void MotionCoalescer::scaleGroup(ShapeGroup* target, float amount) {
+	setTarget(target);
+	scale += amount;
+}
+
+Point MotionCoalescer::takeDragDistance() {
+	if (!moved) return Point(0, 0);
+	Point position = mouse.getPosition();
+	Point distance(position.x - dragPosition.x, position.y - dragPosition.y);
+	dragPosition = position;
+	return distance;
+}
+
+bool MotionCoalescer::apply() {
+	if (!shape && !selectionManager && !group) return false;
+	if (selectionManager) {
+		// The whole selection is moved by the mouse's movement since the last move, and keeps pivoting about the same point of it
+		Point distance = takeDragDistance();
+		// Scaling a group down past nothing would flip it, so it stops at a hundredth per frame
+		selectionManager->transformSelection(pivot, rotation, std::max(1 + scale, 0.01f), distance.x, distance.y);
+		pivot.x += distance.x;
+		pivot.y += distance.y;
+	} else if (group) {
+		// Only the group's own transform changes, however many shapes are in it
+		Point distance = takeDragDistance();
+		if (moved) group->translate(distance.x, distance.y);
+		if (rotation != 0) group->rotateBy(rotation);
+		if (scale != 0) group->setScale(std::max(group->getScale() + scale, 0.01f));
+	} else {
+		// Moving only needs the latest mouse position, which is only mapped to object coordinates here
+		if (moved) shape->setPosition(mouse.getPosition().x, mouse.getPosition().y);
+		if (rotation != 0) shape->rotateBy(rotation);
+		// Scaling down stops at a hundredth, like selections and groups, rather than flipping the shape through nothing
+		if (scale != 0) shape->setScale(std::max(shape->getScale() + scale, 0.01f));
+	}
+	updateCount++;
+	discard();
+	return true;
+}
+
+void MotionCoalescer::discard() {
+	shape = nullptr;
+	selectionManager = nullptr;
+	group = nullptr;
+	moved = false;
+	rotation = 0;
+	scale = 0;
+}
+
+void MotionCoalescer::setTarget(Shape* target) {
+	if (selectionManager || group || (shape && shape != target)) apply();
+	shape = target;
+}
+
+void MotionCoalescer::setTarget(ShapeManager* manager) {
+	if (shape || group || (selectionManager && selectionManager != manager)) apply();
+	selectionManager = manager;
+}
+
+void MotionCoalescer::setTarget(ShapeGroup* target) {
+	if (shape || selectionManager || (group && group != target)) apply();
+	group = target;
+}
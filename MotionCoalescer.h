@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Shape.h"
+#include "Mouse.h"
+
+class ShapeManager;
+class ShapeGroup;
+
+/**
+* Accumulates the changes mouse motion events make to a shape, a selection or a group, so they're transformed once per frame
+* however many motion events arrive. Moves keep the last position, rotations and scaling are summed.
+*
+* Usage:
+*	- Call moveToMouse/rotateBy/scaleBy(shape, ...) from the motion callback instead of transforming the shape
+*	- To drag a selection instead, call beginSelectionDrag(manager) when the drag starts, then moveSelection/rotateSelection/scaleSelection
+*	- To drag a group, call beginGroupDrag when the drag starts, then moveGroup/rotateGroup/scaleGroup
+*	- Call apply() once per frame before drawing, and before handling any event that reads or changes the shape
+*/
+class MotionCoalescer {
+
+protected:
+	Mouse& mouse;
+	// Shape the pending changes are for, the manager whose selection they're for or the group they're for
+	Shape* shape = nullptr;
+	ShapeManager* selectionManager = nullptr;
+	ShapeGroup* group = nullptr;
+	// Point a dragged selection rotates and scales about, and the mouse's object position a selection or group was last moved to
+	Point pivot;
+	Point dragPosition;
+	bool moved = false;
+	float rotation = 0;
+	float scale = 0;
+	// Motion events received and shape updates applied
+	size_t eventCount = 0;
+	size_t updateCount = 0;
+
+public:
+	/**
+	* Parameter: Mouse& mouse  Mouse whose object position moved shapes are placed at
+	*/
+	MotionCoalescer(Mouse& mouse);
+
+	/**
+	* Counts a motion event, whether or not it changes a shape
+	*/
+	inline void countEvent() { eventCount++; }
+	/**
+	* Moves a shape to the mouse's object position when the changes are applied
+	* Parameter: Shape* target  Shape to move. Changes pending for another shape are applied first
+	*/
+	void moveToMouse(Shape* target);
+	/**
+	* Parameter: Shape* target  Shape to rotate
+	* Parameter: float angle  Degrees to add to the pending rotation
+	*/
+	void rotateBy(Shape* target, float angle);
+	/**
+	* Parameter: Shape* target  Shape to scale
+	* Parameter: float amount  Amount to add to the pending scale
+	*/
+	void scaleBy(Shape* target, float amount);
+	/**
+	* Starts dragging a manager's selection, from the mouse's current object position and pivoting about the selection's centroid
+	*/
+	void beginSelectionDrag(ShapeManager& manager);
+	/**
+	* Moves the selection by as far as the mouse has moved since it was last moved, see beginSelectionDrag
+	*/
+	void moveSelection(ShapeManager& manager);
+	/**
+	* Parameter: float angle  Degrees to add to the pending rotation about the pivot
+	*/
+	void rotateSelection(ShapeManager& manager, float angle);
+	/**
+	* Parameter: float amount  Amount to add to the pending scale, the selection's scales and distances from the pivot are multiplied by 1 + amount
+	*/
+	void scaleSelection(ShapeManager& manager, float amount);
+	/**
+	* Starts dragging a group, from the mouse's current object position. Groups rotate and scale about their own position
+	*/
+	void beginGroupDrag();
+	/**
+	* Moves a group by as far as the mouse has moved since it was last moved, see beginGroupDrag
+	* Parameter: ShapeGroup* target  Group without a parent, so it moves in world coordinates
+	*/
+	void moveGroup(ShapeGroup* target);
+	/**
+	* Parameter: float angle  Degrees to add to the pending rotation
+	*/
+	void rotateGroup(ShapeGroup* target, float angle);
+	/**
+	* Parameter: float amount  Amount to add to the pending scale, as scaleBy does for shapes
+	*/
+	void scaleGroup(ShapeGroup* target, float amount);
+	/**
+	* Applies the pending changes to the shape, selection or group
+	* Returns: bool  True if there were changes to apply
+	*/
+	bool apply();
+	/**
+	* Drops the pending changes without applying them, such as when their shape is deleted
+	*/
+	void discard();
+
+	/**
+	* Returns: bool  True if there are changes waiting to be applied
+	*/
+	inline bool hasPending() { return shape != nullptr || selectionManager != nullptr || group != nullptr; }
+	/**
+	* Returns: size_t  Number of motion events received
+	*/
+	inline size_t getEventCount() { return eventCount; }
+	/**
+	* Returns: size_t  Number of times pending changes were applied to a shape, usually at most once per frame
+	*/
+	inline size_t getUpdateCount() { return updateCount; }
+
+protected:
+	/**
+	* Sets the shape, selection or group changes are pending for, applying any changes pending for a different one
+	*/
+	void setTarget(Shape* target);
+	void setTarget(ShapeManager* manager);
+	void setTarget(ShapeGroup* target);
+	/**
+	* Returns: Point  How far the mouse has moved since the last move of a selection or group, if there's a move pending
+	*/
+	Point takeDragDistance();
+};
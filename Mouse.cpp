@@ -1,37 +1,110 @@
 #include "stdafx.h"
 #include "Mouse.h"
-#include "glut.h"
-#include <gl\GL.h>
+#include "InputCodes.h"
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+
+/**
+* Multiplies two column major 4x4 matrices
+*/
+static void multiplyMatrices(const double* a, const double* b, double* out) {
+	for (int col = 0; col < 4; col++) {
+		for (int row = 0; row < 4; row++) {
+			double sum = 0;
+			for (int i = 0; i < 4; i++) sum += a[i * 4 + row] * b[col * 4 + i];
+			out[col * 4 + row] = sum;
+		}
+	}
+}
+
+/**
+* Inverts a 4x4 matrix by Gauss-Jordan elimination with partial pivoting
+* Returns: bool  False if the matrix is singular
+*/
+static bool invertMatrix(const double* matrix, double* out) {
+	double m[4][8];
+	for (int row = 0; row < 4; row++) {
+		for (int col = 0; col < 4; col++) {
+			m[row][col] = matrix[col * 4 + row];
+			m[row][col + 4] = (row == col)? 1 : 0;
+		}
+	}
+	for (int col = 0; col < 4; col++) {
+		int pivot = col;
+		for (int row = col + 1; row < 4; row++) {
+			if (std::fabs(m[row][col]) > std::fabs(m[pivot][col])) pivot = row;
+		}
+		if (m[pivot][col] == 0) return false;
+		if (pivot != col) std::swap(m[pivot], m[col]);
+		double scale = 1 / m[col][col];
+		for (int i = 0; i < 8; i++) m[col][i] *= scale;
+		for (int row = 0; row < 4; row++) {
+			if (row == col || m[row][col] == 0) continue;
+			double factor = m[row][col];
+			for (int i = 0; i < 8; i++) m[row][i] -= factor * m[col][i];
+		}
+	}
+	for (int row = 0; row < 4; row++) {
+		for (int col = 0; col < 4; col++) out[col * 4 + row] = m[row][col + 4];
+	}
+	return true;
+}
 
 
 Mouse::Mouse() {
+	// Identity matrices until the view is set up
+	for (int i = 0; i < 16; i++) modelViewMatrix[i] = projectionMatrix[i] = (i % 5 == 0)? 1 : 0;
+	viewport[0] = viewport[1] = 0;
+	viewport[2] = viewport[3] = 1;
+	std::fill(screenTransform, screenTransform + 9, 0.0);
+	updateScreenTransform();
 	// Default button states
-	buttonStates[GLUT_LEFT_BUTTON] = GLUT_UP;
-	buttonStates[GLUT_RIGHT_BUTTON] = GLUT_UP;
-	buttonStates[GLUT_MIDDLE_BUTTON] = GLUT_UP;
+	buttonStates[InputCodes::LEFT_BUTTON] = InputCodes::BUTTON_UP;
+	buttonStates[InputCodes::RIGHT_BUTTON] = InputCodes::BUTTON_UP;
+	buttonStates[InputCodes::MIDDLE_BUTTON] = InputCodes::BUTTON_UP;
 }
 
 Point Mouse::screenToObject(int x, int y) {
-	// Using cached model and projection matrix
-	GLint viewportMatrix[4];
-	GLfloat winX, winY;
-	GLdouble objectX, objectY, objectZ;
-
-	// Get viewport matrix
-	glGetIntegerv(GL_VIEWPORT, viewportMatrix);
-
-	winX = x;
-	winY = viewportMatrix[3] - y; // invert y so 0,0 is top left
-	// Map screen coordinates to object coordinates
-	gluUnProject(winX, winY, 0, modelViewMatrix, projectionMatrix, viewportMatrix, &objectX, &objectY, &objectZ);
-	return Point(objectX, objectY);
+	double winX = x;
+	double winY = viewport[3] - y; // invert y so 0,0 is top left
+	const double* t = screenTransform;
+	double w = t[6] * winX + t[7] * winY + t[8];
+	return Point((t[0] * winX + t[1] * winY + t[2]) / w, (t[3] * winX + t[4] * winY + t[5]) / w);
+}
+void Mouse::setModelMatrix(const double* matrix) {
+	// Called every frame, but the view only changes when it's panned or zoomed
+	if (memcmp(matrix, modelViewMatrix, sizeof(modelViewMatrix)) == 0) return;
+	// Positions are in the view they were recorded in
+	resolvePositions();
+	std::copy(matrix, matrix + 16, modelViewMatrix);
+	updateScreenTransform();
 }
-void Mouse::updateModelMatrix() {
-	glGetDoublev(GL_MODELVIEW_MATRIX, modelViewMatrix);
+void Mouse::setProjectionMatrix(const double* matrix, const int* newViewport) {
+	resolvePositions();
+	std::copy(matrix, matrix + 16, projectionMatrix);
+	std::copy(newViewport, newViewport + 4, viewport);
+	updateScreenTransform();
 }
-void Mouse::updateProjectionMatrix() {
-	glGetDoublev(GL_PROJECTION_MATRIX, projectionMatrix);
+
+void Mouse::updateScreenTransform() {
+	if (viewport[2] <= 0 || viewport[3] <= 0) return;
+	double combined[16], inverse[16];
+	multiplyMatrices(projectionMatrix, modelViewMatrix, combined);
+	if (!invertMatrix(combined, inverse)) return;
+	// Window to normalised device coordinates, as gluUnProject does with a window z of 0 (device z of -1)
+	double scaleX = 2.0 / viewport[2], offsetX = -1 - 2.0 * viewport[0] / viewport[2];
+	double scaleY = 2.0 / viewport[3], offsetY = -1 - 2.0 * viewport[1] / viewport[3];
+	// Then fold the inverse's x, y and w rows into the 2D transform
+	const int rows[3] = { 0, 1, 3 };
+	for (int i = 0; i < 3; i++) {
+		int row = rows[i];
+		screenTransform[i * 3] = inverse[row] * scaleX;
+		screenTransform[i * 3 + 1] = inverse[4 + row] * scaleY;
+		screenTransform[i * 3 + 2] = inverse[row] * offsetX + inverse[4 + row] * offsetY - inverse[8 + row] + inverse[12 + row];
+	}
 }
 
 void Mouse::onClick(int button, int state, int x, int y) {
@@ -43,25 +116,30 @@ void Mouse::onMove(int x, int y) {
 	prevScreenPosition = screenPosition;
 	screenPosition.x = x;
 	screenPosition.y = y;
-	// Update object coordinates
-	Point objectCoords = screenToObject(x, y);
-	prevPosition = position;
-	position.x = objectCoords.x;
-	position.y = objectCoords.y;
+	// Object coordinates are mapped when they're next needed
+	if (!positionStale) prevPosition = position;
+	prevPositionStale = positionStale;
+	positionStale = true;
+}
+
+void Mouse::resolvePositions() {
+	if (prevPositionStale) prevPosition = screenToObject(prevScreenPosition.x, prevScreenPosition.y);
+	if (positionStale) position = screenToObject(screenPosition.x, screenPosition.y);
+	prevPositionStale = positionStale = false;
 }
 
 bool Mouse::isButtonPressed(int button) {
-	return buttonStates[button] == GLUT_DOWN;
+	return buttonStates[button] == InputCodes::BUTTON_DOWN;
 }
 
 bool Mouse::leftButtonPressed() {
-	return buttonStates[GLUT_LEFT_BUTTON] == GLUT_DOWN;
+	return buttonStates[InputCodes::LEFT_BUTTON] == InputCodes::BUTTON_DOWN;
 }
 
 bool Mouse::rightButtonPressed() {
-	return buttonStates[GLUT_RIGHT_BUTTON] == GLUT_DOWN;
+	return buttonStates[InputCodes::RIGHT_BUTTON] == InputCodes::BUTTON_DOWN;
 }
 
 bool Mouse::middleButtonPressed() {
-	return buttonStates[GLUT_MIDDLE_BUTTON] == GLUT_DOWN;
+	return buttonStates[InputCodes::MIDDLE_BUTTON] == InputCodes::BUTTON_DOWN;
 }
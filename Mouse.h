@@ -5,7 +5,8 @@
 
 /**
 * Stores mouse information such as position and button states. 
-* Callbacks should be passed window coordinates which will be converted to object coordinates 
+* Callbacks should be passed window coordinates which will be converted to object coordinates.
+* Object coordinates are only calculated when they're asked for, so motion events that only use screen positions stay cheap
 */
 class Mouse {
 
@@ -19,16 +20,23 @@ protected:
 	// Position in screen coordinates
 	Point screenPosition;
 	std::unordered_map<int, int> buttonStates;
+	// True if position or prevPosition haven't been mapped from the screen positions since they last changed
+	bool positionStale = false;
+	bool prevPositionStale = false;
 
-	// Cached matrices
-	GLdouble modelViewMatrix[16];
-	GLdouble projectionMatrix[16];
+	// Cached matrices, column major as OpenGL stores them
+	double modelViewMatrix[16];
+	double projectionMatrix[16];
+	int viewport[4];
+	// Window to object transform, the inverse of viewport * projection * model view on the z = 0 plane.
+	// Rows map (window x, window y, 1) to homogeneous object x, y and w, where w is 1 for orthographic views
+	double screenTransform[9];
 
 public:
 	Mouse();
 
 	/**
-	* Maps a screen point (mouse position) to object coordinates
+	* Maps a screen point (mouse position) to object coordinates, using the transform cached when the view last changed
 	* Parameter: int x  Screen x coordinate
 	* Parameter: int y  Screen y coordinate
 	* Returns: Point in object coordinates
@@ -36,13 +44,16 @@ public:
 	Point screenToObject(int x, int y);
 
 	/**
-	* Updates the cached model matrix used for screen to object mapping to the current model matrix.
+	* Sets the model matrix used for screen to object mapping. Should be called whenever the view is panned or zoomed
+	* Parameter: const double* matrix  Column major 4x4 model view matrix
 	*/
-	void updateModelMatrix();
+	void setModelMatrix(const double* matrix);
 	/**
-	* Updates the cached projection matrix used for screen to object mapping to the current projection matrix.
+	* Sets the projection matrix and viewport used for screen to object mapping. Should be called whenever the window is reshaped
+	* Parameter: const double* matrix  Column major 4x4 projection matrix
+	* Parameter: const int* newViewport  Viewport x, y, width and height
 	*/
-	void updateProjectionMatrix();
+	void setProjectionMatrix(const double* matrix, const int* newViewport);
 
 	/**
 	* Glut mouse callback
@@ -81,7 +92,10 @@ public:
 	/**
 	* Returns: Point  Mouse position in object coordinates
 	*/
-	inline Point getPosition() { return position; }
+	inline Point getPosition() { 
+		if (positionStale) resolvePositions();
+		return position; 
+	}
 	/**
 	* Returns: Point  Mouse position in screen coordinates
 	*/
@@ -90,11 +104,24 @@ public:
 	/**
 	* Returns: Point  Last object position of the mouse before the current position was updated
 	*/
-	inline Point getPrevPosition() { return prevPosition; }
+	inline Point getPrevPosition() { 
+		if (prevPositionStale) resolvePositions();
+		return prevPosition; 
+	}
 	/**
 	* Returns: Point  Last screen position of the mouse before the current position was updated
 	*/
 	inline Point getPrevScreenPosition() { return prevScreenPosition; }
 
+protected:
+	/**
+	* Recalculates the cached window to object transform from the matrices and viewport. 
+	* Leaves the transform as it was if the view can't be inverted
+	*/
+	void updateScreenTransform();
+	/**
+	* Maps any stale screen positions to object coordinates, using the current view
+	*/
+	void resolvePositions();
 };
 
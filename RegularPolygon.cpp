@@ -1,22 +1,29 @@
 #include "stdafx.h"
 #include "RegularPolygon.h"
 #include <iostream>
+#include <cmath>
 
 
 RegularPolygon::RegularPolygon(std::string name, int numEdges, float radius, Point position)
-	: Shape(name, position), numEdges(numEdges), radius(radius) {
+	: Shape(name, position) {
+	this->numEdges = numEdges;
+	this->radius = radius;
 	create();
 }
 
 RegularPolygon::RegularPolygon(Shape* shape) : Shape(shape) {}
 
+bool RegularPolygon::isValid(int numEdges, float radius) {
+	return numEdges >= 3 && numEdges <= MAX_EDGES && std::isfinite(radius);
+}
+
 
 void RegularPolygon::create() {
 	// Angle between vertices in radians
 	float rot = 3.142f * ((360.f / numEdges) / 180.f);
+	std::vector<Point> vertices;
 	// Add the initial vertex directly up from the centre
 	vertices.push_back(Point(0, radius));
-	std::cout << rot << std::endl;
 	// For each remaining vertex
 	for (int i = 1; i <= numEdges; i++) {
 		// Create a vertex rotated counter-clockwise from the initial vertex by 
@@ -26,4 +33,5 @@ void RegularPolygon::create() {
 			vertices[0].x * sin(rot * i) + vertices[0].y * cos(rot * i)
 		));
 	}
+	geometry = std::make_shared<const std::vector<Point>>(std::move(vertices));
 }
\ No newline at end of file
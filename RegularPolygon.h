@@ -6,11 +6,9 @@
 
 class RegularPolygon : public Shape {
 
-protected:
-	int numEdges;
-	float radius;
-
 public:
+	// Most edges a polygon can be loaded with, so a corrupt save can't create an enormous one
+	static const int MAX_EDGES = 64;
 	
 	/**
 	* Creates a regular polygon where all sides are of equal length and vertices are rotated around it's center
@@ -22,6 +20,11 @@ public:
 	RegularPolygon(std::string name, int numEdges, float radius, Point position);
 	RegularPolygon(Shape* shape);
 
+	/**
+	* Returns: bool  True if a polygon can be created with the edges and radius, 3 to MAX_EDGES edges and a finite radius
+	*/
+	static bool isValid(int numEdges, float radius);
+
 protected:
 	virtual void create() override;
 };
@@ -0,0 +1,99 @@
+#include "stdafx.h"
+#include "RenderSnapshot.h"
+#include "ShapeGroup.h"
+#include "Trace.h"
+#include <cstdio>
+#include <cmath>
+
+using std::vector;
+using std::unique_ptr;
+
+
+void RenderSnapshot::capture(const vector<unique_ptr<Shape>>& sceneShapes, const SceneSettings& settings) {
+	Trace::Scope span("RenderSnapshot::capture");
+	shapes.resize(sceneShapes.size());
+	for (size_t i = 0; i < sceneShapes.size(); i++) {
+		Shape& shape = *sceneShapes[i];
+		ShapeState& state = shapes[i];
+		// Only replace the geometry pointer when it's changed, saving the reference count updates
+		if (state.geometry != shape.getGeometry()) state.geometry = shape.getGeometry();
+		state.transform = ShapeTransform(shape.getRotationSin(), shape.getRotationCos(), shape.getScale(), shape.getPosition());
+		state.extent = shape.getExtent();
+		// Grouped shapes are relative to their group, whose world transform is cached until it or a group above it changes
+		if (ShapeGroup* group = shape.getGroup()) {
+			state.transform = group->getWorldTransform().compose(state.transform);
+			state.extent *= std::abs(group->getWorldScale());
+		}
+		state.colour = shape.getColour();
+		state.outlineColour = shape.getOutlineColour();
+		state.outlineVisible = shape.isOutlineVisible();
+	}
+	sceneSettings = settings;
+	textLineCount = 0;
+	marqueeVisible = false;
+	inputTime = 0;
+}
+
+void RenderSnapshot::setMarquee(const Point& corner, const Point& oppositeCorner) {
+	marquee[0] = corner;
+	marquee[1] = Point(oppositeCorner.x, corner.y);
+	marquee[2] = oppositeCorner;
+	marquee[3] = Point(corner.x, oppositeCorner.y);
+	marqueeVisible = true;
+}
+
+void RenderSnapshot::addText(float x, float y, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	addText(false, x, y, format, args);
+	va_end(args);
+}
+
+void RenderSnapshot::addDetailText(float x, float y, const char* format, ...) {
+	va_list args;
+	va_start(args, format);
+	addText(true, x, y, format, args);
+	va_end(args);
+}
+
+void RenderSnapshot::addText(bool detail, float x, float y, const char* format, va_list args) {
+	if (textLineCount == MAX_TEXT_LINES) return;
+	TextLine& line = textLines[textLineCount++];
+	line.x = x;
+	line.y = y;
+	line.detail = detail;
+	vsnprintf(line.text, MAX_TEXT_LENGTH, format, args);
+}
+
+void RenderSnapshot::render(Renderer& renderer, Detail detail) {
+	Trace::Scope span("RenderSnapshot::render");
+	// Set the background colour to white
+	renderer.clear(Colour(1, 1, 1));
+
+	// Scale view by zoom amount, after translating by the pan amount
+	renderer.setTransform(sceneSettings.zoom, static_cast<float>(sceneSettings.panX), static_cast<float>(sceneSettings.panY));
+	// Level of detail: at minimal detail, skip shapes too small to make out. Extents are radii, so compare with half the size
+	float minExtent = (detail == DETAIL_MINIMAL)? MIN_SHAPE_SIZE / 2 / sceneSettings.zoom : 0;
+	// Transform every drawn shape's vertices in one pass, then draw them in order
+	transforms.clear();
+	for (const ShapeState& shape : shapes) {
+		if (shape.extent >= minExtent) transforms.add(shape.geometry->data(), shape.geometry->size(), shape.transform);
+	}
+	transforms.run();
+	size_t drawn = 0;
+	for (const ShapeState& shape : shapes) {
+		if (shape.extent < minExtent) continue;
+		const Point* worldVertices = transforms.getWorldVertices(drawn);
+		size_t count = transforms.getVertexCount(drawn++);
+		renderer.fillPolygon(worldVertices, count, shape.colour);
+		if (shape.outlineVisible) renderer.drawLineLoop(worldVertices, count, shape.outlineColour);
+	}
+	if (marqueeVisible) renderer.drawLineLoop(marquee, 4, Colour(0.2f, 0.4f, 0.9f));
+
+	// Draw the HUD in camera coordinates
+	renderer.setTransform(1, 0, 0);
+	const Colour textColour(0, 0, 0);
+	for (size_t i = 0; i < textLineCount; i++) {
+		if (!textLines[i].detail || detail == DETAIL_FULL) renderer.drawText(textLines[i].x, textLines[i].y, textLines[i].text, textColour);
+	}
+}
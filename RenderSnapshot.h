@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdarg>
+#include "Shape.h"
+#include "Renderer.h"
+#include "SceneSettings.h"
+#include "TransformBatch.h"
+
+/**
+* Everything needed to draw a frame, captured from the scene by the thread that edits it so another thread can draw it
+* without touching the scene. Shapes are copied by value along with their geometry, which is never modified once shared,
+* so a captured snapshot stays valid however the scene changes afterwards.
+*
+* Storage is reused between captures, so capturing a scene of the same size again doesn't allocate.
+*
+* Usage:
+*	- Call capture(shapes, sceneSettings), then addText or addDetailText for each line of the HUD, and setMarquee if one is being dragged
+*	- Call render(renderer, detail) to draw it, as many times as needed
+*/
+class RenderSnapshot {
+
+public:
+	static constexpr size_t MAX_TEXT_LINES = 16;
+	static constexpr size_t MAX_TEXT_LENGTH = 192;
+	// Shapes smaller than this on screen, in camera units, aren't drawn at DETAIL_MINIMAL
+	static constexpr float MIN_SHAPE_SIZE = 2;
+
+	/**
+	* Optional work to do when drawing, lowered by FrameScheduler when frames overrun
+	*/
+	enum Detail {
+		DETAIL_MINIMAL,		// Skips detail text and shapes smaller than MIN_SHAPE_SIZE
+		DETAIL_REDUCED,		// Skips detail text
+		DETAIL_FULL
+	};
+
+protected:
+	/**
+	* Shape state needed to draw it
+	*/
+	struct ShapeState {
+		Geometry geometry;
+		ShapeTransform transform;
+		// Furthest a vertex reaches from the position, scale included
+		float extent = 0;
+		Colour colour;
+		Colour outlineColour;
+		bool outlineVisible = false;
+	};
+	/**
+	* HUD text, drawn without the view transform
+	*/
+	struct TextLine {
+		float x = 0;
+		float y = 0;
+		// Only drawn at DETAIL_FULL
+		bool detail = false;
+		char text[MAX_TEXT_LENGTH];
+	};
+
+	std::vector<ShapeState> shapes;
+	SceneSettings sceneSettings;
+	TextLine textLines[MAX_TEXT_LINES];
+	size_t textLineCount = 0;
+	// Steady clock microseconds when the oldest input first shown by this snapshot was received, 0 if it shows no new input
+	unsigned long long inputTime = 0;
+	// Corners of the marquee selection rectangle in world coordinates, drawn over the shapes when visible
+	Point marquee[4];
+	bool marqueeVisible = false;
+	// World vertices of the shapes being drawn, transformed together before drawing
+	TransformBatch transforms;
+
+public:
+	/**
+	* Copies the shapes in draw order and the view, and clears the HUD text
+	* Parameter: const std::vector<std::unique_ptr<Shape>>& sceneShapes  Shapes to draw, back to front
+	* Parameter: const SceneSettings& settings  Zoom and pan to draw with
+	*/
+	void capture(const std::vector<std::unique_ptr<Shape>>& sceneShapes, const SceneSettings& settings);
+	/**
+	* Adds a line of HUD text, formatted like printf and cut short at MAX_TEXT_LENGTH. Lines past MAX_TEXT_LINES are ignored
+	* Parameter: float x  Position of the text, in camera coordinates
+	* Parameter: float y  Position of the text, in camera coordinates
+	* Parameter: const char* format  printf format string
+	*/
+	void addText(float x, float y, const char* format, ...);
+	/**
+	* Adds a line of HUD text that can be skipped when frames are overrunning, see addText
+	*/
+	void addDetailText(float x, float y, const char* format, ...);
+	/**
+	* Draws a selection rectangle over the shapes, until the next capture
+	* Parameter: const Point& corner  A corner of the rectangle, in world coordinates
+	* Parameter: const Point& oppositeCorner  The opposite corner
+	*/
+	void setMarquee(const Point& corner, const Point& oppositeCorner);
+	/**
+	* Draws the shapes with the view transform, then the HUD text over them
+	* Parameter: Renderer& renderer  Renderer to draw with
+	* Parameter: Detail detail  Optional work to do
+	*/
+	void render(Renderer& renderer, Detail detail = DETAIL_FULL);
+
+	inline void setInputTime(unsigned long long time) { inputTime = time; }
+	inline unsigned long long getInputTime() const { return inputTime; }
+	inline size_t getShapeCount() const { return shapes.size(); }
+
+protected:
+	void addText(bool detail, float x, float y, const char* format, va_list args);
+};
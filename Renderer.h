@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include "Utils.h"
+
+/**
+* Drawing interface between the core and a platform, so shapes and the HUD can be drawn with OpenGL (see GLRenderer)
+* or without a window (see SoftwareRenderer).
+*
+* Coordinates are camera coordinates: 0,0 at the center of the view, y increasing downwards, 
+* after the transform set with setTransform
+*/
+class Renderer {
+
+public:
+	virtual ~Renderer() {}
+
+	/**
+	* Clears the whole view
+	* Parameter: const Colour& colour  Colour to clear to
+	*/
+	virtual void clear(const Colour& colour) = 0;
+	/**
+	* Sets the transform applied to the points drawn from now on: translated then scaled
+	* Parameter: float scale  Scale, the view zoom
+	* Parameter: float translateX  X translation, the view pan
+	* Parameter: float translateY  Y translation, the view pan
+	*/
+	virtual void setTransform(float scale, float translateX, float translateY) = 0;
+	/**
+	* Draws a filled polygon
+	* Parameter: const Point* vertices  Vertices in order around the polygon
+	* Parameter: size_t count  Number of vertices
+	* Parameter: const Colour& colour  Fill colour
+	*/
+	virtual void fillPolygon(const Point* vertices, size_t count, const Colour& colour) = 0;
+	/**
+	* Draws the outline of a polygon
+	* Parameter: const Point* vertices  Vertices in order around the polygon
+	* Parameter: size_t count  Number of vertices
+	* Parameter: const Colour& colour  Line colour
+	*/
+	virtual void drawLineLoop(const Point* vertices, size_t count, const Colour& colour) = 0;
+	/**
+	* Draws a line of text. Renderers without fonts may ignore this
+	* Parameter: float x  X position of the start of the text's baseline
+	* Parameter: float y  Y position of the start of the text's baseline
+	* Parameter: const char* text  Text to draw, null terminated so it can be formatted into a buffer without allocating
+	* Parameter: const Colour& colour  Text colour
+	*/
+	virtual void drawText(float x, float y, const char* text, const Colour& colour) = 0;
+};
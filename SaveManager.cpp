@@ -1,28 +1,79 @@
 #include "stdafx.h"
 #include "SaveManager.h"
 #include "Utils.h"
+#include "Trace.h"
+#include "AllocationCounter.h"
+#include "CpuDispatch.h"
 #include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+#include <stdexcept>
 
 using std::string;			using std::cout;
 using std::ifstream;		using std::endl;
 using std::vector;
 using std::map;
 
+// Labels of the index lines, see SaveManager.h
+static const string INDEX_SECTION = "section";
+static const string INDEX_KEYS = "keys";
+static const string INDEX_END = "index";
+// Width of the offset on the last index line, so it can be found from the end of the file
+static const int INDEX_END_WIDTH = 20;
+
+/**
+* Returns: const char*  Pointer to the first c in [begin, end), or end if there is none
+*/
+static inline const char* findChar(const char* begin, const char* end, char c) {
+	const void* found = memchr(begin, c, end - begin);
+	return found? static_cast<const char*>(found) : end;
+}
+
+/**
+* Reads the byte range [start, end) of an open file into contents
+* Returns: bool  True if the whole range was read
+*/
+static bool readRange(ifstream& is, unsigned long long start, unsigned long long end, string& contents) {
+	if (end < start) return false;
+	contents.resize(static_cast<size_t>(end - start));
+	is.seekg(start);
+	if (!contents.empty()) is.read(&contents[0], contents.size());
+	return static_cast<bool>(is);
+}
+
 
 SaveManager::SaveManager() {}
 
 void SaveManager::startSave(string file) {
 	if (!saveFile.is_open() && !currentlyWriting) {
-		saveFile.open(file);
+		// Binary mode so tellp offsets in the index match the bytes on disk on every platform
+		// Spans from here to stopSave
+		Trace::begin("SaveManager::save");
+		saveFile.open(file, std::ios::binary);
 		currentlyWriting = true;
+		index.clear();
+		indexFile = "";
 	} else {
-		throw std::exception("Saving already in progress, call stopSave() first!");
+		throw std::runtime_error("Saving already in progress, call stopSave() first!");
 	}
 }
 
-void SaveManager::stopSave() {
+bool SaveManager::stopSave() {
+	bool wasWriting = currentlyWriting;
+	if (currentlyWriting) {
+		if (!index.empty() && section != "") index.back().end = saveFile.tellp();
+		writeIndex();
+	}
+	// Write errors stay set on the stream, and closing flushes the rest of the file so can fail too
 	saveFile.close();
+	bool success = wasWriting && !saveFile.fail();
 	currentlyWriting = false;
+	if (wasWriting) Trace::end("SaveManager::save");
+	return success;
 }
 
 /************************************************************************/
@@ -30,94 +81,341 @@ void SaveManager::stopSave() {
 /************************************************************************/
 
 bool SaveManager::load(string file) {
+	return load(file, 1);
+}
+
+bool SaveManager::load(string file, unsigned threads) {
+	Trace::Scope span("SaveManager::load");
+	AllocationCounter::Scope allocations(AllocationCounter::IO);
 	// Clear any saved settings
+	sections.clear();
+	sectionKeys.clear();
 	sectionValues.clear();
 	sectionArrays.clear();
 	sectionKeyValues.clear();
 	sectionKeyArrays.clear();
 
-	bool success = false;
-	ifstream is(file);
-	if (is) {
-		string buffer;
-
-		string section = "";
-		string key = "";
-		int keyIndex = 0; // Occurrence of the current key
-		bool isArray = false; // Whether an array is currently being built
-		string arrayName;
-		vector<string> stringParts; // Split string cache
-		while (getline(is, buffer)) {
-			Utils::removeFromString(buffer, '\t');
-			stringParts.clear();
-			if (buffer.find(Syntax::VALUE_SEPARATOR) != string::npos || isArray) {
-				if (!isArray) {
-					// Split value at separator to get label and value
-					Utils::splitString(buffer, Syntax::VALUE_SEPARATOR, stringParts);
-					// Removing leading space from value
-					if (stringParts[1][0] == ' ') stringParts[1] = stringParts[1].substr(1);
-				}
-				// Create array if saved value is array
-				if (buffer.find(Syntax::ARRAY_START) != string::npos) {
-					isArray = true;
-					arrayName = stringParts[0];
+	// Read the whole file once, chunks are then parsed straight from memory
+	ifstream is(file, std::ios::binary);
+	if (!is) return false;
+	is.seekg(0, std::ios::end);
+	string contents(static_cast<size_t>(is.tellg()), '\0');
+	is.seekg(0, std::ios::beg);
+	is.read(&contents[0], contents.size());
+	is.close();
+
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+	const char* begin = contents.data();
+	const char* end = begin + contents.size();
+
+	// Split the file into roughly equal chunks, moving each split forward to the next key or section start
+	// so that every chunk only contains whole keys
+	vector<const char*> splits;
+	splits.push_back(begin);
+	for (unsigned i = 1; i < threads; i++) {
+		const char* split = nextChunkStart(begin + contents.size() * i / threads, splits.back(), end);
+		if (split > splits.back() && split < end) splits.push_back(split);
+	}
+	splits.push_back(end);
+
+	if (splits.size() == 2) {
+		parse(begin, end);
+		return true;
+	}
+
+	// Parse each chunk on its own thread into its own SaveManager
+	vector<SaveManager> chunks(splits.size() - 1);
+	vector<std::thread> workers;
+	for (unsigned i = 0; i < chunks.size(); i++) {
+		workers.push_back(std::thread(&SaveManager::parse, &chunks[i], splits[i], splits[i + 1]));
+	}
+	for (auto& worker : workers) worker.join();
+
+	// Merge in file order so keys keep their original order
+	string section = "";
+	for (auto& chunk : chunks) {
+		merge(chunk, section);
+		if (!chunk.sections.empty()) section = chunk.sections.back();
+	}
+	return true;
+}
+
+bool SaveManager::loadIndex(string file) {
+	ifstream is(file, std::ios::binary);
+	if (!is) return false;
+	is.seekg(0, std::ios::end);
+	unsigned long long size = is.tellg();
+
+	// Find the offset of the index from the last line
+	string contents;
+	unsigned long long tailSize = std::min<unsigned long long>(size, INDEX_END.size() + INDEX_END_WIDTH + 8);
+	if (!readRange(is, size - tailSize, size, contents)) return false;
+	size_t endLine = contents.rfind(Syntax::INDEX_START + INDEX_END + " ");
+	if (endLine == string::npos) {
+		index.clear();
+		indexFile = "";
+		return false;
+	}
+	unsigned long long start = std::strtoull(contents.c_str() + endLine + INDEX_END.size() + 2, nullptr, 10);
+	// Keep the cached index if the file hasn't changed
+	if (file == indexFile && size == indexFileSize && start == indexStart) return true;
+
+	index.clear();
+	indexFile = "";
+	if (start >= size || !readRange(is, start, size, contents)) return false;
+	std::istringstream lines(contents);
+	string line, label;
+	while (std::getline(lines, line)) {
+		if (line.empty() || line[0] != Syntax::INDEX_START) continue;
+		std::istringstream values(line.substr(1));
+		values >> label;
+		if (label != INDEX_SECTION) continue;
+		SectionIndex entry;
+		if (values >> entry.name >> entry.start >> entry.end >> entry.keysStart >> entry.keysEnd) index.push_back(entry);
+	}
+	indexFile = file;
+	indexFileSize = size;
+	indexStart = start;
+	return true;
+}
+
+void SaveManager::unloadIndex() {
+	index.clear();
+	indexFile = "";
+}
+
+bool SaveManager::loadIndexKeys(SectionIndex& entry) {
+	if (entry.keysLoaded) return true;
+	ifstream is(indexFile, std::ios::binary);
+	string contents;
+	if (!is || !readRange(is, entry.keysStart, entry.keysEnd, contents)) return false;
+
+	const string prefix = Syntax::INDEX_START + INDEX_KEYS + " " + entry.name + " ";
+	const char* lineStart = contents.c_str();
+	const char* end = lineStart + contents.size();
+	while (lineStart < end) {
+		const char* lineEnd = findChar(lineStart, end, Syntax::ITEM_SEPERATOR);
+		if (static_cast<size_t>(lineEnd - lineStart) > prefix.size() && contents.compare(lineStart - contents.c_str(), prefix.size(), prefix) == 0) {
+			// Key label, count, then the delta encoded offsets
+			const char* pos = lineStart + prefix.size();
+			const char* labelEnd = findChar(pos, lineEnd, ' ');
+			vector<unsigned long long>& offsets = entry.keys[string(pos, labelEnd)];
+			char* next;
+			unsigned long long count = std::strtoull(labelEnd, &next, 10);
+			offsets.clear();
+			offsets.reserve(static_cast<size_t>(count));
+			unsigned long long offset = 0;
+			for (unsigned long long i = 0; i < count && next < lineEnd; i++) {
+				offset += std::strtoull(next, &next, 10);
+				offsets.push_back(offset);
+			}
+		}
+		lineStart = lineEnd + 1;
+	}
+	entry.keysLoaded = true;
+	return true;
+}
+
+SaveManager::SectionIndex* SaveManager::findSection(const string& section) {
+	for (auto& entry : index) {
+		if (entry.name == section) return &entry;
+	}
+	return nullptr;
+}
+
+unsigned SaveManager::getIndexedKeyCount(string section, string key) {
+	SectionIndex* entry = findSection(section);
+	if (entry == nullptr || !loadIndexKeys(*entry)) return 0;
+	auto offsets = entry->keys.find(key);
+	return (offsets == entry->keys.end())? 0 : offsets->second.size();
+}
+
+bool SaveManager::loadSection(string file, string section) {
+	if (!loadIndex(file)) return false;
+	SectionIndex* entry = findSection(section);
+	if (entry == nullptr) return false;
+
+	// Replace anything previously loaded for the section
+	unloadSection(section);
+	return loadRange(file, entry->start, entry->end, section);
+}
+
+void SaveManager::unloadSection(string section) {
+	sections.erase(std::remove(sections.begin(), sections.end(), section), sections.end());
+	sectionKeys.erase(section);
+	sectionValues.erase(section);
+	sectionArrays.erase(section);
+	sectionKeyValues.erase(section);
+	sectionKeyArrays.erase(section);
+}
+
+bool SaveManager::loadKeyRange(string file, string section, string key, unsigned first, unsigned count) {
+	if (!loadIndex(file)) return false;
+	SectionIndex* entry = findSection(section);
+	if (entry == nullptr || !loadIndexKeys(*entry)) return false;
+	auto offsets = entry->keys.find(key);
+	if (offsets == entry->keys.end() || first >= offsets->second.size()) return false;
+	count = std::min<unsigned>(count, offsets->second.size() - first);
+	if (count == 0) return false;
+
+	// The range ends at the next key of any label after the last occurrence, or the end of the section
+	unsigned long long start = offsets->second[first];
+	unsigned long long last = offsets->second[first + count - 1];
+	unsigned long long end = entry->end;
+	for (auto& keyOffsets : entry->keys) {
+		auto next = std::upper_bound(keyOffsets.second.begin(), keyOffsets.second.end(), last);
+		if (next != keyOffsets.second.end()) end = std::min(end, *next);
+	}
+
+	// Replace previously loaded occurrences of the key
+	sectionKeyValues[section].erase(key);
+	sectionKeyArrays[section].erase(key);
+	if (std::find(sections.begin(), sections.end(), section) == sections.end()) sections.push_back(section);
+	return loadRange(file, start, end, section);
+}
+
+bool SaveManager::loadRange(const string& file, unsigned long long start, unsigned long long end, const string& section) {
+	ifstream is(file, std::ios::binary);
+	string contents;
+	if (!is || !readRange(is, start, end, contents)) return false;
+	SaveManager chunk;
+	chunk.parse(contents.data(), contents.data() + contents.size());
+	merge(chunk, section);
+	return true;
+}
+
+const char* SaveManager::nextChunkStart(const char* pos, const char* begin, const char* end) {
+	// Skip to the start of the next line
+	if (pos > begin) {
+		pos = findChar(pos - 1, end, Syntax::ITEM_SEPERATOR);
+		if (pos != end) pos++;
+	}
+	while (pos < end) {
+		const char* lineEnd = findChar(pos, end, Syntax::ITEM_SEPERATOR);
+		// Sections and top level keys are the only unindented lines that aren't values
+		if (*pos == Syntax::SECTION_START 
+			|| (*pos != '\t' && findChar(pos, lineEnd, Syntax::KEY_START) != lineEnd && findChar(pos, lineEnd, Syntax::VALUE_SEPARATOR) == lineEnd)) {
+			return pos;
+		}
+		pos = (lineEnd == end)? end : lineEnd + 1;
+	}
+	return end;
+}
+
+void SaveManager::parse(const char* begin, const char* end) {
+	string buffer;
+
+	string section = "";
+	string key = "";
+	int keyIndex = 0; // Occurrence of the current key
+	bool isArray = false; // Whether an array is currently being built
+	string arrayName;
+	vector<string> stringParts; // Split string cache
+	const char* lineStart = begin;
+	while (lineStart < end) {
+		const char* lineEnd = findChar(lineStart, end, Syntax::ITEM_SEPERATOR);
+		buffer.assign(lineStart, lineEnd);
+		lineStart = (lineEnd == end)? end : lineEnd + 1;
+		Utils::removeFromString(buffer, '\t');
+		Utils::removeFromString(buffer, '\r');
+		stringParts.clear();
+		if (buffer.find(Syntax::VALUE_SEPARATOR) != string::npos || isArray) {
+			if (!isArray) {
+				// Split value at separator to get label and value
+				Utils::splitString(buffer, Syntax::VALUE_SEPARATOR, stringParts);
+				// Removing leading space from value
+				if (stringParts[1][0] == ' ') stringParts[1] = stringParts[1].substr(1);
+			}
+			// Create array if saved value is array
+			if (buffer.find(Syntax::ARRAY_START) != string::npos) {
+				isArray = true;
+				arrayName = stringParts[0];
+				continue; // Skip extra processing on this iteration
+			}
+			if (isArray) {
+				// If end of array
+				if (buffer.find(Syntax::ARRAY_END) != string::npos) {
+					isArray = false;
 					continue; // Skip extra processing on this iteration
 				}
-				if (isArray) {
-					// If end of array
-					if (buffer.find(Syntax::ARRAY_END) != string::npos) {
-						isArray = false;
-						continue; // Skip extra processing on this iteration
-					}
-					// Add array to appropriate arrays map
-					if (key == "") sectionArrays[section][arrayName].push_back(buffer);
-					else sectionKeyArrays[section][key][keyIndex][arrayName].push_back(buffer);
-				} else if (key == "") {
-					// Add value to current section identified by the label
-					sectionValues[section][stringParts[0]] = stringParts[1];
-				} else {
-					// Add values to current section -> key
-					sectionKeyValues[section][key][keyIndex][stringParts[0]] = stringParts[1];
-				}
-			} else if (buffer.find(Syntax::KEY_START) != string::npos) {
-				// Starting a new key, set current key name to it and get the next index
-				Utils::removeFromString(buffer, Syntax::KEY_START);
-				key = buffer;
-				int newKeyIndex = sectionKeyValues[section][key].size();
-				if (newKeyIndex == 0) sectionKeys[section].push_back(key);
-				if (keyIndex != newKeyIndex || newKeyIndex == 0) {
-					// Create new value and array map for the new key
-					map<string, string> newMap;
-					map<string, vector<string>> newArrayMap;
-					sectionKeyValues[section][key].push_back(newMap);
-					sectionKeyArrays[section][key].push_back(newArrayMap);
-					keyIndex = newKeyIndex;
-				}
-			} else if (buffer.find(Syntax::KEY_END) != string::npos) {
-				// Ended current key, clear current key name
-				key = "";
-				keyIndex = 0;
-			} else if (buffer[0] == Syntax::SECTION_START) {
-				// New section started
-				Utils::removeFromString(buffer, Syntax::SECTION_START);
-				Utils::removeFromString(buffer, Syntax::SECTION_END);
-				section = buffer;
-				sections.push_back(section);
-				// Create maps for this section
+				// Add array to appropriate arrays map
+				if (key == "") sectionArrays[section][arrayName].push_back(buffer);
+				else sectionKeyArrays[section][key][keyIndex][arrayName].push_back(buffer);
+			} else if (key == "") {
+				// Add value to current section identified by the label
+				sectionValues[section][stringParts[0]] = stringParts[1];
+			} else {
+				// Add values to current section -> key
+				sectionKeyValues[section][key][keyIndex][stringParts[0]] = stringParts[1];
+			}
+		} else if (buffer.find(Syntax::KEY_START) != string::npos) {
+			// Starting a new key, set current key name to it and get the next index
+			Utils::removeFromString(buffer, Syntax::KEY_START);
+			key = buffer;
+			int newKeyIndex = sectionKeyValues[section][key].size();
+			if (newKeyIndex == 0) sectionKeys[section].push_back(key);
+			if (keyIndex != newKeyIndex || newKeyIndex == 0) {
+				// Create new value and array map for the new key
 				map<string, string> newMap;
 				map<string, vector<string>> newArrayMap;
-				sectionValues[section] = newMap;
-				sectionArrays[section] = newArrayMap;
-				map<string, vector<map<string, string>>> newKeyMap;
-				map<string, vector<map<string, vector<string>>>> newKeyArrayMap;
-				sectionKeyValues[section] = newKeyMap;
-				sectionKeyArrays[section] = newKeyArrayMap;
+				sectionKeyValues[section][key].push_back(newMap);
+				sectionKeyArrays[section][key].push_back(newArrayMap);
+				keyIndex = newKeyIndex;
 			}
+		} else if (buffer.find(Syntax::KEY_END) != string::npos) {
+			// Ended current key, clear current key name
+			key = "";
+			keyIndex = 0;
+		} else if (buffer[0] == Syntax::SECTION_START) {
+			// New section started
+			Utils::removeFromString(buffer, Syntax::SECTION_START);
+			Utils::removeFromString(buffer, Syntax::SECTION_END);
+			section = buffer;
+			sections.push_back(section);
+			// Create maps for this section
+			map<string, string> newMap;
+			map<string, vector<string>> newArrayMap;
+			sectionValues[section] = newMap;
+			sectionArrays[section] = newArrayMap;
+			map<string, vector<map<string, string>>> newKeyMap;
+			map<string, vector<map<string, vector<string>>>> newKeyArrayMap;
+			sectionKeyValues[section] = newKeyMap;
+			sectionKeyArrays[section] = newKeyArrayMap;
+		}
+	}
+}
+
+void SaveManager::merge(SaveManager& chunk, const string& startSection) {
+	// Data the chunk parsed before its first section header belongs to the section the chunk started in
+	auto target = [&startSection](const string& section) { return section.empty()? startSection : section; };
+	sections.insert(sections.end(), chunk.sections.begin(), chunk.sections.end());
+	for (auto& keys : chunk.sectionKeys) {
+		vector<string>& targetKeys = sectionKeys[target(keys.first)];
+		for (auto& key : keys.second) {
+			if (std::find(targetKeys.begin(), targetKeys.end(), key) == targetKeys.end()) targetKeys.push_back(key);
+		}
+	}
+	for (auto& values : chunk.sectionValues) {
+		map<string, string>& targetValues = sectionValues[target(values.first)];
+		for (auto& value : values.second) targetValues[value.first] = std::move(value.second);
+	}
+	for (auto& arrays : chunk.sectionArrays) {
+		map<string, vector<string>>& targetArrays = sectionArrays[target(arrays.first)];
+		for (auto& arr : arrays.second) targetArrays[arr.first] = std::move(arr.second);
+	}
+	for (auto& keys : chunk.sectionKeyValues) {
+		for (auto& key : keys.second) {
+			vector<map<string, string>>& targetKeys = sectionKeyValues[target(keys.first)][key.first];
+			std::move(key.second.begin(), key.second.end(), std::back_inserter(targetKeys));
+		}
+	}
+	for (auto& keys : chunk.sectionKeyArrays) {
+		for (auto& key : keys.second) {
+			vector<map<string, vector<string>>>& targetKeys = sectionKeyArrays[target(keys.first)][key.first];
+			std::move(key.second.begin(), key.second.end(), std::back_inserter(targetKeys));
 		}
-		success = true;
 	}
-	is.close();
-	return success;
 }
 
 void SaveManager::prettyPrint() {
@@ -163,16 +461,25 @@ void SaveManager::prettyPrintValues(std::map<string, std::string>& valMap, int i
 /************************************************************************/
 
 void SaveManager::startSection(string key) {
+	if (currentlyWriting) {
+		SectionIndex entry;
+		entry.name = key;
+		entry.start = saveFile.tellp();
+		index.push_back(entry);
+	}
 	write(Syntax::SECTION_START + key + Syntax::SECTION_END);
 	section = key;
 }
 
 void SaveManager::endSection() {
 	newItem();
+	if (currentlyWriting && !index.empty() && section != "") index.back().end = saveFile.tellp();
 	section = "";
 }
 
 void SaveManager::startKey(string key) {
+	// Index top level keys so they can be loaded individually
+	if (currentlyWriting && keyLevel == 0 && !index.empty() && section != "") index.back().keys[key].push_back(saveFile.tellp());
 	write(key + Syntax::KEY_START);
 	key = key;
 	keyLevel++;
@@ -186,6 +493,78 @@ void SaveManager::endKey() {
 }
 
 
+bool SaveManager::copyKeys(string file, string sourceSection) {
+	if (!currentlyWriting || index.empty() || section == "") return false;
+	SaveManager source;
+	if (!source.loadIndex(file)) return false;
+	SectionIndex* entry = source.findSection(sourceSection);
+	if (entry == nullptr || !source.loadIndexKeys(*entry)) return false;
+
+	// Copy from the first key to the end of the section, without the section's closing line break
+	unsigned long long start = entry->end;
+	for (const auto& key : entry->keys) {
+		if (!key.second.empty()) start = std::min(start, key.second.front());
+	}
+	ifstream is(file, std::ios::binary);
+	string contents;
+	if (start >= entry->end || !is || !readRange(is, start, entry->end, contents)) return start >= entry->end;
+	if (!contents.empty() && contents.back() == Syntax::ITEM_SEPERATOR) contents.pop_back();
+	if (!contents.empty() && contents.back() == '\r') contents.pop_back();
+
+	// Index the copied keys at their new offsets
+	unsigned long long offset = saveFile.tellp();
+	for (const auto& key : entry->keys) {
+		vector<unsigned long long>& offsets = index.back().keys[key.first];
+		for (unsigned long long keyOffset : key.second) offsets.push_back(keyOffset - start + offset);
+	}
+	saveFile.write(contents.data(), contents.size());
+	return true;
+}
+
+void SaveManager::writeIndex() {
+	// Key offsets, grouped by section
+	for (auto& entry : index) {
+		entry.keysStart = saveFile.tellp();
+		for (const auto& key : entry.keys) {
+			saveFile << Syntax::ITEM_SEPERATOR << Syntax::INDEX_START << INDEX_KEYS << ' ' << entry.name << ' ' << key.first << ' ' << key.second.size();
+			unsigned long long previous = 0;
+			for (unsigned long long offset : key.second) {
+				saveFile << ' ' << offset - previous;
+				previous = offset;
+			}
+		}
+		entry.keysEnd = saveFile.tellp();
+	}
+	unsigned long long start = saveFile.tellp();
+	for (const auto& entry : index) {
+		saveFile << Syntax::ITEM_SEPERATOR << Syntax::INDEX_START << INDEX_SECTION << ' ' << entry.name << ' ' << entry.start << ' ' << entry.end
+			<< ' ' << entry.keysStart << ' ' << entry.keysEnd;
+	}
+	saveFile << Syntax::ITEM_SEPERATOR << Syntax::INDEX_START << INDEX_END << ' ' 
+		<< std::setw(INDEX_END_WIDTH) << std::setfill('0') << start << Syntax::ITEM_SEPERATOR;
+}
+
 void SaveManager::newItem() {
 	if (currentlyWriting) saveFile << Syntax::ITEM_SEPERATOR;
-}
\ No newline at end of file
+}
+size_t SaveManager::parseFloats(const string& value, float* numbers, size_t count) {
+	return CpuDispatch::get().parseFloats(value.c_str(), value.c_str() + value.size(), numbers, count);
+}
+
+float SaveManager::parseFloat(const string& value) {
+	float number = 0;
+	parseFloats(value, &number, 1);
+	return number;
+}
+
+Point SaveManager::parsePoint(const string& value) {
+	float xy[2] = {};
+	parseFloats(value, xy, 2);
+	return Point(xy[0], xy[1]);
+}
+
+Colour SaveManager::parseColour(const string& value) {
+	float rgb[3] = {};
+	parseFloats(value, rgb, 3);
+	return Colour(rgb[0], rgb[1], rgb[2]);
+}
@@ -1,10 +1,13 @@
 #pragma once
+#ifdef _MSC_VER
 #pragma warning(disable:4503) // Ignore truncated names warning 
+#endif
 
 #include <string>
 #include <fstream>
 #include <vector>
 #include <map>
+#include "Utils.h"
 
 /**
 * Manages loading and saving of the scene, including file writing format
@@ -40,6 +43,18 @@
 *	- Call load(file_name)
 *	- Use the getter methods to get values/arrays from sections and keys
 *
+* Seeking:
+*	stopSave appends an index of the byte offsets of each section and top level key, which the parser ignores:
+*
+*	!keys section_name key_label count offsets...			// Offset of each key, the first is absolute and the rest are relative to the previous
+*	!section section_name start end keys_start keys_end		// One line per section, keys_* is the range of its !keys lines
+*	!index start											// Fixed width last line with the offset of the first !section line
+*
+*	- Call loadSection(file_name, section_name) or loadKeyRange(file_name, section_name, key_label, first, count)
+*	  to parse only part of the file. Only the last line, the !section lines and the requested range are read from disk,
+*	  plus the section's !keys lines for loadKeyRange. The index is cached until the file changes
+*	- Use the getter methods as normal
+*
 *	Note: Keys cannot contain sub-keys and arrays must only be 1 dimensional
 *	
 *	
@@ -47,19 +62,35 @@
 class SaveManager {
 
 	// Characters used to format the file
-	static struct Syntax {
-		static const char SECTION_START = '[';
-		static const char SECTION_END = ']';
-		static const char KEY_START = '{';
-		static const char KEY_END = '}';
-		static const char VALUE_SEPARATOR = ':';
-		static const char ARRAY_START = '[';
-		static const char ARRAY_END = ']';
-		static const char ARRAY_COL_SEPARATOR = '\n';
-		static const char ITEM_SEPERATOR = '\n';
+	struct Syntax {
+		static constexpr char INDEX_START = '!';
+		static constexpr char SECTION_START = '[';
+		static constexpr char SECTION_END = ']';
+		static constexpr char KEY_START = '{';
+		static constexpr char KEY_END = '}';
+		static constexpr char VALUE_SEPARATOR = ':';
+		static constexpr char ARRAY_START = '[';
+		static constexpr char ARRAY_END = ']';
+		static constexpr char ARRAY_COL_SEPARATOR = '\n';
+		static constexpr char ITEM_SEPERATOR = '\n';
 	};
 
 protected:
+	/**
+	* Byte offsets of a section and its top level keys within a save file
+	*/
+	struct SectionIndex {
+		std::string name;
+		unsigned long long start = 0;
+		unsigned long long end = 0;
+		// Range of the section's !keys lines
+		unsigned long long keysStart = 0;
+		unsigned long long keysEnd = 0;
+		// Offsets of each occurrence of each key label, in file order. Loaded on demand
+		std::map<std::string, std::vector<unsigned long long>> keys;
+		bool keysLoaded = false;
+	};
+
 	// Current section name
 	std::string section = "";
 	// Current key name
@@ -89,6 +120,13 @@ protected:
 	// Example:  sectionKeyArrays[shape_manager][shape][0][vertices] = vertices array
 	// Gets the vertices array stored in the first shape key entry in the shape_manager section
 	std::map<std::string, std::map<std::string, std::vector<std::map<std::string, std::vector<std::string>>>>> sectionKeyArrays;
+
+	// Index of the file being saved, or of indexFile once loaded
+	std::vector<SectionIndex> index;
+	// File the index was loaded from, along with its size and index offset to detect changes
+	std::string indexFile;
+	unsigned long long indexFileSize = 0;
+	unsigned long long indexStart = 0;
 	
 private:
 	bool currentlyWriting = false;
@@ -104,8 +142,9 @@ public:
 
 	/**
 	* Closes the current file.
+	* Returns: bool  True if everything was written, false if a write or closing the file failed
 	*/
-	void stopSave();
+	bool stopSave();
 
 	/**
 	* Loads settings from a previously saved file. Only supports one level of keys
@@ -113,6 +152,56 @@ public:
 	* Returns: bool  True if the file was loaded successfully
 	*/
 	bool load(std::string file);
+	/**
+	* Loads settings from a previously saved file, parsing it on multiple threads. 
+	* The file is split into chunks at key and section boundaries which are parsed in parallel, then merged in file order
+	* Parameter: std::string file  File to load
+	* Parameter: unsigned threads  Number of threads to parse with, 0 to use one per hardware thread
+	* Returns: bool  True if the file was loaded successfully
+	*/
+	bool load(std::string file, unsigned threads);
+
+	/**
+	* Loads the index of a file without parsing the rest of it. Called automatically by loadSection and loadKeyRange
+	* Parameter: std::string file  File to load the index of
+	* Returns: bool  True if the file has an index and it was loaded successfully
+	*/
+	bool loadIndex(std::string file);
+	/**
+	* Forgets the loaded index, so the next load reads it again even if the file looks unchanged. 
+	* Needed when a file may have been replaced by one of the same size and index offset
+	*/
+	void unloadIndex();
+	/**
+	* Parses a single section using the file's index, replacing any previously loaded values for the section
+	* Parameter: std::string file  File to load from
+	* Parameter: std::string section  Section to load
+	* Returns: bool  False if the file has no index or the section doesn't exist
+	*/
+	bool loadSection(std::string file, std::string section);
+	/**
+	* Parses a range of occurrences of a top level key using the file's index, replacing any previously loaded occurrences
+	* of that key in the section. The first loaded occurrence is then at index 0 of getSectionKeyValues/getSectionKeyArrays.
+	* Other keys saved between the occurrences are loaded as well
+	* Parameter: std::string file  File to load from
+	* Parameter: std::string section  Section containing the key
+	* Parameter: std::string key  Label of the key
+	* Parameter: unsigned first  Index of the first occurrence to load
+	* Parameter: unsigned count  Number of occurrences to load, clamped to the number saved
+	* Returns: bool  False if the file has no index or first is out of range
+	*/
+	bool loadKeyRange(std::string file, std::string section, std::string key, unsigned first, unsigned count);
+	/**
+	* Parameter: std::string section  Section containing the key
+	* Parameter: std::string key  Label of the key
+	* Returns: unsigned  Number of occurrences of the key saved in the section, according to the loaded index
+	*/
+	unsigned getIndexedKeyCount(std::string section, std::string key);
+	/**
+	* Removes a loaded section's values, arrays and keys, freeing their memory
+	* Parameter: std::string section  Section to unload
+	*/
+	void unloadSection(std::string section);
 
 	/**
 	* Prints the loaded settings to stdout
@@ -133,6 +222,15 @@ public:
 	void startKey(std::string key);
 	void endKey();
 
+	/**
+	* Copies the keys of a section in another indexed save into the current section, without parsing them. 
+	* The file being copied from can't be the file being saved to
+	* Parameter: std::string file  Save file to copy from
+	* Parameter: std::string section  Section to copy the keys of
+	* Returns: bool  True if the keys were copied, false if the file has no index or section
+	*/
+	bool copyKeys(std::string file, std::string section);
+
 	/**
 	* Writes a value under the current key/section
 	* Parameter: std::string key  Unique (within the current section/key) label for the value without spaces
@@ -153,11 +251,22 @@ public:
 	*/
 	template <typename T>
 	void addValue(std::string label, std::vector<T>& vector) {
+		addArray(label, vector.data(), vector.data() + vector.size());
+	}
+
+	/**
+	* Writes a range of items as a 1 dimensional array to the current key/section
+	* Parameter: std::string key  Unique (within the current section/key) label for the value without spaces
+	* Parameter: const T* begin  First item to write
+	* Parameter: const T* end  One past the last item to write
+	*/
+	template <typename T>
+	void addArray(std::string label, const T* begin, const T* end) {
 		write(label + Syntax::VALUE_SEPARATOR + " ");
 		write(Syntax::ARRAY_START, false);
 		keyLevel++;
-		for (auto& item : vector) {
-			write(item);
+		for (const T* item = begin; item != end; item++) {
+			write(*item);
 		}
 		keyLevel--;
 		write(Syntax::ARRAY_END);
@@ -210,6 +319,28 @@ public:
 		return sectionKeyArrays[section][key];
 	}
 
+	/**
+	* Reads the numbers in a loaded value, such as the "(x, y)" of a Point or the "(r, g, b)" of a Colour, with CpuDispatch's
+	* parsing kernel. Gives the same values as std::stof, missing numbers are left unchanged
+	* Parameter: const std::string& value  Value to read
+	* Parameter: float* numbers  Numbers read, in order
+	* Parameter: size_t count  Most numbers to read
+	* Returns: size_t  Numbers read
+	*/
+	static size_t parseFloats(const std::string& value, float* numbers, size_t count);
+	/**
+	* Returns: float  First number in a value, or 0 if there isn't one
+	*/
+	static float parseFloat(const std::string& value);
+	/**
+	* Returns: Point  Point from a value in the format (x, y)
+	*/
+	static Point parsePoint(const std::string& value);
+	/**
+	* Returns: Colour  Colour from a value in the format (r, g, b)
+	*/
+	static Colour parseColour(const std::string& value);
+
 
 
 protected:
@@ -233,6 +364,43 @@ protected:
 		}
 	}
 
+	/**
+	* Writes the index of the saved sections and keys to the end of the file
+	*/
+	void writeIndex();
+	/**
+	* Returns: SectionIndex*  Loaded index entry for a section, or null if it isn't in the index
+	*/
+	SectionIndex* findSection(const std::string& section);
+	/**
+	* Loads the key offsets of a section from indexFile, if they haven't been already
+	* Returns: bool  True if the offsets were loaded
+	*/
+	bool loadIndexKeys(SectionIndex& entry);
+	/**
+	* Parses the byte range [start, end) of a file, which must start at a section or top level key, into the settings maps
+	* Parameter: const std::string& section  Section the range is in
+	* Returns: bool  True if the range was read successfully
+	*/
+	bool loadRange(const std::string& file, unsigned long long start, unsigned long long end, const std::string& section);
+
+	/**
+	* Parses loaded file contents into the settings maps
+	* Parameter: const char* begin  Start of the contents to parse
+	* Parameter: const char* end  End of the contents to parse
+	*/
+	void parse(const char* begin, const char* end);
+	/**
+	* Moves the settings parsed by another SaveManager into this one, appending keys after the existing keys
+	* Parameter: SaveManager& chunk  SaveManager that parsed the next chunk of the file
+	* Parameter: const std::string& startSection  Section the chunk started in, used for values before its first section header
+	*/
+	void merge(SaveManager& chunk, const std::string& startSection);
+	/**
+	* Returns: const char*  Start of the first line at or after pos that begins a section or top level key, or end if there is none
+	*/
+	static const char* nextChunkStart(const char* pos, const char* begin, const char* end);
+
 	// Pretty prints an array map or value map from saved settings at the passed indentation level
 	void prettyPrintArrays(std::map<std::string, std::vector<std::string>>& arryMap, int indentLevel);
 	void prettyPrintValues(std::map<std::string, std::string>& valMap, int indentLevel);
@@ -0,0 +1,29 @@
+#include "stdafx.h"
+#include "SceneSettings.h"
+
+using std::string;
+using std::map;
+
+
+void SceneSettings::save(SaveManager& saveManager) const {
+	saveManager.startSection("scene");
+	saveManager.addValue("zoom", zoom);
+	saveManager.addValue("pan_x", panX);
+	saveManager.addValue("pan_y", panY);
+	saveManager.endSection();
+}
+
+void SceneSettings::getViewBounds(float viewWidth, float viewHeight, Point& min, Point& max) const {
+	// The view is centred on the origin, then scaled by zoom, after translating by the pan
+	min.x = -viewWidth / 2 / zoom - panX;
+	min.y = -viewHeight / 2 / zoom - panY;
+	max.x = viewWidth / 2 / zoom - panX;
+	max.y = viewHeight / 2 / zoom - panY;
+}
+
+void SceneSettings::load(SaveManager& saveManager) {
+	map<string, string>& vals = saveManager.getSectionValues("scene");
+	zoom = std::stof(vals["zoom"]);
+	panX = std::stof(vals["pan_x"]);
+	panY = std::stof(vals["pan_y"]);
+}
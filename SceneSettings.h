@@ -0,0 +1,32 @@
+#pragma once
+
+#include "SaveManager.h"
+#include "Utils.h"
+
+/**
+* View settings for the scene, such as zoom and pan
+*/
+struct SceneSettings {
+	float zoom = 1; // View zoom modifier
+	int panX = 0, panY = 0; // View pan location
+
+	/**
+	* Saves the settings to a scene section. The SaveManager must be in a saving state
+	* Parameter: SaveManager& saveManager  SaveManager to use to save
+	*/
+	void save(SaveManager& saveManager) const;
+	/**
+	* Loads the settings from the scene section, file must have been loaded beforehand
+	* Parameter: SaveManager& saveManager  SaveManager to load from
+	*/
+	void load(SaveManager& saveManager);
+
+	/**
+	* Gets the area of the scene that's in view
+	* Parameter: float viewWidth  Width of the view before zooming
+	* Parameter: float viewHeight  Height of the view before zooming
+	* Parameter: Point& min  Set to the top left of the area in view
+	* Parameter: Point& max  Set to the bottom right of the area in view
+	*/
+	void getViewBounds(float viewWidth, float viewHeight, Point& min, Point& max) const;
+};
@@ -0,0 +1,281 @@
+#include "stdafx.h"
+#include "SceneSnapshot.h"
+#include "ShapeManager.h"
+#include <unordered_map>
+#include <map>
+#include <algorithm>
+#include <cmath>
+
+using std::vector;
+using std::unique_ptr;
+using std::unordered_map;
+using std::unordered_multimap;
+using std::string;
+using std::pair;
+
+
+SceneSnapshot::SceneSnapshot() {}
+
+void SceneSnapshot::capture(ShapeManager& shapeManager) {
+	clear();
+	vector<unique_ptr<Shape>>& shapes = shapeManager.getShapes();
+	names.reserve(shapes.size());
+	positions.reserve(shapes.size());
+	rotations.reserve(shapes.size());
+	scales.reserve(shapes.size());
+	colours.reserve(shapes.size());
+	outlineColours.reserve(shapes.size());
+	numEdges.reserve(shapes.size());
+	radii.reserve(shapes.size());
+	geometries.reserve(shapes.size());
+	orders.reserve(shapes.size());
+	for (auto& shape : shapes) add(*shape);
+	// Add the shapes and tiles that aren't loaded, if the manager is paging
+	shapeManager.capturePages(*this);
+}
+
+void SceneSnapshot::add(Shape& shape) {
+	names.push_back(shape.getName());
+	// Groups aren't saved, so grouped shapes are saved where they appear
+	positions.push_back(shape.getWorldPosition());
+	rotations.push_back(shape.getWorldRotation());
+	scales.push_back(shape.getWorldScale());
+	colours.push_back(shape.getColour());
+	outlineColours.push_back(shape.getOutlineColour());
+	numEdges.push_back(shape.getNumEdges());
+	radii.push_back(shape.getRadius());
+	geometries.push_back(shape.isParametric()? Geometry() : shape.getGeometry());
+	orders.push_back(shape.getZOrder());
+}
+
+void SceneSnapshot::append(const SceneSnapshot& snapshot) {
+	names.insert(names.end(), snapshot.names.begin(), snapshot.names.end());
+	positions.insert(positions.end(), snapshot.positions.begin(), snapshot.positions.end());
+	rotations.insert(rotations.end(), snapshot.rotations.begin(), snapshot.rotations.end());
+	scales.insert(scales.end(), snapshot.scales.begin(), snapshot.scales.end());
+	colours.insert(colours.end(), snapshot.colours.begin(), snapshot.colours.end());
+	outlineColours.insert(outlineColours.end(), snapshot.outlineColours.begin(), snapshot.outlineColours.end());
+	numEdges.insert(numEdges.end(), snapshot.numEdges.begin(), snapshot.numEdges.end());
+	radii.insert(radii.end(), snapshot.radii.begin(), snapshot.radii.end());
+	geometries.insert(geometries.end(), snapshot.geometries.begin(), snapshot.geometries.end());
+	orders.insert(orders.end(), snapshot.orders.begin(), snapshot.orders.end());
+}
+
+void SceneSnapshot::capture(ShapeManager& shapeManager, const SceneSettings& sceneSettings) {
+	capture(shapeManager);
+	settings = sceneSettings;
+}
+
+void SceneSnapshot::save(SaveManager& saveManager) const {
+	settings.save(saveManager);
+	saveShapes(saveManager);
+}
+
+void SceneSnapshot::buildGeometryDictionary(GeometryDictionary& dictionary) const {
+	dictionary.entries.clear();
+	dictionary.hashes.clear();
+	dictionary.shapeEntries.assign(size(), -1);
+	// Shapes that share geometry in memory share the entry without comparing vertices
+	unordered_map<const vector<Point>*, int> pointerIndices;
+	// Entries by content hash, to find separately created but identical vertex lists
+	unordered_multimap<unsigned long long, int> hashIndices;
+	// Base entries keep their indices, even if no shape uses them
+	for (const Geometry& base : baseGeometries) {
+		const vector<Point>* vertices = base.get();
+		unsigned long long hash = Utils::hash(vertices->data(), vertices->size() * sizeof(Point));
+		pointerIndices[vertices] = dictionary.entries.size();
+		hashIndices.insert(std::make_pair(hash, dictionary.entries.size()));
+		dictionary.entries.push_back(vertices);
+		dictionary.hashes.push_back(hash);
+	}
+	for (size_t i = 0; i < size(); i++) {
+		if (!geometries[i]) continue;
+		const vector<Point>* vertices = geometries[i].get();
+		auto pointerIndex = pointerIndices.find(vertices);
+		if (pointerIndex != pointerIndices.end()) {
+			dictionary.shapeEntries[i] = pointerIndex->second;
+			continue;
+		}
+		unsigned long long hash = Utils::hash(vertices->data(), vertices->size() * sizeof(Point));
+		auto matches = hashIndices.equal_range(hash);
+		for (auto match = matches.first; match != matches.second; match++) {
+			const vector<Point>& entry = *dictionary.entries[match->second];
+			if (entry.size() == vertices->size() && std::equal(entry.begin(), entry.end(), vertices->begin(), 
+				[](const Point& a, const Point& b) { return a.x == b.x && a.y == b.y; })) {
+				dictionary.shapeEntries[i] = match->second;
+				break;
+			}
+		}
+		if (dictionary.shapeEntries[i] < 0) {
+			// New entry
+			dictionary.shapeEntries[i] = dictionary.entries.size();
+			hashIndices.insert(std::make_pair(hash, dictionary.shapeEntries[i]));
+			dictionary.entries.push_back(vertices);
+			dictionary.hashes.push_back(hash);
+		}
+		pointerIndices[vertices] = dictionary.shapeEntries[i];
+	}
+}
+
+/**
+* Writes each distinct vertex list once to a geometry section, shapes then reference it by its index
+*/
+static void saveGeometry(SaveManager& saveManager, const SceneSnapshot::GeometryDictionary& dictionary) {
+	saveManager.startSection("geometry");
+	for (size_t i = 0; i < dictionary.entries.size(); i++) {
+		const vector<Point>& vertices = *dictionary.entries[i];
+		saveManager.startKey("geometry");
+		saveManager.addValue("hash", dictionary.hashes[i]);
+		saveManager.addArray("vertices", vertices.data(), vertices.data() + vertices.size());
+		saveManager.endKey();
+	}
+	saveManager.endSection();
+}
+
+void SceneSnapshot::saveShapes(SaveManager& saveManager) const {
+	if (tileSize > 0) {
+		saveTiles(saveManager);
+		return;
+	}
+	GeometryDictionary dictionary;
+	buildGeometryDictionary(dictionary);
+	saveGeometry(saveManager, dictionary);
+
+	saveManager.startSection("shape_manager");
+	for (size_t i = 0; i < size(); i++) saveShape(saveManager, i, dictionary, false);
+	saveManager.endSection();
+}
+
+void SceneSnapshot::saveTiles(SaveManager& saveManager) const {
+	GeometryDictionary dictionary;
+	buildGeometryDictionary(dictionary);
+	saveGeometry(saveManager, dictionary);
+
+	// Group the shapes by tile, tiles that aren't loaded may also have loaded shapes that have been moved into them
+	std::map<pair<int, int>, Tile> tiles;
+	std::map<pair<int, int>, vector<size_t>> tileShapes;
+	unsigned long long maxOrder = 0;
+	for (const Tile& source : sourceTiles) tiles[std::make_pair(source.x, source.y)] = source;
+	for (size_t i = 0; i < size(); i++) {
+		pair<int, int> key = getTile(positions[i], tileSize);
+		Tile& tile = tiles[key];
+		tile.x = key.first;
+		tile.y = key.second;
+		tile.count++;
+		tile.extent = std::max(tile.extent, getExtent(i));
+		tileShapes[key].push_back(i);
+		maxOrder = std::max(maxOrder, orders[i]);
+	}
+
+	// Tile directory
+	saveManager.startSection("tiles");
+	saveManager.addValue("tile_size", tileSize);
+	saveManager.addValue("max_order", maxOrder);
+	for (const auto& tile : tiles) {
+		saveManager.startKey("tile");
+		saveManager.addValue("x", tile.second.x);
+		saveManager.addValue("y", tile.second.y);
+		saveManager.addValue("count", tile.second.count);
+		saveManager.addValue("extent", tile.second.extent);
+		saveManager.endKey();
+	}
+	saveManager.endSection();
+
+	for (const auto& tile : tiles) {
+		string section = getTileSection(tile.first.first, tile.first.second);
+		saveManager.startSection(section);
+		bool isSource = std::any_of(sourceTiles.begin(), sourceTiles.end(), 
+			[&tile](const Tile& source) { return source.x == tile.first.first && source.y == tile.first.second; });
+		// Tiles that aren't loaded are unchanged, so their saved shapes are copied as they are
+		if (isSource) saveManager.copyKeys(tileSource, section);
+		for (size_t i : tileShapes[tile.first]) saveShape(saveManager, i, dictionary, true);
+		saveManager.endSection();
+	}
+}
+
+void SceneSnapshot::saveShape(SaveManager& saveManager, size_t i, const GeometryDictionary& dictionary, bool saveOrder) const {
+	saveManager.startKey("shape");
+	saveManager.addValue("name", names[i]);
+	if (numEdges[i] > 0) {
+		// Parametric shapes only need the parameters to recreate their vertices
+		saveManager.addValue("edges", numEdges[i]);
+		saveManager.addValue("radius", radii[i]);
+	}
+	saveManager.addValue("rotation", rotations[i]);
+	saveManager.addValue("scale", scales[i]);
+	saveManager.addValue("position", positions[i]);
+	if (dictionary.shapeEntries[i] >= 0) saveManager.addValue("geometry", dictionary.shapeEntries[i]);
+	saveManager.addValue("colour", colours[i]);
+	saveManager.addValue("outline_colour", outlineColours[i]);
+	if (saveOrder) saveManager.addValue("order", orders[i]);
+	saveManager.endKey();
+}
+
+unsigned long long SceneSnapshot::hash() const {
+	unsigned long long result = hashValues();
+	for (const Geometry& geometry : geometries) {
+		const void* vertices = geometry.get();
+		result = Utils::hash(&vertices, sizeof(vertices), result);
+	}
+	return result;
+}
+
+unsigned long long SceneSnapshot::checksum() const {
+	unsigned long long result = Utils::hash(&settings.zoom, sizeof(settings.zoom), hashValues());
+	result = Utils::hash(&settings.panX, sizeof(settings.panX), result);
+	result = Utils::hash(&settings.panY, sizeof(settings.panY), result);
+	// Geometry addresses change between runs, so hash the vertices instead
+	for (const Geometry& geometry : geometries) {
+		if (geometry) result = Utils::hash(geometry->data(), geometry->size() * sizeof(Point), result);
+	}
+	return result;
+}
+
+unsigned long long SceneSnapshot::hashValues() const {
+	unsigned long long result = Utils::hash(positions.data(), positions.size() * sizeof(Point));
+	result = Utils::hash(rotations.data(), rotations.size() * sizeof(float), result);
+	result = Utils::hash(scales.data(), scales.size() * sizeof(float), result);
+	result = Utils::hash(colours.data(), colours.size() * sizeof(Colour), result);
+	result = Utils::hash(outlineColours.data(), outlineColours.size() * sizeof(Colour), result);
+	result = Utils::hash(numEdges.data(), numEdges.size() * sizeof(int), result);
+	result = Utils::hash(radii.data(), radii.size() * sizeof(float), result);
+	result = Utils::hash(orders.data(), orders.size() * sizeof(unsigned long long), result);
+	for (const string& name : names) result = Utils::hash(name.data(), name.size(), result);
+	return result;
+}
+
+float SceneSnapshot::getExtent(size_t i) const {
+	// Regular polygon vertices are all at the radius
+	if (numEdges[i] > 0) return radii[i] * std::abs(scales[i]);
+	float extent = 0;
+	if (geometries[i]) {
+		for (const Point& vertex : *geometries[i]) extent = std::max(extent, vertex.x * vertex.x + vertex.y * vertex.y);
+	}
+	return std::sqrt(extent) * std::abs(scales[i]);
+}
+
+pair<int, int> SceneSnapshot::getTile(const Point& position, float tileSize) {
+	return std::make_pair(static_cast<int>(std::floor(position.x / tileSize)), static_cast<int>(std::floor(position.y / tileSize)));
+}
+
+string SceneSnapshot::getTileSection(int x, int y) {
+	return "tile_" + std::to_string(x) + "_" + std::to_string(y);
+}
+
+void SceneSnapshot::clear() {
+	names.clear();
+	positions.clear();
+	rotations.clear();
+	scales.clear();
+	colours.clear();
+	outlineColours.clear();
+	numEdges.clear();
+	radii.clear();
+	geometries.clear();
+	orders.clear();
+	tileSize = 0;
+	baseGeometries.clear();
+	tileSource.clear();
+	sourceTiles.clear();
+	spatialIndex.clear();
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <utility>
+#include "Utils.h"
+#include "Shape.h"
+#include "SaveManager.h"
+#include "SceneSettings.h"
+#include "SpatialIndex.h"
+
+class ShapeManager;
+
+/**
+* Frozen copy of a scene stored as a struct of arrays, where element i of each array belongs to shape i.
+* Once captured, a snapshot doesn't reference any live Shape, so it can be serialised on another thread 
+* while the scene continues to be edited. Vertices aren't copied, since shape geometry is immutable the snapshot
+* shares it with the live shapes.
+* Capturing into an existing snapshot reuses its allocations, so repeated captures are cheap.
+*
+* When tileSize is set, shapes are saved in a tiled layout: each shape is saved in the section of the square tile
+* its position is in, named tile_<x>_<y>, after a tiles section listing every tile. This lets ShapeManager page 
+* tiles in and out as the view moves. Shapes in each tile are saved with their z order so the overall order is kept.
+*/
+class SceneSnapshot {
+
+public:
+	/**
+	* Distinct vertex lists of the non parametric shapes in a snapshot, used to store each one once when saving
+	*/
+	struct GeometryDictionary {
+		std::vector<const std::vector<Point>*> entries;
+		// Content hash of each entry
+		std::vector<unsigned long long> hashes;
+		// Index of the entry used by each shape, -1 for parametric shapes
+		std::vector<int> shapeEntries;
+	};
+	/**
+	* Tile directory entry
+	*/
+	struct Tile {
+		int x = 0;
+		int y = 0;
+		// Number of shapes in the tile
+		unsigned count = 0;
+		// Furthest distance a vertex of any shape in the tile reaches from its shape's position
+		float extent = 0;
+	};
+
+	SceneSettings settings;
+
+	std::vector<std::string> names;
+	std::vector<Point> positions;
+	std::vector<float> rotations;
+	std::vector<float> scales;
+	std::vector<Colour> colours;
+	std::vector<Colour> outlineColours;
+	// Generating parameters, numEdges is 0 for shapes that aren't parametric
+	std::vector<int> numEdges;
+	std::vector<float> radii;
+	// Geometry of non parametric shapes. Parametric shapes have a null geometry since they're regenerated when loaded
+	std::vector<Geometry> geometries;
+	// Stacking order of each shape, only saved in the tiled layout since the untiled layout is saved in stacking order
+	std::vector<unsigned long long> orders;
+
+	// Size of the square tiles shapes are saved in, 0 to save untiled
+	float tileSize = 0;
+	// Geometry section entries that keep their index when saving, so the tiles copied from tileSource stay valid
+	std::vector<Geometry> baseGeometries;
+	// Tiled save that sourceTiles are copied from
+	std::string tileSource;
+	// Tiles that aren't loaded, which are copied from tileSource when saving
+	std::vector<Tile> sourceTiles;
+	// Saved spatial index of the shapes, if the file had a valid one (see BinarySaveManager). Empty otherwise
+	SpatialIndexNodes spatialIndex;
+
+	SceneSnapshot();
+
+	/**
+	* Copies the current state of the shapes in a ShapeManager into this snapshot, replacing any previous contents
+	* Parameter: ShapeManager& shapeManager  ShapeManager to copy
+	*/
+	void capture(ShapeManager& shapeManager);
+	/**
+	* Copies the current state of the shapes and scene settings into this snapshot, replacing any previous contents
+	* Parameter: ShapeManager& shapeManager  ShapeManager to copy
+	* Parameter: const SceneSettings& sceneSettings  Scene settings to copy
+	*/
+	void capture(ShapeManager& shapeManager, const SceneSettings& sceneSettings);
+	/**
+	* Copies the current state of a shape to the end of the snapshot
+	* Parameter: Shape& shape  Shape to copy
+	*/
+	void add(Shape& shape);
+	/**
+	* Copies the shapes in another snapshot to the end of this one
+	* Parameter: const SceneSnapshot& snapshot  Snapshot to copy shapes from
+	*/
+	void append(const SceneSnapshot& snapshot);
+
+	/**
+	* Saves the scene settings and shapes. The SaveManager must be in a saving state
+	* Parameter: SaveManager& saveManager  SaveManager to use to save
+	*/
+	void save(SaveManager& saveManager) const;
+	/**
+	* Saves just the shapes to a shape_manager section, after a geometry section holding each distinct vertex list once.
+	* Uses the tiled layout instead if tileSize is set. The SaveManager must be in a saving state
+	* Parameter: SaveManager& saveManager  SaveManager to use to save
+	*/
+	void saveShapes(SaveManager& saveManager) const;
+	/**
+	* Saves the shapes in the tiled layout, see tileSize. The SaveManager must be in a saving state and not writing to tileSource
+	* Parameter: SaveManager& saveManager  SaveManager to use to save
+	*/
+	void saveTiles(SaveManager& saveManager) const;
+
+	/**
+	* Finds the distinct vertex lists used by the snapshot's non parametric shapes. 
+	* Shapes sharing geometry in memory, or with identical vertices, use the same entry
+	* Parameter: GeometryDictionary& dictionary  Dictionary to fill, replacing any previous contents
+	*/
+	void buildGeometryDictionary(GeometryDictionary& dictionary) const;
+
+	/**
+	* Removes all shapes from the snapshot, keeping allocated memory for reuse
+	*/
+	void clear();
+
+	/**
+	* Returns: unsigned long long  Hash of the shapes in the snapshot, used to check if they've changed
+	*/
+	unsigned long long hash() const;
+	/**
+	* Returns: unsigned long long  Hash of the scene settings and shapes including their vertices, which unlike hash 
+	*							   is the same between runs, used to check that replaying input reproduces a scene
+	*/
+	unsigned long long checksum() const;
+	/**
+	* Parameter: size_t shape  Index of the shape
+	* Returns: float  Furthest distance a vertex of the shape reaches from its position
+	*/
+	float getExtent(size_t shape) const;
+
+	/**
+	* Parameter: const Point& position  Position in the scene
+	* Parameter: float tileSize  Size of the square tiles
+	* Returns: std::pair<int, int>  X and y index of the tile containing the position
+	*/
+	static std::pair<int, int> getTile(const Point& position, float tileSize);
+	/**
+	* Returns: std::string  Name of the section a tile's shapes are saved in
+	*/
+	static std::string getTileSection(int x, int y);
+
+	/**
+	* Returns: size_t  Number of shapes in the snapshot
+	*/
+	inline size_t size() const { return names.size(); }
+
+protected:
+	/**
+	* Saves a shape key
+	* Parameter: size_t shape  Index of the shape
+	* Parameter: const GeometryDictionary& dictionary  Dictionary the shape's geometry index is from
+	* Parameter: bool saveOrder  True to save the shape's stacking order
+	*/
+	void saveShape(SaveManager& saveManager, size_t shape, const GeometryDictionary& dictionary, bool saveOrder) const;
+	/**
+	* Returns: unsigned long long  Hash of every shape property except geometry
+	*/
+	unsigned long long hashValues() const;
+};
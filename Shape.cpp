@@ -1,38 +1,52 @@
 #include "stdafx.h"
 #include "Shape.h"
+#include "ShapeGroup.h"
+#include "TransformBatch.h"
+#include "CpuDispatch.h"
+#include <cmath>
+#include <algorithm>
 
 using std::string;
 
+/**
+* Returns: Geometry  Shared empty geometry, used by shapes that haven't created their vertices
+*/
+static Geometry emptyGeometry() {
+	static Geometry empty = std::make_shared<const std::vector<Point>>();
+	return empty;
+}
+
+
+Shape::Shape(string name, Point position) : name(name), position(position), geometry(emptyGeometry()) {}
 
-Shape::Shape(string name, Point position) : name(name), position(position) {}
+Shape::Shape(string name, Point position, std::vector<Point> vertices) 
+	: name(name), position(position), geometry(std::make_shared<const std::vector<Point>>(std::move(vertices))) {}
 
-Shape::Shape(string name, Point position, std::vector<Point> vertices) : name(name), position(position), vertices(vertices) {}
+Shape::Shape(string name, Point position, Geometry geometry) 
+	: name(name), position(position), geometry(geometry? geometry : emptyGeometry()) {}
 
-Shape::Shape(Shape* shape) {
+Shape::Shape(Shape* shape) : geometry(emptyGeometry()) {
 	copy(shape);
 }
 
 void Shape::rotateBy(float angle) {
 	updateRotation(rotation + angle);
 }
-void Shape::setRotation(float angle, bool updateVerts) {
-	if (updateVerts) updateRotation(angle);
-	else rotation = angle;
+void Shape::setRotation(float angle) {
+	updateRotation(angle);
 }
 
 void Shape::updateRotation(float newRotation) {
 	// Wrap values above +-360 to make text output more logical
 	if (abs(newRotation) > 360) newRotation = (int)newRotation % 360;
-	// Amount to rotate by to reach target rotation, in radians
-	float deltaRot = 3.142f * ((rotation - newRotation) / 180);
-	for (auto& vert : vertices) {
-		vert = Point(
-			// Rotate point clockwise
-			vert.x * cos(deltaRot) + vert.y * sin(deltaRot),
-			-vert.x * sin(deltaRot) + vert.y * cos(deltaRot)
-		);
-	}
 	rotation = newRotation;
+	// Like scaling, rotation is applied to vertices when they're used, so the shared vertices are never modified 
+	// and repeated rotations don't accumulate rounding errors
+	float radians = 3.142f * (rotation / 180);
+	rotationSin = sin(radians);
+	rotationCos = cos(radians);
+	// Rotating doesn't move the shape between index cells, so the observer isn't notified, but the world bounds change
+	worldBoundsValid = false;
 }
 
 
@@ -52,17 +66,59 @@ void Shape::updateScaling(float newScale) {
 	// To avoid floating point rounding errors, vertices are scaled when used, 
 	// as opposed to constantly being scaled on update
 	scale += deltaScale;
+	notifyBoundsChanged();
 }
 
 
 void Shape::translate(float x, float y) {
 	position.x += x;
 	position.y += y;
+	notifyBoundsChanged();
 }
 
 void Shape::setPosition(float x, float y) {
 	position.x = x;
 	position.y = y;
+	notifyBoundsChanged();
+}
+
+void Shape::setTransform(const Point& newPosition, float newRotation, float newScale) {
+	if (newRotation != rotation) updateRotation(newRotation);
+	// Rotating alone doesn't change the index cells, see updateRotation
+	if (newScale == scale && newPosition.x == position.x && newPosition.y == position.y) return;
+	scale = newScale;
+	position = newPosition;
+	notifyBoundsChanged();
+}
+
+ShapeTransform Shape::getWorldTransform() {
+	ShapeTransform local(rotationSin, rotationCos, scale, position);
+	return group? group->getWorldTransform().compose(local) : local;
+}
+
+Point Shape::getWorldPosition() {
+	return group? group->localToWorld(position) : position;
+}
+
+float Shape::getWorldRotation() {
+	return group? group->getWorldRotation() + rotation : rotation;
+}
+
+float Shape::getWorldScale() {
+	return group? group->getWorldScale() * scale : scale;
+}
+
+
+float Shape::getExtent() {
+	// Regular polygon vertices are all at the radius
+	if (numEdges > 0) return radius * std::abs(scale);
+	float extent = 0;
+	for (const Point& vertex : *geometry) extent = std::max(extent, vertex.x * vertex.x + vertex.y * vertex.y);
+	return std::sqrt(extent) * std::abs(scale);
+}
+
+size_t Shape::getMemoryUsage() {
+	return sizeof(Shape) + name.capacity() + geometry->capacity() * sizeof(Point) / geometry.use_count();
 }
 
 
@@ -71,7 +127,7 @@ void Shape::setColour(float r, float g, float b) {
 	colour.g = g;
 	colour.b = b;
 }
-void Shape::setColour(Colour& newColour) {
+void Shape::setColour(const Colour& newColour) {
 	colour.r = newColour.r;
 	colour.g = newColour.g;
 	colour.b = newColour.b;
@@ -82,7 +138,7 @@ void Shape::setOutlineColour(float r, float g, float b) {
 	outlineColour.g = g;
 	outlineColour.b = b;
 }
-void Shape::setOutlineColour(Colour& newColour) {
+void Shape::setOutlineColour(const Colour& newColour) {
 	outlineColour.r = newColour.r;
 	outlineColour.g = newColour.g;
 	outlineColour.b = newColour.b;
@@ -90,81 +146,131 @@ void Shape::setOutlineColour(Colour& newColour) {
 
 
 bool Shape::pointInBounds(float x, float y) {
-	// Convert test point to local coordinates
-	x -= position.x;
-	y -= position.y;
+	return localPointInBounds(worldToLocal(x, y));
+}
+
+bool Shape::localPointInBounds(const Point& point) {
+	const std::vector<Point>& vertices = *geometry;
+	if (vertices.empty()) return false;
 	// Smallest and largest x and y points
-	float xMin = vertices[0].x;
-	float xMax = vertices[0].x;
-	float yMin = vertices[0].y;
-	float yMax = vertices[0].y;
-	for (auto& vert : vertices) {
-		if (vert.x < xMin) xMin = vert.x;
-		if (vert.x > xMax) xMax = vert.x;
-		if (vert.y < yMin) yMin = vert.y;
-		if (vert.y > yMax) yMax = vert.y;
-	}
-	// If the target x is within xMin and xMax and target y is within yMin and yMax, it's within the shape's bounds
-	return (x > xMin * scale && x < xMax * scale) && (y > yMin * scale && y < yMax * scale);
+	Point min, max;
+	CpuDispatch::get().bounds(vertices.data(), vertices.size(), min, max);
+	// If the target x is within the smallest and largest x and target y within the smallest and largest y, it's within the shape's bounds
+	return (point.x > min.x && point.x < max.x) && (point.y > min.y && point.y < max.y);
 }
 
 bool Shape::pointInShape(float x, float y) {
+	// Convert test point to local coordinates, so it can be tested against the unscaled, unrotated vertices
+	Point point = worldToLocal(x, y);
 	// Quick check to see if point is in the shape bounding box, if it is, perform a slower, more accurate test
-	if (pointInBounds(x, y)) {
-		// Convert test point to local coordinates
-		x -= position.x;
-		y -= position.y;
-		// Based on PNPOLY by Wm. Randolph Franklin (https://www.ecse.rpi.edu/Homepages/wrf/Research/Short_Notes/pnpoly.html)
-		// Cast a horizontal ray to the right from the test point and for each edge the it crosses, flips the inShape boolean 
-		// If number of crossed edges is odd, the point is in the shape and the boolean will be true
-		int numVerts = vertices.size();
-		bool inShape = false; // Whether the point is in the shape
-		std::vector<float> vertx; // Vector of x vertices
-		std::vector<float> verty; // Vector of y vertices
-		for (auto& vert : vertices) {
-			// Multiply each vertex by the scale and add to appropriate vector to improve readability of the if statement
-			vertx.push_back(vert.x * scale);
-			verty.push_back(vert.y * scale);
+	if (localPointInBounds(point)) {
+		const std::vector<Point>& vertices = *geometry;
+		// Even-odd test of a horizontal ray to the right of the point against every edge
+		return CpuDispatch::get().pointInPolygon(vertices.data(), vertices.size(), point.x, point.y);
+	}
+	return false;
+}
+
+void Shape::getWorldBounds(Point& min, Point& max) {
+	if (!worldBoundsValid) {
+		const std::vector<Point>& vertices = *geometry;
+		worldMin = worldMax = position;
+		for (size_t i = 0; i < vertices.size(); i++) {
+			Point world = localToWorld(vertices[i]);
+			if (i == 0) worldMin = worldMax = world;
+			worldMin.x = std::min(worldMin.x, world.x);
+			worldMin.y = std::min(worldMin.y, world.y);
+			worldMax.x = std::max(worldMax.x, world.x);
+			worldMax.y = std::max(worldMax.y, world.y);
 		}
-		int i, j;
-		for (i = 0, j = numVerts - 1; i < numVerts; j = i++) {
-			// j and i are the indices of the 2 vertices that make up the current edge
-			// Check if test y is within the upper and lower y bound of the edge
-			if (((verty[i] > y) != (verty[j] > y)) &&
-				// If it is, check if the test x is to the left of the x point of the edge, given the test y
-				(x < (vertx[j] - vertx[i]) * (y - verty[i]) / (verty[j] - verty[i]) + vertx[i]))
-				// If if its, an edge has been crossed, flip inShape boolean
-				inShape = !inShape;
+		worldBoundsValid = true;
+	}
+	min = worldMin;
+	max = worldMax;
+}
+
+/**
+* Returns whether two line segments cross, touching at an end doesn't count
+*/
+static bool segmentsCross(const Point& a, const Point& b, const Point& c, const Point& d) {
+	// Which side of each segment the other's ends are on, from the sign of the cross products
+	float d1 = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	float d2 = (b.x - a.x) * (d.y - a.y) - (b.y - a.y) * (d.x - a.x);
+	float d3 = (d.x - c.x) * (a.y - c.y) - (d.y - c.y) * (a.x - c.x);
+	float d4 = (d.x - c.x) * (b.y - c.y) - (d.y - c.y) * (b.x - c.x);
+	return ((d1 > 0 && d2 < 0) || (d1 < 0 && d2 > 0)) && ((d3 > 0 && d4 < 0) || (d3 < 0 && d4 > 0));
+}
+
+/**
+* Returns whether any edge of a shape, in world coordinates, crosses any edge of a polygon
+*/
+static bool edgesCross(Shape& shape, const Point* polygon, size_t count) {
+	const std::vector<Point>& vertices = shape.getVertices();
+	// World vertices are recalculated rather than stored, shapes only have a few
+	Point start = shape.localToWorld(vertices.back());
+	for (const Point& vertex : vertices) {
+		Point end = shape.localToWorld(vertex);
+		for (size_t i = 0, j = count - 1; i < count; j = i++) {
+			if (segmentsCross(start, end, polygon[j], polygon[i])) return true;
 		}
-		return inShape;
-		//
+		start = end;
 	}
 	return false;
 }
 
+bool Shape::intersectsPolygon(const Point* polygon, size_t count) {
+	const std::vector<Point>& vertices = *geometry;
+	if (vertices.empty() || count < 3) return false;
+	const CpuDispatch::Kernels& kernels = CpuDispatch::get();
+	// Overlapping shapes either have a vertex inside the other or edges that cross
+	for (const Point& vertex : vertices) {
+		Point world = localToWorld(vertex);
+		if (kernels.pointInPolygon(polygon, count, world.x, world.y)) return true;
+	}
+	for (size_t i = 0; i < count; i++) {
+		if (pointInShape(polygon[i].x, polygon[i].y)) return true;
+	}
+	return edgesCross(*this, polygon, count);
+}
+
+bool Shape::inPolygon(const Point* polygon, size_t count) {
+	const std::vector<Point>& vertices = *geometry;
+	if (vertices.empty() || count < 3) return false;
+	const CpuDispatch::Kernels& kernels = CpuDispatch::get();
+	for (const Point& vertex : vertices) {
+		Point world = localToWorld(vertex);
+		if (!kernels.pointInPolygon(polygon, count, world.x, world.y)) return false;
+	}
+	// A concave polygon can cut between vertices that are all inside it
+	return !edgesCross(*this, polygon, count);
+}
+
 void Shape::morph(Shape* shape) {
 	if (shape) {
-		// Set this shape's vertices to the target shape's vertices
-		vertices = shape->getVertices();
-		// Since the target shape could have a different scale and rotation which will have been applied to the vertices
-		// cache this shape's current scale and rotation for transforming to after
-		float currentScale = scale;
-		float currentRotation = rotation;
-		// Update this shape's scale and rotation to match the target shape's scale and rotation
-		scale = shape->getScale();
-		rotation = shape->getRotation();
+		// Share the target shape's vertices. Scale and rotation aren't applied to the vertices, 
+		// so this shape's current scale and rotation are kept without any conversion
+		geometry = shape->getGeometry();
 		name = shape->getName();
-		// Update this shape's scale and rotation to the original (cached) values
-		setScale(currentScale);
-		setRotation(currentRotation);
+		numEdges = shape->getNumEdges();
+		radius = shape->getRadius();
+		notifyBoundsChanged();
 	}
 }
 
+void Shape::setGeometry(Geometry newGeometry) {
+	geometry = newGeometry? newGeometry : emptyGeometry();
+	numEdges = 0;
+	radius = 0;
+	notifyBoundsChanged();
+}
+
 void Shape::copy(Shape* shape) {
 	if (shape) {
-		rotation = shape->getRotation();
-		scale = shape->getScale();
-		position = shape->getPosition();
+		// Copies aren't grouped, so they take the world transform of grouped shapes and appear in the same place
+		setRotation(shape->getWorldRotation());
+		scale = shape->getWorldScale();
+		position = shape->getWorldPosition();
+		notifyBoundsChanged();
 		colour = shape->getColour();
 		outlineColour = shape->getOutlineColour();
 		morph(shape);
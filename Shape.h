@@ -2,21 +2,77 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 #include "Utils.h"
 
+/**
+* Immutable list of local vertices, shared between shapes with identical geometry
+*/
+typedef std::shared_ptr<const std::vector<Point>> Geometry;
+
+class Shape;
+class ShapeGroup;
+struct ShapeTransform;
+
+/**
+* Receives notifications when a shape's bounds change, see Shape::setObserver
+*/
+class ShapeObserver {
+public:
+	/**
+	* Called the first time the shape's position, scale or vertices change after Shape::clearBoundsChanged
+	*/
+	virtual void onBoundsChanged(Shape* shape) = 0;
+};
+
+/**
+* Range of spatial index cells a shape is stored in, maintained by SpatialIndex
+*/
+struct CellRange {
+	int minX = 0;
+	int minY = 0;
+	int maxX = -1;
+	int maxY = -1;
+	// Set when the range covers too many cells to store the shape in each, so the index keeps it in a list it always checks instead
+	bool overflow = false;
+
+	inline bool empty() const { return maxX < minX || maxY < minY; }
+};
+
 
 class Shape {
 
 
 protected:
-	std::vector<Point> vertices;
+	// Local vertices, before scale, rotation and position are applied. 
+	// Since they're never modified, copies and morphs share the same geometry
+	Geometry geometry;
 	Point position;
 	Colour colour;
 	Colour outlineColour;
 	bool outlineVisible = false;
 	std::string name;
 	float rotation = 0;
+	// Cached sine and cosine of the rotation, used to transform vertices
+	float rotationSin = 0;
+	float rotationCos = 1;
 	float scale = 1;
+	// Parameters the vertices were generated from, numEdges is 0 if the vertices aren't parametric
+	int numEdges = 0;
+	float radius = 0;
+	// Stacking order assigned by ShapeManager, shapes with a higher order are drawn on top
+	unsigned long long zOrder = 0;
+	// Notified when the bounds change, boundsChanged is set until the observer clears it so it's only notified once
+	ShapeObserver* observer = nullptr;
+	bool boundsChanged = false;
+	CellRange indexCells;
+	// Whether the shape is in its manager's selection
+	bool selected = false;
+	// Group the position, rotation and scale are relative to, or nullptr if they're relative to the world
+	ShapeGroup* group = nullptr;
+	// Cached bounding box of the vertices, in the same coordinates as the position, recalculated when next needed after the shape is moved, scaled, rotated or morphed
+	Point worldMin, worldMax;
+	bool worldBoundsValid = false;
 
 public:
 	/**
@@ -31,10 +87,16 @@ public:
 	*/
 	Shape(std::string name, Point position, std::vector<Point> vertices);
 	/**
+	* Parameter: std::string name  Name of the shape
+	* Parameter: Point position  Starting position of the shape, with center origin
+	* Parameter: Geometry geometry  Shared local vertices to use for this shape
+	*/
+	Shape(std::string name, Point position, Geometry geometry);
+	/**
 	* Copy all properties of the input shape to the new Shape instance, effectively duplicating the input shape
 	*/
 	Shape(Shape* shape);
-	~Shape() {}
+	virtual ~Shape() {}
 
 	/**
 	* Returns whether the specified point is within the shape's bounding box
@@ -50,10 +112,32 @@ public:
 	* Returns: bool  True if the point is within the shape's area
 	*/
 	virtual bool pointInShape(float x, float y);
+	/**
+	* Returns whether any part of the shape overlaps a polygon
+	* Parameter: const Point* polygon  Vertices of the polygon in world coordinates, which may be concave
+	* Parameter: size_t count  Number of vertices, at least 3
+	* Returns: bool  True if the shape and polygon overlap
+	*/
+	bool intersectsPolygon(const Point* polygon, size_t count);
+	/**
+	* Returns whether the whole shape is inside a polygon
+	* Parameter: const Point* polygon  Vertices of the polygon in world coordinates, which may be concave
+	* Parameter: size_t count  Number of vertices, at least 3
+	* Returns: bool  True if every vertex is inside the polygon and no edges cross
+	*/
+	bool inPolygon(const Point* polygon, size_t count);
+	/**
+	* Gets the axis-aligned box around the shape's world vertices, cached until the shape's transform or vertices change.
+	* Like the other tests, it's in the coordinates of the shape's group for shapes in one
+	* Parameter: Point& min  Set to the smallest world x and y
+	* Parameter: Point& max  Set to the largest world x and y
+	*/
+	void getWorldBounds(Point& min, Point& max);
 
 
 	/**
-	* Converts this shape's vertices into the target shape's vertices, current scaling and rotation are maintained
+	* Converts this shape's vertices into the target shape's vertices, current scaling and rotation are maintained.
+	* The target's geometry is shared rather than copied
 	* Parameter: Shape* shape  Shape to morph to
 	*/
 	void morph(Shape* shape);
@@ -72,13 +156,17 @@ public:
 	/**
 	* Set rotation of the shape around its centre
 	* Parameter: float angle  Rotation angle in degrees
-	* Parameter: bool updateVerts  True if the vertices should be updated to match the new rotation, rather than just setting the rotation value
 	*/
-	void setRotation(float angle, bool updateVerts=true);
+	void setRotation(float angle);
 	/**
 	* Returns: int  Current shape rotation in degrees
 	*/
 	inline float getRotation() { return rotation; }
+	/**
+	* Returns: float  Cached sine and cosine of the rotation, as used by localToWorld
+	*/
+	inline float getRotationSin() { return rotationSin; }
+	inline float getRotationCos() { return rotationCos; }
 
 	/**
 	* Scale the shape by the scale factor with shape center as origin
@@ -117,6 +205,33 @@ public:
 	*/
 	inline Point getPosition() { return position; }
 
+	/**
+	* Returns: ShapeTransform  Local to world transform, composed with the group's cached world transform for shapes in a group
+	*/
+	ShapeTransform getWorldTransform();
+	/**
+	* Returns: Point  Position, rotation and scale relative to the world rather than the shape's group, as they're saved
+	*/
+	Point getWorldPosition();
+	float getWorldRotation();
+	float getWorldScale();
+	/**
+	* Returns: ShapeGroup*  Group the shape's transform is relative to, or nullptr
+	*/
+	inline ShapeGroup* getGroup() { return group; }
+	/**
+	* Parameter: ShapeGroup* newGroup  Group the transform is relative to. ShapeGroup keeps its shapes in sync with this, so only it should set it
+	*/
+	inline void setGroup(ShapeGroup* newGroup) { group = newGroup; }
+
+	/**
+	* Sets the position, rotation and scale at once, notifying the observer once, as group transforms do
+	* Parameter: const Point& newPosition  New position
+	* Parameter: float newRotation  New rotation in degrees
+	* Parameter: float newScale  New scale factor
+	*/
+	void setTransform(const Point& newPosition, float newRotation, float newScale);
+
 	/**
 	* Set the colour of the shape
 	* Parameter: float r  Red component
@@ -125,7 +240,7 @@ public:
 	*/
 	void setColour(float r, float g, float b);
 	// Note: Colour properties are copied
-	void setColour(Colour& newColour);
+	void setColour(const Colour& newColour);
 	/**
 	* Returns: Colour  Current shape colour
 	*/
@@ -139,7 +254,7 @@ public:
 	*/
 	void setOutlineColour(float r, float g, float b);
 	// Note: Colour properties are copied
-	void setOutlineColour(Colour& newColour);
+	void setOutlineColour(const Colour& newColour);
 	/**
 	* Returns: Colour  Current shape outline colour
 	*/
@@ -155,12 +270,106 @@ public:
 	*/
 	inline bool isOutlineVisible() { return outlineVisible;  }
 
-	inline std::string getName() { return name; }
+	inline const std::string& getName() { return name; }
+
+	/**
+	* Returns: bool  True if the vertices were generated from the number of edges and radius, 
+	*				 so can be recreated from them rather than stored
+	*/
+	inline bool isParametric() { return numEdges > 0; }
+	/**
+	* Returns: int  Number of edges the vertices were generated with, 0 if the shape isn't parametric
+	*/
+	inline int getNumEdges() { return numEdges; }
+	/**
+	* Returns: float  Radius the vertices were generated with
+	*/
+	inline float getRadius() { return radius; }
+
+	/**
+	* Returns: unsigned long long  Stacking order, shapes with a higher order are drawn on top
+	*/
+	inline unsigned long long getZOrder() { return zOrder; }
+	/**
+	* Parameter: unsigned long long order  New stacking order. ShapeManager keeps its shapes sorted by this, so only it should set it
+	*/
+	inline void setZOrder(unsigned long long order) { zOrder = order; }
+	/**
+	* Returns: bool  True if the shape is in its manager's selection
+	*/
+	inline bool isSelected() { return selected; }
+	/**
+	* Parameter: bool value  Whether the shape is selected. ShapeManager keeps its selection in sync with this, so only it should set it
+	*/
+	inline void setSelected(bool value) { selected = value; }
+
+	/**
+	* Parameter: ShapeObserver* newObserver  Observer to notify when the bounds change, or nullptr
+	*/
+	inline void setObserver(ShapeObserver* newObserver) { observer = newObserver; }
+	/**
+	* Returns: bool  True if the bounds have changed since the observer last cleared the flag
+	*/
+	inline bool hasBoundsChanged() { return boundsChanged; }
+	/**
+	* Re-enables bounds change notifications
+	*/
+	inline void clearBoundsChanged() { boundsChanged = false; }
+	/**
+	* Returns: CellRange&  Spatial index cells the shape is stored in
+	*/
+	inline CellRange& getIndexCells() { return indexCells; }
+
+	/**
+	* Returns: float  Furthest distance a vertex reaches from the position, at any rotation
+	*/
+	float getExtent();
 
 	/**
-	* Returns: std::vector<Point>&  Vector of shape vertices (as Points)
+	* Returns: size_t  Approximate memory used by the shape in bytes, with shared geometry divided between the shapes using it
 	*/
-	inline std::vector<Point>& getVertices() { return vertices; }
+	size_t getMemoryUsage();
+
+	/**
+	* Returns: const std::vector<Point>&  Vector of local shape vertices (as Points), before scale, rotation and position are applied
+	*/
+	inline const std::vector<Point>& getVertices() { return *geometry; }
+	/**
+	* Returns: const Geometry&  Shared pointer to the local shape vertices
+	*/
+	inline const Geometry& getGeometry() { return geometry; }
+	/**
+	* Replaces the shape's vertices with shared geometry. The shape is no longer parametric
+	* Parameter: Geometry newGeometry  Local vertices to use
+	*/
+	void setGeometry(Geometry newGeometry);
+
+	/**
+	* Transforms a point from the shape's local coordinates to world coordinates, or its group's coordinates for shapes in a group.
+	* pointInShape and the region tests take points in the same coordinates, so ShapeManager converts them for grouped shapes
+	* Parameter: const Point& point  Point in local coordinates, such as a vertex
+	* Returns: Point  Point with the shape's scale, rotation and position applied
+	*/
+	inline Point localToWorld(const Point& point) {
+		return Point(
+			position.x + (point.x * rotationCos - point.y * rotationSin) * scale,
+			position.y + (point.x * rotationSin + point.y * rotationCos) * scale
+		);
+	}
+	/**
+	* Transforms a point from world coordinates to the shape's local coordinates
+	* Parameter: float x  X coordinate of the point
+	* Parameter: float y  Y coordinate of the point
+	* Returns: Point  Point with the shape's position, rotation and scale removed
+	*/
+	inline Point worldToLocal(float x, float y) {
+		x -= position.x;
+		y -= position.y;
+		return Point(
+			(x * rotationCos + y * rotationSin) / scale,
+			(-x * rotationSin + y * rotationCos) / scale
+		);
+	}
 
 protected:
 	/**
@@ -175,8 +384,24 @@ protected:
 	void updateScaling(float newScale);
 
 	/**
-	* Updates vertex coordinates to the new rotation
+	* Updates the rotation used when transforming vertices
 	* Parameter: float newRotation  New shape rotation in degrees
 	*/
 	void updateRotation(float newRotation);
+
+	/**
+	* Returns whether a point in local coordinates is within the shape's bounding box
+	*/
+	bool localPointInBounds(const Point& point);
+
+	/**
+	* Notifies the observer that the bounds have changed, unless it's already been notified
+	*/
+	inline void notifyBoundsChanged() {
+		worldBoundsValid = false;
+		if (observer && !boundsChanged) {
+			boundsChanged = true;
+			observer->onBoundsChanged(this);
+		}
+	}
 };
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include "stdafx.h"
+#include "ShapeGroup.h"
+#include <cmath>
+#include <algorithm>
+
+
+ShapeGroup::ShapeGroup(const Point& position) : position(position) {}
+
+void ShapeGroup::translate(float x, float y) {
+	position.x += x;
+	position.y += y;
+	invalidateWorld();
+}
+
+void ShapeGroup::setPosition(float x, float y) {
+	position.x = x;
+	position.y = y;
+	invalidateWorld();
+}
+
+void ShapeGroup::rotateBy(float angle) {
+	updateRotation(rotation + angle);
+}
+
+void ShapeGroup::setRotation(float angle) {
+	updateRotation(angle);
+}
+
+void ShapeGroup::updateRotation(float newRotation) {
+	rotation = newRotation;
+	// The same conversion as Shape, so a group and a shape rotated by the same angle turn by the same amount
+	float radians = 3.142f * (rotation / 180);
+	rotationSin = sin(radians);
+	rotationCos = cos(radians);
+	invalidateWorld();
+}
+
+void ShapeGroup::setScale(float newScale) {
+	scale = newScale;
+	invalidateWorld();
+}
+
+void ShapeGroup::invalidateWorld() {
+	// Everything below an invalid group is already invalid, so only groups that were valid are visited
+	if (!worldValid) return;
+	worldValid = false;
+	for (ShapeGroup* child : children) child->invalidateWorld();
+}
+
+const ShapeTransform& ShapeGroup::getWorldTransform() {
+	if (!worldValid) {
+		ShapeTransform local(rotationSin, rotationCos, scale, position);
+		if (parent) {
+			world = parent->getWorldTransform().compose(local);
+			worldRotation = parent->getWorldRotation() + rotation;
+			worldScale = parent->getWorldScale() * scale;
+		} else {
+			world = local;
+			worldRotation = rotation;
+			worldScale = scale;
+		}
+		worldValid = true;
+	}
+	return world;
+}
+
+float ShapeGroup::getWorldRotation() {
+	getWorldTransform();
+	return worldRotation;
+}
+
+float ShapeGroup::getWorldScale() {
+	getWorldTransform();
+	return worldScale;
+}
+
+ShapeGroup* ShapeGroup::getRoot() {
+	ShapeGroup* root = this;
+	while (root->parent) root = root->parent;
+	return root;
+}
+
+size_t ShapeGroup::getShapeCount() {
+	size_t count = shapes.size();
+	for (ShapeGroup* child : children) count += child->getShapeCount();
+	return count;
+}
+
+void ShapeGroup::addShape(Shape* shape) {
+	shapes.push_back(shape);
+	shape->setGroup(this);
+	index.insert(shape);
+}
+
+void ShapeGroup::removeShape(Shape* shape) {
+	auto it = std::find(shapes.begin(), shapes.end(), shape);
+	if (it == shapes.end()) return;
+	index.remove(shape);
+	shape->setGroup(nullptr);
+	// Order doesn't matter, so the last shape fills the gap
+	*it = shapes.back();
+	shapes.pop_back();
+}
+
+void ShapeGroup::clearShapes() {
+	for (Shape* shape : shapes) {
+		shape->setGroup(nullptr);
+		shape->getIndexCells() = CellRange();
+	}
+	shapes.clear();
+	index.clear();
+}
+
+void ShapeGroup::addChild(ShapeGroup* group) {
+	children.push_back(group);
+	group->parent = this;
+	// The child's world transform now includes this group's
+	group->invalidateWorld();
+}
+
+void ShapeGroup::removeChild(ShapeGroup* group) {
+	auto it = std::find(children.begin(), children.end(), group);
+	if (it == children.end()) return;
+	children.erase(it);
+	group->parent = nullptr;
+	group->invalidateWorld();
+}
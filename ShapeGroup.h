@@ -0,0 +1,133 @@
+#pragma once
+
+#include <vector>
+#include "Utils.h"
+#include "Shape.h"
+#include "SpatialIndex.h"
+#include "TransformBatch.h"
+
+/**
+* A node of the scene hierarchy with its own position, rotation and scale. Its shapes and child groups are stored relative
+* to it, so transforming a group moves everything in it without changing any of them.
+*
+* The world transform is composed with the parent's when next needed and cached. Transforming a group invalidates the cached
+* transforms of the groups below it, stopping at groups that are already invalid, since everything below an invalid group is too.
+* Shapes are never visited, they compose their own transform with their group's when drawn or saved, see Shape::getWorldTransform.
+*
+* The group's shapes are kept in its own SpatialIndex in its local coordinates, which ShapeManager searches
+* with points and regions converted to them, so moving the group doesn't move its shapes between cells either.
+* ShapeManager creates, fills and deletes groups, see ShapeManager::createGroup
+*/
+class ShapeGroup {
+
+protected:
+	ShapeGroup* parent = nullptr;
+	std::vector<ShapeGroup*> children;
+	// Shapes directly in this group, in no particular order
+	std::vector<Shape*> shapes;
+	SpatialIndex index;
+	// Transform relative to the parent, or to the world for groups without one
+	Point position;
+	float rotation = 0;
+	float rotationSin = 0;
+	float rotationCos = 1;
+	float scale = 1;
+	// Cached world transform, and the rotation and scale it's made of
+	ShapeTransform world;
+	float worldRotation = 0;
+	float worldScale = 1;
+	bool worldValid = false;
+
+public:
+	/**
+	* Parameter: const Point& position  Origin of the group, which it rotates and scales about, relative to its parent
+	*/
+	ShapeGroup(const Point& position);
+
+	/**
+	* Parameter: float x  Distance to move along the parent's x axis
+	* Parameter: float y  Distance to move along the parent's y axis
+	*/
+	void translate(float x, float y);
+	void setPosition(float x, float y);
+	inline Point getPosition() { return position; }
+	/**
+	* Parameter: float angle  Degrees to rotate about the group's position by
+	*/
+	void rotateBy(float angle);
+	void setRotation(float angle);
+	inline float getRotation() { return rotation; }
+	/**
+	* Parameter: float newScale  Scale relative to the parent, applied about the group's position
+	*/
+	void setScale(float newScale);
+	inline float getScale() { return scale; }
+
+	/**
+	* Returns: ShapeTransform  Transform from the group's coordinates to its parent's
+	*/
+	inline ShapeTransform getLocalTransform() { return ShapeTransform(rotationSin, rotationCos, scale, position); }
+	/**
+	* Returns: const ShapeTransform&  Transform from the group's coordinates to the world's, composed with the parent's if it's changed
+	*/
+	const ShapeTransform& getWorldTransform();
+	/**
+	* Returns: float  Rotation in degrees and scale relative to the world, the sums and products of the ancestors' and this group's
+	*/
+	float getWorldRotation();
+	float getWorldScale();
+	/**
+	* Returns: Point  World point converted to the group's coordinates, the ones its shapes' positions are in
+	*/
+	inline Point worldToLocal(const Point& point) { return getWorldTransform().applyInverse(point); }
+	/**
+	* Returns: Point  Point in the group's coordinates converted to world coordinates
+	*/
+	inline Point localToWorld(const Point& point) { return getWorldTransform().apply(point); }
+
+	inline ShapeGroup* getParent() { return parent; }
+	/**
+	* Returns: ShapeGroup*  The outermost group this group is in, or this group if it isn't in one
+	*/
+	ShapeGroup* getRoot();
+	inline const std::vector<ShapeGroup*>& getChildren() { return children; }
+	/**
+	* Returns: const std::vector<Shape*>&  Shapes directly in this group, not those in its child groups
+	*/
+	inline const std::vector<Shape*>& getShapes() { return shapes; }
+	/**
+	* Returns: size_t  Number of shapes in this group and every group below it
+	*/
+	size_t getShapeCount();
+	/**
+	* Returns: bool  True if the group has no shapes or child groups
+	*/
+	inline bool empty() { return shapes.empty() && children.empty(); }
+	/**
+	* Returns: SpatialIndex&  Index of the group's own shapes in its local coordinates
+	*/
+	inline SpatialIndex& getIndex() { return index; }
+
+	/**
+	* Adds and removes shapes and child groups. ShapeManager converts their transforms to and from the group's coordinates
+	* and keeps the index up to date, so only it should call these
+	*/
+	void addShape(Shape* shape);
+	void removeShape(Shape* shape);
+	/**
+	* Removes every shape at once, without removing them from the index one at a time
+	*/
+	void clearShapes();
+	void addChild(ShapeGroup* group);
+	void removeChild(ShapeGroup* group);
+
+protected:
+	/**
+	* Updates the cached sine and cosine after the rotation changes
+	*/
+	void updateRotation(float newRotation);
+	/**
+	* Marks the cached world transform of this group and every group below it as out of date
+	*/
+	void invalidateWorld();
+};
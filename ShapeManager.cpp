@@ -2,16 +2,89 @@
 #include "ShapeManager.h"
 #include "Shape.h"
 #include "ShapeRenderer.h"
+#include "SceneSnapshot.h"
+#include "RegularPolygon.h"
+#include "Trace.h"
+#include "AllocationCounter.h"
+#include "CpuDispatch.h"
 #include <iostream>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <random>
 
 using std::unique_ptr;
 using std::vector;
 using std::string;
 using std::map;
 
+/**
+* Returns: bool  True if a is stacked below b
+*/
+static inline bool zOrderLess(const unique_ptr<Shape>& a, const unique_ptr<Shape>& b) {
+	return a->getZOrder() < b->getZOrder();
+}
+
+// Fewest shapes per thread when region queries and selection updates are split between threads
+static const size_t MIN_SHAPES_PER_THREAD = 4096;
+
+/**
+* Splits a number of shapes into a range per thread and runs an operation on each range, the calling thread running the first.
+* Fewer threads are used when there aren't enough shapes to be worth starting them
+* Parameter: size_t count  Number of shapes
+* Parameter: unsigned threads  Most threads to use, 0 to use one per hardware thread
+* Parameter: Operation operation  Callable taking the first and one past the last index of a range
+*/
+template <class Operation>
+static void runInRanges(size_t count, unsigned threads, Operation operation) {
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+	threads = static_cast<unsigned>(std::min<size_t>(threads, count / MIN_SHAPES_PER_THREAD + 1));
+	vector<std::thread> workers;
+	for (unsigned i = 1; i < threads; i++) workers.push_back(std::thread(operation, count * i / threads, count * (i + 1) / threads));
+	operation(0, count / threads);
+	for (auto& worker : workers) worker.join();
+}
+
+/**
+* Removes the shapes that fail a region test, then sorts the rest back to front if they weren't already.
+* Rejected shapes are set to nullptr in place, so ranges can be tested on separate threads without other storage
+* Parameter: std::vector<Shape*>& shapes  Candidate shapes, replaced by the ones that pass
+* Parameter: bool sorted  True if the candidates are already back to front
+* Parameter: unsigned threads  Most threads to test with, 0 to use one per hardware thread
+* Parameter: Test test  Callable taking a Shape& and returning true to keep it
+*/
+template <class Test>
+static void filterShapes(vector<Shape*>& shapes, bool sorted, unsigned threads, Test test) {
+	runInRanges(shapes.size(), threads, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			if (!test(*shapes[i])) shapes[i] = nullptr;
+		}
+	});
+	shapes.erase(std::remove(shapes.begin(), shapes.end(), nullptr), shapes.end());
+	if (!sorted) std::sort(shapes.begin(), shapes.end(), [](Shape* a, Shape* b) { return a->getZOrder() < b->getZOrder(); });
+}
+
+/**
+* Returns whether a shape is in a polygon region, first rejecting it by its cached bounds against the polygon's
+* Parameter: const Point& min  Smallest x and y of the polygon
+* Parameter: const Point& max  Largest x and y of the polygon
+*/
+static bool inPolygonRegion(Shape& shape, const Point* polygon, size_t count, const Point& min, const Point& max, ShapeManager::RegionMode mode) {
+	// Shapes outside the polygon's bounds are rejected by their cached bounds before testing against every edge
+	Point shapeMin, shapeMax;
+	shape.getWorldBounds(shapeMin, shapeMax);
+	if (shapeMax.x < min.x || shapeMin.x > max.x || shapeMax.y < min.y || shapeMin.y > max.y) return false;
+	if (mode == ShapeManager::CONTAINED) {
+		return shapeMin.x >= min.x && shapeMax.x <= max.x && shapeMin.y >= min.y && shapeMax.y <= max.y 
+			&& shape.inPolygon(polygon, count);
+	}
+	return shape.intersectsPolygon(polygon, count);
+}
 
 ShapeManager::ShapeManager() {
-	renderer = ShapeRenderer();
+	shapeRenderer = ShapeRenderer();
 }
 
 
@@ -19,60 +92,842 @@ ShapeManager::~ShapeManager() {
 	// Vectors and the unique pointers are destroyed automatically
 }
 
-void ShapeManager::update() {
-	renderer.render(shapes);
+vector<Geometry> ShapeManager::loadGeometry(SaveManager& saveManager) {
+	vector<Geometry> geometries;
+	for (auto& geometryArrays : saveManager.getSectionKeyArrays("geometry", "geometry")) {
+		vector<Point> vertices;
+		for (const auto& pointStr : geometryArrays["vertices"]) {
+			vertices.push_back(SaveManager::parsePoint(pointStr));
+		}
+		geometries.push_back(std::make_shared<const vector<Point>>(std::move(vertices)));
+	}
+	return geometries;
+}
+
+void ShapeManager::render(Renderer& renderer) {
+	Trace::Scope span("ShapeManager::render");
+	shapeRenderer.render(renderer, shapes);
 }
 
 void ShapeManager::save(SaveManager& saveManager) {
-	saveManager.startSection("shape_manager");
-	for (auto& shape : shapes) {
-		saveManager.startKey("shape");
-		saveManager.addValue("name", shape->getName());
-		saveManager.addValue("rotation", shape->getRotation());
-		saveManager.addValue("scale", shape->getScale());
-		saveManager.addValue("position", shape->getPosition());
-		//saveManager.addValue("outline_visible", shape->isOutlineVisible());
-		saveManager.addValue("vertices", shape->getVertices());
-		saveManager.addValue("colour", shape->getColour());
-		saveManager.addValue("outline_colour", shape->getOutlineColour());
-		saveManager.endKey();
-	}
-	saveManager.endSection();
+	// Serialise through a snapshot so synchronous saves and background autosaves write the same format
+	SceneSnapshot snapshot;
+	snapshot.capture(*this);
+	snapshot.saveShapes(saveManager);
 }
 
 void ShapeManager::load(SaveManager& saveManager) {
-	vector<map<string, string>>& shapeVals = saveManager.getSectionKeyValues("shape_manager", "shape");
-	vector<map<string, vector<string>>>& shapeArrays = saveManager.getSectionKeyArrays("shape_manager", "shape");
+	load(saveManager, 1);
+}
+
+void ShapeManager::load(SaveManager& saveManager, unsigned threads) {
+	// Untiled saves have every shape in the shape_manager section, tiled saves have them in the sections listed in tiles
+	vector<map<string, string>*> shapeVals;
+	vector<map<string, vector<string>>*> shapeArrays;
+	vector<string> shapeSections(1, "shape_manager");
+	for (auto& tile : saveManager.getSectionKeyValues("tiles", "tile")) {
+		shapeSections.push_back(SceneSnapshot::getTileSection(stoi(tile["x"]), stoi(tile["y"])));
+	}
+	for (const string& section : shapeSections) {
+		vector<map<string, string>>& values = saveManager.getSectionKeyValues(section, "shape");
+		vector<map<string, vector<string>>>& arrays = saveManager.getSectionKeyArrays(section, "shape");
+		for (size_t i = 0; i < values.size(); i++) {
+			shapeVals.push_back(&values[i]);
+			shapeArrays.push_back(&arrays[i]);
+		}
+	}
+	bool tiled = shapeSections.size() > 1;
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+
+	vector<Geometry> geometries = loadGeometry(saveManager);
+
+	// Each thread creates the shapes for its own range of keys, which are then added in order to preserve z-order
+	vector<Shape*> loaded(shapeVals.size());
+	auto createRange = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) loaded[i] = createShape(*shapeVals[i], *shapeArrays[i], geometries);
+	};
+	vector<std::thread> workers;
+	for (unsigned i = 1; i < threads; i++) {
+		workers.push_back(std::thread(createRange, loaded.size() * i / threads, loaded.size() * (i + 1) / threads));
+	}
+	createRange(0, loaded.size() / threads);
+	for (auto& worker : workers) worker.join();
+	// Shapes with invalid values aren't created
+	loaded.erase(std::remove(loaded.begin(), loaded.end(), nullptr), loaded.end());
+
+	shapes.reserve(shapes.size() + loaded.size());
+	invalidateIndex();
+	// Tiled saves store each shape's z order, untiled saves are in z order
+	if (tiled) insertOrdered(loaded);
+	else for (Shape* shape : loaded) add(shape);
+}
+
+void ShapeManager::restore(const SceneSnapshot& snapshot) {
+	// The saved index refers to shapes by their index in the snapshot, so can only be used if there aren't any other shapes
+	bool restoreIndex = shapes.empty() && snapshot.spatialIndex.size() > 0;
+	shapes.reserve(shapes.size() + snapshot.size());
+	invalidateIndex();
+	for (size_t i = 0; i < snapshot.size(); i++) add(createShape(snapshot, i));
+	if (restoreIndex) {
+		vector<Shape*> restored;
+		restored.reserve(shapes.size());
+		for (auto& shape : shapes) restored.push_back(shape.get());
+		indexValid = index.restore(snapshot.spatialIndex, restored);
+	}
+}
+
+Shape* ShapeManager::createShape(const SceneSnapshot& snapshot, size_t i) const {
 	Shape* shape;
-	vector<Point> vertices;
-	for (unsigned i = 0; i < shapeVals.size(); i++) {
-		vertices.clear();
+	if (snapshot.numEdges[i] > 0) shape = createParametric(snapshot.names[i], snapshot.numEdges[i], snapshot.radii[i]);
+	else shape = new Shape(snapshot.names[i], Point(), snapshot.geometries[i]);
+	shape->setPosition(snapshot.positions[i].x, snapshot.positions[i].y);
+	shape->setRotation(snapshot.rotations[i]);
+	shape->setScale(snapshot.scales[i]);
+	shape->setColour(snapshot.colours[i].r, snapshot.colours[i].g, snapshot.colours[i].b);
+	shape->setOutlineColour(snapshot.outlineColours[i].r, snapshot.outlineColours[i].g, snapshot.outlineColours[i].b);
+	if (i < snapshot.orders.size()) shape->setZOrder(snapshot.orders[i]);
+	return shape;
+}
+
+void ShapeManager::createShapes(SaveManager& saveManager, const string& section, const vector<Geometry>& geometries, 
+	size_t first, size_t count, vector<Shape*>& created) const {
+	vector<map<string, string>>& values = saveManager.getSectionKeyValues(section, "shape");
+	vector<map<string, vector<string>>>& arrays = saveManager.getSectionKeyArrays(section, "shape");
+	size_t end = std::min(values.size(), first + count);
+	for (size_t i = first; i < end; i++) {
+		if (Shape* shape = createShape(values[i], arrays[i], geometries)) created.push_back(shape);
+	}
+}
+
+void ShapeManager::reserveZOrders(unsigned long long count) {
+	for (auto& shape : shapes) shape->setZOrder(shape->getZOrder() + count);
+	maxZOrder += count;
+}
+
+void ShapeManager::insertOrdered(vector<Shape*>& added) {
+	std::stable_sort(added.begin(), added.end(), [](Shape* a, Shape* b) { return a->getZOrder() < b->getZOrder(); });
+	size_t middle = shapes.size();
+	for (Shape* shape : added) {
+		maxZOrder = std::max(maxZOrder, shape->getZOrder());
+		shape->setObserver(this);
+		if (indexValid) index.insert(shape);
+		shapes.push_back(unique_ptr<Shape>(shape));
+	}
+	std::inplace_merge(shapes.begin(), shapes.begin() + middle, shapes.end(), zOrderLess);
+}
+
+/************************************************************************/
+/* PAGING                                                               */
+/************************************************************************/
+
+void ShapeManager::setPaging(const PagingSettings& settings) {
+	// Stored tiles were grouped using the current tile size
+	float tileSize = pagingSettings.tileSize;
+	pagingSettings = settings;
+	if (!tiles.empty()) pagingSettings.tileSize = tileSize;
+	paging = pagingSettings.tileSize > 0;
+	lastShapeCount = std::numeric_limits<size_t>::max();
+}
+
+bool ShapeManager::loadPaged(string file) {
+	if (!pagingReader.loadSection(file, "tiles")) return false;
+	map<string, string>& values = pagingReader.getSectionValues("tiles");
+	float tileSize = values.count("tile_size")? SaveManager::parseFloat(values["tile_size"]) : 0;
+	if (!(tileSize > 0) || !pagingReader.loadSection(file, "geometry")) return false;
+
+	clear();
+	pagingGeometries = loadGeometry(pagingReader);
+	pagingReader.unloadSection("geometry");
+	pagingFile = file;
+	pagingSettings.tileSize = tileSize;
+	paging = true;
+	maxZOrder = values.count("max_order")? stoull(values["max_order"]) : 0;
+	for (auto& tileValues : pagingReader.getSectionKeyValues("tiles", "tile")) {
+		Tile& tile = tiles[TileKey(stoi(tileValues["x"]), stoi(tileValues["y"]))];
+		tile.state = Tile::ON_DISK;
+		tile.onDisk = true;
+		tile.count = stoul(tileValues["count"]);
+		tile.extent = SaveManager::parseFloat(tileValues["extent"]);
+	}
+	pagingReader.unloadSection("tiles");
+	return true;
+}
+
+void ShapeManager::updatePaging(const SceneSettings& sceneSettings, float viewWidth, float viewHeight, std::initializer_list<Shape*> pinned) {
+	if (!paging) return;
+	Point viewMin, viewMax;
+	sceneSettings.getViewBounds(viewWidth, viewHeight, viewMin, viewMax);
+	// Nothing to load or evict unless the view has moved or shapes have been added or removed
+	if (viewMin.x == lastViewMin.x && viewMin.y == lastViewMin.y && viewMax.x == lastViewMax.x && viewMax.y == lastViewMax.y 
+		&& shapes.size() == lastShapeCount) return;
+	lastViewMin = viewMin;
+	lastViewMax = viewMax;
+	pagingFrame++;
+	float tileSize = pagingSettings.tileSize;
+
+	// Memory used by the resident shapes in each tile
+	map<TileKey, size_t> residentTiles;
+	residentMemory = 0;
+	for (auto& shape : shapes) {
+		size_t bytes = shape->getMemoryUsage();
+		residentMemory += bytes;
+		residentTiles[getTile(*shape)] += bytes;
+	}
+	for (auto& resident : residentTiles) tiles[resident.first];
+	for (Shape* shape : pinned) {
+		if (shape) tiles[getTile(*shape)].frame = pagingFrame;
+	}
+	for (Shape* shape : selection) tiles[getTile(*shape)].frame = pagingFrame;
+
+	// Load tiles whose shapes could reach into the view
+	auto inView = [&](const TileKey& key, const Tile& tile, float margin) {
+		float extent = tile.extent + margin;
+		return key.first * tileSize - extent <= viewMax.x && (key.first + 1) * tileSize + extent >= viewMin.x
+			&& key.second * tileSize - extent <= viewMax.y && (key.second + 1) * tileSize + extent >= viewMin.y;
+	};
+	vector<TileKey> prefetch;
+	for (auto& entry : tiles) {
+		Tile& tile = entry.second;
+		bool stored = tile.state == Tile::ON_DISK || tile.state == Tile::IN_MEMORY;
+		if (inView(entry.first, tile, 0)) {
+			tile.frame = pagingFrame;
+			if (stored) {
+				size_t bytes = loadTile(entry.first, tile);
+				residentMemory += bytes;
+				residentTiles[entry.first] += bytes;
+			}
+		} else if (stored && inView(entry.first, tile, pagingSettings.prefetch * tileSize)) {
+			prefetch.push_back(entry.first);
+		}
+	}
+
+	// Evict the least recently viewed tiles until within the budget, tiles in view are kept
+	if (residentMemory > pagingSettings.memoryBudget) {
+		vector<std::pair<unsigned long long, TileKey>> candidates;
+		for (auto& resident : residentTiles) {
+			unsigned long long frame = tiles[resident.first].frame;
+			if (frame != pagingFrame) candidates.push_back(std::make_pair(frame, resident.first));
+		}
+		std::sort(candidates.begin(), candidates.end());
+		vector<TileKey> evicted;
+		for (auto& candidate : candidates) {
+			if (residentMemory <= pagingSettings.memoryBudget) break;
+			evicted.push_back(candidate.second);
+			residentMemory -= residentTiles[candidate.second];
+		}
+		evictTiles(evicted);
+	}
+
+	// Prefetch tiles around the view that fit in the remaining budget
+	size_t averageBytes = shapes.empty()? sizeof(Shape) : residentMemory / shapes.size();
+	for (const TileKey& key : prefetch) {
+		Tile& tile = tiles[key];
+		if (residentMemory + tile.count * averageBytes > pagingSettings.memoryBudget) continue;
+		tile.frame = pagingFrame;
+		residentMemory += loadTile(key, tile);
+	}
+	lastShapeCount = shapes.size();
+}
+
+size_t ShapeManager::loadTile(const TileKey& key, Tile& tile) {
+	vector<Shape*> loaded;
+	if (tile.state == Tile::ON_DISK) {
+		string section = SceneSnapshot::getTileSection(key.first, key.second);
+		if (pagingReader.loadSection(pagingFile, section)) {
+			vector<map<string, string>>& values = pagingReader.getSectionKeyValues(section, "shape");
+			vector<map<string, vector<string>>>& arrays = pagingReader.getSectionKeyArrays(section, "shape");
+			for (size_t i = 0; i < values.size(); i++) {
+				if (Shape* shape = createShape(values[i], arrays[i], pagingGeometries)) loaded.push_back(shape);
+			}
+			pagingReader.unloadSection(section);
+		}
+		// Hash the shapes as loaded, so they can be dropped when evicted if they haven't changed
+		std::stable_sort(loaded.begin(), loaded.end(), [](Shape* a, Shape* b) { return a->getZOrder() < b->getZOrder(); });
+		SceneSnapshot snapshot;
+		for (Shape* shape : loaded) snapshot.add(*shape);
+		tile.hash = snapshot.hash();
+	} else if (tile.state == Tile::IN_MEMORY) {
+		for (size_t i = 0; i < tile.shapes.size(); i++) loaded.push_back(createShape(tile.shapes, i));
+		tile.shapes = SceneSnapshot();
+	}
+	tile.state = Tile::RESIDENT;
+	size_t bytes = 0;
+	for (Shape* shape : loaded) bytes += shape->getMemoryUsage();
+	insertOrdered(loaded);
+	return bytes;
+}
+
+void ShapeManager::evictTiles(const vector<TileKey>& keys) {
+	if (keys.empty()) return;
+	// Load any stored shapes first, for tiles that resident shapes have been moved into, so each tile is stored as a whole
+	map<TileKey, Tile*> evicting;
+	for (const TileKey& key : keys) {
+		Tile& tile = tiles[key];
+		if (tile.state == Tile::ON_DISK || tile.state == Tile::IN_MEMORY) loadTile(key, tile);
+		tile.shapes.clear();
+		evicting[key] = &tile;
+	}
+
+	// Move the shapes into their tile's snapshot, in z order
+	// Grouped shapes are kept, a group is moved as a whole and would otherwise lose shapes
+	auto split = std::stable_partition(shapes.begin(), shapes.end(), 
+		[this, &evicting](unique_ptr<Shape>& shape) { return shape->getGroup() || evicting.count(getTile(*shape)) == 0; });
+	if (indexValid) {
+		// Apply pending changes first, so changedShapes doesn't reference evicted shapes
+		updateIndex();
+		for (auto it = split; it != shapes.end(); it++) index.remove(it->get());
+	}
+	for (auto it = split; it != shapes.end(); it++) evicting[getTile(**it)]->shapes.add(**it);
+	shapes.erase(split, shapes.end());
+
+	for (auto& entry : evicting) {
+		Tile& tile = *entry.second;
+		tile.count = tile.shapes.size();
+		tile.extent = 0;
+		for (size_t i = 0; i < tile.shapes.size(); i++) tile.extent = std::max(tile.extent, tile.shapes.getExtent(i));
+		if (tile.onDisk && tile.shapes.hash() == tile.hash) {
+			// Unchanged, reload it from the file when needed
+			tile.state = Tile::ON_DISK;
+			tile.shapes = SceneSnapshot();
+		} else if (tile.count > 0) {
+			tile.state = Tile::IN_MEMORY;
+			tile.onDisk = false;
+		} else {
+			tiles.erase(entry.first);
+		}
+	}
+}
+
+void ShapeManager::capturePages(SceneSnapshot& snapshot) {
+	if (!paging) return;
+	snapshot.tileSize = pagingSettings.tileSize;
+	snapshot.tileSource = pagingFile;
+	snapshot.baseGeometries = pagingGeometries;
+	for (auto& entry : tiles) {
+		Tile& tile = entry.second;
+		if (tile.state == Tile::IN_MEMORY) {
+			snapshot.append(tile.shapes);
+		} else if (tile.state == Tile::ON_DISK) {
+			SceneSnapshot::Tile source;
+			source.x = entry.first.first;
+			source.y = entry.first.second;
+			source.count = tile.count;
+			source.extent = tile.extent;
+			snapshot.sourceTiles.push_back(source);
+		}
+	}
+}
+
+size_t ShapeManager::getResidentTileCount() {
+	size_t count = 0;
+	for (auto& entry : tiles) {
+		if (entry.second.state == Tile::RESIDENT) count++;
+	}
+	return count;
+}
+
+Shape* ShapeManager::createShape(map<string, string>& values, map<string, vector<string>>& arrays, const vector<Geometry>& geometries) const {
+	string name = values["name"];
+	float rotation = SaveManager::parseFloat(values["rotation"]);
+	Shape* shape = nullptr;
+	float scale = SaveManager::parseFloat(values["scale"]);
+	if (!std::isfinite(scale)) return nullptr;
+	if (values.count("edges")) {
+		// Parametric shapes are saved without vertices, recreate them from the parameters. A corrupt edge count would create 
+		// an enormous polygon, so the shape is skipped
+		int numEdges = stoi(values["edges"]);
+		float radius = SaveManager::parseFloat(values["radius"]);
+		if (!RegularPolygon::isValid(numEdges, radius)) return nullptr;
+		shape = createParametric(name, numEdges, radius);
+	} else if (values.count("geometry")) {
+		unsigned index = stoul(values["geometry"]);
+		shape = new Shape(name, Point(), (index < geometries.size())? geometries[index] : Geometry());
+	} else {
+		// Older saves stored the vertices of every shape with the rotation applied, convert them back to local vertices
+		float radians = 3.142f * (rotation / 180);
+		vector<Point> vertices;
 		// Convert point strings to Point objects
-		for (const auto& pointStr : shapeArrays[i]["vertices"]) {
-			vertices.push_back(Point(pointStr));
-		}
-		shape = new Shape(shapeVals[i]["name"], Point(shapeVals[i]["position"]), vertices);
-		shape->setRotation(stof(shapeVals[i]["rotation"]), false);
-		shape->setScale(stof(shapeVals[i]["scale"]));
-		//shape->setOutlineVisible((shapeVals[i]["scale"] == "1")? true : false);
-		shape->setColour(Colour(shapeVals[i]["colour"]));
-		shape->setOutlineColour(Colour(shapeVals[i]["outline_colour"]));
+		for (const auto& pointStr : arrays["vertices"]) {
+			Point vertex = SaveManager::parsePoint(pointStr);
+			vertices.push_back(Point(
+				vertex.x * cos(radians) + vertex.y * sin(radians),
+				-vertex.x * sin(radians) + vertex.y * cos(radians)
+			));
+		}
+		// Use the matching type instead if the vertices are the type's, so the shape is saved parametrically from now on
+		Shape* type = getType(name);
+		if (type && type->getVertices().size() == vertices.size()) {
+			shape = createParametric(name, type->getNumEdges(), type->getRadius());
+			for (unsigned i = 0; i < vertices.size(); i++) {
+				// Allow for rounding in the saved text and rotation drift
+				if (std::abs(vertices[i].x - shape->getVertices()[i].x) > 0.05f || std::abs(vertices[i].y - shape->getVertices()[i].y) > 0.05f) {
+					delete shape;
+					shape = nullptr;
+					break;
+				}
+			}
+		}
+		if (!shape) shape = new Shape(name, Point(), vertices);
+	}
+	Point position = SaveManager::parsePoint(values["position"]);
+	shape->setPosition(position.x, position.y);
+	shape->setRotation(rotation);
+	shape->setScale(scale);
+	if (values.count("order")) shape->setZOrder(stoull(values["order"]));
+	//shape->setOutlineVisible((values["scale"] == "1")? true : false);
+	shape->setColour(SaveManager::parseColour(values["colour"]));
+	shape->setOutlineColour(SaveManager::parseColour(values["outline_colour"]));
+	return shape;
+}
+
+Shape* ShapeManager::createParametric(const string& name, int numEdges, float radius) const {
+	Shape* type = getType(name);
+	if (type && type->getNumEdges() == numEdges && type->getRadius() == radius) {
+		return new Shape(type);
+	}
+	return new RegularPolygon(name, numEdges, radius, Point());
+}
+
+void ShapeManager::addType(Shape* shape) {
+	if (shape) {
+		unique_ptr<Shape> pShape;
+		pShape.reset(shape);
+		types.push_back(std::move(pShape));
+	}
+}
+
+Shape* ShapeManager::getType(const string& name) const {
+	for (const auto& type : types) {
+		if (type->getName() == name) return type.get();
+	}
+	return nullptr;
+}
+
+/**
+* Maps the generator's raw output to ranges itself, since the standard distributions' results differ between standard libraries
+* and the same seed has to give the same scene everywhere. mt19937's sequence is fixed by the standard
+* Returns: float  Uniform value from min to max inclusive, from the top 24 bits of the next output
+*/
+static float uniformFloat(std::mt19937& random, float min, float max) {
+	return min + (max - min) * (static_cast<float>(random() >> 8) / 16777215.0f);
+}
+
+/**
+* Returns: int  Uniform value from min to max inclusive. The modulo's bias is negligible for the small ranges used
+*/
+static int uniformInt(std::mt19937& random, int min, int max) {
+	return min + static_cast<int>(random() % static_cast<unsigned>(max - min + 1));
+}
+
+/**
+* Returns: float  Normally distributed value with a mean of 0, from two outputs with the Box-Muller transform
+*/
+static float normalFloat(std::mt19937& random, float deviation) {
+	// Offset by half a step, so the logarithm is never of 0
+	double u1 = ((random() >> 8) + 0.5) / 16777216.0;
+	double u2 = ((random() >> 8) + 0.5) / 16777216.0;
+	return static_cast<float>(deviation * std::sqrt(-2 * std::log(u1)) * std::cos(2 * 3.14159265358979 * u2));
+}
+
+float ShapeManager::generate(const GenerationSettings& settings) {
+	Trace::Scope span("ShapeManager::generate");
+	static const char* const POLYGON_NAMES[] = { "", "", "", "Triangle", "Square", "Pentagon", "Hexagon", "Heptagon", "Octagon", "Nonagon", "Decagon" };
+	int minEdges = std::max(3, std::min(settings.minEdges, 10));
+	int maxEdges = std::max(minEdges, std::min(settings.maxEdges, 10));
+
+	// Prototype, name and radius for each vertex count
+	Shape* edgeTypes[11] = {};
+	const char* edgeNames[11] = {};
+	float edgeRadii[11] = {};
+	for (int edges = minEdges; edges <= maxEdges; edges++) {
+		for (const auto& type : types) {
+			if (type->getNumEdges() == edges) {
+				edgeTypes[edges] = type.get();
+				break;
+			}
+		}
+		edgeNames[edges] = edgeTypes[edges]? edgeTypes[edges]->getName().c_str() : POLYGON_NAMES[edges];
+		edgeRadii[edges] = edgeTypes[edges]? edgeTypes[edges]->getRadius() : settings.radius;
+	}
+
+	// Size the scene so the shapes' total area covers it overlap times. A regular polygon with n edges has an area of
+	// n/2 * r^2 * sin(2pi/n), and the mean of scale^2 over a uniform range is (max^3 - min^3) / 3(max - min)
+	const float PI = 3.14159265f;
+	float meanArea = 0;
+	for (int edges = minEdges; edges <= maxEdges; edges++) {
+		meanArea += edges / 2.0f * edgeRadii[edges] * edgeRadii[edges] * std::sin(2 * PI / edges);
+	}
+	meanArea /= maxEdges - minEdges + 1;
+	float meanScaleSquared = (settings.maxScale > settings.minScale)? 
+		(std::pow(settings.maxScale, 3.0f) - std::pow(settings.minScale, 3.0f)) / (3 * (settings.maxScale - settings.minScale)) 
+		: settings.minScale * settings.minScale;
+	float width = std::sqrt(settings.count * meanArea * meanScaleSquared / std::max(settings.overlap, 0.0001f));
+
+	// Each value is drawn into its own variable, so they're drawn in the same order whatever order a compiler evaluates arguments in
+	std::mt19937 random(settings.seed);
+	vector<Point> clusterCenters(std::max(settings.clusters, 1));
+	for (Point& center : clusterCenters) {
+		float x = uniformFloat(random, -width / 2, width / 2);
+		float y = uniformFloat(random, -width / 2, width / 2);
+		center = Point(x, y);
+	}
+
+	// Added in bulk, like a load, so the index is rebuilt once when next needed rather than updated per shape
+	invalidateIndex();
+	shapes.reserve(shapes.size() + settings.count);
+	for (size_t i = 0; i < settings.count; i++) {
+		int edges = uniformInt(random, minEdges, maxEdges);
+		Shape* shape = createParametric(edgeNames[edges], edges, edgeRadii[edges]);
+		if (settings.clustering > 0 && uniformFloat(random, 0, 1) < settings.clustering) {
+			const Point& center = clusterCenters[uniformInt(random, 0, static_cast<int>(clusterCenters.size()) - 1)];
+			float x = center.x + normalFloat(random, settings.clusterSpread);
+			float y = center.y + normalFloat(random, settings.clusterSpread);
+			shape->setPosition(x, y);
+		} else {
+			float x = uniformFloat(random, -width / 2, width / 2);
+			float y = uniformFloat(random, -width / 2, width / 2);
+			shape->setPosition(x, y);
+		}
+		shape->setRotation(uniformFloat(random, settings.minRotation, settings.maxRotation));
+		shape->setScale(uniformFloat(random, settings.minScale, settings.maxScale));
+		float r = uniformFloat(random, settings.minColour, settings.maxColour);
+		float g = uniformFloat(random, settings.minColour, settings.maxColour);
+		float b = uniformFloat(random, settings.minColour, settings.maxColour);
+		shape->setColour(r, g, b);
 		add(shape);
 	}
+	return width;
 }
 
 void ShapeManager::clear() {
+	selection.clear();
 	shapes.clear();
+	groups.clear();
+	index.clear();
+	changedShapes.clear();
+	indexValid = true;
+	// Clearing a paged scene clears the tiles that aren't resident too
+	tiles.clear();
+	// Nothing is left to stack above, so orders start again, as they would for a fresh scene
+	maxZOrder = 0;
+	lastShapeCount = std::numeric_limits<size_t>::max();
 }
 
 Shape* ShapeManager::getShapeAt(float x, float y) {
-	// Since the shape at the back is the shape rendered on top, iterate in reverse
-	for (vector<unique_ptr<Shape>>::reverse_iterator it = shapes.rbegin(); it != shapes.rend(); it++) {
-		if ((*it)->pointInShape(x, y)) {
-			return (*it).get();
+	Trace::Scope span("ShapeManager::getShapeAt");
+	AllocationCounter::Scope allocations(AllocationCounter::PICKING);
+	updateIndex();
+	Shape* top = index.pick(x, y);
+	// Grouped shapes are in their group's index, in its coordinates
+	for (auto& group : groups) {
+		if (group->getShapes().empty()) continue;
+		Point local = group->worldToLocal(Point(x, y));
+		Shape* shape = group->getIndex().pick(local.x, local.y);
+		if (shape && (!top || shape->getZOrder() > top->getZOrder())) top = shape;
+	}
+	return top;
+}
+
+void ShapeManager::getShapesAt(const vector<Point>& points, vector<Shape*>& results, unsigned threads) {
+	Trace::Scope span("ShapeManager::getShapesAt");
+	AllocationCounter::Scope allocations(AllocationCounter::PICKING);
+	updateIndex();
+	index.pick(points, results, threads);
+	for (auto& group : groups) {
+		if (group->getShapes().empty()) continue;
+		const ShapeTransform& transform = group->getWorldTransform();
+		groupPoints.resize(points.size());
+		for (size_t i = 0; i < points.size(); i++) groupPoints[i] = transform.applyInverse(points[i]);
+		group->getIndex().pick(groupPoints, groupResults, threads);
+		for (size_t i = 0; i < points.size(); i++) {
+			Shape* shape = groupResults[i];
+			if (shape && (!results[i] || shape->getZOrder() > results[i]->getZOrder())) results[i] = shape;
 		}
 	}
-	return nullptr;
+}
+
+void ShapeManager::getShapesInRect(const Point& corner, const Point& oppositeCorner, RegionMode mode, vector<Shape*>& results, unsigned threads) {
+	Trace::Scope span("ShapeManager::getShapesInRect");
+	AllocationCounter::Scope allocations(AllocationCounter::PICKING);
+	updateIndex();
+	Point min(std::min(corner.x, oppositeCorner.x), std::min(corner.y, oppositeCorner.y));
+	Point max(std::max(corner.x, oppositeCorner.x), std::max(corner.y, oppositeCorner.y));
+	const Point rect[4] = { min, Point(max.x, min.y), max, Point(min.x, max.y) };
+	bool sorted = getRegionCandidates(min, max, results);
+	filterShapes(results, sorted, threads, [&](Shape& shape) {
+		// Most shapes are decided by the square they can reach at any rotation, which doesn't need their vertices
+		Point position = shape.getPosition();
+		float extent = shape.getExtent();
+		if (position.x - extent >= min.x && position.x + extent <= max.x && position.y - extent >= min.y && position.y + extent <= max.y) return true;
+		if (position.x + extent < min.x || position.x - extent > max.x || position.y + extent < min.y || position.y - extent > max.y) return false;
+		// Then by their cached bounds. A shape is only in a rectangle if its bounds are
+		Point shapeMin, shapeMax;
+		shape.getWorldBounds(shapeMin, shapeMax);
+		if (shapeMin.x >= min.x && shapeMax.x <= max.x && shapeMin.y >= min.y && shapeMax.y <= max.y) return true;
+		if (mode == CONTAINED || shapeMax.x < min.x || shapeMin.x > max.x || shapeMax.y < min.y || shapeMin.y > max.y) return false;
+		// Bounds that overlap an edge of the rectangle need the exact test
+		return shape.intersectsPolygon(rect, 4);
+	});
+	addGroupedShapesInRegion(rect, 4, mode, results, threads);
+}
+
+void ShapeManager::getShapesInPolygon(const vector<Point>& polygon, RegionMode mode, vector<Shape*>& results, unsigned threads) {
+	Trace::Scope span("ShapeManager::getShapesInPolygon");
+	AllocationCounter::Scope allocations(AllocationCounter::PICKING);
+	results.clear();
+	if (polygon.size() < 3) return;
+	updateIndex();
+	Point min, max;
+	CpuDispatch::get().bounds(polygon.data(), polygon.size(), min, max);
+	bool sorted = getRegionCandidates(min, max, results);
+	filterShapes(results, sorted, threads, [&](Shape& shape) { 
+		return inPolygonRegion(shape, polygon.data(), polygon.size(), min, max, mode); 
+	});
+	addGroupedShapesInRegion(polygon.data(), polygon.size(), mode, results, threads);
+}
+
+void ShapeManager::addGroupedShapesInRegion(const Point* polygon, size_t count, RegionMode mode, vector<Shape*>& results, unsigned threads) {
+	size_t found = results.size();
+	for (auto& group : groups) {
+		if (group->getShapes().empty()) continue;
+		// Groups only rotate, scale and translate, so a shape is in the region exactly when it's in the region converted to its group's coordinates
+		const ShapeTransform& transform = group->getWorldTransform();
+		groupPoints.resize(count);
+		for (size_t i = 0; i < count; i++) groupPoints[i] = transform.applyInverse(polygon[i]);
+		Point min, max;
+		CpuDispatch::get().bounds(groupPoints.data(), count, min, max);
+		groupResults.clear();
+		group->getIndex().query(min, max, groupResults);
+		// Sorted with the rest afterwards
+		filterShapes(groupResults, true, threads, [&](Shape& shape) { return inPolygonRegion(shape, groupPoints.data(), count, min, max, mode); });
+		results.insert(results.end(), groupResults.begin(), groupResults.end());
+	}
+	if (results.size() > found) std::sort(results.begin(), results.end(), [](Shape* a, Shape* b) { return a->getZOrder() < b->getZOrder(); });
+}
+
+bool ShapeManager::getRegionCandidates(const Point& min, const Point& max, vector<Shape*>& candidates) {
+	candidates.clear();
+	// A region covering more cells than are occupied has most of the shapes in it, so testing every shape in order 
+	// is quicker than gathering them cell by cell and sorting them
+	if (index.countCells(min, max) > index.getCellCount()) {
+		candidates.reserve(shapes.size());
+		for (auto& shape : shapes) {
+			// Grouped shapes are found through their group's index
+			if (!shape->getGroup()) candidates.push_back(shape.get());
+		}
+		return true;
+	}
+	index.query(min, max, candidates);
+	return false;
+}
+
+void ShapeManager::updateIndex() {
+	if (!indexValid) {
+		// Grouped shapes are skipped, and stay queued for their groups' indexes
+		index.build(shapes, 0);
+		for (auto& shape : shapes) {
+			if (!shape->getGroup()) shape->clearBoundsChanged();
+		}
+		indexValid = true;
+	}
+	for (Shape* shape : changedShapes) {
+		if (shape->getGroup()) shape->getGroup()->getIndex().update(shape);
+		else index.update(shape);
+		shape->clearBoundsChanged();
+	}
+	changedShapes.clear();
+}
+
+void ShapeManager::invalidateIndex() {
+	indexValid = false;
+	index.clear();
+	changedShapes.erase(std::remove_if(changedShapes.begin(), changedShapes.end(), [](Shape* shape) { return !shape->getGroup(); }), changedShapes.end());
+}
+
+void ShapeManager::onBoundsChanged(Shape* shape) {
+	// Invalid indexes are rebuilt from every shape anyway, group indexes never are. Selection updates queue their shapes when they finish
+	if ((indexValid || shape->getGroup()) && !deferBoundsChanges) changedShapes.push_back(shape);
+}
+
+void ShapeManager::setSelection(const vector<Shape*>& shapes) {
+	clearSelection();
+	selection.assign(shapes.begin(), shapes.end());
+	for (Shape* shape : selection) {
+		shape->setSelected(true);
+		shape->setOutlineVisible(true);
+	}
+}
+
+void ShapeManager::clearSelection() {
+	for (Shape* shape : selection) {
+		shape->setSelected(false);
+		shape->setOutlineVisible(false);
+	}
+	selection.clear();
+}
+
+Point ShapeManager::getSelectionCentroid() {
+	if (selection.empty()) return Point(0, 0);
+	double x = 0, y = 0;
+	for (Shape* shape : selection) {
+		Point position = shape->getWorldPosition();
+		x += position.x;
+		y += position.y;
+	}
+	return Point(static_cast<float>(x / selection.size()), static_cast<float>(y / selection.size()));
+}
+
+void ShapeManager::transformSelection(const Point& pivot, float angle, float scaleFactor, float x, float y, unsigned threads) {
+	Trace::Scope span("ShapeManager::transformSelection");
+	// The same conversion to radians as Shape uses, so each shape turns by as much as its position turns about the pivot
+	float radians = 3.142f * (angle / 180);
+	float sin = std::sin(radians);
+	float cos = std::cos(radians);
+	// Translations alone are added straight to the positions, as taking them relative to the pivot and back would round them
+	bool translateOnly = angle == 0 && scaleFactor == 1;
+	beginSelectionUpdate();
+	runInRanges(selection.size(), threads, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			Shape& shape = *selection[i];
+			// Grouped shapes are moved in world coordinates, then converted back to their group's
+			ShapeGroup* group = shape.getGroup();
+			Point position = group? group->localToWorld(shape.getPosition()) : shape.getPosition();
+			if (translateOnly) {
+				position = Point(position.x + x, position.y + y);
+				if (group) position = group->worldToLocal(position);
+				shape.setPosition(position.x, position.y);
+				continue;
+			}
+			float offsetX = position.x - pivot.x;
+			float offsetY = position.y - pivot.y;
+			position.x = pivot.x + (offsetX * cos - offsetY * sin) * scaleFactor + x;
+			position.y = pivot.y + (offsetX * sin + offsetY * cos) * scaleFactor + y;
+			if (group) position = group->worldToLocal(position);
+			shape.setTransform(position, shape.getRotation() + angle, shape.getScale() * scaleFactor);
+		}
+	});
+	endSelectionUpdate();
+}
+
+void ShapeManager::setSelectionColour(const Colour& colour, unsigned threads) {
+	Trace::Scope span("ShapeManager::setSelectionColour");
+	runInRanges(selection.size(), threads, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) selection[i]->setColour(colour);
+	});
+}
+
+void ShapeManager::morphSelection(bool reverse, unsigned threads) {
+	Trace::Scope span("ShapeManager::morphSelection");
+	if (types.empty()) return;
+	beginSelectionUpdate();
+	runInRanges(selection.size(), threads, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			Shape& shape = *selection[i];
+			for (size_t type = 0; type < types.size(); type++) {
+				if (shape.getName() != types[type]->getName()) continue;
+				size_t next = reverse? (type + types.size() - 1) % types.size() : (type + 1) % types.size();
+				shape.morph(types[next].get());
+				break;
+			}
+		}
+	});
+	endSelectionUpdate();
+}
+
+void ShapeManager::beginSelectionUpdate() {
+	updateIndex();
+	// Group transforms are composed now, as the threads converting grouped shapes would otherwise all compose them
+	for (auto& group : groups) group->getWorldTransform();
+	deferBoundsChanges = true;
+}
+
+void ShapeManager::endSelectionUpdate() {
+	deferBoundsChanges = false;
+	for (Shape* shape : selection) {
+		if (shape->hasBoundsChanged() && (indexValid || shape->getGroup())) changedShapes.push_back(shape);
+	}
+}
+
+ShapeGroup* ShapeManager::createGroup(const vector<Shape*>& members) {
+	Trace::Scope span("ShapeManager::createGroup");
+	if (members.empty()) return nullptr;
+	// Every member is then in the index it's leaving, and the changes made here are all queued
+	updateIndex();
+	// Shapes that are already grouped bring their outermost group, found once for runs of shapes from the same group
+	vector<Shape*> ungrouped;
+	vector<ShapeGroup*> roots;
+	double x = 0, y = 0;
+	for (Shape* shape : members) {
+		Point position = shape->getWorldPosition();
+		x += position.x;
+		y += position.y;
+		if (!shape->getGroup()) {
+			ungrouped.push_back(shape);
+			continue;
+		}
+		ShapeGroup* root = shape->getGroup()->getRoot();
+		if (std::find(roots.begin(), roots.end(), root) == roots.end()) roots.push_back(root);
+	}
+	Point origin(static_cast<float>(x / members.size()), static_cast<float>(y / members.size()));
+	groups.push_back(unique_ptr<ShapeGroup>(new ShapeGroup(origin)));
+	ShapeGroup* group = groups.back().get();
+	group->getIndex().setCellSize(index.getCellSize());
+
+	// The new group is only translated from the world, so its members just move by its origin
+	for (ShapeGroup* root : roots) {
+		root->translate(-origin.x, -origin.y);
+		group->addChild(root);
+	}
+	for (Shape* shape : ungrouped) {
+		if (indexValid) index.remove(shape);
+		shape->translate(-origin.x, -origin.y);
+		group->addShape(shape);
+	}
+	updateIndex();
+	return group;
+}
+
+void ShapeManager::ungroup(ShapeGroup* group) {
+	Trace::Scope span("ShapeManager::ungroup");
+	if (!group) return;
+	updateIndex();
+	ShapeGroup* parent = group->getParent();
+	// Members are converted from the group's coordinates to its parent's, which are the world's if it has none
+	ShapeTransform transform = group->getLocalTransform();
+	float rotation = group->getRotation();
+	float scale = group->getScale();
+	vector<ShapeGroup*> children = group->getChildren();
+	for (ShapeGroup* child : children) {
+		group->removeChild(child);
+		Point position = transform.apply(child->getPosition());
+		child->setPosition(position.x, position.y);
+		child->setRotation(std::fmod(rotation + child->getRotation(), 360.0f));
+		child->setScale(scale * child->getScale());
+		if (parent) parent->addChild(child);
+	}
+	vector<Shape*> members = group->getShapes();
+	group->clearShapes();
+	for (Shape* shape : members) {
+		// Wrapped here, as Shape truncates rotations past a full turn to whole degrees
+		float shapeRotation = std::fmod(rotation + shape->getRotation(), 360.0f);
+		shape->setTransform(transform.apply(shape->getPosition()), shapeRotation, scale * shape->getScale());
+		if (parent) parent->addShape(shape);
+		else if (indexValid) index.insert(shape);
+	}
+	if (parent) parent->removeChild(group);
+	updateIndex();
+	groups.erase(std::find_if(groups.begin(), groups.end(), [group](const unique_ptr<ShapeGroup>& entry) { return entry.get() == group; }));
+}
+
+void ShapeManager::ungroupSelection() {
+	vector<ShapeGroup*> roots;
+	for (Shape* shape : selection) {
+		if (!shape->getGroup()) continue;
+		ShapeGroup* root = shape->getGroup()->getRoot();
+		if (std::find(roots.begin(), roots.end(), root) == roots.end()) roots.push_back(root);
+	}
+	for (ShapeGroup* root : roots) ungroup(root);
 }
 
 void ShapeManager::bringToFront(Shape* shape) {
@@ -80,7 +935,9 @@ void ShapeManager::bringToFront(Shape* shape) {
 		for (vector<unique_ptr<Shape>>::iterator it = shapes.begin(); it != shapes.end(); it++) {
 			// If the memory address of the test shape is equal to the memory address of the current shape
 			if (&(*shape) == &(**it)) {
+				shape->setZOrder(++maxZOrder);
 				Utils::moveToBack(shapes, it - shapes.begin());
+				break;
 			}
 		}
 	}
@@ -92,6 +949,9 @@ void ShapeManager::add(Shape* shape) {
 		unique_ptr<Shape> pShape;
 		// Set to existing shape pointer
 		pShape.reset(shape);
+		shape->setZOrder(++maxZOrder);
+		shape->setObserver(this);
+		if (indexValid) index.insert(shape);
 		// Move the pointer into the vector
 		shapes.push_back(std::move(pShape));
 	}
@@ -102,6 +962,19 @@ void ShapeManager::remove(Shape* shape) {
 		for (vector<unique_ptr<Shape>>::iterator it = shapes.begin(); it != shapes.end(); it++) {
 			// If the memory address of the test shape is equal to the memory address of the current shape
 			if (&(*shape) == &(**it)) {
+				if (shape->isSelected()) selection.erase(std::find(selection.begin(), selection.end(), shape));
+				if (shape->hasBoundsChanged()) changedShapes.erase(std::remove(changedShapes.begin(), changedShapes.end(), shape), changedShapes.end());
+				if (ShapeGroup* group = shape->getGroup()) {
+					group->removeShape(shape);
+					// Groups left empty are deleted, along with any parents that leaves empty
+					while (group && group->empty()) {
+						ShapeGroup* parent = group->getParent();
+						ungroup(group);
+						group = parent;
+					}
+				} else if (indexValid) {
+					index.remove(shape);
+				}
 				shapes.erase(it);
 				break;
 			}
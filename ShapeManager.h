@@ -4,31 +4,162 @@
 #include "Shape.h"
 #include "Pentagon.h"
 #include "SaveManager.h"
+#include "SceneSnapshot.h"
+#include "SceneSettings.h"
+#include "SpatialIndex.h"
+#include "ShapeGroup.h"
 #include <vector>
 #include <memory>
+#include <map>
+#include <utility>
+
+/**
+* Settings for paging tiles of shapes in and out of memory, see ShapeManager::setPaging
+*/
+struct PagingSettings {
+	// Size of the square tiles shapes are grouped in
+	float tileSize = 1024;
+	// Memory, in bytes, resident shapes should use. Tiles in view are always kept, so this can be exceeded
+	size_t memoryBudget = 64 * 1024 * 1024;
+	// Number of tiles around the view to load ahead of time, while within the budget
+	int prefetch = 1;
+};
+
+/**
+* Distributions of the shapes ShapeManager::generate creates. Ranges are uniform and inclusive
+*/
+struct GenerationSettings {
+	// Number of shapes, and the seed that makes the same settings generate the same scene
+	size_t count = 0;
+	unsigned seed = 1;
+	// Range of vertex counts, from 3 to 10. Shapes copy the registered type with that many edges, if there is one
+	int minEdges = 3, maxEdges = 10;
+	// Radius of shapes without a registered type
+	float radius = 25;
+	// Average number of shapes covering each point, which sets the size of the square scene from the shapes' average area
+	float overlap = 1;
+	// Fraction of shapes placed around cluster centers instead of anywhere in the scene, 
+	// and the standard deviation of their distance from the center
+	float clustering = 0;
+	int clusters = 8;
+	float clusterSpread = 200;
+	float minScale = 0.5f, maxScale = 2;
+	// Rotation in degrees
+	float minRotation = 0, maxRotation = 360;
+	// Range of each fill colour component
+	float minColour = 0, maxColour = 1;
+};
 
 /*
 * Manages Shape objects in a scene, including rendering and updating
+*
+* Shapes are kept sorted by their z order, which is assigned when they're added or brought to the front.
+* 
+* Paging:
+*	When paging, shapes are grouped into square tiles by position and only the tiles near the view are resident 
+*	(in the shapes vector). Tiles are loaded from a tiled save (see SceneSnapshot) as they come into view, 
+*	and the least recently viewed tiles are evicted when the resident shapes use more than the memory budget.
+*	Evicted tiles that are unchanged since they were loaded are dropped and reloaded from the file when needed, 
+*	changed tiles are kept in memory as a compact SceneSnapshot until they're needed again.
+*	Saving a paged scene copies the tiles that aren't loaded from the file they were loaded from.
+*
+* Picking:
+*	Resident shapes are kept in a SpatialIndex, so finding the shape at a point only tests the shapes near it,
+*	and finding the shapes in a region only tests the shapes in the cells it covers.
+*	Shapes notify the manager when their bounds change and are moved between cells on the next pick.
+*	Bulk loads invalidate the index and it's rebuilt in parallel when next needed, unless a saved index was restored with the shapes.
+*
+* Selection:
+*	Selected shapes are outlined and kept resident when paging. Group transforms, colour changes and morphs update ranges of 
+*	the selection on separate threads, and the spatial index is updated for the changed shapes once they've all been updated.
+*
+* Groups:
+*	Shapes can be grouped into ShapeGroups, which can be grouped in turn. A grouped shape's transform is relative to its group 
+*	and it's kept in its group's spatial index rather than the manager's, so transforming a group never visits its shapes. 
+*	Picks and region queries search the manager's index, then each group's with the point or region converted to the group's 
+*	coordinates. Grouped shapes are kept resident when paging, and saved with their world transforms, so saves aren't grouped.
 */
-class ShapeManager {
+class ShapeManager : public ShapeObserver {
 
 
 protected:
+	/**
+	* Paging state of a tile
+	*/
+	struct Tile {
+		enum State {
+			EMPTY,		// No shapes are stored for the tile, though resident shapes may have been moved into it
+			ON_DISK,	// Shapes are in pagingFile
+			IN_MEMORY,	// Shapes are in the shapes snapshot
+			RESIDENT	// Shapes are in the manager
+		};
+		State state = EMPTY;
+		// Number of stored shapes and the furthest they reach from their positions, used to check if they're in view
+		unsigned count = 0;
+		float extent = 0;
+		// True if pagingFile has the tile's current shapes, in which case hash is the hash of them when loaded
+		bool onDisk = false;
+		unsigned long long hash = 0;
+		// Paging frame the tile was last in view or pinned
+		unsigned long long frame = 0;
+		// Evicted shapes that have changed since they were loaded
+		SceneSnapshot shapes;
+	};
+	typedef std::pair<int, int> TileKey;
+
 	// Use a (smart) pointer for polymorphism
 	std::vector<std::unique_ptr<Shape>> shapes;
-	ShapeRenderer renderer;
+	// Shape type prototypes, used to recreate parametric shapes and for cycling through shape types
+	std::vector<std::unique_ptr<Shape>> types;
+	ShapeRenderer shapeRenderer;
+	// Z order of the shape at the front
+	unsigned long long maxZOrder = 0;
+
+	bool paging = false;
+	PagingSettings pagingSettings;
+	// Tiled save tiles are loaded from
+	std::string pagingFile;
+	SaveManager pagingReader;
+	// Geometry section of pagingFile, which tiles reference by index
+	std::vector<Geometry> pagingGeometries;
+	std::map<TileKey, Tile> tiles;
+	unsigned long long pagingFrame = 0;
+	// View bounds and shape count of the last update, paging is skipped if neither has changed
+	Point lastViewMin, lastViewMax;
+	size_t lastShapeCount = 0;
+	size_t residentMemory = 0;
+
+	SpatialIndex index;
+	// False if the index needs to be rebuilt
+	bool indexValid = true;
+	// Shapes whose bounds have changed since the indexes were last updated. Ungrouped shapes are only tracked while the index is valid,
+	// grouped shapes always are, since group indexes are never invalidated
+	std::vector<Shape*> changedShapes;
+	// True while a group update runs on several threads, the changed shapes are queued once it finishes instead of as they change
+	bool deferBoundsChanges = false;
+
+	// Selected shapes, see setSelection
+	std::vector<Shape*> selection;
+
+	// Every group, outermost or not, see createGroup
+	std::vector<std::unique_ptr<ShapeGroup>> groups;
+	// Points, regions and results converted to a group's coordinates, reused so picking grouped shapes doesn't allocate
+	std::vector<Point> groupPoints;
+	std::vector<Shape*> groupResults;
 
 public:
 	ShapeManager();
 	~ShapeManager();
 
 	/**
-	* Update and render added Shapes
+	* Render added Shapes, back to front
+	* Parameter: Renderer& renderer  Renderer to draw with
 	*/
-	void update();
+	void render(Renderer& renderer);
 
 	/**
-	* Saves the current manager settings to a save_manager section. The SaveManager must be in a saving state
+	* Saves the current manager settings to a shape_manager section, with shared vertices in a geometry section. 
+	* The SaveManager must be in a saving state
 	* Parameter: SaveManager& saveManager  SaveManager to use to save
 	*/
 	void save(SaveManager& saveManager);
@@ -37,6 +168,104 @@ public:
 	* Parameter: SaveManager& saveManager  SaveManager to load from
 	*/
 	void load(SaveManager& saveManager);
+	/**
+	* Loads from the SaveManager instance, creating shapes on multiple threads. File must have been loaded beforehand
+	* Parameter: SaveManager& saveManager  SaveManager to load from
+	* Parameter: unsigned threads  Number of threads to create shapes with, 0 to use one per hardware thread
+	*/
+	void load(SaveManager& saveManager, unsigned threads);
+	/**
+	* Adds the shapes in a snapshot, such as one loaded by BinarySaveManager. Parametric shapes are recreated from their parameters
+	* Parameter: const SceneSnapshot& snapshot  Snapshot to add shapes from
+	*/
+	void restore(const SceneSnapshot& snapshot);
+	/**
+	* Creates the shapes saved in a loaded section without adding them, such as on a loading thread. 
+	* Only the shape types are read, so this can run while the manager is used on another thread, as long as no types are added
+	* Parameter: SaveManager& saveManager  SaveManager the section was loaded into
+	* Parameter: const std::string& section  Section containing the shape keys
+	* Parameter: const std::vector<Geometry>& geometries  Loaded geometry section entries, see loadGeometry
+	* Parameter: size_t first  Index of the first shape key to create
+	* Parameter: size_t count  Number of shapes to create, clamped to the number loaded
+	* Parameter: std::vector<Shape*>& created  Vector the new shapes are appended to, the caller must add them to a manager or delete them
+	*/
+	void createShapes(SaveManager& saveManager, const std::string& section, const std::vector<Geometry>& geometries, 
+		size_t first, size_t count, std::vector<Shape*>& created) const;
+	/**
+	* Adds shapes without changing their z order, keeping the shapes sorted
+	* Parameter: std::vector<Shape*>& added  Shapes to add
+	*/
+	void insertOrdered(std::vector<Shape*>& added);
+	/**
+	* Raises the z order of every shape, freeing orders 1 to count for shapes that should be stacked below them
+	* Parameter: unsigned long long count  Number of z orders to free
+	*/
+	void reserveZOrders(unsigned long long count);
+	/**
+	* Creates the entries of a loaded geometry section, each is shared by every shape that references it
+	* Parameter: SaveManager& saveManager  SaveManager the geometry section was loaded into
+	* Returns: std::vector<Geometry>  Entries in the order they were saved
+	*/
+	static std::vector<Geometry> loadGeometry(SaveManager& saveManager);
+	/**
+	* Adds randomly generated regular polygons in a square centered on 0,0, for stress testing. 
+	* The same settings and shape types always generate the same shapes
+	* Parameter: const GenerationSettings& settings  Number of shapes and their distributions
+	* Returns: float  Width of the square the shapes were placed in
+	*/
+	float generate(const GenerationSettings& settings);
+
+	/**
+	* Enables paging, shapes are then saved in the tiled layout. Settings apply from the next update
+	* Parameter: const PagingSettings& settings  Paging settings. The tile size of a file loaded with loadPaged overrides the one set here
+	*/
+	void setPaging(const PagingSettings& settings);
+	/**
+	* Starts paging shapes from a tiled save, replacing the current shapes. Only the tile directory and geometry are loaded, 
+	* tiles are loaded by updatePaging
+	* Parameter: std::string file  Tiled save file
+	* Returns: bool  False if the file couldn't be loaded or doesn't use the tiled layout
+	*/
+	bool loadPaged(std::string file);
+	/**
+	* Rereads the tiled save's index before loading more tiles, after a save replaces the file. The new file has the same tiles
+	* that are still on disk, but they can be at different offsets
+	*/
+	inline void reloadPagingIndex() { pagingReader.unloadIndex(); }
+	/**
+	* Loads the tiles in and around the view and evicts tiles out of view to stay within the memory budget. Call every frame
+	* Parameter: const SceneSettings& sceneSettings  Current zoom and pan
+	* Parameter: float viewWidth  Width of the view before zooming
+	* Parameter: float viewHeight  Height of the view before zooming
+	* Parameter: std::initializer_list<Shape*> pinned  Shapes that mustn't be evicted, such as the shape being dragged. 
+	*												   Selected shapes are never evicted
+	*/
+	void updatePaging(const SceneSettings& sceneSettings, float viewWidth, float viewHeight, std::initializer_list<Shape*> pinned);
+	/**
+	* Adds the shapes and tiles that aren't resident to a snapshot and sets its tiled layout settings. Does nothing if not paging
+	* Parameter: SceneSnapshot& snapshot  Snapshot of the resident shapes
+	*/
+	void capturePages(SceneSnapshot& snapshot);
+	/**
+	* Returns: bool  True if paging is enabled
+	*/
+	inline bool isPaging() { return paging; }
+	/**
+	* Returns: size_t  Approximate memory used by resident shapes in bytes, as of the last updatePaging
+	*/
+	inline size_t getResidentMemory() { return residentMemory; }
+	/**
+	* Returns: size_t  Number of tiles that are resident
+	*/
+	size_t getResidentTileCount();
+	/**
+	* Returns: size_t  Number of tiles with shapes
+	*/
+	inline size_t getTileCount() { return tiles.size(); }
+	/**
+	* Returns: const PagingSettings&  Current paging settings
+	*/
+	inline const PagingSettings& getPagingSettings() { return pagingSettings; }
 
 	/**
 	* Removes all shapes from the manager
@@ -44,13 +273,127 @@ public:
 	void clear();
 
 	/**
-	* Gets the first shape that touches the specified point
+	* Gets the shape on top at the specified point
 	* Parameter: float x  Point to find shape at
 	* Parameter: float y  Point to find shape at
 	* Returns: std::unique_ptr<Shape>&  Reference of unique_ptr to shape instance, or to nullptr if no shape was found
 	*/
 	//std::unique_ptr<Shape>& getShapeAt(float x, float y);
 	Shape* getShapeAt(float x, float y);
+	/**
+	* Gets the shape on top at each of many points, much faster than calling getShapeAt for each, see SpatialIndex::pick
+	* Parameter: const std::vector<Point>& points  Points to find shapes at
+	* Parameter: std::vector<Shape*>& results  Set to the shape at each point, or nullptr where there's none
+	* Parameter: unsigned threads  Number of threads to pick with, 0 to use one per hardware thread
+	*/
+	void getShapesAt(const std::vector<Point>& points, std::vector<Shape*>& results, unsigned threads = 0);
+
+	/**
+	* How a shape must overlap a region to be found by a region query
+	*/
+	enum RegionMode {
+		INTERSECTING,	// Any part of the shape is in the region
+		CONTAINED		// The whole shape is in the region
+	};
+	/**
+	* Gets the shapes in an axis-aligned rectangle, such as a marquee selection. Only the shapes in the spatial index cells 
+	* the rectangle covers are tested, and most are decided by their extent or cached world bounds without testing their edges
+	* Parameter: const Point& corner  A corner of the rectangle
+	* Parameter: const Point& oppositeCorner  The opposite corner
+	* Parameter: RegionMode mode  Whether shapes must be partly or wholly inside
+	* Parameter: std::vector<Shape*>& results  Set to the shapes found, back to front
+	* Parameter: unsigned threads  Most threads to test with, 0 to use one per hardware thread. Small queries use one
+	*/
+	void getShapesInRect(const Point& corner, const Point& oppositeCorner, RegionMode mode, std::vector<Shape*>& results, unsigned threads = 0);
+	/**
+	* Gets the shapes in a polygon, such as a lasso selection. The polygon's bounds select the spatial index cells to search 
+	* and reject shapes by their cached world bounds, the rest are tested against its edges
+	* Parameter: const std::vector<Point>& polygon  Vertices of the polygon in world coordinates, which may be concave
+	* Parameter: RegionMode mode  Whether shapes must be partly or wholly inside
+	* Parameter: std::vector<Shape*>& results  Set to the shapes found, back to front. Empty if the polygon has fewer than 3 vertices
+	* Parameter: unsigned threads  Most threads to test with, 0 to use one per hardware thread. Small queries use one
+	*/
+	void getShapesInPolygon(const std::vector<Point>& polygon, RegionMode mode, std::vector<Shape*>& results, unsigned threads = 0);
+	/**
+	* Replaces the selection, showing the selected shapes' outlines and hiding the previously selected shapes'
+	* Parameter: const std::vector<Shape*>& shapes  Shapes to select, which must have been added to this manager
+	*/
+	void setSelection(const std::vector<Shape*>& shapes);
+	/**
+	* Deselects every shape, hiding their outlines
+	*/
+	void clearSelection();
+	/**
+	* Returns: const std::vector<Shape*>&  Selected shapes, in the order they were selected
+	*/
+	inline const std::vector<Shape*>& getSelection() { return selection; }
+	/**
+	* Returns: Point  Average position of the selected shapes, which group rotation and scaling pivot about. 0,0 if none are selected
+	*/
+	Point getSelectionCentroid();
+	/**
+	* Rotates and scales every selected shape about a pivot, then translates them, so the selection moves as one rigid group
+	* Parameter: const Point& pivot  Point to rotate and scale about, such as the selection's centroid
+	* Parameter: float angle  Degrees to rotate by
+	* Parameter: float scaleFactor  Factor to multiply scales and distances from the pivot by
+	* Parameter: float x  Distance to translate along x
+	* Parameter: float y  Distance to translate along y
+	* Parameter: unsigned threads  Most threads to update with, 0 to use one per hardware thread. Small selections use one
+	*/
+	void transformSelection(const Point& pivot, float angle, float scaleFactor, float x, float y, unsigned threads = 0);
+	/**
+	* Parameter: const Colour& colour  Colour to fill every selected shape with
+	* Parameter: unsigned threads  Most threads to update with, 0 to use one per hardware thread. Small selections use one
+	*/
+	void setSelectionColour(const Colour& colour, unsigned threads = 0);
+	/**
+	* Morphs every selected shape to the shape type after its own, or before it, wrapping around, see getTypes.
+	* Shapes that aren't a registered type are unchanged
+	* Parameter: bool reverse  True to morph to the previous type
+	* Parameter: unsigned threads  Most threads to update with, 0 to use one per hardware thread. Small selections use one
+	*/
+	void morphSelection(bool reverse, unsigned threads = 0);
+
+	/**
+	* Groups shapes about their centroid. Shapes that are already grouped bring their outermost group, which becomes a child 
+	* of the new group, so groups nest. The shapes' world transforms are unchanged
+	* Parameter: const std::vector<Shape*>& members  Shapes to group, which must have been added to this manager
+	* Returns: ShapeGroup*  The new group, owned by the manager, or nullptr if there were no shapes
+	*/
+	ShapeGroup* createGroup(const std::vector<Shape*>& members);
+	/**
+	* Deletes a group, moving its shapes and child groups to its parent, or out of any group, without changing their world transforms
+	* Parameter: ShapeGroup* group  Group to delete, owned by this manager
+	*/
+	void ungroup(ShapeGroup* group);
+	/**
+	* Groups the selected shapes, see createGroup
+	* Returns: ShapeGroup*  The new group, or nullptr if nothing is selected
+	*/
+	inline ShapeGroup* groupSelection() { return createGroup(selection); }
+	/**
+	* Ungroups the outermost group of each selected shape, so each call removes one level of nesting
+	*/
+	void ungroupSelection();
+	/**
+	* Returns: const std::vector<std::unique_ptr<ShapeGroup>>&  Every group, in the order they were created
+	*/
+	inline const std::vector<std::unique_ptr<ShapeGroup>>& getGroups() { return groups; }
+
+	/**
+	* Brings the spatial index up to date, rebuilding it on multiple threads if it's been invalidated.
+	* Called by getShapeAt, call after loading to avoid the delay on the first pick
+	*/
+	void updateIndex();
+	/**
+	* Returns: bool  True if the spatial index was restored from the save or is up to date
+	*/
+	inline bool isIndexValid() { return indexValid; }
+
+	/**
+	* Queues a shape to be moved between spatial index cells
+	*/
+	void onBoundsChanged(Shape* shape) override;
 
 
 	/**
@@ -75,5 +418,79 @@ public:
 	* Returns: std::vector<std::unique_ptr<Shape>>&  Vector of unique_ptrs to shapes added to this manager.
 	*/
 	inline std::vector<std::unique_ptr<Shape>>& getShapes() { return shapes; }
+
+	/**
+	* Registers a shape type prototype. Loaded parametric shapes with the same name, number of edges and radius
+	* copy the prototype's vertices instead of generating them
+	* Parameter: Shape* shape  Prototype shape, the manager takes ownership of it
+	*/
+	void addType(Shape* shape);
+	/**
+	* Parameter: const std::string& name  Name of the shape type
+	* Returns: Shape*  Prototype with the name, or nullptr if there isn't one
+	*/
+	Shape* getType(const std::string& name) const;
+	/**
+	* Returns: std::vector<std::unique_ptr<Shape>>&  Shape type prototypes in the order they were added
+	*/
+	inline std::vector<std::unique_ptr<Shape>>& getTypes() { return types; }
+
+protected:
+	/**
+	* Creates a shape from the values and arrays of a saved shape key
+	* Parameter: const std::vector<Geometry>& geometries  Loaded geometry section entries, which shapes reference by index
+	* Returns: Shape*  New shape, which the caller must manage or add to a manager, or nullptr if the edge count, radius or scale is invalid
+	*/
+	Shape* createShape(std::map<std::string, std::string>& values, std::map<std::string, std::vector<std::string>>& arrays, 
+		const std::vector<Geometry>& geometries) const;
+	/**
+	* Creates an unrotated parametric shape, copying a prototype's vertices if one matches
+	* Returns: Shape*  New shape, which the caller must manage or add to a manager
+	*/
+	Shape* createParametric(const std::string& name, int numEdges, float radius) const;
+	/**
+	* Creates shape i of a snapshot
+	* Returns: Shape*  New shape, which the caller must manage or add to a manager
+	*/
+	Shape* createShape(const SceneSnapshot& snapshot, size_t shape) const;
+
+	/**
+	* Makes a tile's stored shapes resident
+	* Returns: size_t  Memory used by the loaded shapes in bytes
+	*/
+	size_t loadTile(const TileKey& key, Tile& tile);
+	/**
+	* Moves the resident shapes positioned in each tile into the tile's storage
+	* Parameter: const std::vector<TileKey>& keys  Tiles to evict
+	*/
+	void evictTiles(const std::vector<TileKey>& keys);
+	/**
+	* Gets the shapes that might be in a region from the spatial index cells its bounds cover, or every shape for large regions
+	* Parameter: const Point& min  Smallest x and y of the region
+	* Parameter: const Point& max  Largest x and y of the region
+	* Parameter: std::vector<Shape*>& candidates  Set to the shapes to test
+	* Returns: bool  True if the candidates are back to front
+	*/
+	bool getRegionCandidates(const Point& min, const Point& max, std::vector<Shape*>& candidates);
+	/**
+	* Adds the grouped shapes in a region to the results of a region query, then sorts them back to front if any were added
+	* Parameter: const Point* polygon  Vertices of the region in world coordinates
+	* Parameter: size_t count  Number of vertices
+	*/
+	void addGroupedShapesInRegion(const Point* polygon, size_t count, RegionMode mode, std::vector<Shape*>& results, unsigned threads);
+	/**
+	* Starts and finishes updating the selection on several threads. Pending index changes are applied first, 
+	* so afterwards every selected shape whose bounds changed can be queued for the index
+	*/
+	void beginSelectionUpdate();
+	void endSelectionUpdate();
+	/**
+	* Empties the spatial index so it's rebuilt on the next pick, used before adding many shapes at once
+	*/
+	void invalidateIndex();
+	/**
+	* Returns: TileKey  Tile containing a shape's world position
+	*/
+	inline TileKey getTile(Shape& shape) { return SceneSnapshot::getTile(shape.getWorldPosition(), pagingSettings.tileSize); }
 };
 
@@ -1,6 +1,4 @@
 #include "stdafx.h"
-#include <Windows.h>
-#include <gl\GL.h>
 #include "ShapeRenderer.h"
 #include "Shape.h"
 #include <iostream>
@@ -18,32 +16,31 @@ ShapeRenderer::ShapeRenderer() {
 ShapeRenderer::~ShapeRenderer() {
 }
 
-void ShapeRenderer::drawVertices(Shape& shape) {
-	for (const Point& vertex : shape.getVertices()) {
-		glVertex2f(
-			shape.getPosition().x + (vertex.x * shape.getScale()), 
-			shape.getPosition().y + (vertex.y* shape.getScale())
-		);
-	}
+void ShapeRenderer::transformVertices(Shape& shape) {
+	worldVertices.clear();
+	ShapeTransform transform = shape.getWorldTransform();
+	for (const Point& vertex : shape.getVertices()) worldVertices.push_back(transform.apply(vertex));
 }
 
-void ShapeRenderer::render(Shape& shape) {
+void ShapeRenderer::render(Renderer& renderer, Shape& shape) {
+	transformVertices(shape);
 	// Draw filled polygon
-	glBegin(GL_POLYGON);
-	glColor3f(shape.getColour().r, shape.getColour().g, shape.getColour().b);
-	drawVertices(shape);
-	glEnd();
+	renderer.fillPolygon(worldVertices.data(), worldVertices.size(), shape.getColour());
 	// Draw outline if it's set
-	if (shape.isOutlineVisible()) {
-		glBegin(GL_LINE_LOOP);
-		glColor3f(shape.getOutlineColour().r, shape.getOutlineColour().g, shape.getOutlineColour().b);
-		drawVertices(shape);
-		glEnd();
-	}
+	if (shape.isOutlineVisible()) renderer.drawLineLoop(worldVertices.data(), worldVertices.size(), shape.getOutlineColour());
 }
 
-void ShapeRenderer::render(const vector<unique_ptr<Shape>>& shapes) {
+void ShapeRenderer::render(Renderer& renderer, const vector<unique_ptr<Shape>>& shapes) {
+	// Transform every shape's vertices in one pass, then draw them in order
+	transforms.clear();
 	for (const auto& shape : shapes) {
-		render(*shape);
+		const vector<Point>& vertices = shape->getVertices();
+		transforms.add(vertices.data(), vertices.size(), shape->getWorldTransform());
 	}
-}
\ No newline at end of file
+	transforms.run();
+	for (size_t i = 0; i < shapes.size(); i++) {
+		Shape& shape = *shapes[i];
+		renderer.fillPolygon(transforms.getWorldVertices(i), transforms.getVertexCount(i), shape.getColour());
+		if (shape.isOutlineVisible()) renderer.drawLineLoop(transforms.getWorldVertices(i), transforms.getVertexCount(i), shape.getOutlineColour());
+	}
+}
@@ -2,9 +2,13 @@
 #include <vector>
 #include <memory>
 #include "Shape.h"
+#include "Renderer.h"
+#include "TransformBatch.h"
 
 
-
+/**
+* Draws shapes with a Renderer
+*/
 class ShapeRenderer {
 
 public:
@@ -13,21 +17,28 @@ public:
 
 	/**
 	* Render a Shapes
+	* Parameter: Renderer& renderer  Renderer to draw with
 	* Parameter: Shape& shape  Shape to render
 	*/
-	void render(Shape& shape);
+	void render(Renderer& renderer, Shape& shape);
 	/**
 	* Render a vector of Shapes in order, i.e. Shape at element 0 will be rendered first (at the back)
+	* Parameter: Renderer& renderer  Renderer to draw with
 	* Parameter: vector<unique_ptr<Shape>>* shapes  Shapes to render
 	*/
-	void render(const std::vector<std::unique_ptr<Shape>>& shapes);
+	void render(Renderer& renderer, const std::vector<std::unique_ptr<Shape>>& shapes);
 
 private:
+	// World vertices of the shape being drawn, reused between shapes
+	std::vector<Point> worldVertices;
+	// World vertices of every shape, when rendering a vector of them
+	TransformBatch transforms;
+
 	/**
-	* Draws the vertices of a shape
-	* Parameter: Shape& shape  Shape reference to draw
+	* Transforms the vertices of a shape to world coordinates, into worldVertices
+	* Parameter: Shape& shape  Shape reference to transform
 	*/
-	void drawVertices(Shape& shape);
+	void transformVertices(Shape& shape);
 
 };
 
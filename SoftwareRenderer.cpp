@@ -0,0 +1,113 @@
+#include "stdafx.h"
+#include "SoftwareRenderer.h"
+#include "CpuDispatch.h"
+#include <cmath>
+#include <algorithm>
+
+using std::vector;
+
+
+/**
+* Converts a colour with components between 0 and 1 to bytes
+*/
+static void toBytes(const Colour& colour, unsigned char* rgb) {
+	const float components[3] = { colour.r, colour.g, colour.b };
+	for (int i = 0; i < 3; i++) rgb[i] = static_cast<unsigned char>(std::min(1.0f, std::max(0.0f, components[i])) * 255 + 0.5f);
+}
+
+
+SoftwareRenderer::SoftwareRenderer(int width, int height, float cameraWidth, float cameraHeight) 
+	: width(0), height(0), cameraWidth(cameraWidth), cameraHeight(cameraHeight) {
+	resize(width, height);
+}
+
+void SoftwareRenderer::resize(int newWidth, int newHeight) {
+	width = std::max(newWidth, 1);
+	height = std::max(newHeight, 1);
+	pixels.assign(static_cast<size_t>(width) * height * 3, 0);
+}
+
+void SoftwareRenderer::clear(const Colour& colour) {
+	unsigned char rgb[3];
+	toBytes(colour, rgb);
+	for (size_t i = 0; i < pixels.size(); i += 3) {
+		pixels[i] = rgb[0];
+		pixels[i + 1] = rgb[1];
+		pixels[i + 2] = rgb[2];
+	}
+}
+
+void SoftwareRenderer::setTransform(float newScale, float newTranslateX, float newTranslateY) {
+	scale = newScale;
+	translateX = newTranslateX;
+	translateY = newTranslateY;
+}
+
+void SoftwareRenderer::project(const Point* vertices, size_t count) {
+	float pixelsPerUnitX = width / cameraWidth;
+	float pixelsPerUnitY = height / cameraHeight;
+	projected.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		projected[i].x = ((vertices[i].x + translateX) * scale + cameraWidth / 2) * pixelsPerUnitX;
+		projected[i].y = ((vertices[i].y + translateY) * scale + cameraHeight / 2) * pixelsPerUnitY;
+	}
+}
+
+void SoftwareRenderer::fillRow(int y, int fromX, int toX, const unsigned char* rgb) {
+	fromX = std::max(fromX, 0);
+	toX = std::min(toX, width);
+	if (fromX < toX) CpuDispatch::get().fillPixels(&pixels[(static_cast<size_t>(y) * width + fromX) * 3], toX - fromX, rgb);
+}
+
+void SoftwareRenderer::fillPolygon(const Point* vertices, size_t count, const Colour& colour) {
+	if (count < 3) return;
+	project(vertices, count);
+	Point min, max;
+	CpuDispatch::get().bounds(projected.data(), count, min, max);
+	// Rows whose centers are inside the polygon's bounds, clipped to the image
+	int firstRow = std::max(0, static_cast<int>(std::ceil(min.y - 0.5f)));
+	int lastRow = std::min(height - 1, static_cast<int>(std::floor(max.y - 0.5f)));
+	if (firstRow > lastRow) return;
+	unsigned char rgb[3];
+	toBytes(colour, rgb);
+
+	for (int y = firstRow; y <= lastRow; y++) {
+		float center = y + 0.5f;
+		crossings.clear();
+		for (size_t i = 0; i < count; i++) {
+			const Point& a = projected[i];
+			const Point& b = projected[(i + 1) % count];
+			// Half open, so a row through a vertex counts it once
+			if ((a.y <= center) != (b.y <= center)) crossings.push_back(a.x + (center - a.y) / (b.y - a.y) * (b.x - a.x));
+		}
+		std::sort(crossings.begin(), crossings.end());
+		for (size_t i = 0; i + 1 < crossings.size(); i += 2) {
+			// Pixels whose centers are between the crossings
+			fillRow(y, static_cast<int>(std::ceil(crossings[i] - 0.5f)), static_cast<int>(std::ceil(crossings[i + 1] - 0.5f)), rgb);
+		}
+	}
+}
+
+void SoftwareRenderer::drawLineLoop(const Point* vertices, size_t count, const Colour& colour) {
+	if (count < 2) return;
+	project(vertices, count);
+	unsigned char rgb[3];
+	toBytes(colour, rgb);
+	for (size_t i = 0; i < count; i++) {
+		const Point& a = projected[i];
+		const Point& b = projected[(i + 1) % count];
+		// One pixel per step along the longer axis
+		float steps = std::ceil(std::max(std::abs(b.x - a.x), std::abs(b.y - a.y)));
+		if (!(steps < 1 << 16)) continue;
+		for (float step = 0; step <= steps; step++) {
+			float t = (steps > 0)? step / steps : 0;
+			int x = static_cast<int>(std::floor(a.x + (b.x - a.x) * t));
+			int y = static_cast<int>(std::floor(a.y + (b.y - a.y) * t));
+			if (x >= 0 && x < width && y >= 0 && y < height) fillRow(y, x, x + 1, rgb);
+		}
+	}
+}
+
+void SoftwareRenderer::drawText(float x, float y, const char* text, const Colour& colour) {
+	// No font to draw with
+}
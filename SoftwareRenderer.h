@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+#include "Renderer.h"
+
+/**
+* Renderer that rasterises into an RGB image in memory, so scenes can be drawn without a window or OpenGL,
+* such as when replaying input headlessly. Text isn't drawn.
+* Maps camera coordinates to pixels like the GLUT frontend's orthographic camera: the camera's width and height
+* are stretched over the whole image, with 0,0 at its center.
+*/
+class SoftwareRenderer : public Renderer {
+
+protected:
+	int width;
+	int height;
+	float cameraWidth;
+	float cameraHeight;
+	// Rows of RGB pixels, top to bottom
+	std::vector<unsigned char> pixels;
+	float scale = 1;
+	float translateX = 0;
+	float translateY = 0;
+	// Pixel coordinates of the polygon being drawn and the x coordinates where a row crosses it, reused between draws
+	std::vector<Point> projected;
+	std::vector<float> crossings;
+
+public:
+	/**
+	* Parameter: int width  Image width in pixels
+	* Parameter: int height  Image height in pixels
+	* Parameter: float cameraWidth  Width of the view in camera coordinates
+	* Parameter: float cameraHeight  Height of the view in camera coordinates
+	*/
+	SoftwareRenderer(int width, int height, float cameraWidth, float cameraHeight);
+
+	/**
+	* Resizes the image, clearing it to black
+	*/
+	void resize(int newWidth, int newHeight);
+
+	virtual void clear(const Colour& colour) override;
+	virtual void setTransform(float newScale, float newTranslateX, float newTranslateY) override;
+	/**
+	* Fills pixels whose centers are inside the polygon, using the even-odd rule
+	*/
+	virtual void fillPolygon(const Point* vertices, size_t count, const Colour& colour) override;
+	virtual void drawLineLoop(const Point* vertices, size_t count, const Colour& colour) override;
+	virtual void drawText(float x, float y, const char* text, const Colour& colour) override;
+
+	/**
+	* Returns: const std::vector<unsigned char>&  Rows of RGB pixels, top to bottom
+	*/
+	inline const std::vector<unsigned char>& getPixels() const { return pixels; }
+	inline int getWidth() const { return width; }
+	inline int getHeight() const { return height; }
+
+protected:
+	/**
+	* Transforms points to pixel coordinates, into projected
+	*/
+	void project(const Point* vertices, size_t count);
+	/**
+	* Fills a horizontal run of pixels in a row, clipped to the image
+	*/
+	void fillRow(int y, int fromX, int toX, const unsigned char* rgb);
+};
@@ -0,0 +1,405 @@
+#include "stdafx.h"
+#include "SpatialIndex.h"
+#include "SceneSnapshot.h"
+#include "CpuDispatch.h"
+#include <thread>
+#include <cmath>
+#include <algorithm>
+
+using std::vector;
+using std::unique_ptr;
+
+const float SpatialIndex::DEFAULT_CELL_SIZE = 128;
+// Padding added to shape bounds, so rounding in saved positions and scales doesn't change a shape's cells
+static const float BOUNDS_PADDING = 1;
+// Fewest points in a cell that batched picking tests together, fewer are picked one at a time
+static const size_t MIN_BATCH_POINTS = 4;
+
+
+SpatialIndex::SpatialIndex() {}
+
+void SpatialIndex::clear() {
+	for (auto& shard : shards) shard.clear();
+	overflow.clear();
+}
+
+CellRange SpatialIndex::getCells(const Point& position, float extent, float cellSize) {
+	CellRange cells;
+	extent += BOUNDS_PADDING;
+	float minX = std::floor((position.x - extent) / cellSize);
+	float minY = std::floor((position.y - extent) / cellSize);
+	float maxX = std::floor((position.x + extent) / cellSize);
+	float maxY = std::floor((position.y + extent) / cellSize);
+	// Shapes with invalid or enormous bounds aren't indexed
+	const float limit = 1 << 30;
+	if (!(minX >= -limit && minY >= -limit && maxX <= limit && maxY <= limit)) return cells;
+	cells.minX = static_cast<int>(minX);
+	cells.minY = static_cast<int>(minY);
+	cells.maxX = static_cast<int>(maxX);
+	cells.maxY = static_cast<int>(maxY);
+	cells.overflow = (maxX - minX + 1) * (maxY - minY + 1) > MAX_SHAPE_CELLS;
+	return cells;
+}
+
+void SpatialIndex::build(const vector<unique_ptr<Shape>>& shapes, unsigned threads) {
+	clear();
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+	if (threads > SHARDS) threads = SHARDS;
+
+	// Finding the cells of each shape is the expensive part, each thread does a range of shapes
+	auto findCells = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			Shape& shape = *shapes[i];
+			if (!shape.getGroup()) shape.getIndexCells() = getCells(shape.getPosition(), shape.getExtent(), cellSize);
+		}
+	};
+	// Then each thread fills its own shards, so no locking is needed
+	auto fillShards = [&](unsigned thread) {
+		for (const auto& shape : shapes) {
+			if (shape->getGroup()) continue;
+			const CellRange& cells = shape->getIndexCells();
+			if (cells.overflow) {
+				if (thread == 0) overflow.push_back(shape.get());
+				continue;
+			}
+			for (int x = cells.minX; x <= cells.maxX; x++) {
+				for (int y = cells.minY; y <= cells.maxY; y++) {
+					int shard = getShard(x, y);
+					if (shard % threads == thread) shards[shard][getKey(x, y)].push_back(shape.get());
+				}
+			}
+		}
+	};
+
+	vector<std::thread> workers;
+	for (unsigned i = 1; i < threads; i++) {
+		workers.push_back(std::thread(findCells, shapes.size() * i / threads, shapes.size() * (i + 1) / threads));
+	}
+	findCells(0, shapes.size() / threads);
+	for (auto& worker : workers) worker.join();
+	workers.clear();
+	for (unsigned i = 1; i < threads; i++) workers.push_back(std::thread(fillShards, i));
+	fillShards(0);
+	for (auto& worker : workers) worker.join();
+}
+
+bool SpatialIndex::restore(const SpatialIndexNodes& nodes, const vector<Shape*>& shapes) {
+	clear();
+	if (!(nodes.cellSize > 0) || nodes.cellStarts.size() != nodes.size() + 1 || nodes.cellY.size() != nodes.size()) return false;
+	cellSize = nodes.cellSize;
+	// Each shape's cells are the bounding range of the cells it's saved in. 
+	// They're gathered in a separate array and copied to the shapes at the end, which is much more cache friendly
+	vector<CellRange> ranges(shapes.size());
+
+	for (size_t cell = 0; cell < nodes.size(); cell++) {
+		int x = nodes.cellX[cell];
+		int y = nodes.cellY[cell];
+		unsigned begin = nodes.cellStarts[cell];
+		unsigned end = nodes.cellStarts[cell + 1];
+		if (begin > end || end > nodes.shapes.size()) {
+			clear();
+			return false;
+		}
+		vector<Shape*>& cellShapes = shards[getShard(x, y)][getKey(x, y)];
+		cellShapes.resize(end - begin);
+		for (unsigned i = begin; i < end; i++) {
+			unsigned shape = nodes.shapes[i];
+			if (shape >= shapes.size()) {
+				clear();
+				return false;
+			}
+			cellShapes[i - begin] = shapes[shape];
+			CellRange& cells = ranges[shape];
+			if (cells.empty()) {
+				cells.minX = cells.maxX = x;
+				cells.minY = cells.maxY = y;
+			} else {
+				cells.minX = std::min(cells.minX, x);
+				cells.minY = std::min(cells.minY, y);
+				cells.maxX = std::max(cells.maxX, x);
+				cells.maxY = std::max(cells.maxY, y);
+			}
+		}
+	}
+	for (size_t i = 0; i < shapes.size(); i++) {
+		// Shapes in no cell either have invalid bounds or overflow, which are found again the same way build finds them
+		if (ranges[i].empty()) {
+			ranges[i] = getCells(shapes[i]->getPosition(), shapes[i]->getExtent(), cellSize);
+			addToCells(shapes[i], ranges[i]);
+		}
+		shapes[i]->getIndexCells() = ranges[i];
+	}
+	return true;
+}
+
+void SpatialIndex::insert(Shape* shape) {
+	shape->getIndexCells() = getCells(shape->getPosition(), shape->getExtent(), cellSize);
+	addToCells(shape, shape->getIndexCells());
+}
+
+void SpatialIndex::remove(Shape* shape) {
+	removeFromCells(shape, shape->getIndexCells());
+	shape->getIndexCells() = CellRange();
+}
+
+void SpatialIndex::update(Shape* shape) {
+	CellRange cells = getCells(shape->getPosition(), shape->getExtent(), cellSize);
+	CellRange& current = shape->getIndexCells();
+	if (cells.minX == current.minX && cells.minY == current.minY && cells.maxX == current.maxX && cells.maxY == current.maxY
+		&& cells.overflow == current.overflow) return;
+	removeFromCells(shape, current);
+	current = cells;
+	addToCells(shape, current);
+}
+
+Shape* SpatialIndex::pick(float x, float y) {
+	int cellX = static_cast<int>(std::floor(x / cellSize));
+	int cellY = static_cast<int>(std::floor(y / cellSize));
+	auto& shard = shards[getShard(cellX, cellY)];
+	auto cell = shard.find(getKey(cellX, cellY));
+	Shape* top = nullptr;
+	if (cell != shard.end()) {
+		for (Shape* shape : cell->second) {
+			if ((!top || shape->getZOrder() > top->getZOrder()) && shape->pointInShape(x, y)) top = shape;
+		}
+	}
+	for (Shape* shape : overflow) {
+		if ((!top || shape->getZOrder() > top->getZOrder()) && shape->pointInShape(x, y)) top = shape;
+	}
+	return top;
+}
+
+void SpatialIndex::pick(const vector<Point>& points, vector<Shape*>& results, unsigned threads) {
+	struct Query {
+		int x, y;
+		unsigned point;
+		bool operator<(const Query& other) const {
+			return x != other.x? x < other.x : y != other.y? y < other.y : point < other.point;
+		}
+	};
+	results.assign(points.size(), nullptr);
+	vector<Query> queries(points.size());
+	for (size_t i = 0; i < points.size(); i++) {
+		queries[i] = Query{ static_cast<int>(std::floor(points[i].x / cellSize)), static_cast<int>(std::floor(points[i].y / cellSize)), static_cast<unsigned>(i) };
+	}
+	std::sort(queries.begin(), queries.end());
+	auto sameCell = [&](size_t a, size_t b) { return queries[a].x == queries[b].x && queries[a].y == queries[b].y; };
+
+	// Each thread picks a range of cells, writing only to its own points' results
+	auto pickRange = [&](size_t begin, size_t end) {
+		const CpuDispatch::Kernels& kernels = CpuDispatch::get();
+		vector<Shape*> cellShapes;
+		vector<unsigned> remaining, candidates;
+		vector<float> xs, ys;
+		vector<unsigned char> inside;
+		for (size_t first = begin, last; first < end; first = last) {
+			for (last = first + 1; last < end && sameCell(first, last); last++);
+			auto& shard = shards[getShard(queries[first].x, queries[first].y)];
+			auto cell = shard.find(getKey(queries[first].x, queries[first].y));
+			if (cell == shard.end()) continue;
+			// Too few points to share the work of sorting the cell and transforming for each shape, test them as pick does
+			if (last - first < MIN_BATCH_POINTS) {
+				for (size_t i = first; i < last; i++) {
+					const Point& point = points[queries[i].point];
+					Shape*& top = results[queries[i].point];
+					for (Shape* shape : cell->second) {
+						if ((!top || shape->getZOrder() > top->getZOrder()) && shape->pointInShape(point.x, point.y)) top = shape;
+					}
+				}
+				continue;
+			}
+			// Top down, so each point's first containing shape is the one on top. An insertion sort, as cells are small and it's
+			// stable, so shapes with equal orders are picked in cell order like pick
+			cellShapes.assign(cell->second.begin(), cell->second.end());
+			for (size_t i = 1; i < cellShapes.size(); i++) {
+				Shape* shape = cellShapes[i];
+				size_t j = i;
+				for (; j > 0 && cellShapes[j - 1]->getZOrder() < shape->getZOrder(); j--) cellShapes[j] = cellShapes[j - 1];
+				cellShapes[j] = shape;
+			}
+			remaining.clear();
+			for (size_t i = first; i < last; i++) remaining.push_back(queries[i].point);
+
+			for (Shape* shape : cellShapes) {
+				const vector<Point>& vertices = shape->getVertices();
+				if (vertices.empty()) continue;
+				// The points in the shape's bounding box, in its local coordinates, as Shape::pointInShape tests them
+				Point min, max;
+				kernels.bounds(vertices.data(), vertices.size(), min, max);
+				candidates.clear();
+				xs.clear();
+				ys.clear();
+				for (unsigned point : remaining) {
+					Point local = shape->worldToLocal(points[point].x, points[point].y);
+					if (local.x > min.x && local.x < max.x && local.y > min.y && local.y < max.y) {
+						candidates.push_back(point);
+						xs.push_back(local.x);
+						ys.push_back(local.y);
+					}
+				}
+				if (candidates.empty()) continue;
+				inside.resize(candidates.size());
+				kernels.pointsInPolygon(vertices.data(), vertices.size(), xs.data(), ys.data(), candidates.size(), inside.data());
+				bool found = false;
+				for (size_t i = 0; i < candidates.size(); i++) {
+					if (inside[i]) {
+						results[candidates[i]] = shape;
+						found = true;
+					}
+				}
+				if (!found) continue;
+				remaining.erase(std::remove_if(remaining.begin(), remaining.end(), [&](unsigned point) { return results[point] != nullptr; }), remaining.end());
+				if (remaining.empty()) break;
+			}
+		}
+		// Then the overflowing shapes, after the cells like pick
+		if (overflow.empty()) return;
+		for (size_t i = begin; i < end; i++) {
+			const Point& point = points[queries[i].point];
+			Shape*& top = results[queries[i].point];
+			for (Shape* shape : overflow) {
+				if ((!top || shape->getZOrder() > top->getZOrder()) && shape->pointInShape(point.x, point.y)) top = shape;
+			}
+		}
+	};
+
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+	// Split the queries evenly, then move each split to the start of a cell so no cell is looked up twice
+	vector<size_t> splits(threads + 1);
+	for (unsigned i = 0; i <= threads; i++) {
+		splits[i] = queries.size() * i / threads;
+		while (i > 0 && i < threads && splits[i] > 0 && splits[i] < queries.size() && sameCell(splits[i] - 1, splits[i])) splits[i]++;
+		if (i > 0) splits[i] = std::max(splits[i], splits[i - 1]);
+	}
+	vector<std::thread> workers;
+	for (unsigned i = 1; i < threads; i++) workers.push_back(std::thread(pickRange, splits[i], splits[i + 1]));
+	pickRange(splits[0], splits[1]);
+	for (auto& worker : workers) worker.join();
+}
+
+void SpatialIndex::query(const Point& min, const Point& max, vector<Shape*>& results) {
+	// The rectangle's cells, clamped to the range getCells indexes
+	CellRange range;
+	const float limit = 1 << 30;
+	float minX = std::max(std::floor(min.x / cellSize), -limit);
+	float minY = std::max(std::floor(min.y / cellSize), -limit);
+	float maxX = std::min(std::floor(max.x / cellSize), limit);
+	float maxY = std::min(std::floor(max.y / cellSize), limit);
+	if (!(minX <= maxX && minY <= maxY)) return;
+	range.minX = static_cast<int>(minX);
+	range.minY = static_cast<int>(minY);
+	range.maxX = static_cast<int>(maxX);
+	range.maxY = static_cast<int>(maxY);
+	for (Shape* shape : overflow) {
+		const CellRange& cells = shape->getIndexCells();
+		if (cells.minX <= range.maxX && cells.maxX >= range.minX && cells.minY <= range.maxY && cells.maxY >= range.minY) results.push_back(shape);
+	}
+
+	// A shape in several of the cells is only added from the one at its smallest cell coordinates within the range
+	auto addCell = [&](int x, int y, const vector<Shape*>& cellShapes) {
+		for (Shape* shape : cellShapes) {
+			const CellRange& cells = shape->getIndexCells();
+			if (x == std::max(cells.minX, range.minX) && y == std::max(cells.minY, range.minY)) results.push_back(shape);
+		}
+	};
+	if (countCells(min, max) > getCellCount()) {
+		for (auto& shard : shards) {
+			for (auto& cell : shard) {
+				int x = static_cast<int>(static_cast<unsigned>(cell.first >> 32));
+				int y = static_cast<int>(static_cast<unsigned>(cell.first));
+				if (x >= range.minX && x <= range.maxX && y >= range.minY && y <= range.maxY) addCell(x, y, cell.second);
+			}
+		}
+		return;
+	}
+	for (int x = range.minX; x <= range.maxX; x++) {
+		for (int y = range.minY; y <= range.maxY; y++) {
+			auto& shard = shards[getShard(x, y)];
+			auto cell = shard.find(getKey(x, y));
+			if (cell != shard.end()) addCell(x, y, cell->second);
+		}
+	}
+}
+
+double SpatialIndex::countCells(const Point& min, const Point& max) {
+	double columns = std::floor(max.x / cellSize) - std::floor(min.x / cellSize) + 1;
+	double rows = std::floor(max.y / cellSize) - std::floor(min.y / cellSize) + 1;
+	return (columns > 0 && rows > 0)? columns * rows : 0;
+}
+
+size_t SpatialIndex::getCellCount() {
+	size_t count = 0;
+	for (auto& shard : shards) count += shard.size();
+	return count;
+}
+
+void SpatialIndex::buildNodes(const SceneSnapshot& snapshot, float cellSize, SpatialIndexNodes& nodes) {
+	struct Reference {
+		int x, y;
+		unsigned shape;
+		bool operator<(const Reference& other) const {
+			return x != other.x? x < other.x : y != other.y? y < other.y : shape < other.shape;
+		}
+	};
+	vector<Reference> references;
+	references.reserve(snapshot.size());
+	for (size_t i = 0; i < snapshot.size(); i++) {
+		CellRange cells = getCells(snapshot.positions[i], snapshot.getExtent(i), cellSize);
+		if (cells.overflow) continue;
+		for (int x = cells.minX; x <= cells.maxX; x++) {
+			for (int y = cells.minY; y <= cells.maxY; y++) references.push_back(Reference{ x, y, static_cast<unsigned>(i) });
+		}
+	}
+	std::sort(references.begin(), references.end());
+
+	nodes.clear();
+	nodes.cellSize = cellSize;
+	nodes.shapes.reserve(references.size());
+	for (size_t i = 0; i < references.size(); i++) {
+		if (i == 0 || references[i].x != references[i - 1].x || references[i].y != references[i - 1].y) {
+			nodes.cellX.push_back(references[i].x);
+			nodes.cellY.push_back(references[i].y);
+			nodes.cellStarts.push_back(i);
+		}
+		nodes.shapes.push_back(references[i].shape);
+	}
+	nodes.cellStarts.push_back(references.size());
+}
+
+void SpatialIndex::addToCells(Shape* shape, const CellRange& cells) {
+	if (cells.overflow) {
+		overflow.push_back(shape);
+		return;
+	}
+	for (int x = cells.minX; x <= cells.maxX; x++) {
+		for (int y = cells.minY; y <= cells.maxY; y++) shards[getShard(x, y)][getKey(x, y)].push_back(shape);
+	}
+}
+
+void SpatialIndex::removeFromCells(Shape* shape, const CellRange& cells) {
+	if (cells.overflow) {
+		auto found = std::find(overflow.begin(), overflow.end(), shape);
+		if (found != overflow.end()) {
+			*found = overflow.back();
+			overflow.pop_back();
+		}
+		return;
+	}
+	for (int x = cells.minX; x <= cells.maxX; x++) {
+		for (int y = cells.minY; y <= cells.maxY; y++) {
+			auto& shard = shards[getShard(x, y)];
+			auto cell = shard.find(getKey(x, y));
+			if (cell == shard.end()) continue;
+			vector<Shape*>& cellShapes = cell->second;
+			auto found = std::find(cellShapes.begin(), cellShapes.end(), shape);
+			if (found != cellShapes.end()) {
+				// Order within a cell doesn't matter, so swap with the last shape rather than shifting
+				*found = cellShapes.back();
+				cellShapes.pop_back();
+			}
+			if (cellShapes.empty()) shard.erase(cell);
+		}
+	}
+}
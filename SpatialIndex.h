@@ -0,0 +1,165 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include "Shape.h"
+
+class SceneSnapshot;
+
+/**
+* Cells of a spatial index that refer to shapes by their index in a SceneSnapshot, used to save and restore an index.
+* The shapes in cell i are shapes[cellStarts[i]] to shapes[cellStarts[i + 1] - 1]
+*/
+struct SpatialIndexNodes {
+	// Size of the cells, 0 if there are no nodes
+	float cellSize = 0;
+	std::vector<int> cellX;
+	std::vector<int> cellY;
+	std::vector<unsigned> cellStarts;
+	std::vector<unsigned> shapes;
+
+	inline void clear() {
+		cellSize = 0;
+		cellX.clear();
+		cellY.clear();
+		cellStarts.clear();
+		shapes.clear();
+	}
+	/**
+	* Returns: size_t  Number of cells
+	*/
+	inline size_t size() const { return cellX.size(); }
+};
+
+/**
+* Uniform grid of square cells, used to find the shapes at a point without testing every shape.
+* Each shape is stored in every cell overlapped by the square its vertices can reach at any rotation (see Shape::getExtent),
+* so rotating a shape never moves it between cells. The cells a shape is in are stored in the shape,
+* so it can be updated or removed without searching.
+* Shapes covering more than MAX_SHAPE_CELLS cells are kept in an overflow list that every pick and query checks instead,
+* so a few huge shapes can't grow the index, or saves of it, with the square of their size.
+* Cells are split between a fixed number of shards, so the index can be built on multiple threads.
+*/
+class SpatialIndex {
+
+public:
+	static const int SHARDS = 16;
+	// Most cells a shape is stored in, larger shapes go in the overflow list
+	static const int MAX_SHAPE_CELLS = 64;
+	static const float DEFAULT_CELL_SIZE;
+
+protected:
+	float cellSize = DEFAULT_CELL_SIZE;
+	// Shapes in each cell, keyed by the packed cell coordinates
+	std::unordered_map<unsigned long long, std::vector<Shape*>> shards[SHARDS];
+	// Shapes covering too many cells to store in each, tested by every pick and query
+	std::vector<Shape*> overflow;
+
+public:
+	SpatialIndex();
+
+	/**
+	* Parameter: float newCellSize  Size of the cells, applied when the index is next built
+	*/
+	inline void setCellSize(float newCellSize) { cellSize = newCellSize; }
+	inline float getCellSize() { return cellSize; }
+
+	/**
+	* Removes every shape from the index
+	*/
+	void clear();
+	/**
+	* Replaces the contents of the index with the shapes
+	* Parameter: const std::vector<std::unique_ptr<Shape>>& shapes  Shapes to index. Grouped shapes are skipped, they're in their group's index
+	* Parameter: unsigned threads  Number of threads to build with, 0 to use one per hardware thread
+	*/
+	void build(const std::vector<std::unique_ptr<Shape>>& shapes, unsigned threads);
+	/**
+	* Replaces the contents of the index with saved nodes
+	* Parameter: const SpatialIndexNodes& nodes  Saved nodes
+	* Parameter: const std::vector<Shape*>& shapes  Shapes the nodes' shape indices refer to. Shapes in no node are indexed from their bounds,
+	*											   which puts overflowing shapes back in the overflow list
+	* Returns: bool  False if the nodes refer to shapes that don't exist, in which case the index is left empty
+	*/
+	bool restore(const SpatialIndexNodes& nodes, const std::vector<Shape*>& shapes);
+
+	void insert(Shape* shape);
+	void remove(Shape* shape);
+	/**
+	* Moves a shape to the cells its current bounds overlap
+	*/
+	void update(Shape* shape);
+
+	/**
+	* Finds the shape on top at a point
+	* Parameter: float x  X coordinate of the point
+	* Parameter: float y  Y coordinate of the point
+	* Returns: Shape*  Shape with the highest z order that contains the point, or nullptr
+	*/
+	Shape* pick(float x, float y);
+	/**
+	* Finds the shape on top at each of many points, giving the same shapes as picking them one at a time.
+	* The points are sorted by cell, so each cell is looked up once for all of its points. The cell's shapes are then tested
+	* from the top down against the points none of the shapes above contained, several at a time with CpuDispatch's 
+	* pointsInPolygon kernel. Ranges of cells are split between threads
+	* Parameter: const std::vector<Point>& points  Points to find the shapes at
+	* Parameter: std::vector<Shape*>& results  Set to the shape at each point, or nullptr
+	* Parameter: unsigned threads  Number of threads to pick with, 0 to use one per hardware thread
+	*/
+	void pick(const std::vector<Point>& points, std::vector<Shape*>& results, unsigned threads);
+	/**
+	* Finds the shapes whose cells overlap a rectangle, the candidates for a region query. Each shape is added once, 
+	* from the first of its cells inside the rectangle, so no set is needed to remove duplicates. Rectangles covering more cells 
+	* than are occupied go through the occupied cells instead of looking up each cell
+	* Parameter: const Point& min  Smallest x and y of the rectangle
+	* Parameter: const Point& max  Largest x and y of the rectangle
+	* Parameter: std::vector<Shape*>& results  Vector the shapes are appended to, in no particular order
+	*/
+	void query(const Point& min, const Point& max, std::vector<Shape*>& results);
+	/**
+	* Returns: double  Number of cells a rectangle covers, occupied or not
+	*/
+	double countCells(const Point& min, const Point& max);
+	/**
+	* Returns: size_t  Number of cells with shapes in them
+	*/
+	size_t getCellCount();
+	/**
+	* Returns: size_t  Number of shapes in the overflow list
+	*/
+	inline size_t getOverflowCount() { return overflow.size(); }
+
+	/**
+	* Builds the nodes of an index of the shapes in a snapshot, as they would be if the shapes were restored and indexed
+	* Parameter: const SceneSnapshot& snapshot  Shapes to index
+	* Parameter: float cellSize  Size of the cells
+	* Parameter: SpatialIndexNodes& nodes  Nodes to fill, sorted by cell, replacing any previous contents. Overflowing shapes aren't in any
+	*/
+	static void buildNodes(const SceneSnapshot& snapshot, float cellSize, SpatialIndexNodes& nodes);
+	/**
+	* Returns: CellRange  Cells overlapped by the square reaching extent from the position,
+	*					   padded slightly so small rounding in saved positions doesn't change the cells, marked as overflowing
+	*					   if there are more than MAX_SHAPE_CELLS of them
+	*/
+	static CellRange getCells(const Point& position, float extent, float cellSize);
+
+protected:
+	/**
+	* Returns: unsigned long long  Key of a cell in its shard
+	*/
+	static inline unsigned long long getKey(int x, int y) {
+		return (static_cast<unsigned long long>(static_cast<unsigned>(x)) << 32) | static_cast<unsigned>(y);
+	}
+	/**
+	* Returns: int  Shard a cell is stored in
+	*/
+	static inline int getShard(int x, int y) {
+		return static_cast<int>((static_cast<unsigned>(x) * 73856093u ^ static_cast<unsigned>(y) * 19349663u) % SHARDS);
+	}
+	/**
+	* Adds or removes a shape from every cell in a range, or the overflow list if the range overflows
+	*/
+	void addToCells(Shape* shape, const CellRange& cells);
+	void removeFromCells(Shape* shape, const CellRange& cells);
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/**
+* Fixed capacity lock-free queue for passing values from one producer thread to one consumer thread.
+* Neither side ever blocks or allocates: push fails when the queue is full and pop fails when it's empty.
+*
+* Usage:
+*	- Only one thread may call push and only one (other) thread may call pop
+*/
+template <typename T, size_t CAPACITY>
+class SpscQueue {
+	static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "SpscQueue capacity must be a power of 2");
+
+protected:
+	T items[CAPACITY];
+	// Total values pushed and popped. Each is only written by one side, on separate cache lines so the sides don't contend
+	alignas(64) std::atomic<size_t> pushed;
+	alignas(64) std::atomic<size_t> popped;
+
+public:
+	SpscQueue() : pushed(0), popped(0) {}
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	/**
+	* Adds a value to the back of the queue. Producer thread only
+	* Parameter: const T& value  Value to copy into the queue
+	* Returns: bool  False if the queue was full, in which case nothing was added
+	*/
+	bool push(const T& value) {
+		size_t back = pushed.load(std::memory_order_relaxed);
+		if (back - popped.load(std::memory_order_acquire) == CAPACITY) return false;
+		items[back & (CAPACITY - 1)] = value;
+		// Release so the consumer sees the value before the new count
+		pushed.store(back + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	* Removes the value at the front of the queue. Consumer thread only
+	* Parameter: T& value  Set to the removed value
+	* Returns: bool  False if the queue was empty
+	*/
+	bool pop(T& value) {
+		size_t front = popped.load(std::memory_order_relaxed);
+		if (front == pushed.load(std::memory_order_acquire)) return false;
+		value = items[front & (CAPACITY - 1)];
+		// Release so the producer doesn't overwrite the slot before it's been read
+		popped.store(front + 1, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	* Returns: bool  True if the queue was empty when checked. Only a hint, the producer may push at any time
+	*/
+	inline bool empty() const { return popped.load(std::memory_order_acquire) == pushed.load(std::memory_order_acquire); }
+};
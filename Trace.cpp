@@ -0,0 +1,166 @@
+#include "stdafx.h"
+#include "Trace.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+using std::string;
+using std::vector;
+using std::unique_ptr;
+using std::chrono::steady_clock;
+
+
+/**
+* Event as written to the trace
+*/
+struct TraceEvent {
+	const char* name;
+	// Nanoseconds since the program started
+	long long time;
+	double value;
+	char phase;
+};
+
+/**
+* Event in a thread's ring buffer. The fields are atomic, as Trace::write can read an event while its thread overwrites it,
+* but relaxed, so they're written as plain stores
+*/
+struct TraceSlot {
+	std::atomic<const char*> name{ nullptr };
+	std::atomic<long long> time{ 0 };
+	std::atomic<double> value{ 0 };
+	std::atomic<char> phase{ 0 };
+};
+
+/**
+* Ring buffer of a thread's events. Only its thread writes to it, other threads only read it when writing the trace
+*/
+struct TraceBuffer {
+	unsigned threadId;
+	std::atomic<const char*> threadName{ nullptr };
+	unique_ptr<TraceSlot[]> events;
+	size_t capacity = 0;
+	// Number of events ever recorded, the latest are at (count - 1) % capacity and before
+	std::atomic<size_t> count{ 0 };
+	// Number of events whose writing has started, one more than count while an event is being written. 
+	// Event i's slot can be overwritten once started passes i + capacity
+	std::atomic<size_t> started{ 0 };
+	// Count when recording last started, events before it are from an earlier trace
+	size_t first = 0;
+};
+
+std::atomic<bool> Trace::recording{ false };
+static std::mutex buffersMutex;
+// Buffers are kept after their threads exit, so their events can still be written
+static vector<unique_ptr<TraceBuffer>> buffers;
+static thread_local TraceBuffer* threadBuffer = nullptr;
+static size_t bufferCapacity = Trace::DEFAULT_CAPACITY;
+static const steady_clock::time_point origin = steady_clock::now();
+
+
+/**
+* Returns the calling thread's buffer, creating it on first use
+*/
+static TraceBuffer* getThreadBuffer() {
+	if (!threadBuffer) {
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		unique_ptr<TraceBuffer> buffer(new TraceBuffer());
+		buffer->threadId = static_cast<unsigned>(buffers.size()) + 1;
+		buffer->events.reset(new TraceSlot[bufferCapacity]);
+		buffer->capacity = bufferCapacity;
+		threadBuffer = buffer.get();
+		buffers.push_back(std::move(buffer));
+	}
+	return threadBuffer;
+}
+
+
+void Trace::start(size_t capacity) {
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	// Threads that have already recorded keep their buffers, so only threads new to tracing get the new capacity
+	bufferCapacity = std::max<size_t>(capacity, 1);
+	for (auto& buffer : buffers) buffer->first = buffer->count.load(std::memory_order_acquire);
+	recording.store(true, std::memory_order_relaxed);
+}
+
+void Trace::stop() {
+	recording.store(false, std::memory_order_relaxed);
+}
+
+void Trace::setThreadName(const char* name) {
+	// Threads only get a buffer once they record
+	if (isRecording()) getThreadBuffer()->threadName.store(name, std::memory_order_relaxed);
+}
+
+void Trace::record(const char* name, char phase, double value) {
+	TraceBuffer* buffer = getThreadBuffer();
+	size_t count = buffer->count.load(std::memory_order_relaxed);
+	// Announces the slot is being overwritten before writing it, so a writer that read any of the new values sees that it was
+	buffer->started.store(count + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	TraceSlot& event = buffer->events[count % buffer->capacity];
+	event.name.store(name, std::memory_order_relaxed);
+	event.phase.store(phase, std::memory_order_relaxed);
+	event.value.store(value, std::memory_order_relaxed);
+	event.time.store(std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now() - origin).count(), std::memory_order_relaxed);
+	// Publishes the event to write
+	buffer->count.store(count + 1, std::memory_order_release);
+}
+
+bool Trace::write(const string& file) {
+	std::ofstream os(file);
+	os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool firstEvent = true;
+	auto separate = [&]() {
+		os << (firstEvent? "\n" : ",\n");
+		firstEvent = false;
+	};
+	os << std::fixed << std::setprecision(3);
+	vector<TraceEvent> events;
+	{
+		std::lock_guard<std::mutex> lock(buffersMutex);
+		for (auto& buffer : buffers) {
+			separate();
+			os << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"args\":{\"name\":\"";
+			const char* threadName = buffer->threadName.load(std::memory_order_relaxed);
+			if (threadName) os << threadName;
+			else os << "Thread " << buffer->threadId;
+			os << "\"}}";
+
+			// Copy the events, then drop the oldest ones the thread could have started overwriting meanwhile
+			size_t count = buffer->count.load(std::memory_order_acquire);
+			size_t capacity = buffer->capacity;
+			size_t first = std::max(buffer->first, (count > capacity)? count - capacity : 0);
+			events.clear();
+			for (size_t i = first; i < count; i++) {
+				const TraceSlot& slot = buffer->events[i % capacity];
+				events.push_back(TraceEvent{ slot.name.load(std::memory_order_relaxed), slot.time.load(std::memory_order_relaxed),
+					slot.value.load(std::memory_order_relaxed), slot.phase.load(std::memory_order_relaxed) });
+			}
+			std::atomic_thread_fence(std::memory_order_acquire);
+			size_t started = buffer->started.load(std::memory_order_relaxed);
+			size_t overwritten = (started > capacity)? std::min(started - capacity, count) : 0;
+			size_t skip = (overwritten > first)? overwritten - first : 0;
+
+			// Ends whose begins were overwritten would close spans that were never opened
+			size_t depth = 0;
+			for (size_t i = skip; i < events.size(); i++) {
+				const TraceEvent& event = events[i];
+				if (event.phase == 'B') depth++;
+				else if (event.phase == 'E' && depth == 0) continue;
+				else if (event.phase == 'E') depth--;
+				separate();
+				os << "{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase << "\",\"ts\":" << event.time / 1000.0
+					<< ",\"pid\":1,\"tid\":" << buffer->threadId;
+				if (event.phase == 'C') os << ",\"args\":{\"value\":" << event.value << "}";
+				os << "}";
+			}
+		}
+	}
+	os << "\n]}\n";
+	return static_cast<bool>(os);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+
+/**
+* Records timed spans and counters from any thread, and writes them in the Chrome trace event format,
+* which chrome://tracing and ui.perfetto.dev open, to show where the time went in a hitch.
+*
+* Each thread records into its own fixed size ring buffer, so recording never locks or allocates after a thread's
+* first event, and only the most recent events are kept. While recording is off, each span and counter costs one branch.
+* Buffers are read while their threads keep recording, like a seqlock: each event is announced before it's written, 
+* and the writer leaves out the events that could have been overwritten while it copied them.
+* Names must be string literals, or otherwise outlive the trace, since only the pointer is stored.
+*
+* Usage:
+*	- Call Trace::start() to start recording
+*	- Put a Trace::Scope span("name"); at the start of a block to time it, or call Trace::counter("name", value)
+*	- Call Trace::write(file) to write the recorded events, Trace::stop() to stop recording
+*/
+class Trace {
+
+public:
+	/**
+	* Times the block it's declared in, if recording was on when it was declared
+	*/
+	class Scope {
+		const char* name;
+
+	public:
+		inline Scope(const char* name) : name(Trace::isRecording()? name : nullptr) {
+			if (this->name) Trace::record(name, 'B', 0);
+		}
+		inline ~Scope() {
+			// Ended even if recording has stopped since, so a span that was begun is never left open
+			if (name) Trace::record(name, 'E', 0);
+		}
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+
+	// Events kept per thread by default, older events are overwritten
+	static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+protected:
+	static std::atomic<bool> recording;
+
+public:
+	/**
+	* Starts recording, clearing any events recorded before
+	* Parameter: size_t capacity  Events to keep per thread
+	*/
+	static void start(size_t capacity = DEFAULT_CAPACITY);
+	/**
+	* Stops recording, keeping the recorded events for writing
+	*/
+	static void stop();
+	/**
+	* Writes the recorded events as a Chrome trace JSON file. Threads keep recording meanwhile, the events they overwrite
+	* while their buffer is copied are left out, along with ends whose begins were overwritten
+	* Parameter: const std::string& file  File to write to
+	* Returns: bool  True if the file was written
+	*/
+	static bool write(const std::string& file);
+	/**
+	* Names the calling thread in written traces, threads are numbered otherwise. Does nothing while recording is off
+	* Parameter: const char* name  Thread name, which must outlive the trace
+	*/
+	static void setThreadName(const char* name);
+
+	/**
+	* Returns: bool  True if events are being recorded
+	*/
+	static inline bool isRecording() { return recording.load(std::memory_order_relaxed); }
+
+	/**
+	* Records the start of a span, which the next end on the same thread closes
+	*/
+	static inline void begin(const char* name) { if (isRecording()) record(name, 'B', 0); }
+	/**
+	* Records the end of the span begun last on this thread
+	*/
+	static inline void end(const char* name) { if (isRecording()) record(name, 'E', 0); }
+	/**
+	* Records the value of a counter, drawn as a graph over time
+	*/
+	static inline void counter(const char* name, double value) { if (isRecording()) record(name, 'C', value); }
+
+protected:
+	/**
+	* Adds an event to the calling thread's buffer, creating the buffer on the thread's first event
+	* Parameter: char phase  Chrome trace event phase: B begin, E end or C counter
+	*/
+	static void record(const char* name, char phase, double value);
+};
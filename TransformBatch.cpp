@@ -0,0 +1,41 @@
+#include "stdafx.h"
+#include "TransformBatch.h"
+#include <thread>
+
+using std::vector;
+
+
+void TransformBatch::clear() {
+	entries.clear();
+	vertexCount = 0;
+}
+
+size_t TransformBatch::add(const Point* vertices, size_t count, const ShapeTransform& transform) {
+	Entry entry;
+	entry.vertices = vertices;
+	entry.count = count;
+	entry.offset = vertexCount;
+	entry.transform = transform;
+	entries.push_back(entry);
+	vertexCount += count;
+	return entries.size() - 1;
+}
+
+void TransformBatch::run(unsigned threads) {
+	if (world.size() < vertexCount) world.resize(vertexCount);
+	if (threads == 0) threads = std::thread::hardware_concurrency();
+	if (threads == 0) threads = 1;
+	// Each thread transforms a range of shapes, which write to separate parts of the pool
+	vector<std::thread> workers;
+	for (unsigned i = 1; i < threads; i++) {
+		workers.push_back(std::thread(&TransformBatch::runRange, this, entries.size() * i / threads, entries.size() * (i + 1) / threads));
+	}
+	runRange(0, entries.size() / threads);
+	for (auto& worker : workers) worker.join();
+}
+
+void TransformBatch::runRange(size_t first, size_t last) {
+	auto transform = CpuDispatch::get(getIsa()).transform;
+	Point* out = world.data();
+	for (size_t i = first; i < last; i++) transform(entries[i].vertices, entries[i].count, entries[i].transform, out + entries[i].offset);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include "Utils.h"
+#include "CpuDispatch.h"
+
+/**
+* Local to world transform of a shape, as Shape::localToWorld: rotated and scaled, then translated.
+* a and b are the cosine and sine of the rotation multiplied by the scale
+*/
+struct ShapeTransform {
+	float a = 1;
+	float b = 0;
+	float x = 0;
+	float y = 0;
+
+	ShapeTransform() {}
+	ShapeTransform(float rotationSin, float rotationCos, float scale, const Point& position)
+		: a(rotationCos * scale), b(rotationSin * scale), x(position.x), y(position.y) {}
+
+	/**
+	* Returns: Point  The point transformed
+	*/
+	inline Point apply(const Point& point) const {
+		return Point(point.x * a - point.y * b + x, point.x * b + point.y * a + y);
+	}
+	/**
+	* Returns: Point  The point with the transform undone
+	*/
+	inline Point applyInverse(const Point& point) const {
+		float px = point.x - x;
+		float py = point.y - y;
+		float lengthSquared = a * a + b * b;
+		return Point((px * a + py * b) / lengthSquared, (py * a - px * b) / lengthSquared);
+	}
+	/**
+	* Returns: ShapeTransform  Transform that applies inner, then this transform, such as a shape's within its group's
+	*/
+	inline ShapeTransform compose(const ShapeTransform& inner) const {
+		ShapeTransform result;
+		result.a = a * inner.a - b * inner.b;
+		result.b = b * inner.a + a * inner.b;
+		Point position = apply(Point(inner.x, inner.y));
+		result.x = position.x;
+		result.y = position.y;
+		return result;
+	}
+};
+
+/**
+* Transforms the vertices of many shapes to world coordinates in one pass, into a packed pool of world vertices.
+* Shapes are added with a pointer to their local vertices, which are read in place since geometry is shared between shapes,
+* and their transform. Each shape's vertices are transformed several at a time with CpuDispatch's transform kernel, 
+* and ranges of shapes can be transformed on multiple threads.
+*
+* Results may differ from Shape::localToWorld in the last bit, since the scale is applied with the rotation.
+*
+* Usage:
+*	- Call clear(), then add(vertices, count, transform) for each shape
+*	- Call run(threads), then read each shape's world vertices with getWorldVertices(shape)
+*/
+class TransformBatch {
+
+protected:
+	/**
+	* A shape's local vertices, where its world vertices go in the pool and its transform
+	*/
+	struct Entry {
+		const Point* vertices;
+		size_t count;
+		size_t offset;
+		ShapeTransform transform;
+	};
+
+	std::vector<Entry> entries;
+	std::vector<Point> world;
+	size_t vertexCount = 0;
+	// Instruction set chosen with setIsa, otherwise CpuDispatch's selection when each run starts, 
+	// so batches constructed before an --isa override still follow it
+	CpuDispatch::Isa isa = CpuDispatch::SCALAR;
+	bool isaSet = false;
+
+public:
+	/**
+	* Removes every shape, keeping the storage for reuse
+	*/
+	void clear();
+	/**
+	* Adds a shape to transform on the next run
+	* Parameter: const Point* vertices  Local vertices, which must stay valid until run
+	* Parameter: size_t count  Number of vertices
+	* Parameter: const ShapeTransform& transform  Transform to apply
+	* Returns: size_t  Index of the shape, for getWorldVertices
+	*/
+	size_t add(const Point* vertices, size_t count, const ShapeTransform& transform);
+	/**
+	* Transforms the vertices of every shape added since the last clear
+	* Parameter: unsigned threads  Number of threads to split the shapes between, 0 to use one per hardware thread
+	*/
+	void run(unsigned threads = 1);
+
+	/**
+	* Returns: const Point*  World vertices of a shape, after run
+	*/
+	inline const Point* getWorldVertices(size_t shape) const { return world.data() + entries[shape].offset; }
+	inline size_t getVertexCount(size_t shape) const { return entries[shape].count; }
+	inline size_t getShapeCount() const { return entries.size(); }
+	/**
+	* Returns: size_t  Vertices of every shape added
+	*/
+	inline size_t getTotalVertexCount() const { return vertexCount; }
+
+	/**
+	* Parameter: CpuDispatch::Isa newIsa  Instruction set to transform with, if the CPU supports it
+	*/
+	inline void setIsa(CpuDispatch::Isa newIsa) { if (CpuDispatch::isSupported(newIsa)) { isa = newIsa; isaSet = true; } }
+	/**
+	* Returns: CpuDispatch::Isa  Instruction set the next run transforms with
+	*/
+	inline CpuDispatch::Isa getIsa() const { return isaSet? isa : CpuDispatch::getIsa(); }
+
+protected:
+	/**
+	* Transforms the shapes from first to last - 1
+	*/
+	void runRange(size_t first, size_t last);
+};
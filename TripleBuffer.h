@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+
+/**
+* Lock-free triple buffer for handing the latest version of a value from one producer thread to one consumer thread.
+* The producer fills the back buffer and publishes it, the consumer takes the most recently published buffer as its front buffer.
+* Neither side waits for the other: the producer can publish while the consumer is reading its front buffer, 
+* and versions the consumer didn't take in time are overwritten.
+*
+* Buffers are reused rather than copied, so the back buffer holds a stale version that must be completely overwritten.
+*
+* Usage:
+*	- Producer: fill getBack(), then call publish()
+*	- Consumer: call update() to take the latest published buffer, then read getFront()
+*/
+template <typename T>
+class TripleBuffer {
+
+protected:
+	// Set on middle while it holds a buffer the consumer hasn't taken
+	static constexpr int NEW_BIT = 4;
+	static constexpr int INDEX_MASK = 3;
+
+	T buffers[3];
+	// Buffer being filled, only used by the producer
+	int back = 0;
+	// Buffer exchanged between the two sides
+	std::atomic<int> middle;
+	// Buffer being read, only used by the consumer
+	int front = 2;
+
+public:
+	TripleBuffer() : middle(1) {}
+	TripleBuffer(const TripleBuffer&) = delete;
+	TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+	/**
+	* Returns: T&  Buffer to fill before the next publish. Producer thread only
+	*/
+	inline T& getBack() { return buffers[back]; }
+	/**
+	* Makes the back buffer the latest version and takes a buffer to fill next. Producer thread only
+	*/
+	inline void publish() {
+		back = middle.exchange(back | NEW_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+	/**
+	* Returns: bool  True if the last published buffer hasn't been taken by the consumer yet, so the next publish would replace it
+	*/
+	inline bool isPending() const { return (middle.load(std::memory_order_acquire) & NEW_BIT) != 0; }
+
+	/**
+	* Takes the latest published buffer as the front buffer, if there's been a publish since the last update. Consumer thread only
+	* Returns: bool  True if the front buffer changed
+	*/
+	inline bool update() {
+		if (!(middle.load(std::memory_order_relaxed) & NEW_BIT)) return false;
+		front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+	/**
+	* Returns: T&  Latest buffer taken by update. Consumer thread only
+	*/
+	inline T& getFront() { return buffers[front]; }
+};
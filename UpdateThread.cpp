@@ -0,0 +1,101 @@
+#include "stdafx.h"
+#include "UpdateThread.h"
+#include "Trace.h"
+#include <chrono>
+
+using std::chrono::steady_clock;
+using std::chrono::microseconds;
+
+
+UpdateThread::UpdateThread(Editor& editor) : editor(editor), running(false) {}
+
+UpdateThread::~UpdateThread() {
+	stop();
+}
+
+unsigned long long UpdateThread::now() {
+	return std::chrono::duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void UpdateThread::start(unsigned long long interval) {
+	stop();
+	this->interval = interval;
+	// Draw the scene as it is until the first update is published
+	editor.capture(snapshots.getBack());
+	snapshots.publish();
+	running = true;
+	worker = std::thread(&UpdateThread::run, this);
+}
+
+void UpdateThread::stop() {
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+		running = false;
+	}
+	wake.notify_one();
+	if (worker.joinable()) worker.join();
+}
+
+void UpdateThread::post(InputEvent event) {
+	event.time = now();
+	while (!events.push(event)) std::this_thread::yield();
+	// Taking the lock means the update thread is either about to check the queue or already waiting, so the wake isn't missed
+	{ std::lock_guard<std::mutex> lock(wakeMutex); }
+	wake.notify_one();
+}
+
+bool UpdateThread::render(Renderer& renderer, RenderSnapshot::Detail detail) {
+	if (snapshots.update()) frontDrawn = false;
+	snapshots.getFront().render(renderer, detail);
+	bool firstDraw = !frontDrawn;
+	frontDrawn = true;
+	return firstDraw;
+}
+
+void UpdateThread::setFrameStats(const FrameScheduler::Stats& stats) {
+	std::lock_guard<std::mutex> lock(frameStatsMutex);
+	frameStats = stats;
+}
+
+unsigned long long UpdateThread::handleEvents() {
+	unsigned long long firstTime = 0;
+	InputEvent event;
+	while (events.pop(event)) {
+		if (!firstTime) firstTime = event.time;
+		editor.dispatch(event);
+	}
+	return firstTime;
+}
+
+void UpdateThread::run() {
+	Trace::setThreadName("Update");
+	// Input time of the last published snapshot
+	unsigned long long publishedInputTime = 0;
+	while (running) {
+		steady_clock::time_point nextUpdate = steady_clock::now() + microseconds(interval);
+		unsigned long long inputTime = handleEvents();
+		editor.update();
+		// Only capture when there's something new to draw. Without new input, wait until the last snapshot has been taken, 
+		// so capturing doesn't take time from drawing when frames take longer to draw than to update
+		if (editor.isDirty() && (inputTime || !snapshots.isPending())) {
+			RenderSnapshot& snapshot = snapshots.getBack();
+			{
+				std::lock_guard<std::mutex> lock(frameStatsMutex);
+				editor.setFrameStats(frameStats);
+			}
+			editor.capture(snapshot);
+			// If the last snapshot hasn't been drawn it's about to be replaced, so this one is the first to show its input.
+			// Tagged after capturing, which resets the time
+			if (publishedInputTime && snapshots.isPending()) inputTime = publishedInputTime;
+			snapshot.setInputTime(inputTime);
+			snapshots.publish();
+			publishedInputTime = inputTime;
+		}
+
+		// Sleep until the next update, cutting the wait short when input arrives
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wake.wait_until(lock, nextUpdate, [this] { return !running || !events.empty(); });
+	}
+	// Handle the last events so none are lost
+	handleEvents();
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include "Editor.h"
+#include "RenderSnapshot.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+#include "FrameScheduler.h"
+
+/**
+* Runs an editor's input handling and scene updates on a background thread, so a slow frame doesn't delay input
+* and slow input handling doesn't delay drawing.
+* Input events are passed to the update thread through a lock-free queue. After handling them it updates the scene
+* and captures a RenderSnapshot into a triple buffer, which the drawing thread draws the latest of without waiting.
+* Every snapshot is tagged with when the oldest input it first shows was received, for measuring input to photon latency.
+*
+* Usage:
+*	- Call start() once the editor has started, then post(event) for each input event and render(renderer) each frame.
+*	  Only one thread may post and only one thread may render
+*	- Call stop() before using the editor on another thread again, e.g. to save it
+*/
+class UpdateThread {
+
+public:
+	// Input events that can be waiting to be handled
+	static constexpr size_t QUEUE_CAPACITY = 4096;
+
+protected:
+	Editor& editor;
+	std::thread worker;
+	std::atomic<bool> running;
+	SpscQueue<InputEvent, QUEUE_CAPACITY> events;
+	TripleBuffer<RenderSnapshot> snapshots;
+	// Wakes the update thread when input is posted or it's stopped, so it can sleep until the next update
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	// Frame times from the drawing thread, passed to the editor before each capture
+	std::mutex frameStatsMutex;
+	FrameScheduler::Stats frameStats;
+	// Microseconds between updates while no input is arriving, input is handled and updated as soon as it arrives
+	unsigned long long interval = 4000;
+	// True if the front snapshot has been drawn before
+	bool frontDrawn = false;
+
+public:
+	/**
+	* Parameter: Editor& editor  Editor to update, which mustn't be used by other threads while running
+	*/
+	UpdateThread(Editor& editor);
+	~UpdateThread();
+
+	/**
+	* Starts the update thread
+	* Parameter: unsigned long long interval  Microseconds between updates while no input is arriving
+	*/
+	void start(unsigned long long interval = 4000);
+	/**
+	* Handles any events still queued, then stops the update thread. Blocks until finished
+	*/
+	void stop();
+
+	/**
+	* Queues an input event to be handled on the update thread, stamping it with the time it was received, and wakes it.
+	* Waits for the update thread to make room if the queue is full
+	* Parameter: InputEvent event  Event to handle
+	*/
+	void post(InputEvent event);
+	/**
+	* Draws the latest snapshot the update thread has captured
+	* Parameter: Renderer& renderer  Renderer to draw with
+	* Parameter: RenderSnapshot::Detail detail  Optional work to do, see FrameScheduler
+	* Returns: bool  True if the snapshot hadn't been drawn before
+	*/
+	bool render(Renderer& renderer, RenderSnapshot::Detail detail = RenderSnapshot::DETAIL_FULL);
+	/**
+	* Sets the frame times the editor's HUD shows from the next snapshot on. Drawing thread only
+	* Parameter: const FrameScheduler::Stats& stats  Frame times of the drawing thread
+	*/
+	void setFrameStats(const FrameScheduler::Stats& stats);
+	/**
+	* Returns: bool  True if a snapshot has been published since the last render, so there's something new to draw
+	*/
+	inline bool hasNewSnapshot() const { return snapshots.isPending(); }
+	/**
+	* Returns: const RenderSnapshot&  Snapshot last drawn by render. Drawing thread only
+	*/
+	inline const RenderSnapshot& getFrontSnapshot() { return snapshots.getFront(); }
+
+	/**
+	* Returns: unsigned long long  Steady clock time in microseconds, the clock event and snapshot input times use
+	*/
+	static unsigned long long now();
+
+protected:
+	/**
+	* Update thread loop, handles queued events, updates the scene and publishes a snapshot until stopped
+	*/
+	void run();
+	/**
+	* Handles the queued events
+	* Returns: unsigned long long  Time the first event was received, or 0 if there were none
+	*/
+	unsigned long long handleEvents();
+};
@@ -4,7 +4,7 @@
 #include <string>
 #include <sstream>
 #include <algorithm>
-#include "glut.h"
+#include <cstring>
 
 /** 
 * Header only static utilities class
@@ -12,18 +12,6 @@
 class Utils {
 
 public:
-	/**
-	* Draws a string using glut
-	* Parameter: std::string str  String to draw
-	*/
-	static inline void renderString(float x, float y, std::string str) {
-		glColor3f(0, 0, 0);
-		glRasterPos2f(x, y);
-		for (unsigned i = 0; i < str.length(); i++) {
-			glutBitmapCharacter(GLUT_BITMAP_HELVETICA_18, str[i]);
-		}
-	}
-
 	/**
 	* Based on http://stackoverflow.com/a/236803
 	* Parameter: const std::string& str  String to split
@@ -54,11 +42,47 @@ public:
 	/**
 	* Removes the specified characters from the string
 	* Parameter: std::string& str String to edit
-	* Parameter: char c[]  Array of characters to remove, these are processed individually
+	* Parameter: const char (&c)[N]  Array of characters to remove, these are processed individually
 	*/
-	static inline void removeFromString(std::string& str, char c[]) {
-		int size = sizeof(c) / sizeof(char);
-		for (int i = 0; i < size; i++) removeFromString(str, c[i]);
+	template <size_t N>
+	static inline void removeFromString(std::string& str, const char (&c)[N]) {
+		for (size_t i = 0; i < N; i++) removeFromString(str, c[i]);
+	}
+
+	/**
+	* 64 bit FNV-1a hash of a block of memory
+	* Parameter: const void* data  Data to hash
+	* Parameter: size_t size  Size of the data in bytes
+	* Parameter: unsigned long long hash  Hash to continue from, so multiple blocks can be hashed together
+	* Returns: unsigned long long  Hash of the data
+	*/
+	static inline unsigned long long hash(const void* data, size_t size, unsigned long long hash = 14695981039346656037ULL) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	/**
+	* FNV-1a style checksum of a block of memory, processed 8 bytes at a time so it's quick enough for whole files
+	* Parameter: const void* data  Data to check
+	* Parameter: size_t size  Size of the data in bytes
+	* Returns: unsigned long long  Checksum of the data
+	*/
+	static inline unsigned long long checksum(const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		unsigned long long hash = 14695981039346656037ULL;
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8) {
+			unsigned long long word;
+			memcpy(&word, bytes + i, 8);
+			hash ^= word;
+			hash *= 1099511628211ULL;
+			hash ^= hash >> 32;
+		}
+		return Utils::hash(bytes + i, size - i, hash);
 	}
 
 	/**
@@ -149,7 +173,7 @@ struct Colour{
 	Colour(std::string colourOutput) {
 		char chars[] = {'(', ')', ' '};
 		Utils::removeFromString(colourOutput, chars);
-		std::vector<std::string>& split = Utils::splitString(colourOutput, ',');
+		std::vector<std::string> split = Utils::splitString(colourOutput, ',');
 		r = std::stof(split[0]);
 		g = std::stof(split[1]);
 		b = std::stof(split[2]);
@@ -0,0 +1,980 @@
+#include "stdafx.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include "Benchmark.h"
+#include "ShapeManager.h"
+#include "SaveManager.h"
+#include "BinarySaveManager.h"
+#include "SceneSnapshot.h"
+#include "RegularPolygon.h"
+#include "SoftwareRenderer.h"
+#include "Editor.h"
+#include "InputCodes.h"
+#include "AllocationCounter.h"
+#include "UpdateThread.h"
+#include "SpscQueue.h"
+#include "TransformBatch.h"
+#include "CpuDispatch.h"
+
+// Verbose to avoid potentially conflicting namespaces
+using std::cout;			using std::endl;
+using std::vector;			using std::string;
+
+// Benchmarks the engine's hot paths on synthetic scenes of increasing size, writing the results as JSON
+
+// Names of the shape types by number of edges
+const char* TYPE_NAMES[] = { "", "", "", "Triangle", "Square", "Pentagon", "Hexagon", "Heptagon", "Octagon", "Nonagon", "Decagon" };
+
+struct BenchOptions {
+	vector<size_t> sizes = { 1000, 10000, 100000, 1000000, 10000000 };
+	string jsonFile = "benchmark.json";
+	// Directory to write the save files timed by the I/O benchmarks to
+	string directory = ".";
+	double minTime = 0.25;
+	bool io = true;
+	// Check the frame and pick paths don't allocate instead of benchmarking
+	bool check = false;
+	// Only check the instruction sets' kernels against the scalar ones, which is much quicker than the full check
+	bool checkKernels = false;
+	// Measure input to photon latency with and without the update thread instead of benchmarking
+	bool latency = false;
+	// Instruction set for the kernels outside the per instruction set benchmarks, empty for the widest supported
+	string isa;
+
+	/**
+	* Reads the program arguments: [--sizes=N,N,...] [--json=FILE] [--dir=DIR] [--time=SECONDS] [--no-io] [--check] [--check-kernels] [--latency] [--isa=NAME]
+	*/
+	bool parse(int argc, char* argv[]) {
+		for (int i = 1; i < argc; i++) {
+			string arg = argv[i];
+			if (arg.compare(0, 8, "--sizes=") == 0) {
+				sizes.clear();
+				for (const string& size : Utils::splitString(arg.substr(8), ',')) sizes.push_back(std::stoull(size));
+			}
+			else if (arg.compare(0, 7, "--json=") == 0) jsonFile = arg.substr(7);
+			else if (arg.compare(0, 6, "--dir=") == 0) directory = arg.substr(6);
+			else if (arg.compare(0, 7, "--time=") == 0) minTime = std::stod(arg.substr(7));
+			else if (arg == "--no-io") io = false;
+			else if (arg == "--check") check = true;
+			else if (arg == "--check-kernels") checkKernels = true;
+			else if (arg == "--latency") latency = true;
+			else if (arg.compare(0, 6, "--isa=") == 0) isa = arg.substr(6);
+			else {
+				cout << "Usage: shapes_bench [--sizes=N,N,...] [--json=FILE] [--dir=DIR] [--time=SECONDS] [--no-io] [--check] [--check-kernels] [--latency] [--isa=NAME]" << endl;
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+/**
+* Adds the shape types saves are loaded with, as the editor does
+*/
+void addTypes(ShapeManager& shapeManager) {
+	for (int edges = 3; edges <= 10; edges++) {
+		shapeManager.addType(new RegularPolygon(TYPE_NAMES[edges], edges, Editor::DEFAULT_RADIUS, Point(0, 0)));
+	}
+}
+
+/**
+* Fills a shape manager with randomly placed, rotated, scaled and coloured regular polygons, in a square centered on 0,0.
+* Shapes cover the scene about once at every size, so the view shows about as many shapes at every scene size
+* Returns: float  Width of the square
+*/
+float generateScene(ShapeManager& shapeManager, size_t count, std::mt19937& random) {
+	GenerationSettings settings;
+	settings.count = count;
+	settings.seed = random();
+	settings.radius = Editor::DEFAULT_RADIUS;
+	float width = shapeManager.generate(settings);
+	shapeManager.updateIndex();
+	return width;
+}
+
+/**
+* Runs the benchmarks that don't depend on the scene
+*/
+void runShapeBenchmarks(Benchmark& benchmark, std::mt19937& random) {
+	const size_t BATCH = 1024;
+	std::uniform_int_distribution<int> edges(3, 10);
+	vector<int> edgeCounts(BATCH);
+	for (int& count : edgeCounts) count = edges(random);
+	Benchmark::printRow(cout, benchmark.measure("RegularPolygon()", 0, BATCH, [&](size_t) {
+		for (int numEdges : edgeCounts) {
+			RegularPolygon polygon(TYPE_NAMES[numEdges], numEdges, Editor::DEFAULT_RADIUS, Point(0, 0));
+		}
+	}));
+}
+
+/**
+* Runs the benchmarks of a scene of a given size
+*/
+/**
+* Makes a concave five pointed star, as a lasso selection might be
+* Parameter: const Point& center  Center of the star
+* Parameter: float radius  Distance from the center to the points
+* Parameter: std::vector<Point>& star  Set to the star's 10 vertices
+*/
+void makeStar(const Point& center, float radius, vector<Point>& star) {
+	star.resize(10);
+	for (size_t i = 0; i < star.size(); i++) {
+		float angle = 3.14159265f * i / 5;
+		float distance = (i % 2)? radius * 0.4f : radius;
+		star[i] = Point(center.x + std::sin(angle) * distance, center.y + std::cos(angle) * distance);
+	}
+}
+
+void runSceneBenchmarks(Benchmark& benchmark, const BenchOptions& options, size_t count, std::mt19937& random) {
+	ShapeManager shapeManager;
+	addTypes(shapeManager);
+	float width = generateScene(shapeManager, count, random);
+	vector<std::unique_ptr<Shape>>& shapes = shapeManager.getShapes();
+
+	// Random shapes and points to test them with, generated up front so only the operation is timed
+	const size_t BATCH = 1024;
+	std::uniform_int_distribution<size_t> shapeIndex(0, count - 1);
+	std::uniform_real_distribution<float> offset(-Editor::DEFAULT_RADIUS * 2, Editor::DEFAULT_RADIUS * 2);
+	std::uniform_real_distribution<float> scenePosition(-width / 2, width / 2);
+	vector<Shape*> targets(BATCH);
+	vector<Point> nearPoints(BATCH);
+	vector<Point> scenePoints(BATCH);
+	for (size_t i = 0; i < BATCH; i++) {
+		targets[i] = shapes[shapeIndex(random)].get();
+		nearPoints[i] = Point(targets[i]->getPosition().x + offset(random), targets[i]->getPosition().y + offset(random));
+		scenePoints[i] = Point(scenePosition(random), scenePosition(random));
+	}
+	size_t hits = 0;
+
+	Benchmark::printRow(cout, benchmark.measure("pointInShape", count, BATCH, [&](size_t) {
+		for (size_t i = 0; i < BATCH; i++) hits += targets[i]->pointInShape(nearPoints[i].x, nearPoints[i].y);
+	}));
+	Benchmark::printRow(cout, benchmark.measure("getShapeAt", count, BATCH, [&](size_t) {
+		for (const Point& point : scenePoints) hits += shapeManager.getShapeAt(point.x, point.y) != nullptr;
+	}));
+	// Picks many points in one call, one op per point
+	const size_t PICK_BATCH = 65536;
+	vector<Point> pickPoints(PICK_BATCH);
+	for (Point& point : pickPoints) point = Point(scenePosition(random), scenePosition(random));
+	vector<Shape*> picked;
+	Benchmark::printRow(cout, benchmark.measure("getShapeAt (64k points)", count, PICK_BATCH, [&](size_t) {
+		for (const Point& point : pickPoints) hits += shapeManager.getShapeAt(point.x, point.y) != nullptr;
+	}));
+	Benchmark::printRow(cout, benchmark.measure("getShapesAt", count, PICK_BATCH, [&](size_t) {
+		shapeManager.getShapesAt(pickPoints, picked);
+		hits += picked[0] != nullptr;
+	}));
+	// Region queries the size of the default view, one op per query, then the whole scene as a marquee around everything would select
+	const float VIEW_WIDTH = Editor::CAMERA_WIDTH, VIEW_HEIGHT = Editor::CAMERA_HEIGHT;
+	vector<Shape*> found;
+	Benchmark::printRow(cout, benchmark.measure("getShapesInRect (view)", count, BATCH, [&](size_t) {
+		for (const Point& point : scenePoints) {
+			shapeManager.getShapesInRect(point, Point(point.x + VIEW_WIDTH, point.y + VIEW_HEIGHT), ShapeManager::INTERSECTING, found);
+			hits += found.size();
+		}
+	}));
+	Benchmark::printRow(cout, benchmark.measure("getShapesInRect (all)", count, 1, [&](size_t) {
+		shapeManager.getShapesInRect(Point(-width, -width), Point(width, width), ShapeManager::CONTAINED, found);
+		hits += found.size();
+	}));
+	vector<Point> lasso;
+	Benchmark::printRow(cout, benchmark.measure("getShapesInPolygon", count, BATCH, [&](size_t) {
+		for (const Point& point : scenePoints) {
+			makeStar(point, VIEW_HEIGHT / 2, lasso);
+			shapeManager.getShapesInPolygon(lasso, ShapeManager::INTERSECTING, found);
+			hits += found.size();
+		}
+	}));
+	// Transforms include updating the spatial index for the moved shapes, as the next pick would
+	Benchmark::printRow(cout, benchmark.measure("rotateBy", count, BATCH, [&](size_t) {
+		for (Shape* shape : targets) shape->rotateBy(1);
+		shapeManager.updateIndex();
+	}));
+	Benchmark::printRow(cout, benchmark.measure("setScale", count, BATCH, [&](size_t batch) {
+		float scale = (batch % 2)? 1.5f : 1;
+		for (Shape* shape : targets) shape->setScale(scale);
+		shapeManager.updateIndex();
+	}));
+
+	// Group changes to a selection of up to 100k shapes spread through the scene, one op per shape, then the same move made
+	// to each shape on its own. Moves include updating the spatial index
+	size_t selectionSize = std::min<size_t>(count, 100000);
+	vector<Shape*> selected(selectionSize);
+	for (size_t i = 0; i < selectionSize; i++) selected[i] = shapes[i * count / selectionSize].get();
+	shapeManager.setSelection(selected);
+	Point pivot = shapeManager.getSelectionCentroid();
+	Benchmark::printRow(cout, benchmark.measure("selection translate", count, selectionSize, [&](size_t batch) {
+		shapeManager.transformSelection(pivot, 0, 1, (batch % 2)? -1.0f : 1.0f, 0);
+		shapeManager.updateIndex();
+	}));
+	Benchmark::printRow(cout, benchmark.measure("translate each selected", count, selectionSize, [&](size_t batch) {
+		for (Shape* shape : selected) shape->translate((batch % 2)? -1.0f : 1.0f, 0);
+		shapeManager.updateIndex();
+	}));
+	Benchmark::printRow(cout, benchmark.measure("selection rotate", count, selectionSize, [&](size_t batch) {
+		shapeManager.transformSelection(pivot, (batch % 2)? -1.0f : 1.0f, 1, 0, 0);
+		shapeManager.updateIndex();
+	}));
+	Benchmark::printRow(cout, benchmark.measure("selection scale", count, selectionSize, [&](size_t batch) {
+		shapeManager.transformSelection(pivot, 0, (batch % 2)? 0.8f : 1.25f, 0, 0);
+		shapeManager.updateIndex();
+	}));
+	Benchmark::printRow(cout, benchmark.measure("selection colour", count, selectionSize, [&](size_t batch) {
+		shapeManager.setSelectionColour((batch % 2)? Colour(1, 0, 0) : Colour(0, 0, 1));
+	}));
+	Benchmark::printRow(cout, benchmark.measure("selection morph", count, selectionSize, [&](size_t batch) {
+		shapeManager.morphSelection(batch % 2 == 1);
+		shapeManager.updateIndex();
+	}));
+	shapeManager.clearSelection();
+
+	// Draws the default view, which shows about the same number of shapes at every scene size
+	SoftwareRenderer renderer(Editor::WINDOW_WIDTH, Editor::WINDOW_HEIGHT, Editor::CAMERA_WIDTH, Editor::CAMERA_HEIGHT);
+	Benchmark::printRow(cout, benchmark.measure("render", count, 1, [&](size_t) {
+		renderer.clear(Colour(1, 1, 1));
+		renderer.setTransform(1, 0, 0);
+		shapeManager.render(renderer);
+	}));
+
+	// The same selection grouped. Moving the group only changes its transform, so one op per move costs the same at any group size,
+	// and drawing composes the group's cached transform into each grouped shape's
+	ShapeGroup* group = shapeManager.createGroup(selected);
+	Benchmark::printRow(cout, benchmark.measure("group translate", count, 1, [&](size_t batch) {
+		group->translate((batch % 2)? -1.0f : 1.0f, 0);
+		shapeManager.updateIndex();
+	}));
+	Benchmark::printRow(cout, benchmark.measure("group rotate", count, 1, [&](size_t batch) {
+		group->rotateBy((batch % 2)? -1.0f : 1.0f);
+		shapeManager.updateIndex();
+	}));
+	Benchmark::printRow(cout, benchmark.measure("getShapeAt (grouped)", count, BATCH, [&](size_t) {
+		for (const Point& point : scenePoints) hits += shapeManager.getShapeAt(point.x, point.y) != nullptr;
+	}));
+	Benchmark::printRow(cout, benchmark.measure("render (grouped)", count, 1, [&](size_t batch) {
+		group->translate((batch % 2)? -1.0f : 1.0f, 0);
+		renderer.clear(Colour(1, 1, 1));
+		renderer.setTransform(1, 0, 0);
+		shapeManager.render(renderer);
+	}));
+	shapeManager.ungroup(group);
+
+	// Transforms every shape's vertices to world coordinates, one op per vertex: per shape with localToWorld as the renderers used to,
+	// then batched with each instruction set the CPU supports, and with the widest across every hardware thread
+	TransformBatch transforms;
+	for (const auto& shape : shapes) {
+		const vector<Point>& vertices = shape->getVertices();
+		transforms.add(vertices.data(), vertices.size(), ShapeTransform(shape->getRotationSin(), shape->getRotationCos(), shape->getScale(), shape->getPosition()));
+	}
+	size_t vertexCount = transforms.getTotalVertexCount();
+	vector<Point> worldVertices(vertexCount);
+	Benchmark::printRow(cout, benchmark.measure("transform localToWorld", count, vertexCount, [&](size_t) {
+		Point* out = worldVertices.data();
+		for (const auto& shape : shapes) {
+			for (const Point& vertex : shape->getVertices()) *out++ = shape->localToWorld(vertex);
+		}
+	}));
+	for (int isa = CpuDispatch::SCALAR; isa < CpuDispatch::ISA_COUNT; isa++) {
+		if (!CpuDispatch::isSupported(static_cast<CpuDispatch::Isa>(isa))) continue;
+		transforms.setIsa(static_cast<CpuDispatch::Isa>(isa));
+		Benchmark::printRow(cout, benchmark.measure(string("transform ") + CpuDispatch::getName(transforms.getIsa()), count, vertexCount, [&](size_t) {
+			transforms.run(); 
+		}));
+	}
+	Benchmark::printRow(cout, benchmark.measure(string("transform ") + CpuDispatch::getName(transforms.getIsa()) + " " 
+		+ std::to_string(std::thread::hardware_concurrency()) + " thr", count, vertexCount, [&](size_t) { transforms.run(0); }));
+
+	if (options.io) {
+		string textFile = options.directory + "/bench_scene.txt";
+		string binaryFile = options.directory + "/bench_scene.bin";
+		Benchmark::printRow(cout, benchmark.measure("save (text)", count, 1, [&](size_t) {
+			SaveManager saveManager;
+			saveManager.startSave(textFile);
+			shapeManager.save(saveManager);
+			saveManager.stopSave();
+		}));
+		Benchmark::printRow(cout, benchmark.measure("load (text)", count, 1, [&](size_t) {
+			SaveManager saveManager;
+			ShapeManager loaded;
+			addTypes(loaded);
+			if (saveManager.load(textFile, std::thread::hardware_concurrency())) loaded.load(saveManager);
+			hits += loaded.getShapes().size();
+		}));
+		Benchmark::printRow(cout, benchmark.measure("save (binary)", count, 1, [&](size_t) {
+			SceneSnapshot snapshot;
+			snapshot.capture(shapeManager);
+			BinarySaveManager binarySaveManager;
+			binarySaveManager.save(binaryFile, snapshot);
+		}));
+		Benchmark::printRow(cout, benchmark.measure("load (binary)", count, 1, [&](size_t) {
+			SceneSnapshot snapshot;
+			BinarySaveManager binarySaveManager;
+			ShapeManager loaded;
+			addTypes(loaded);
+			if (binarySaveManager.load(binaryFile, snapshot)) loaded.restore(snapshot);
+			hits += loaded.getShapes().size();
+		}));
+		std::remove(textFile.c_str());
+		std::remove(binaryFile.c_str());
+	}
+	// Keeps the results of the operations from being optimised away
+	if (hits == 0) cout << "No hits" << endl;
+}
+
+/**
+* Returns: EditorOptions  Options for an editor to run checks on. The save file doesn't exist, so the editor starts empty and never writes it
+*/
+EditorOptions getEditorOptions(const BenchOptions& options) {
+	EditorOptions editorOptions;
+	editorOptions.saveFile = options.directory + "/bench_editor.bin";
+	// The editor loads its save file on start and saves it on exit, so remove the last run's to start on an empty scene
+	std::remove(editorOptions.saveFile.c_str());
+	// Autosaves allocate, and would land in whichever check is running when they're due
+	editorOptions.autosaveInterval = 0;
+	return editorOptions;
+}
+
+/**
+* Gets the window position of the shape nearest the center of the default view, to drag
+*/
+void getDragPosition(Editor& editor, int& x, int& y) {
+	Shape* target = editor.getShapeManager().getShapeAt(0, 0);
+	if (!target) target = editor.getShapeManager().getShapes().front().get();
+	x = static_cast<int>((target->getPosition().x + Editor::CAMERA_WIDTH / 2.0f) * Editor::WINDOW_WIDTH / Editor::CAMERA_WIDTH);
+	y = static_cast<int>((target->getPosition().y + Editor::CAMERA_HEIGHT / 2.0f) * Editor::WINDOW_HEIGHT / Editor::CAMERA_HEIGHT);
+}
+
+/**
+* Gets a window position near the top left of the default view with no shape under it, to start a marquee from
+*/
+void getEmptyPosition(Editor& editor, int& x, int& y) {
+	for (y = 0; y < Editor::WINDOW_HEIGHT / 2; y += 8) {
+		for (x = 0; x < Editor::WINDOW_WIDTH / 2; x += 8) {
+			float worldX = (x * static_cast<float>(Editor::CAMERA_WIDTH) / Editor::WINDOW_WIDTH) - Editor::CAMERA_WIDTH / 2.0f;
+			float worldY = (y * static_cast<float>(Editor::CAMERA_HEIGHT) / Editor::WINDOW_HEIGHT) - Editor::CAMERA_HEIGHT / 2.0f;
+			if (!editor.getShapeManager().getShapeAt(worldX, worldY)) return;
+		}
+	}
+	x = y = 0;
+}
+
+/**
+* Counts the allocations made by an operation, printing them by subsystem if there were any
+* Returns: bool  True if the operation didn't allocate
+*/
+bool expectNoAllocations(const char* name, const std::function<void()>& operation) {
+	size_t before[AllocationCounter::SUBSYSTEM_COUNT];
+	for (int subsystem = 0; subsystem < AllocationCounter::SUBSYSTEM_COUNT; subsystem++) {
+		before[subsystem] = AllocationCounter::getCount(static_cast<AllocationCounter::Subsystem>(subsystem));
+	}
+	operation();
+	bool passed = true;
+	for (int subsystem = 0; subsystem < AllocationCounter::SUBSYSTEM_COUNT; subsystem++) {
+		AllocationCounter::Subsystem type = static_cast<AllocationCounter::Subsystem>(subsystem);
+		size_t allocations = AllocationCounter::getCount(type) - before[subsystem];
+		if (allocations > 0) {
+			cout << "FAIL " << name << ": " << allocations << " " << AllocationCounter::getName(type) << " allocations" << endl;
+			passed = false;
+		}
+	}
+	if (passed) cout << "ok   " << name << endl;
+	return passed;
+}
+
+/**
+* Prints whether a check passed
+* Returns: bool  True if there were no mismatches
+*/
+bool report(const string& name, size_t mismatches, const char* what) {
+	if (mismatches > 0) cout << "FAIL " << name << ": " << mismatches << " " << what << endl;
+	else cout << "ok   " << name << endl;
+	return mismatches == 0;
+}
+
+/**
+* Returns: bool  True if two floats have the same bits, so signed zeros and NaNs compare as well
+*/
+bool identical(float a, float b) {
+	return std::memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+/**
+* Checks that the scalar transform matches Shape::localToWorld within rounding of the shape's size, then that every 
+* instruction set's kernels the CPU supports give identical results to the scalar kernels. The kernels are given the 
+* scene's shapes, random polygons with enough vertices to fill the widest vectors, fills of every length up to a few 
+* vectors and numbers written as saves write them, along with numbers the fast parsing paths leave to std::strtof
+* Returns: bool  True if they all matched
+*/
+bool checkKernels(const vector<std::unique_ptr<Shape>>& shapes, std::mt19937& random) {
+	TransformBatch transforms;
+	for (const auto& shape : shapes) {
+		const vector<Point>& vertices = shape->getVertices();
+		transforms.add(vertices.data(), vertices.size(), ShapeTransform(shape->getRotationSin(), shape->getRotationCos(), shape->getScale(), shape->getPosition()));
+	}
+	transforms.setIsa(CpuDispatch::SCALAR);
+	transforms.run();
+	vector<Point> expectedWorld(transforms.getWorldVertices(0), transforms.getWorldVertices(0) + transforms.getTotalVertexCount());
+	size_t mismatches = 0;
+	for (size_t i = 0; i < shapes.size(); i++) {
+		const vector<Point>& vertices = shapes[i]->getVertices();
+		float tolerance = 1e-5f * (std::abs(shapes[i]->getPosition().x) + std::abs(shapes[i]->getPosition().y) + shapes[i]->getExtent() + 1);
+		for (size_t j = 0; j < vertices.size(); j++) {
+			Point expected = shapes[i]->localToWorld(vertices[j]);
+			const Point& actual = transforms.getWorldVertices(i)[j];
+			if (std::abs(actual.x - expected.x) > tolerance || std::abs(actual.y - expected.y) > tolerance) mismatches++;
+		}
+	}
+	bool passed = report("transform scalar", mismatches, "vertices differ from localToWorld");
+
+	// Random polygons of 1 to 40 vertices, and points in and around them
+	vector<vector<Point>> polygons;
+	vector<Point> points;
+	std::uniform_real_distribution<float> coordinate(-50, 50);
+	for (size_t size = 1; size <= 40; size++) {
+		for (int i = 0; i < 8; i++) {
+			vector<Point> polygon(size);
+			for (Point& vertex : polygon) vertex = Point(coordinate(random), coordinate(random));
+			polygons.push_back(polygon);
+		}
+	}
+	for (const auto& shape : shapes) polygons.push_back(shape->getVertices());
+	// 253 points, so the batched point tests have a partial vector left over at every width
+	for (int i = 0; i < 253; i++) points.push_back(Point(coordinate(random), coordinate(random)));
+	vector<float> xs, ys;
+	for (const Point& point : points) {
+		xs.push_back(point.x);
+		ys.push_back(point.y);
+	}
+	vector<unsigned char> inside(points.size());
+	// Numbers as saves write them, then ones with exponents, too many digits or other forms the fast paths leave to strtof
+	vector<string> numbers = { "(0, 0)", "-0", "+5", ".5", "5.", ".", "-", "-.", "1e-05", "2.5E3", "0x1p3", "123456789", "1234567.5", 
+		"0.000000000001", "-inf", "nan", "1.2.3", "(1,2)(3,4)", "999999.9", "16777217", "0.1 0.2 0.3 0.7 0.9" };
+	std::uniform_real_distribution<float> value(-1000, 1000);
+	std::uniform_int_distribution<int> exponent(-8, 8);
+	for (int i = 0; i < 4096; i++) {
+		std::ostringstream text;
+		text << "(" << value(random) * std::pow(10.0f, static_cast<float>(exponent(random))) << ", " << value(random) << ", " << value(random) / 1000 << ")";
+		numbers.push_back(text.str());
+	}
+
+	const CpuDispatch::Kernels& scalar = CpuDispatch::get(CpuDispatch::SCALAR);
+	mismatches = 0;
+	for (const vector<Point>& polygon : polygons) {
+		scalar.pointsInPolygon(polygon.data(), polygon.size(), xs.data(), ys.data(), points.size(), inside.data());
+		for (size_t i = 0; i < points.size(); i++) mismatches += scalar.pointInPolygon(polygon.data(), polygon.size(), points[i].x, points[i].y) != (inside[i] != 0);
+	}
+	passed &= report("pointsInPolygon scalar", mismatches, "points differ from pointInPolygon");
+
+	for (int isa = CpuDispatch::SSE2; isa < CpuDispatch::ISA_COUNT; isa++) {
+		if (!CpuDispatch::isSupported(static_cast<CpuDispatch::Isa>(isa))) continue;
+		const CpuDispatch::Kernels& kernels = CpuDispatch::get(static_cast<CpuDispatch::Isa>(isa));
+		string name = CpuDispatch::getName(static_cast<CpuDispatch::Isa>(isa));
+
+		transforms.setIsa(static_cast<CpuDispatch::Isa>(isa));
+		transforms.run(2);
+		mismatches = 0;
+		for (size_t i = 0; i < expectedWorld.size(); i++) {
+			const Point& actual = transforms.getWorldVertices(0)[i];
+			if (!identical(actual.x, expectedWorld[i].x) || !identical(actual.y, expectedWorld[i].y)) mismatches++;
+		}
+		passed &= report("transform " + name, mismatches, "vertices differ from scalar");
+
+		size_t pointMismatches = 0, pointsMismatches = 0, boundsMismatches = 0;
+		for (const vector<Point>& polygon : polygons) {
+			kernels.pointsInPolygon(polygon.data(), polygon.size(), xs.data(), ys.data(), points.size(), inside.data());
+			for (size_t i = 0; i < points.size(); i++) {
+				bool expected = scalar.pointInPolygon(polygon.data(), polygon.size(), points[i].x, points[i].y);
+				pointMismatches += expected != kernels.pointInPolygon(polygon.data(), polygon.size(), points[i].x, points[i].y);
+				pointsMismatches += expected != (inside[i] != 0);
+			}
+			// Bounds are compared by value, the smaller of a signed zero pair can be either
+			Point expectedMin, expectedMax, min, max;
+			scalar.bounds(polygon.data(), polygon.size(), expectedMin, expectedMax);
+			kernels.bounds(polygon.data(), polygon.size(), min, max);
+			boundsMismatches += min.x != expectedMin.x || min.y != expectedMin.y || max.x != expectedMax.x || max.y != expectedMax.y;
+		}
+		passed &= report("pointInPolygon " + name, pointMismatches, "points differ from scalar");
+		passed &= report("pointsInPolygon " + name, pointsMismatches, "points differ from scalar");
+		passed &= report("bounds " + name, boundsMismatches, "polygons differ from scalar");
+
+		// Fills of each length at each offset into a row, checked along with the pixels around them
+		mismatches = 0;
+		const unsigned char rgb[3] = { 12, 34, 56 };
+		for (size_t length = 0; length <= 200; length++) {
+			for (size_t offset = 0; offset < 4; offset++) {
+				vector<unsigned char> expected(3 * 208, 255), actual(3 * 208, 255);
+				scalar.fillPixels(&expected[offset * 3], length, rgb);
+				kernels.fillPixels(&actual[offset * 3], length, rgb);
+				mismatches += expected != actual;
+			}
+		}
+		passed &= report("fillPixels " + name, mismatches, "fills differ from scalar");
+
+		mismatches = 0;
+		for (const string& text : numbers) {
+			float expected[8] = {}, actual[8] = {};
+			size_t expectedCount = scalar.parseFloats(text.c_str(), text.c_str() + text.size(), expected, 8);
+			size_t actualCount = kernels.parseFloats(text.c_str(), text.c_str() + text.size(), actual, 8);
+			bool same = expectedCount == actualCount;
+			for (size_t i = 0; i < expectedCount && same; i++) same = identical(expected[i], actual[i]);
+			mismatches += !same;
+		}
+		passed &= report("parseFloats " + name, mismatches, "values differ from scalar");
+	}
+	return passed;
+}
+
+/**
+* Checks that picking many points at once finds the same shapes as picking them one at a time, split between threads
+* Returns: bool  True if every point's shape matched
+*/
+bool checkBatchPicking(ShapeManager& shapeManager, const vector<Point>& scenePoints) {
+	// Points on shapes as well as anywhere in the scene, so most have a shape and many have several
+	vector<Point> points = scenePoints;
+	for (const auto& shape : shapeManager.getShapes()) {
+		if (points.size() >= scenePoints.size() * 2) break;
+		points.push_back(shape->getPosition());
+	}
+	vector<Shape*> results;
+	shapeManager.getShapesAt(points, results, 3);
+	size_t mismatches = 0;
+	for (size_t i = 0; i < points.size(); i++) mismatches += results[i] != shapeManager.getShapeAt(points[i].x, points[i].y);
+	return report("getShapesAt", mismatches, "points differ from getShapeAt");
+}
+
+/**
+* Checks that region queries find the same shapes as testing every shape, for view sized rectangles and concave polygons 
+* in both modes, and a rectangle around the whole scene
+* Returns: bool  True if every query matched
+*/
+bool checkRegionQueries(ShapeManager& shapeManager, const vector<Point>& scenePoints, float width) {
+	vector<std::unique_ptr<Shape>>& shapes = shapeManager.getShapes();
+	vector<Shape*> results, expected;
+	size_t rectMismatches = 0, polygonMismatches = 0;
+	auto check = [&](const vector<Point>& polygon, ShapeManager::RegionMode mode, size_t& mismatches) {
+		// Shapes are stored back to front, the order queries return them in
+		expected.clear();
+		for (const auto& shape : shapes) {
+			bool inside = (mode == ShapeManager::CONTAINED)? shape->inPolygon(polygon.data(), polygon.size()) 
+				: shape->intersectsPolygon(polygon.data(), polygon.size());
+			if (inside) expected.push_back(shape.get());
+		}
+		mismatches += results != expected;
+	};
+	vector<Point> polygon(4);
+	for (size_t i = 0; i < scenePoints.size() && i < 16; i++) {
+		const Point& corner = scenePoints[i];
+		Point opposite(corner.x + Editor::CAMERA_WIDTH, corner.y - Editor::CAMERA_HEIGHT);
+		polygon = { corner, Point(opposite.x, corner.y), opposite, Point(corner.x, opposite.y) };
+		for (ShapeManager::RegionMode mode : { ShapeManager::INTERSECTING, ShapeManager::CONTAINED }) {
+			shapeManager.getShapesInRect(corner, opposite, mode, results, 3);
+			check(polygon, mode, rectMismatches);
+			makeStar(corner, Editor::CAMERA_HEIGHT / 2, polygon);
+			shapeManager.getShapesInPolygon(polygon, mode, results, 3);
+			check(polygon, mode, polygonMismatches);
+			polygon = { corner, Point(opposite.x, corner.y), opposite, Point(corner.x, opposite.y) };
+		}
+	}
+	shapeManager.getShapesInRect(Point(-width, -width), Point(width, width), ShapeManager::CONTAINED, results);
+	rectMismatches += results.size() != shapes.size();
+	return report("getShapesInRect", rectMismatches, "queries differ from testing every shape") 
+		& report("getShapesInPolygon", polygonMismatches, "queries differ from testing every shape");
+}
+
+/**
+* Checks that a group transform gives the same shapes on several threads as on one, that it moves the selection rigidly,
+* that the spatial index is updated for the moved shapes, and that morphing the selection forwards then back restores it
+* Returns: bool  True if every check passed
+*/
+bool checkSelection(ShapeManager& shapeManager) {
+	vector<std::unique_ptr<Shape>>& shapes = shapeManager.getShapes();
+	vector<Shape*> selected;
+	for (size_t i = 0; i < shapes.size(); i += 4) selected.push_back(shapes[i].get());
+	shapeManager.setSelection(selected);
+	struct State {
+		Point position;
+		float rotation, scale;
+		string name;
+	};
+	auto capture = [&](vector<State>& states) {
+		states.resize(selected.size());
+		for (size_t i = 0; i < selected.size(); i++) {
+			states[i] = State{ selected[i]->getPosition(), selected[i]->getRotation(), selected[i]->getScale(), selected[i]->getName() };
+		}
+	};
+	vector<State> before, single, threaded;
+	capture(before);
+	const float ANGLE = 30, FACTOR = 1.5f;
+	Point pivot = shapeManager.getSelectionCentroid();
+	shapeManager.transformSelection(pivot, ANGLE, FACTOR, 10, -5, 1);
+	capture(single);
+	for (size_t i = 0; i < selected.size(); i++) selected[i]->setTransform(before[i].position, before[i].rotation, before[i].scale);
+	shapeManager.transformSelection(pivot, ANGLE, FACTOR, 10, -5, 3);
+	capture(threaded);
+
+	size_t threadMismatches = 0, rigidMismatches = 0, indexMismatches = 0, morphMismatches = 0;
+	for (size_t i = 0; i < selected.size(); i++) {
+		threadMismatches += !identical(single[i].position.x, threaded[i].position.x) || !identical(single[i].position.y, threaded[i].position.y)
+			|| !identical(single[i].rotation, threaded[i].rotation) || !identical(single[i].scale, threaded[i].scale);
+		// Distances between shapes are scaled by the factor and nothing else
+		if (i == 0) continue;
+		auto distance = [](const Point& a, const Point& b) { return std::hypot(a.x - b.x, a.y - b.y); };
+		float expected = distance(before[i].position, before[i - 1].position) * FACTOR;
+		float actual = distance(threaded[i].position, threaded[i - 1].position);
+		rigidMismatches += std::abs(actual - expected) > 1e-3f * std::max(expected, 1.0f);
+	}
+	// Picks at the moved shapes must find what testing every shape from the top finds
+	for (size_t i = 0; i < selected.size() && i < 4096; i++) {
+		Point point = selected[i]->getPosition();
+		Shape* top = nullptr;
+		for (auto it = shapes.rbegin(); it != shapes.rend() && !top; it++) {
+			if ((*it)->pointInShape(point.x, point.y)) top = it->get();
+		}
+		indexMismatches += shapeManager.getShapeAt(point.x, point.y) != top;
+	}
+	shapeManager.morphSelection(false, 3);
+	shapeManager.morphSelection(true, 3);
+	for (size_t i = 0; i < selected.size(); i++) morphMismatches += selected[i]->getName() != before[i].name;
+	shapeManager.clearSelection();
+	return report("transformSelection threads", threadMismatches, "shapes differ between 1 and 3 threads")
+		& report("transformSelection rigid", rigidMismatches, "distances between shapes weren't scaled by the factor")
+		& report("transformSelection index", indexMismatches, "picks differ from testing every shape")
+		& report("morphSelection", morphMismatches, "shapes weren't restored by morphing forwards and back");
+}
+
+/**
+* Checks that grouping shapes, and ungrouping them, doesn't move them, that transforming groups doesn't change their shapes,
+* and that picks and region queries find the same grouped shapes as testing every shape after nested groups are transformed
+* Returns: bool  True if every check passed
+*/
+bool checkGroups(ShapeManager& shapeManager, const vector<Point>& scenePoints) {
+	vector<std::unique_ptr<Shape>>& shapes = shapeManager.getShapes();
+	// Ungrouping wraps rotations to a turn, which moves vertices by a little, as the shapes' 3.142 isn't quite pi
+	vector<float> turnError;
+	auto worldVertices = [&](vector<Point>& vertices) {
+		vertices.clear();
+		turnError.clear();
+		for (const auto& shape : shapes) {
+			ShapeTransform transform = shape->getWorldTransform();
+			float error = 0.001f * std::abs(shape->getWorldScale());
+			for (const Point& vertex : shape->getVertices()) {
+				vertices.push_back(transform.apply(vertex));
+				turnError.push_back(error * (std::abs(vertex.x) + std::abs(vertex.y)));
+			}
+		}
+	};
+	auto countMoved = [&](const vector<Point>& a, const vector<Point>& b) {
+		size_t moved = 0;
+		for (size_t i = 0; i < a.size(); i++) {
+			float tolerance = 1e-4f * (1 + std::abs(a[i].x) + std::abs(a[i].y)) + turnError[i];
+			moved += std::abs(a[i].x - b[i].x) > tolerance || std::abs(a[i].y - b[i].y) > tolerance;
+		}
+		return moved;
+	};
+
+	// Alternate thirds of the shapes in two groups, nested in a third
+	vector<Shape*> first, second;
+	for (size_t i = 0; i < shapes.size(); i += 3) ((i / 3 % 2)? second : first).push_back(shapes[i].get());
+	vector<Point> ungrouped, grouped;
+	worldVertices(ungrouped);
+	ShapeGroup* firstGroup = shapeManager.createGroup(first);
+	ShapeGroup* secondGroup = shapeManager.createGroup(second);
+	ShapeGroup* parent = shapeManager.createGroup({ first.front(), second.front() });
+	worldVertices(grouped);
+	size_t groupingMismatches = countMoved(ungrouped, grouped);
+	bool nested = firstGroup->getParent() == parent && secondGroup->getParent() == parent && parent->getShapeCount() == first.size() + second.size();
+
+	// Transforming the groups only changes the groups
+	vector<Point> localPositions;
+	for (const auto& shape : shapes) localPositions.push_back(shape->getPosition());
+	parent->rotateBy(30);
+	parent->setScale(1.5f);
+	parent->translate(10, -5);
+	firstGroup->rotateBy(-10);
+	size_t changedShapes = 0;
+	for (size_t i = 0; i < shapes.size(); i++) {
+		changedShapes += !identical(shapes[i]->getPosition().x, localPositions[i].x) || !identical(shapes[i]->getPosition().y, localPositions[i].y);
+	}
+
+	// Picks and region queries against testing every shape from the top, with points converted to each shape's group
+	auto inShape = [](Shape& shape, const Point& point) {
+		Point local = shape.getGroup()? shape.getGroup()->worldToLocal(point) : point;
+		return shape.pointInShape(local.x, local.y);
+	};
+	size_t pickMismatches = 0, batchMismatches = 0, regionMismatches = 0;
+	vector<Shape*> results, expected;
+	for (const Point& point : scenePoints) {
+		Shape* top = nullptr;
+		for (auto it = shapes.rbegin(); it != shapes.rend() && !top; it++) {
+			if (inShape(**it, point)) top = it->get();
+		}
+		pickMismatches += shapeManager.getShapeAt(point.x, point.y) != top;
+	}
+	shapeManager.getShapesAt(scenePoints, results, 3);
+	for (size_t i = 0; i < scenePoints.size(); i++) batchMismatches += results[i] != shapeManager.getShapeAt(scenePoints[i].x, scenePoints[i].y);
+	vector<Point> polygon(4), local(4);
+	for (size_t i = 0; i < scenePoints.size() && i < 16; i++) {
+		const Point& corner = scenePoints[i];
+		Point opposite(corner.x + Editor::CAMERA_WIDTH, corner.y - Editor::CAMERA_HEIGHT);
+		polygon = { corner, Point(opposite.x, corner.y), opposite, Point(corner.x, opposite.y) };
+		for (ShapeManager::RegionMode mode : { ShapeManager::INTERSECTING, ShapeManager::CONTAINED }) {
+			shapeManager.getShapesInRect(corner, opposite, mode, results, 3);
+			expected.clear();
+			for (const auto& shape : shapes) {
+				for (size_t j = 0; j < 4; j++) local[j] = shape->getGroup()? shape->getGroup()->worldToLocal(polygon[j]) : polygon[j];
+				bool inside = (mode == ShapeManager::CONTAINED)? shape->inPolygon(local.data(), 4) : shape->intersectsPolygon(local.data(), 4);
+				if (inside) expected.push_back(shape.get());
+			}
+			regionMismatches += results != expected;
+		}
+	}
+
+	// Ungrouping keeps the transformed world transforms
+	worldVertices(grouped);
+	shapeManager.ungroup(parent);
+	shapeManager.ungroup(firstGroup);
+	shapeManager.ungroup(secondGroup);
+	worldVertices(ungrouped);
+	size_t ungroupingMismatches = countMoved(grouped, ungrouped);
+	size_t leftGrouped = shapeManager.getGroups().size();
+	for (const auto& shape : shapes) leftGrouped += shape->getGroup() != nullptr;
+	return report("createGroup", groupingMismatches + (nested? 0 : 1), "vertices moved by grouping, or the groups weren't nested")
+		& report("group transforms", changedShapes, "shapes changed by transforming their groups")
+		& report("getShapeAt (grouped)", pickMismatches, "picks differ from testing every shape")
+		& report("getShapesAt (grouped)", batchMismatches, "points differ from getShapeAt")
+		& report("getShapesInRect (grouped)", regionMismatches, "queries differ from testing every shape")
+		& report("ungroup", ungroupingMismatches + leftGrouped, "vertices moved by ungrouping, or groups were left");
+}
+
+/**
+* Checks that drawing frames, picking, dragging shapes, dragging a marquee selection, dragging the selection and dragging a group don't allocate, on an editor with a generated scene of each size.
+* Each check is warmed up first, so buffers that grow once and are then reused don't count.
+* Also checks every instruction set's kernels against the scalar ones, batched picking against single picks 
+* region queries against testing every shape, group transforms on one thread against several and grouped shapes, on each scene
+* Returns: int  Exit code, 0 if nothing allocated and the kernels and picks matched
+*/
+int checkAllocations(const BenchOptions& options, std::mt19937& random) {
+	const int FRAMES = 60;
+	bool passed = true;
+	for (size_t size : options.sizes) {
+		if (size == 0) continue;
+		cout << size << " shapes" << endl;
+		Editor editor(getEditorOptions(options));
+		editor.start();
+		float width = generateScene(editor.getShapeManager(), size, random);
+		SoftwareRenderer renderer(Editor::WINDOW_WIDTH, Editor::WINDOW_HEIGHT, Editor::CAMERA_WIDTH, Editor::CAMERA_HEIGHT);
+		auto frame = [&]() {
+			editor.update();
+			editor.render(renderer);
+		};
+
+		// Points in and around the view to pick at
+		std::uniform_real_distribution<float> scenePosition(-width / 2, width / 2);
+		vector<Point> points(1024);
+		for (Point& point : points) point = Point(scenePosition(random), scenePosition(random));
+		size_t hits = 0;
+		auto pick = [&]() {
+			for (const Point& point : points) hits += editor.getShapeManager().getShapeAt(point.x, point.y) != nullptr;
+		};
+
+		int dragX, dragY;
+		getDragPosition(editor, dragX, dragY);
+		auto drag = [&]() {
+			editor.onMouse(InputCodes::RIGHT_BUTTON, InputCodes::BUTTON_DOWN, dragX, dragY);
+			for (int i = 0; i < FRAMES; i++) {
+				editor.onMotion(dragX + i % 10, dragY + i % 10);
+				editor.onMotion(dragX + i % 10 + 1, dragY + i % 10);
+				frame();
+			}
+			// Ends where it started, so each drag moves shapes through the same index cells
+			editor.onMotion(dragX, dragY);
+			frame();
+			editor.onMouse(InputCodes::RIGHT_BUTTON, InputCodes::BUTTON_UP, dragX, dragY);
+			frame();
+		};
+		// Drags a marquee from empty canvas near the top left of the window to the bottom right, selecting the shapes inside
+		int marqueeX = 0, marqueeY = 0;
+		getEmptyPosition(editor, marqueeX, marqueeY);
+		auto marquee = [&]() {
+			editor.onMouse(InputCodes::RIGHT_BUTTON, InputCodes::BUTTON_DOWN, marqueeX, marqueeY);
+			for (int i = 1; i <= FRAMES; i++) {
+				editor.onMotion(marqueeX + (Editor::WINDOW_WIDTH - marqueeX) * i / FRAMES, marqueeY + (Editor::WINDOW_HEIGHT - marqueeY) * i / FRAMES);
+				frame();
+			}
+			editor.onMouse(InputCodes::RIGHT_BUTTON, InputCodes::BUTTON_UP, Editor::WINDOW_WIDTH, Editor::WINDOW_HEIGHT);
+			frame();
+		};
+
+		// Warm up. The marquee selects the dragged shape, so the second drag moves the whole selection
+		for (int i = 0; i < FRAMES; i++) frame();
+		pick();
+		drag();
+		marquee();
+		drag();
+		editor.getShapeManager().clearSelection();
+
+		passed &= expectNoAllocations("idle frames", [&]() { for (int i = 0; i < FRAMES; i++) frame(); });
+		passed &= expectNoAllocations("getShapeAt", pick);
+		passed &= expectNoAllocations("drag", drag);
+		passed &= expectNoAllocations("marquee", marquee);
+		passed &= report("marquee selection", editor.getShapeManager().getSelection().size() < 2? 1 : 0, "drags selected fewer than 2 shapes");
+		passed &= expectNoAllocations("group drag", drag);
+		// Grouping the selection, so dragging the shape drags the group
+		ShapeGroup* group = editor.getShapeManager().groupSelection();
+		drag();
+		passed &= expectNoAllocations("grouped drag", drag);
+		editor.getShapeManager().ungroup(group);
+		passed &= checkKernels(editor.getShapeManager().getShapes(), random);
+		passed &= checkBatchPicking(editor.getShapeManager(), points);
+		passed &= checkRegionQueries(editor.getShapeManager(), points, width);
+		passed &= checkSelection(editor.getShapeManager());
+		passed &= checkGroups(editor.getShapeManager(), points);
+		// Keeps the picks from being optimised away
+		if (hits == 0) cout << "No hits" << endl;
+	}
+	return passed? 0 : 1;
+}
+
+/**
+* Checks every supported instruction set's kernels against the scalar ones on a generated scene of each size, see checkKernels
+* Returns: int  Exit code, 0 if the kernels matched
+*/
+int checkAllKernels(const BenchOptions& options, std::mt19937& random) {
+	bool passed = true;
+	for (size_t size : options.sizes) {
+		if (size == 0) continue;
+		cout << size << " shapes" << endl;
+		ShapeManager shapeManager;
+		generateScene(shapeManager, size, random);
+		passed &= checkKernels(shapeManager.getShapes(), random);
+	}
+	return passed? 0 : 1;
+}
+
+/**
+* Drags a shape for a couple of seconds from an input thread, as a mouse sending motion at 250Hz would, while drawing 
+* the scene as often as possible with the software renderer. Reports how long input takes to reach the screen: 
+* for each frame that shows new input, the time from the oldest input it shows being received to the frame being drawn.
+* Runs the editor on one thread, where input waits for the frame being drawn, then with an UpdateThread.
+* The latency excludes the buffer swap and display, which the software renderer doesn't have
+* Returns: int  Exit code
+*/
+int measureLatency(const BenchOptions& options, std::mt19937& random) {
+	const unsigned long long MOTION_INTERVAL = 4000;
+	const int MOTION_EVENTS = 500;
+	cout << std::left << std::setw(14) << "Mode" << std::right << std::setw(10) << "Shapes" << std::setw(10) << "Frames/s"
+		<< std::setw(10) << "Mean ms" << std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99" << std::setw(10) << "Max" << endl;
+	for (size_t size : options.sizes) {
+		if (size == 0) continue;
+		for (int split = 0; split <= 1; split++) {
+			Editor editor(getEditorOptions(options));
+			editor.start();
+			generateScene(editor.getShapeManager(), size, random);
+			SoftwareRenderer renderer(Editor::WINDOW_WIDTH, Editor::WINDOW_HEIGHT, Editor::CAMERA_WIDTH, Editor::CAMERA_HEIGHT);
+			int dragX, dragY;
+			getDragPosition(editor, dragX, dragY);
+
+			// Without the update thread, events wait in a queue until the frame being drawn finishes, as with GLUT
+			SpscQueue<InputEvent, UpdateThread::QUEUE_CAPACITY> queue;
+			UpdateThread updateThread(editor);
+			auto post = [&](InputEvent event) {
+				if (split) {
+					updateThread.post(event);
+				} else {
+					event.time = UpdateThread::now();
+					while (!queue.push(event)) std::this_thread::yield();
+				}
+			};
+			std::atomic<bool> inputDone(false);
+			if (split) updateThread.start();
+			unsigned long long startTime = UpdateThread::now();
+			std::thread input([&]() {
+				post(InputEvent(InputEvent::MOUSE, InputCodes::RIGHT_BUTTON, InputCodes::BUTTON_DOWN, dragX, dragY));
+				for (int i = 1; i <= MOTION_EVENTS; i++) {
+					std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::microseconds(startTime + i * MOTION_INTERVAL)));
+					post(InputEvent(InputEvent::MOTION, dragX + i % 100, dragY + i % 50));
+				}
+				post(InputEvent(InputEvent::MOUSE, InputCodes::RIGHT_BUTTON, InputCodes::BUTTON_UP, dragX, dragY));
+				inputDone = true;
+			});
+
+			vector<double> latencies;
+			size_t frames = 0;
+			while (!inputDone) {
+				unsigned long long inputTime = 0;
+				if (split) {
+					if (updateThread.render(renderer)) inputTime = updateThread.getFrontSnapshot().getInputTime();
+				} else {
+					InputEvent event;
+					while (queue.pop(event)) {
+						if (!inputTime) inputTime = event.time;
+						editor.dispatch(event);
+					}
+					editor.update();
+					editor.render(renderer);
+				}
+				frames++;
+				if (inputTime) latencies.push_back((UpdateThread::now() - inputTime) / 1000.0);
+			}
+			double seconds = (UpdateThread::now() - startTime) / 1e6;
+			input.join();
+			updateThread.stop();
+
+			std::sort(latencies.begin(), latencies.end());
+			auto percentile = [&](double p) { return latencies.empty()? 0 : latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))]; };
+			double mean = 0;
+			for (double latency : latencies) mean += latency;
+			if (!latencies.empty()) mean /= latencies.size();
+			cout << std::left << std::setw(14) << (split? "update thread" : "single thread") << std::right << std::setw(10) << size
+				<< std::fixed << std::setprecision(1) << std::setw(10) << frames / seconds << std::setprecision(3)
+				<< std::setw(10) << mean << std::setw(10) << percentile(0.5) << std::setw(10) << percentile(0.95)
+				<< std::setw(10) << percentile(0.99) << std::setw(10) << (latencies.empty()? 0 : latencies.back()) << std::defaultfloat << endl;
+		}
+	}
+	return 0;
+}
+
+
+int main(int argc, char* argv[]) {
+	BenchOptions options;
+	if (!options.parse(argc, argv)) return 1;
+	if (!options.isa.empty() && !CpuDispatch::select(options.isa)) {
+		cout << "Instruction set " << options.isa << " isn't supported" << endl;
+		return 1;
+	}
+	cout << "Kernels: " << CpuDispatch::getName(CpuDispatch::getIsa()) << " (widest supported " << CpuDispatch::getName(CpuDispatch::getDetected()) << ")" << endl;
+	Benchmark benchmark(options.minTime);
+	// Fixed seed so every run benchmarks the same scenes
+	std::mt19937 random(1);
+	if (options.check) return checkAllocations(options, random);
+	if (options.checkKernels) return checkAllKernels(options, random);
+	if (options.latency) return measureLatency(options, random);
+
+	Benchmark::printHeader(cout);
+	runShapeBenchmarks(benchmark, random);
+	for (size_t size : options.sizes) {
+		if (size > 0) runSceneBenchmarks(benchmark, options, size, random);
+	}
+
+	std::ofstream json(options.jsonFile);
+	benchmark.writeJson(json);
+	if (!json) {
+		cout << "Couldn't write results to " << options.jsonFile << endl;
+		return 1;
+	}
+	cout << "Wrote results to " << options.jsonFile << endl;
+	return 0;
+}
@@ -0,0 +1,25 @@
+#include "stdafx.h"
+#include <iostream>
+#include "Editor.h"
+#include "SoftwareRenderer.h"
+
+// Entry point without a window or OpenGL, for replaying recorded sessions and generating scenes on any platform
+
+
+int main(int argc, char* argv[]) {
+	EditorOptions options;
+	if (!options.parse(argc, argv)) return 1;
+	if (options.generation.count > 0) {
+		Editor generator(options);
+		return generator.generate();
+	}
+	if (options.replayFile.empty()) {
+		std::cout << "Usage: shapes_headless --replay=FILE [--realtime] [--draw]" << std::endl;
+		std::cout << "       shapes_headless --generate=N [generation options] [--compact] [--tiles] save_file" << std::endl;
+		return 1;
+	}
+	Editor editor(options);
+	// Frames are drawn at the default window size
+	SoftwareRenderer renderer(Editor::WINDOW_WIDTH, Editor::WINDOW_HEIGHT, Editor::CAMERA_WIDTH, Editor::CAMERA_HEIGHT);
+	return editor.replay(options.drawReplay? &renderer : nullptr);
+}
@@ -1,58 +1,38 @@
 #include "stdafx.h"
+#ifdef _WIN32
 #include <Windows.h>
-#include <iostream>
+#endif
 #include <memory>
 #include <string>
-#include <map>
-#include <gl/GL.h>
-#include <gl/GLU.h>
+// The bundled GLUT header is for Windows, elsewhere the system's matches its GL headers
+#ifdef _WIN32
 #include "glut.h"
-#include "Utils.h"
-#include "ShapeManager.h"
-#include "Pentagon.h"
-#include "Triangle.h"
-#include "Square.h"
-#include "Mouse.h"
-#include "Keyboard.h"
-#include "SaveManager.h"
+#else
+#include <GL/glut.h>
+#endif
+#include "Editor.h"
+#include "GLRenderer.h"
+#include "UpdateThread.h"
+#include "FrameScheduler.h"
+#include "Trace.h"
 
 // Verbose to avoid potentially conflicting namespaces
-using std::cout;			using std::endl;
-using std::vector;			using std::unique_ptr;
-using std::map;				using std::string;
+using std::unique_ptr;		using std::string;
 
 
-struct SceneSettings {
-	float zoom = 1; // View zoom modifier
-	int panX, panY = 0; // View pan location
-};
-
-const int CAMERA_WIDTH = 1000;
-const int CAMERA_HEIGHT = CAMERA_WIDTH / (16.0 / 9); // Optimise for 16:9 resolutions
-const int DEFAULT_RADIUS = 25; // Used when adding and morphing shapes
-
-// Actions used for key and mouse mappings
-enum Action {
-	A_ADD, A_DUPLICATE, A_DELETE, A_ZOOM, A_PAN, A_TRANSLATE, A_SCALE, A_ROTATE, 
-	A_COLOUR_RED, A_COLOUR_GREEN, A_COLOUR_BLUE, A_MORPH_UP, A_MORPH_DOWN, A_MODIFIER, A_CLEAR
-};
-map<Action, char> keyMappings;
-map<Action, int> mouseMappings;
-
-SceneSettings sceneSettings;
-SaveManager saveManager;
-ShapeManager shapeManager;
-Mouse mouse;
-Keyboard keyboard;
-Shape* selectedShape;
-Shape* lastSelectedShape;
-// Vector of different shape types used for cycling through different shapes
-vector<unique_ptr<Shape>> shapeTypes;
+// GLUT frontend for the editor, which holds all of the program's state
+unique_ptr<Editor> editor;
+// Handles input and updates the editor on its own thread, unless running with --single-thread
+unique_ptr<UpdateThread> updateThread;
+// Paces updates and frames, created once the options are read
+unique_ptr<FrameScheduler> scheduler;
+GLRenderer glRenderer;
 
 void display();
 void reshape(int w, int h);
 void idle();
-void init();
+void frameTimer(int value);
+bool hasNewFrame();
 void mouseFunc(int button, int state, int x, int y);
 void mouseMotion(int x, int y);
 void keyboardFunc(unsigned char key, int x, int y);
@@ -60,21 +40,38 @@ void keyboardUpFunc(unsigned char key, int x, int y);
 void specialFunc(int key, int x, int y);
 void specialUpFunc(int key, int x, int y);
 void save();
-void load();
+void handle(const InputEvent& event);
 
 
 int main(int argc, char* argv[]) {
+	EditorOptions options;
+	// Replays and scene generation run without a window, so glut isn't initialised
+	for (int i = 1; i < argc; i++) {
+		if (string(argv[i]).compare(0, 9, "--replay=") == 0) {
+			if (!options.parse(argc, argv)) return 1;
+			Editor replayEditor(options);
+			return replayEditor.replay(nullptr);
+		}
+		if (string(argv[i]).compare(0, 11, "--generate=") == 0) {
+			if (!options.parse(argc, argv)) return 1;
+			Editor generator(options);
+			return generator.generate();
+		}
+	}
+
 	// Init glut
 	glutInit(&argc, argv);
+	if (!options.parse(argc, argv)) return 1;
+	editor.reset(new Editor(options));
 
 	// Center window
-	glutInitWindowPosition(1280/2, 720/2);
+	glutInitWindowPosition(Editor::WINDOW_WIDTH / 2, Editor::WINDOW_HEIGHT / 2);
 	// Set window size (16:9 ratio)
-	glutInitWindowSize(1280, 720);
+	glutInitWindowSize(Editor::WINDOW_WIDTH, Editor::WINDOW_HEIGHT);
 
 	// Set display mode: RGBA, Double buffered, depth buffer
 	glutInitDisplayMode(GLUT_RGBA | GLUT_DOUBLE | GLUT_DEPTH);
-	// Enable depth testing 
+	// Enable depth testing
 	glEnable(GL_DEPTH_TEST);
 
 	// Create window
@@ -83,7 +80,6 @@ int main(int argc, char* argv[]) {
 	// Register glut callback functions
 	glutDisplayFunc(display);
 	glutReshapeFunc(reshape);
-	glutIdleFunc(idle);
 	glutMouseFunc(mouseFunc);
 	glutMotionFunc(mouseMotion);
 	glutKeyboardFunc(keyboardFunc);
@@ -91,70 +87,25 @@ int main(int argc, char* argv[]) {
 	glutSpecialFunc(specialFunc);
 	glutSpecialUpFunc(specialUpFunc);
 
-	// Init program specific settings
-	init();
+	// Load the save and start autosaving
+	editor->start();
+	scheduler.reset(new FrameScheduler(options.updateRate, options.frameRate, RenderSnapshot::DETAIL_FULL));
+	// From here the editor is only used by the update thread, this thread passes it input and draws its snapshots
+	if (options.splitThreads) {
+		updateThread.reset(new UpdateThread(*editor));
+		updateThread->start(static_cast<unsigned long long>(scheduler->getUpdateStep() * 1e6));
+	}
+
+	// Frames are paced by a timer, so the loop waits for input rather than for the next frame
+	glutTimerFunc(0, frameTimer, 0);
 
 	// Save on exit
 	atexit(save);
 
 	// Enter glut main loop
 	glutMainLoop();
-	
-	return 0;
-}
-
-/**
-* Init program specific settings
-*/
-void init() {
-	// Load save
-	load();
-
-	// Key mappings
-	keyMappings[Action::A_MODIFIER] = ' '; // Held to switch from shape to view manipulation
-	keyMappings[Action::A_ADD] = 'a';
-	keyMappings[Action::A_DUPLICATE] = 'd';
-	keyMappings[Action::A_DELETE] = 'x';
-	keyMappings[Action::A_MORPH_UP] = 'w';
-	keyMappings[Action::A_MORPH_DOWN] = 's';
-	keyMappings[Action::A_COLOUR_RED] = 'r';
-	keyMappings[Action::A_COLOUR_GREEN] = 'g';
-	keyMappings[Action::A_COLOUR_BLUE] = 'b';
-	keyMappings[Action::A_CLEAR] = '\b';
-
-	mouseMappings[Action::A_PAN] = GLUT_RIGHT_BUTTON;
-	mouseMappings[Action::A_TRANSLATE] = GLUT_RIGHT_BUTTON;
-	mouseMappings[Action::A_ROTATE] = GLUT_LEFT_BUTTON;
-	mouseMappings[Action::A_SCALE] = GLUT_MIDDLE_BUTTON;
-	mouseMappings[Action::A_ZOOM] = GLUT_MIDDLE_BUTTON;
-
-	// Create shape types, from triangle to decagon, for cycling through when the up and down arrow keys are pressed
-	unique_ptr<Shape> shape;
-	// Examples of RegularPolygon child classes
-	shape.reset(new Triangle(DEFAULT_RADIUS, Point(0, 0)));
-	shapeTypes.push_back(std::move(shape));
-
-	shape.reset(new Square(DEFAULT_RADIUS, Point(0, 0)));
-	shapeTypes.push_back(std::move(shape));
 
-	shape.reset(new Pentagon(DEFAULT_RADIUS, Point(0, 0)));
-	shapeTypes.push_back(std::move(shape));
-
-	// Examples of instantiating a RegularPolygon directly
-	shape.reset(new RegularPolygon("Hexagon", 6, DEFAULT_RADIUS, Point(0, 0)));
-	shapeTypes.push_back(std::move(shape));
-
-	shape.reset(new RegularPolygon("Heptagon", 7, DEFAULT_RADIUS, Point(0, 0)));
-	shapeTypes.push_back(std::move(shape));
-
-	shape.reset(new RegularPolygon("Octagon", 8, DEFAULT_RADIUS, Point(0, 0)));
-	shapeTypes.push_back(std::move(shape));
-
-	shape.reset(new RegularPolygon("Nonagon", 9, DEFAULT_RADIUS, Point(0, 0)));
-	shapeTypes.push_back(std::move(shape));
-
-	shape.reset(new RegularPolygon("Decagon", 10, DEFAULT_RADIUS, Point(0, 0)));
-	shapeTypes.push_back(std::move(shape));
+	return 0;
 }
 
 
@@ -162,50 +113,21 @@ void init() {
 * GLUT display callback. Triggered depending on the window redisplay state
 */
 void display() {
-	// Set the background colour to white
-	glClearColor(1, 1, 1, 1);
-	// Clear the colour and depth buffers
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-	// Switch to model matrix for drawing
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-	glPushMatrix();
-		// Scale view by zoom amount
-		glScalef(sceneSettings.zoom, sceneSettings.zoom, 1);
-		// Translate the view by the pan amount
-		glTranslatef(sceneSettings.panX, sceneSettings.panY, 0);
-		// Update and render Shapes
-		shapeManager.update();
-		// Save translated model matrix for mouse mapping before resetting 
-		mouse.updateModelMatrix();
-	glPopMatrix();
-
-	// Draw UI
-	glPushMatrix();
-		// Render text in top left of the screen
-		int lineHeight = 15;
-		float x = -CAMERA_WIDTH/2;
-		float y = -CAMERA_HEIGHT / 2 + lineHeight;
-		// Calculate zoom percentage
-		int zoom = ((CAMERA_WIDTH * sceneSettings.zoom) / CAMERA_WIDTH) * 100;
-		// Draw zoom and pan text
-		string strZoom = "Zoom: " + std::to_string(zoom) + "%";
-		string strPan = "Pan: " + std::to_string(sceneSettings.panX) + ", " + std::to_string(sceneSettings.panY);
-		Utils::renderString(x, y, strZoom);
-		Utils::renderString(x, y += lineHeight, strPan);
-		// Draw selected shape settings
-		if (selectedShape) {
-			Utils::renderString(x, y += lineHeight * 2, "Name: " + selectedShape->getName());
-			Utils::renderString(x, y += lineHeight, "Scale: " + std::to_string(selectedShape->getScale()));
-			Utils::renderString(x, y += lineHeight, "Rotation: " + std::to_string(selectedShape->getRotation()));
-			Utils::renderString(x, y += lineHeight, "Position: " + std::to_string(selectedShape->getPosition().x) + ", " + std::to_string(selectedShape->getPosition().y));
-		}
-	glPopMatrix();
-
-	// Swap buffers 
+	Trace::Scope span("display");
+	scheduler->beginFrame();
+	RenderSnapshot::Detail detail = static_cast<RenderSnapshot::Detail>(scheduler->getDetail());
+	// Frame time statistics are shown in the editor's HUD, from the next capture
+	if (updateThread) {
+		updateThread->setFrameStats(scheduler->getStats());
+		updateThread->render(glRenderer, detail);
+	} else {
+		editor->setFrameStats(scheduler->getStats());
+		editor->render(glRenderer, detail);
+	}
+	// Swap buffers
 	// (move contents of the back buffer to front buffer and clear back buffer)
 	glutSwapBuffers();
+	scheduler->endFrame();
 }
 
 /**
@@ -215,187 +137,93 @@ void display() {
 */
 void reshape(int w, int h) {
 	// Window height cannot be 0, also prevents dividing by 0 when calculating the ratio
-	if (h == 0) h = 1;
-	float ratio = 1.0 * w/h;
+	int viewportHeight = (h == 0)? 1 : h;
 
 	// Switch to projection matrix for camera manipulation
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
 	// Fit viewport to window
-	glViewport(0, 0, w, h);
+	glViewport(0, 0, w, viewportHeight);
 	// Orthographic camera for 2D with 0,0 at center of screen so zooming is done from the center of the view
-	glOrtho(-CAMERA_WIDTH / 2, CAMERA_WIDTH / 2, CAMERA_HEIGHT / 2, -CAMERA_HEIGHT / 2, 0, 2);
-	// Save updated projection matrix for mouse mapping
-	mouse.updateProjectionMatrix();
+	glOrtho(-Editor::CAMERA_WIDTH / 2, Editor::CAMERA_WIDTH / 2, Editor::CAMERA_HEIGHT / 2, -Editor::CAMERA_HEIGHT / 2, 0, 2);
 
 	// Switch back to model view matrix (default)
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
+
+	handle(InputEvent(InputEvent::RESHAPE, w, h));
 }
 
 /**
-* GLUT idle callback continuously called when no window events are being processed
+* GLUT timer callback, runs the updates due and redraws if there's anything new, then waits until the next frame is due.
+* Input is still handled as it arrives while waiting
 */
-void idle() {
-	// Set the window redisplay state so display will be called
-	glutPostRedisplay();
+void frameTimer(int value) {
+	if (!updateThread) {
+		for (int steps = scheduler->takeUpdateSteps(); steps > 0; steps--) editor->update();
+	}
+	if (hasNewFrame()) {
+		// With an unlimited frame rate, frames are drawn back to back from the idle callback until there's nothing new
+		if (scheduler->getFrameInterval() > 0) glutPostRedisplay();
+		else glutIdleFunc(idle);
+	}
+	glutTimerFunc(scheduler->takeFrameDelay(), frameTimer, 0);
 }
 
-void save() {
-	saveManager.startSave("save.txt");
-	saveManager.startSection("scene");
-	saveManager.addValue("zoom", sceneSettings.zoom);
-	saveManager.addValue("pan_x", sceneSettings.panX);
-	saveManager.addValue("pan_y", sceneSettings.panY);
-	saveManager.endSection();
-
-	shapeManager.save(saveManager);
+/**
+* GLUT idle callback continuously called when no window events are being processed, only registered while frames are drawn
+* as fast as possible and there's something new to draw
+*/
+void idle() {
+	if (!updateThread) {
+		for (int steps = scheduler->takeUpdateSteps(); steps > 0; steps--) editor->update();
+	}
+	// Set the window redisplay state so display will be called, otherwise leave the loop waiting for input or the frame timer
+	if (hasNewFrame()) glutPostRedisplay();
+	else glutIdleFunc(nullptr);
+}
 
-	saveManager.stopSave();
+/**
+* Returns: bool  True if the update thread has published a snapshot or the editor has changed since the last frame
+*/
+bool hasNewFrame() {
+	return updateThread? updateThread->hasNewSnapshot() : editor->isDirty();
 }
 
-void load() {
-	if (saveManager.load("save.txt")) {
-		//saveManager.prettyPrint();
-		map<string, string>& vals = saveManager.getSectionValues("scene");
-		sceneSettings.zoom = std::stof(vals["zoom"]);
-		sceneSettings.panX = std::stof(vals["pan_x"]);
-		sceneSettings.panY = std::stof(vals["pan_y"]);
+void save() {
+	// Stop updating first, the final save is made on this thread
+	if (updateThread) updateThread->stop();
+	editor->save();
+}
 
-		shapeManager.load(saveManager);
-	}
+/**
+* Passes an input event to the update thread, or straight to the editor when running on a single thread
+*/
+void handle(const InputEvent& event) {
+	if (updateThread) updateThread->post(event);
+	else editor->dispatch(event);
+	// Draw input straight away when the frame rate is unlimited, rather than when the frame timer next checks
+	if (scheduler && scheduler->getFrameInterval() <= 0) glutIdleFunc(idle);
 }
 
+// Input callbacks, GLUT's button, state and key codes are the same as InputCodes
 void mouseFunc(int button, int state, int x, int y) {
-	// Delegate to Mouse instance
-	mouse.onClick(button, state, x, y);
-	// When releasing a button, selected shape should be set to null, otherwise get the shape under the mouse
-	lastSelectedShape = selectedShape;
-	selectedShape = (state == GLUT_UP)? nullptr : shapeManager.getShapeAt(mouse.getPosition().x, mouse.getPosition().y);
-	if (selectedShape) {
-		// Bring the selected shape to the front and show it's outline
-		shapeManager.bringToFront(selectedShape);
-		selectedShape->setOutlineVisible(true);
-	} else if (lastSelectedShape) {
-		// Hide the outline of the last shape
-		lastSelectedShape->setOutlineVisible(false);
-	}
+	handle(InputEvent(InputEvent::MOUSE, button, state, x, y));
 }
 void mouseMotion(int x, int y) {
-	// Delegate to Mouse instance
-	mouse.onMove(x, y);
-
-	// Using mouse screen position for input, rather than object position provides, a much smoother input experience 
-	// and avoids potentially large floating point number arithmetic
-	if (selectedShape) {
-		if (mouse.isButtonPressed(mouseMappings[Action::A_TRANSLATE]) 
-			&& !keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
-			// Use mouse object position for placing shapes
-			selectedShape->setPosition(mouse.getPosition().x, mouse.getPosition().y);
-		}
-		else if (mouse.isButtonPressed(mouseMappings[Action::A_ROTATE])
-				 && !keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
-			selectedShape->rotateBy(mouse.getScreenPosition().x - mouse.getPrevScreenPosition().x);
-		}
-		else if (mouse.isButtonPressed(mouseMappings[Action::A_SCALE])
-				 && !keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
-			selectedShape->increaseScale((mouse.getScreenPosition().x - mouse.getPrevScreenPosition().x) * 0.01);
-		}
-	}
-	if (mouse.isButtonPressed(mouseMappings[Action::A_PAN])
-			 && keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
-		// Pan when the pan button and modifier key are pressed
-		sceneSettings.panX += mouse.getScreenPosition().x - mouse.getPrevScreenPosition().x;
-		sceneSettings.panY += mouse.getScreenPosition().y - mouse.getPrevScreenPosition().y;
-	}
-	else if (mouse.isButtonPressed(mouseMappings[Action::A_ZOOM])
-		&& keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
-		// Zoom when the zoom button and modifier key are pressed
-		sceneSettings.zoom += (mouse.getPrevScreenPosition().y - mouse.getScreenPosition().y) * 0.002;
-		// Clamp max zoom at 1000% and min zoom at 1%
-		if (sceneSettings.zoom < 0.01) sceneSettings.zoom = 0.01;
-		else if (sceneSettings.zoom > 10) sceneSettings.zoom = 10;
-	}
+	handle(InputEvent(InputEvent::MOTION, x, y));
 }
 
 void keyboardFunc(unsigned char key, int x, int y) {
-	keyboard.keyboardFunc(key, x, y);
-	// Since key presses get repeated when held, the mouse position shouldn't be updated when the modifier key is pressed
-	// as it causes the position delta fluctuate too much making view manipulation less smooth
-	if (key != keyMappings[Action::A_MODIFIER]) mouse.onMove(x, y);
-
-	if (keyboard.isKeyDown(keyMappings[Action::A_ADD])) {
-		// Add a pentagon at the mouse location
-		std::cout << "Adding Shape" << std::endl;
-		shapeManager.add(new Pentagon(DEFAULT_RADIUS, Point(mouse.getPosition().x, mouse.getPosition().y)));
-	}
-	else if (keyboard.isKeyDown(keyMappings[Action::A_CLEAR])) {
-		// Clear shapes
-		shapeManager.clear();
-		selectedShape = nullptr;
-	}
-	else if (keyboard.isKeyDown(keyMappings[Action::A_DUPLICATE]) && selectedShape) {
-		// Duplicate shape
-		Shape* s = new RegularPolygon(selectedShape);
-		// Randomly offset (between -30 and 30) slightly to visualise the duplication
-		int randRange = 30 - -30 + 1;
-		s->translate(rand() % randRange + -30, rand() % randRange + -30);
-		shapeManager.add(s);
-	}
-	else if (keyboard.isKeyDown(keyMappings[Action::A_DELETE]) && selectedShape) {
-		shapeManager.remove(selectedShape);
-		selectedShape = nullptr;
-	}
-	// Colour change keys
-	else if (keyboard.isKeyDown(keyMappings[Action::A_COLOUR_RED]) && selectedShape) {
-		// Red
-		selectedShape->setColour(0.9, 0.12, 0.25);
-	}
-	else if (keyboard.isKeyDown(keyMappings[Action::A_COLOUR_GREEN]) && selectedShape) {
-		// Green
-		selectedShape->setColour(0.64, 0.91, 0.12);
-	}
-	else if (keyboard.isKeyDown(keyMappings[Action::A_COLOUR_BLUE]) && selectedShape) {
-		// Blue
-		selectedShape->setColour(0.12, 0.64, 0.9);
-	}
-	// Cycle through shapes when w or s key is pressed
-	else if (selectedShape && (keyboard.isKeyDown(keyMappings[Action::A_MORPH_UP]) || keyboard.isKeyDown(keyMappings[Action::A_MORPH_DOWN]))
-		     && !keyboard.isKeyDown(keyMappings[Action::A_MODIFIER])) {
-		// Whether the shape type should be cycled in reverse
-		bool reverse = false;
-		if (keyboard.isKeyDown(keyMappings[Action::A_MORPH_DOWN])) reverse = true;
-
-		// Iterate over map of shape types
-		for (vector<unique_ptr<Shape>>::iterator it = shapeTypes.begin(); it != shapeTypes.end(); it++) {
-			// If the selected shape is the same as the current shape type
-			if (selectedShape->getName() == (*it)->getName()) {
-				if (reverse) {
-					// If cycling in reverse, and the iterator is at the beginning of the map, wrap around to the end
-					if (it == shapeTypes.begin()) it = shapeTypes.end();
-					// Minus one from the iterator to get the shapeType in front of the current shape in the map
-					it--;
-				}
-				// If the next iteration is the end of the map, wrap around to the beginning of the map
-				else if (++it == shapeTypes.end()) it = shapeTypes.begin();
-				// Morph the shape to the next shape type
-				selectedShape->morph((*it).get());
-				break;
-			}
-		}
-	}
+	handle(InputEvent(InputEvent::KEY_DOWN, key, x, y));
 }
 void keyboardUpFunc(unsigned char key, int x, int y) {
-	keyboard.keyboardUpFunc(key, x, y);
-	mouse.onMove(x, y);
+	handle(InputEvent(InputEvent::KEY_UP, key, x, y));
 }
 
 void specialFunc(int key, int x, int y) {
-	keyboard.specialFunc(key, x, y);
-	mouse.onMove(x, y);
-	
+	handle(InputEvent(InputEvent::SPECIAL_DOWN, key, x, y));
 }
 void specialUpFunc(int key, int x, int y) {
-	keyboard.specialUpFunc(key, x, y);
-	mouse.onMove(x, y);
-}
\ No newline at end of file
+	handle(InputEvent(InputEvent::SPECIAL_UP, key, x, y));
+}